@@ -43,6 +43,7 @@ set(APP_COMMON_LINK_LIBRARIES
     rtos::freertos_usb
     rtos::drivers::custom_i2s_with_rate_calc
     lib_src
+    spsc_ring
 )
 
 #**********************
@@ -50,3 +51,4 @@ set(APP_COMMON_LINK_LIBRARIES
 #**********************
 include(${CMAKE_CURRENT_LIST_DIR}/src/i2s_driver/i2s_driver.cmake)
 include(${CMAKE_CURRENT_LIST_DIR}/asrc_demo_ua.cmake)
+include(${CMAKE_CURRENT_LIST_DIR}/asrc_demo_low_latency.cmake)
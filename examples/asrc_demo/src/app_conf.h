@@ -1,4 +1,4 @@
-// Copyright 2022-2023 XMOS LIMITED.
+// Copyright 2022-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #ifndef APP_CONF_H_
@@ -151,4 +151,93 @@
 
 #define NUM_I2S_CHANS (2)
 
+/* Threads sharing the channels of the ASRC in each direction, including the
+ * ASRC task itself. Each thread runs its group of channels as one lib_src
+ * instance. */
+#ifndef appconfI2S_TO_USB_ASRC_WORKERS
+#define appconfI2S_TO_USB_ASRC_WORKERS  2
+#endif
+
+#ifndef appconfUSB_TO_I2S_ASRC_WORKERS
+#define appconfUSB_TO_I2S_ASRC_WORKERS  2
+#endif
+
+/* Low latency USB -> I2S bridging. The I2S send buffer is held at a small
+ * fixed fill instead of half full, and its level is controlled from the first
+ * short averaging window instead of after a stable average is found. */
+#ifndef appconfASRC_LOW_LATENCY
+#define appconfASRC_LOW_LATENCY                 0
+#endif
+
+/* I2S send buffer fill just after an ASRC output block is written. It has to
+ * cover one block, 2 ms, and the scheduling jitter. */
+#ifndef appconfASRC_LOW_LATENCY_I2S_FILL_US
+#define appconfASRC_LOW_LATENCY_I2S_FILL_US     3000
+#endif
+
+/* log2 of the number of ASRC output blocks averaged for the I2S send buffer level */
+#ifndef appconfASRC_LOW_LATENCY_AVG_WINDOW_LOG2
+#define appconfASRC_LOW_LATENCY_AVG_WINDOW_LOG2 6
+#endif
+
+/* Buffer level control in each direction. The gains are derived for each I2S
+ * rate from these times, see pi_control.h. They were chosen with the control
+ * loop models in test/asrc_sim, for the fastest settling after a 20 ppm rate
+ * step at every I2S rate, with up to 300 us of USB SOF jitter. The low latency
+ * mode has less room in the I2S send buffer, so corrects faster. */
+#ifndef appconfUSB_TO_I2S_PI_TIME_CONSTANT_MS
+#if appconfASRC_LOW_LATENCY
+#define appconfUSB_TO_I2S_PI_TIME_CONSTANT_MS   4000
+#else
+#define appconfUSB_TO_I2S_PI_TIME_CONSTANT_MS   5000
+#endif
+#endif
+
+#ifndef appconfUSB_TO_I2S_PI_INTEGRAL_TIME_MS
+#if appconfASRC_LOW_LATENCY
+#define appconfUSB_TO_I2S_PI_INTEGRAL_TIME_MS   16000
+#else
+#define appconfUSB_TO_I2S_PI_INTEGRAL_TIME_MS   10000
+#endif
+#endif
+
+#ifndef appconfI2S_TO_USB_PI_TIME_CONSTANT_MS
+#define appconfI2S_TO_USB_PI_TIME_CONSTANT_MS   5000
+#endif
+
+#ifndef appconfI2S_TO_USB_PI_INTEGRAL_TIME_MS
+#define appconfI2S_TO_USB_PI_INTEGRAL_TIME_MS   20000
+#endif
+
+/* Rate monitor updates summed by the integral terms. 0 sums all of them. */
+#ifndef appconfPI_INTEGRATOR_WINDOW
+#define appconfPI_INTEGRATOR_WINDOW             0
+#endif
+
+/* Largest rate ratio correction. It has to cover the clock error between the
+ * USB host and the I2S master, which is not known before the rate monitor
+ * has run. */
+#ifndef appconfPI_MAX_CORRECTION_PPM
+#define appconfPI_MAX_CORRECTION_PPM            50
+#endif
+
+/* log2 of the number of ASRC output blocks averaged for the buffer level, and
+ * the number of further averages before the set point is taken. The window
+ * has to be short against the time constant, or the loop rings. */
+#ifndef appconfUSB_TO_I2S_AVG_WINDOW_LOG2
+#define appconfUSB_TO_I2S_AVG_WINDOW_LOG2       9
+#endif
+
+#ifndef appconfUSB_TO_I2S_AVG_STABLE_THRESHOLD
+#define appconfUSB_TO_I2S_AVG_STABLE_THRESHOLD  2
+#endif
+
+#ifndef appconfI2S_TO_USB_AVG_WINDOW_LOG2
+#define appconfI2S_TO_USB_AVG_WINDOW_LOG2       8
+#endif
+
+#ifndef appconfI2S_TO_USB_AVG_STABLE_THRESHOLD
+#define appconfI2S_TO_USB_AVG_STABLE_THRESHOLD  2
+#endif
+
 #endif /* APP_CONF_H_ */
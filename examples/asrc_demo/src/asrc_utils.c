@@ -1,4 +1,4 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 /* STD headers */
 #include <string.h>
@@ -9,8 +9,6 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "timers.h"
-#include "queue.h"
-#include "stream_buffer.h"
 
 /* App headers */
 #include "app_conf.h"
@@ -45,17 +43,171 @@ fs_code_t samp_rate_to_code(unsigned samp_rate){
 }
 
 
-void asrc_one_channel_task(void *args)
+static void asrc_mc_run(asrc_mc_t *mc, asrc_mc_worker_t *w)
 {
-    asrc_init_t *asrc_init_ctx = args;
+    const unsigned n_channels = mc->n_channels;
 
-    for(;;)
+    if (mc->job == ASRC_MC_JOB_INIT)
     {
-        asrc_process_frame_ctx_t *asrc_ctx = NULL;
-        (void) rtos_osal_queue_receive(&asrc_init_ctx->asrc_queue, &asrc_ctx, RTOS_OSAL_WAIT_FOREVER);
+        w->nominal_fs_ratio = asrc_init(mc->in_fs_code, mc->out_fs_code, w->ctrl, w->n_ch, mc->n_in_samples, ASRC_DITHER_SETTING);
+        return;
+    }
+
+    if (mc->n_workers == 1)
+    {
+        // The instance has all the channels, so it works on the interleaved frames directly
+        w->n_out = asrc_process((int *)mc->job_in, (int *)mc->job_out, mc->job_fs_ratio, w->ctrl);
+        return;
+    }
+
+    for (int i = 0; i < mc->n_in_samples; i++)
+    {
+        for (int ch = 0; ch < w->n_ch; ch++)
+        {
+            w->in[i * w->n_ch + ch] = mc->job_in[i * n_channels + w->first_ch + ch];
+        }
+    }
+
+    w->n_out = asrc_process((int *)w->in, (int *)w->out, mc->job_fs_ratio, w->ctrl);
+
+    for (int i = 0; i < w->n_out; i++)
+    {
+        for (int ch = 0; ch < w->n_ch; ch++)
+        {
+            mc->job_out[i * n_channels + w->first_ch + ch] = w->out[i * w->n_ch + ch];
+        }
+    }
+}
+
+static void asrc_mc_worker_task(void *args)
+{
+    asrc_mc_worker_t *w = args;
+
+    for (;;)
+    {
+        (void) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        asrc_mc_run(w->mc, w);
+        w->done_seq = w->mc->seq;
+    }
+}
+
+/*
+ * Runs the posted job on every worker and returns once all of them are done.
+ * The workers get through a block in about the same time, so the caller
+ * polls for the others to finish rather than blocking on a queue.
+ */
+static void asrc_mc_dispatch(asrc_mc_t *mc)
+{
+    const uint32_t seq = mc->seq + 1;
+
+    mc->seq = seq;
+    for (int i = 1; i < mc->n_workers; i++)
+    {
+        xTaskNotifyGive(mc->workers[i].task);
+    }
+
+    asrc_mc_run(mc, &mc->workers[0]);
+
+    for (int i = 1; i < mc->n_workers; i++)
+    {
+        while (mc->workers[i].done_seq != seq)
+        {
+            taskYIELD();
+        }
+    }
+}
 
-        unsigned n_samps_out = asrc_process((int *)asrc_ctx->input_samples, (int *)asrc_ctx->output_samples, asrc_ctx->fs_ratio, asrc_init_ctx->asrc_ctrl_ptr);
+void asrc_mc_init(asrc_mc_t *mc, unsigned n_channels, unsigned n_workers,
+                  unsigned n_in_samples, unsigned n_out_samples_max, unsigned priority)
+{
+    xassert(n_channels > 0 && n_channels <= ASRC_MC_MAX_CHANNELS);
+    xassert(n_workers > 0 && n_workers <= ASRC_MC_MAX_WORKERS);
 
-        (void) rtos_osal_queue_send(&asrc_init_ctx->asrc_ret_queue, &n_samps_out, RTOS_OSAL_WAIT_FOREVER);
+    if (n_workers > n_channels)
+    {
+        n_workers = n_channels;
     }
+
+    memset(mc, 0, sizeof(*mc));
+    mc->n_channels = n_channels;
+    mc->n_workers = n_workers;
+    mc->n_in_samples = n_in_samples;
+    mc->n_out_samples_max = n_out_samples_max;
+
+    unsigned first_ch = 0;
+    for (int i = 0; i < n_workers; i++)
+    {
+        asrc_mc_worker_t *w = &mc->workers[i];
+
+        // Spread the remainder over the first workers
+        w->mc = mc;
+        w->first_ch = first_ch;
+        w->n_ch = n_channels / n_workers + (i < n_channels % n_workers ? 1 : 0);
+        first_ch += w->n_ch;
+
+        w->ctrl = rtos_osal_malloc(w->n_ch * sizeof(asrc_ctrl_t));
+        w->state = rtos_osal_malloc(w->n_ch * sizeof(asrc_state_t));
+        w->adfir_coefs = rtos_osal_malloc(sizeof(asrc_adfir_coefs_t));
+        w->stack = rtos_osal_malloc(w->n_ch * ASRC_STACK_LENGTH_MULT * n_in_samples * sizeof(int));
+        xassert(w->ctrl != NULL && w->state != NULL && w->adfir_coefs != NULL && w->stack != NULL);
+
+        for (int ch = 0; ch < w->n_ch; ch++)
+        {
+            //Set state, stack and coefs into ctrl structure
+            w->ctrl[ch].psState = &w->state[ch];
+            w->ctrl[ch].piStack = &w->stack[ch * ASRC_STACK_LENGTH_MULT * n_in_samples];
+            w->ctrl[ch].piADCoefs = w->adfir_coefs->iASRCADFIRCoefs;
+        }
+
+        if (n_workers > 1)
+        {
+            w->in = rtos_osal_malloc(w->n_ch * n_in_samples * sizeof(int32_t));
+            w->out = rtos_osal_malloc(w->n_ch * n_out_samples_max * sizeof(int32_t));
+            xassert(w->in != NULL && w->out != NULL);
+        }
+
+        if (i > 0)
+        {
+            BaseType_t ret = xTaskCreate((TaskFunction_t)asrc_mc_worker_task,
+                                         "asrc_worker",
+                                         RTOS_THREAD_STACK_SIZE(asrc_mc_worker_task),
+                                         w,
+                                         priority,
+                                         &w->task);
+            xassert(ret == pdPASS);
+        }
+    }
+}
+
+uint64_t asrc_mc_set_rates(asrc_mc_t *mc, unsigned fs_in, unsigned fs_out)
+{
+    mc->job = ASRC_MC_JOB_INIT;
+    mc->in_fs_code = samp_rate_to_code(fs_in);  //Sample rate code 0..5
+    mc->out_fs_code = samp_rate_to_code(fs_out);
+    asrc_mc_dispatch(mc);
+
+    // Every instance has the same rates, so the same nominal ratio
+    return mc->workers[0].nominal_fs_ratio;
+}
+
+unsigned asrc_mc_process(asrc_mc_t *mc, int32_t *in, int32_t *out, uint64_t fs_ratio)
+{
+    mc->job = ASRC_MC_JOB_PROCESS;
+    mc->job_in = in;
+    mc->job_out = out;
+    mc->job_fs_ratio = fs_ratio;
+    asrc_mc_dispatch(mc);
+
+    const unsigned n_out = mc->workers[0].n_out;
+    for (int i = 1; i < mc->n_workers; i++)
+    {
+        if (mc->workers[i].n_out != n_out)
+        {
+            rtos_printf("Error: ASRC workers returned different number of samples: worker 0 %u, worker %d %u\n", n_out, i, mc->workers[i].n_out);
+            xassert(0);
+        }
+    }
+    xassert(n_out <= mc->n_out_samples_max);
+
+    return n_out;
 }
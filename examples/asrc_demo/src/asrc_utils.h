@@ -1,4 +1,4 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #ifndef ASRC_UTILS_H
 #define ASRC_UTILS_H
@@ -6,35 +6,108 @@
 #include <stdint.h>
 /* FreeRTOS headers */
 #include "FreeRTOS.h"
-#include "queue.h"
+#include "task.h"
 #include "src.h"
 
-typedef struct
-{
-    /* data */
-    int32_t *input_samples;
-    int32_t *output_samples;
-    uint64_t fs_ratio;
-    unsigned i2s_sampling_rate;
-}asrc_process_frame_ctx_t;
-
-
-typedef struct {
-    uint32_t fs_in;
-    uint32_t fs_out;
-    uint32_t n_in_samples;
-    asrc_ctrl_t *asrc_ctrl_ptr;
-    rtos_osal_queue_t asrc_queue;
-    rtos_osal_queue_t asrc_ret_queue;
-}asrc_init_t;
-
 #define USB_TO_I2S_ASRC_BLOCK_LENGTH (96)
 #define I2S_TO_USB_ASRC_BLOCK_LENGTH (244)  // Found out from simulation. Relatively jitter free average buffer levels seen with 244 samples block than 240 samples block size
 #define ASRC_N_CHANNELS              (1)
 #define ASRC_CHANNELS_PER_INSTANCE   (1)
 #define ASRC_DITHER_SETTING          OFF
 
+/* Most channels and worker threads that one multi-channel ASRC can have */
+#define ASRC_MC_MAX_CHANNELS         (8)
+#define ASRC_MC_MAX_WORKERS          (4)
+
+typedef enum {
+    ASRC_MC_JOB_INIT,
+    ASRC_MC_JOB_PROCESS,
+} asrc_mc_job_t;
+
+typedef struct asrc_mc_struct asrc_mc_t;
+
+/* One lib_src instance, processing a contiguous group of the channels */
+typedef struct {
+    asrc_mc_t *mc;
+    unsigned first_ch;
+    unsigned n_ch;
+    asrc_ctrl_t *ctrl;
+    asrc_state_t *state;
+    asrc_adfir_coefs_t *adfir_coefs;    // Shared by the channels of the instance
+    int *stack;
+    int32_t *in;                        // Channel group of the input, when there is more than one worker
+    int32_t *out;                       // Channel group of the output, when there is more than one worker
+    unsigned n_out;
+    uint64_t nominal_fs_ratio;
+    TaskHandle_t task;
+    volatile uint32_t done_seq;         // seq of the last job this worker finished
+} asrc_mc_worker_t;
+
+/**
+ * Multi-channel ASRC.
+ *
+ * Processes interleaved frames of n_channels with one fs_ratio. The channels
+ * are split into n_workers groups, each run as one lib_src instance so that
+ * the channels of a group share the phase and adaptive filter computation
+ * and only keep their own FIR state. Worker 0 is the calling thread, the
+ * others are threads created by asrc_mc_init(). They are started with a task
+ * notification and the caller then waits for all of them to finish the
+ * block.
+ *
+ * With a single worker the interleaved frame is processed in place, without
+ * any copy or thread handoff.
+ */
+struct asrc_mc_struct {
+    unsigned n_channels;
+    unsigned n_workers;
+    unsigned n_in_samples;
+    unsigned n_out_samples_max;
+
+    /* Job for the workers, written by the calling thread before seq is bumped */
+    asrc_mc_job_t job;
+    fs_code_t in_fs_code;
+    fs_code_t out_fs_code;
+    int32_t *job_in;
+    int32_t *job_out;
+    uint64_t job_fs_ratio;
+    volatile uint32_t seq;
+
+    asrc_mc_worker_t workers[ASRC_MC_MAX_WORKERS];
+};
+
 fs_code_t samp_rate_to_code(unsigned samp_rate);
-void asrc_one_channel_task(void *args);
+
+/**
+ * Allocate a multi-channel ASRC and create its worker threads.
+ *
+ * \param mc                The ASRC.
+ * \param n_channels        Number of interleaved channels, at most ASRC_MC_MAX_CHANNELS.
+ * \param n_workers         Number of threads to split the channels across,
+ *                          including the calling thread. Limited to n_channels.
+ * \param n_in_samples      Input samples per channel in every block.
+ * \param n_out_samples_max Most output samples per channel that a block can produce.
+ * \param priority          Priority of the worker threads. They should be able to
+ *                          run on other cores than the calling thread.
+ */
+void asrc_mc_init(asrc_mc_t *mc, unsigned n_channels, unsigned n_workers,
+                  unsigned n_in_samples, unsigned n_out_samples_max, unsigned priority);
+
+/**
+ * (Re)initialise every channel for a new pair of sample rates. The
+ * instances are initialised in parallel by the workers.
+ *
+ * \return The nominal fs_ratio for asrc_mc_process().
+ */
+uint64_t asrc_mc_set_rates(asrc_mc_t *mc, unsigned fs_in, unsigned fs_out);
+
+/**
+ * Run ASRC on one block of interleaved samples.
+ *
+ * \param in        n_in_samples frames of n_channels.
+ * \param out       Room for n_out_samples_max frames of n_channels.
+ * \param fs_ratio  Ratio of the input to the output rate, as for asrc_process().
+ * \return          Number of output frames.
+ */
+unsigned asrc_mc_process(asrc_mc_t *mc, int32_t *in, int32_t *out, uint64_t fs_ratio);
 
 #endif
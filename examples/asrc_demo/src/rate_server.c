@@ -1,4 +1,4 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #define DEBUG_UNIT RATE_SERVER
 #define DEBUG_PRINT_ENABLE_RATE_SERVER 0
@@ -27,7 +27,8 @@
 #include "rate_server.h"
 #include "avg_buffer_level.h"
 #include "tusb.h"
-#include "div.h"
+#include "rate_estimator.h"
+#include "pi_control.h"
 
 #define LOG_I2S_TO_USB_SIDE (0)
 #define LOG_USB_TO_I2S_SIDE (0)
@@ -39,6 +40,7 @@ static bool g_spkr_itf_close_to_open = false; // Flag tracking if a USB spkr int
                                        // USB. Cleared in usb_to_i2s_intertile, after it resets the i2s send buffer
 
 static buffer_calc_state_t g_i2s_send_buf_state;
+static int32_t g_i2s_send_buf_level_ref = 0; // Fill that g_i2s_send_buf_state levels are counted from
 
 bool get_spkr_itf_close_open_event()
 {
@@ -65,29 +67,54 @@ void set_i2s_to_usb_rate_ratio(uint64_t ratio)
 // Wrapper functions to avoid having g_i2s_send_buf_state visible in i2s_audio.c
 void init_calc_i2s_buffer_level_state(void)
 {
-   // The window size and buffer_level_stable_threahold are calculated using the simulation
-   // framework to ensure that they are large enough that we get stable windowed averages
-    int32_t window_size_log2 = 10;
-    init_calc_buffer_level_state(&g_i2s_send_buf_state, window_size_log2, 8);
+#if appconfASRC_LOW_LATENCY
+    // The set point is fixed, so there is no stable average to wait for
+    init_calc_buffer_level_state(&g_i2s_send_buf_state, appconfASRC_LOW_LATENCY_AVG_WINDOW_LOG2, 0);
+#else
+    init_calc_buffer_level_state(&g_i2s_send_buf_state, appconfUSB_TO_I2S_AVG_WINDOW_LOG2, appconfUSB_TO_I2S_AVG_STABLE_THRESHOLD);
+#endif
 }
 
-void calc_avg_i2s_send_buffer_level(int32_t current_buffer_level, bool reset)
+void calc_avg_i2s_send_buffer_level(int32_t current_buffer_level, int32_t level_ref, bool reset)
 {
+    g_i2s_send_buf_level_ref = level_ref;
     calc_avg_buffer_level(&g_i2s_send_buf_state, current_buffer_level, reset);
 }
 
-static float_s32_t determine_avg_I2S_rate_from_driver()
+// Error of the I2S send buffer level from its set point. Returns false while there isn't one.
+static bool get_i2s_send_buffer_error(int32_t *error)
+{
+#if appconfASRC_LOW_LATENCY
+    // Levels are counted from the fixed fill, which is the set point
+    *error = g_i2s_send_buf_state.avg_buffer_level;
+    return g_i2s_send_buf_state.flag_first_done;
+#else
+    *error = g_i2s_send_buf_state.avg_buffer_level - g_i2s_send_buf_state.stable_avg_level;
+    return g_i2s_send_buf_state.flag_stable_avg;
+#endif
+}
+
+// The levels are measured just after each ASRC output block is written, so on
+// average a sample waits for half a block less than the measured fill.
+static uint32_t get_i2s_send_buffer_latency_us(uint32_t i2s_nominal_rate)
 {
-    #define TOTAL_STORED_AVG_I2S_RATE (16)
-    static uint32_t data_lengths[TOTAL_STORED_AVG_I2S_RATE];
-    static uint32_t time_buckets[TOTAL_STORED_AVG_I2S_RATE];
-    static uint32_t current_data_bucket_size;
-    static bool buckets_full;
-    static uint32_t times_overflowed;
-    static float_s32_t previous_result = {.mant = 0, .exp = 0};
+    if((i2s_nominal_rate == 0) || (g_i2s_send_buf_state.flag_first_done == false))
+    {
+        return 0;
+    }
+    int32_t half_block = (USB_TO_I2S_ASRC_BLOCK_LENGTH * i2s_nominal_rate) / (2 * appconfUSB_AUDIO_SAMPLE_RATE);
+    int32_t fill = g_i2s_send_buf_level_ref + g_i2s_send_buf_state.avg_buffer_level - half_block;
+    if(fill <= 0)
+    {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)fill * 1000000) / i2s_nominal_rate);
+}
+
+static rate_estimate_t determine_avg_I2S_rate_from_driver()
+{
+    static rate_estimator_t i2s_rate_estimator;
     static uint32_t prev_nominal_sampling_rate = 0;
-    static uint32_t counter = 0;
-    static uint32_t timespan_current_bucket = 0;
 
     uint32_t timespan;
     uint32_t num_samples;
@@ -96,130 +123,58 @@ static float_s32_t determine_avg_I2S_rate_from_driver()
     uint32_t i2s_nominal_sampling_rate = rtos_i2s_get_nominal_sampling_rate(i2s_ctx);
     if(i2s_nominal_sampling_rate == 0)
     {
-        float_s32_t t = {.mant=0, .exp=0};
-        return t;
+        return (rate_estimate_t){0, 0};
     }
     else if(i2s_nominal_sampling_rate != prev_nominal_sampling_rate)
     {
         rtos_printf("determine_avg_I2S_rate_from_driver() I2S SR change detected, new_sr = %lu, prev_sr = %lu\n", i2s_nominal_sampling_rate, prev_nominal_sampling_rate);
-        counter = 0;
-        timespan_current_bucket = 0;
 
-        // Because we use "first_time" to also reset the rate determinator,
-        // reset all the static variables to default.
-        current_data_bucket_size = 0;
-        times_overflowed = 0;
-        buckets_full = false;
-
-        for (int i = 0; i < TOTAL_STORED_AVG_I2S_RATE; i++)
-        {
-            data_lengths[i] = 0;
-            time_buckets[i] = 0;
-        }
+        // 16 buckets of 16 calls each
+        const rate_estimator_config_t config = {
+            .nominal_rate = i2s_nominal_sampling_rate,
+            .ticks_per_second = REF_CLOCK_TICKS_PER_SECOND,
+            .n_buckets = 16,
+            .bucket_ticks = 0,
+            .bucket_updates = 16,
+            .outlier_shift = 3,
+            .max_outliers = 4,
+        };
+        rate_estimator_init(&i2s_rate_estimator, &config);
         prev_nominal_sampling_rate = i2s_nominal_sampling_rate;
-        float_s32_t a = {.mant=i2s_nominal_sampling_rate, .exp=0};
-        float_s32_t b = {.mant=REF_CLOCK_TICKS_PER_SECOND, .exp=0};
 
-        float_s32_t rate = float_div(a, b);
-        previous_result = rate;
-
-        return previous_result;
+        // Returns the nominal rate
+        return rate_estimator_get(&i2s_rate_estimator);
     }
-    else if(timespan == 0)
+    else if(timespan != 0)
     {
-        float_s32_t a = {.mant=prev_nominal_sampling_rate, .exp=0};
-        float_s32_t b = {.mant=REF_CLOCK_TICKS_PER_SECOND, .exp=0};
-
-        float_s32_t rate = float_div(a, b);
-        previous_result = rate;
-
-        return previous_result;
-
+        rate_estimator_add(&i2s_rate_estimator, timespan, num_samples);
     }
 
-    counter += 1;
-
-    current_data_bucket_size += num_samples;
-    timespan_current_bucket += timespan;
-
-    uint32_t total_data_intermed = current_data_bucket_size + sum_array(data_lengths, TOTAL_STORED_AVG_I2S_RATE);
-    uint32_t total_timespan = timespan_current_bucket + sum_array(time_buckets, TOTAL_STORED_AVG_I2S_RATE);
-
-    float_s32_t data_per_sample = float_div((float_s32_t){total_data_intermed, 0}, (float_s32_t){total_timespan, 0});
-
-    //float_s32_t data_per_sample1 = float_div((float_s32_t){num_samples, 0}, (float_s32_t){timespan, 0});
-
-    float_s32_t result = data_per_sample;
-
-    if (counter >= 16)
-    {
-        if (buckets_full)
-        {
-            // We've got enough data for a new bucket - replace the oldest bucket data with this new data
-            uint32_t oldest_bucket = times_overflowed % TOTAL_STORED_AVG_I2S_RATE;
-
-            time_buckets[oldest_bucket] = timespan_current_bucket;
-            data_lengths[oldest_bucket] = current_data_bucket_size;
-
-            current_data_bucket_size = 0;
-            counter = 0;
-            timespan_current_bucket = 0;
-
-            times_overflowed++;
-        }
-        else
-        {
-            // We've got enough data for this bucket - save this one and start the next one
-            time_buckets[times_overflowed] = timespan_current_bucket;
-            data_lengths[times_overflowed] = current_data_bucket_size;
-
-            current_data_bucket_size = 0;
-            counter = 0;
-            timespan_current_bucket = 0;
-
-            times_overflowed++;
-            if (times_overflowed == TOTAL_STORED_AVG_I2S_RATE)
-            {
-                buckets_full = true;
-            }
-        }
-    }
-    previous_result = result;
-    return result;
-}
-
-static inline sw_pll_q24_t get_Kp_for_i2s_buffer_control(int32_t nominal_i2s_rate)
-{
-    // The Kp constants are generated using the simulation framework empirically, to get values using which
-    // the calculated correction factor stablises the buffer level.
-    sw_pll_q24_t Kp = 0;
-    if(((int)nominal_i2s_rate == (int)44100) || ((int)nominal_i2s_rate == (int)48000))
-    {
-        Kp = KP_I2S_BUF_CONTROL_FS48;
-    }
-    else if(((int)nominal_i2s_rate == (int)88200) || ((int)nominal_i2s_rate == (int)96000))
-    {
-        Kp = KP_I2S_BUF_CONTROL_FS96;
-    }
-    else if(((int)nominal_i2s_rate == (int)176400) || ((int)nominal_i2s_rate == (int)192000))
-    {
-        Kp = KP_I2S_BUF_CONTROL_FS192;
-    }
-    return Kp;
+    return rate_estimator_get(&i2s_rate_estimator);
 }
 
 void rate_server(void *args)
 {
     static bool prev_spkr_itf_open = false;
+    static pi_control_t i2s_buf_control;
+    uint32_t prev_i2s_nominal_rate = 0;
     uint64_t usb_to_i2s_rate_ratio = 0;
     usb_rate_info_t usb_rate_info;
     i2s_to_usb_rate_info_t i2s_rate_info;
 
+    const pi_control_config_t i2s_buf_control_config = {
+        .time_constant_ms = appconfUSB_TO_I2S_PI_TIME_CONSTANT_MS,
+        .integral_time_ms = appconfUSB_TO_I2S_PI_INTEGRAL_TIME_MS,
+        .integrator_window = appconfPI_INTEGRATOR_WINDOW,
+        .max_correction_ppm = appconfPI_MAX_CORRECTION_PPM,
+    };
+    pi_control_init(&i2s_buf_control, &i2s_buf_control_config);
+
     for(;;)
     {
         // Get usb_rate_info from the other tile
         size_t bytes_received;
-        float_s32_t usb_rate;
+        rate_estimate_t usb_rate;
         bytes_received = rtos_intertile_rx_len(
                     intertile_ctx,
                     appconfUSB_RATE_NOTIFY_PORT,
@@ -231,7 +186,7 @@ void rate_server(void *args)
                         &usb_rate_info,
                         bytes_received);
 
-        usb_rate = usb_rate_info.usb_data_rate;
+        usb_rate = usb_rate_info.usb_rate;
 
         if((prev_spkr_itf_open == false) && (usb_rate_info.spkr_itf_open == true))
         {
@@ -240,12 +195,12 @@ void rate_server(void *args)
         prev_spkr_itf_open = usb_rate_info.spkr_itf_open;
 
         // Compute I2S rate
-        float_s32_t i2s_rate = determine_avg_I2S_rate_from_driver();
+        rate_estimate_t i2s_rate = determine_avg_I2S_rate_from_driver();
 
         // Calculate g_i2s_to_usb_rate_ratio only when the host is recording data from the device
-        if((i2s_rate.mant != 0) && (usb_rate.mant != 0) && (usb_rate_info.mic_itf_open))
+        if((i2s_rate.ticks != 0) && (usb_rate.ticks != 0) && (usb_rate_info.mic_itf_open))
         {
-            uint64_t fs_ratio_u64 = float_div_u64_fixed_output_q_format(i2s_rate, usb_rate, 28+32);
+            uint64_t fs_ratio_u64 = rate_estimator_ratio(i2s_rate, usb_rate);
             fs_ratio_u64 = fs_ratio_u64 + usb_rate_info.buffer_based_correction;
 
 #if LOG_I2S_TO_USB_SIDE
@@ -263,43 +218,47 @@ void rate_server(void *args)
             set_i2s_to_usb_rate_ratio((uint64_t)0);
         }
 
+        uint32_t i2s_nominal_rate = rtos_i2s_get_nominal_sampling_rate(i2s_ctx);
+        if(i2s_nominal_rate != prev_i2s_nominal_rate)
+        {
+            pi_control_set_rates(&i2s_buf_control, appconfUSB_AUDIO_SAMPLE_RATE, i2s_nominal_rate, RATE_MONITOR_UPDATE_PERIOD_US(i2s_nominal_rate));
+            prev_i2s_nominal_rate = i2s_nominal_rate;
+        }
+
         // Calculate usb_to_i2s_rate_ratio only when the host is playing data to the device
-        if((i2s_rate.mant != 0) && (usb_rate.mant != 0) && (usb_rate_info.spkr_itf_open))
+        if((i2s_rate.ticks != 0) && (usb_rate.ticks != 0) && (usb_rate_info.spkr_itf_open))
         {
-            const sw_pll_q24_t Kp = get_Kp_for_i2s_buffer_control(rtos_i2s_get_nominal_sampling_rate(i2s_ctx));
-            int64_t max_allowed_correction = (int64_t)1500 << 32;
             int64_t total_error = 0;
+            int32_t buffer_level_error;
 
-            uint64_t fs_ratio64 = float_div_u64_fixed_output_q_format(usb_rate, i2s_rate, 28+32);
+            uint64_t fs_ratio64 = rate_estimator_ratio(usb_rate, i2s_rate);
 
-            if(g_i2s_send_buf_state.flag_stable_avg)
+            if(get_i2s_send_buffer_error(&buffer_level_error))
             {
-                int64_t error_p = ((int64_t)Kp * (int64_t)(g_i2s_send_buf_state.avg_buffer_level - g_i2s_send_buf_state.stable_avg_level));
-                total_error = (int64_t)(error_p << 8);
-                if(total_error > max_allowed_correction)
-                {
-                    total_error = max_allowed_correction;
-                }
-                else if(total_error < -(max_allowed_correction))
-                {
-                    total_error = -(max_allowed_correction);
-                }
+                total_error = pi_control_update(&i2s_buf_control, buffer_level_error);
 #if LOG_USB_TO_I2S_SIDE
             printint(g_i2s_send_buf_state.avg_buffer_level);
             printchar(',');
             printintln((int32_t)(total_error >> 32)); // Print the upper 32 bits of the correction
 #endif
             }
+            else
+            {
+                // The buffer has been reset, so has the set point
+                pi_control_reset(&i2s_buf_control);
+            }
             usb_to_i2s_rate_ratio = fs_ratio64 + total_error;
 
         }
         else
         {
             usb_to_i2s_rate_ratio = (uint64_t)0;
+            pi_control_reset(&i2s_buf_control);
         }
 
         // Notify USB tile of the usb_to_i2s rate ratio
         i2s_rate_info.usb_to_i2s_rate_ratio = usb_to_i2s_rate_ratio;
+        i2s_rate_info.i2s_send_buf_latency_us = usb_rate_info.spkr_itf_open ? get_i2s_send_buffer_latency_us(i2s_nominal_rate) : 0;
 
         rtos_intertile_tx(
             intertile_ctx,
@@ -309,13 +268,3 @@ void rate_server(void *args)
     }
 }
 
-
-uint32_t sum_array(uint32_t * array_to_sum, uint32_t array_length)
-{
-    uint32_t acc = 0;
-    for (uint32_t i = 0; i < array_length; i++)
-    {
-        acc += array_to_sum[i];
-    }
-    return acc;
-}
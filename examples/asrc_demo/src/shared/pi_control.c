@@ -0,0 +1,116 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <string.h>
+#include "pi_control.h"
+
+void pi_control_init(pi_control_t *ctrl, const pi_control_config_t *config)
+{
+    memset(ctrl, 0, sizeof(*ctrl));
+    ctrl->config = *config;
+    if(ctrl->config.integrator_window > PI_CONTROL_MAX_WINDOW)
+    {
+        ctrl->config.integrator_window = PI_CONTROL_MAX_WINDOW;
+    }
+}
+
+void pi_control_set_rates(pi_control_t *ctrl, uint32_t fs_in, uint32_t fs_out, uint32_t update_period_us)
+{
+    pi_control_reset(ctrl);
+    ctrl->kp = 0;
+    ctrl->ki = 0;
+    ctrl->max_correction = 0;
+    ctrl->integral_limit = 0;
+
+    if((fs_in == 0) || (fs_out == 0) || (ctrl->config.time_constant_ms == 0))
+    {
+        return;
+    }
+
+    // Buffer level rate per unit of rate ratio correction. Only done on a rate change, so double is fine here.
+    double plant_gain = ((double)fs_out * (double)fs_out) / (double)fs_in;
+    double one_q60 = (double)((uint64_t)1 << (28+32));
+    double kp = one_q60 / (plant_gain * ((double)ctrl->config.time_constant_ms / 1000));
+
+    ctrl->max_correction = (int64_t)((one_q60 * fs_in / fs_out) * ctrl->config.max_correction_ppm / 1000000);
+    ctrl->kp = (int64_t)kp;
+    if(ctrl->kp == 0)
+    {
+        ctrl->kp = 1;
+    }
+    if(ctrl->config.integral_time_ms != 0)
+    {
+        ctrl->ki = (int64_t)(kp * ((double)update_period_us / 1000) / (double)ctrl->config.integral_time_ms);
+        if(ctrl->ki == 0)
+        {
+            ctrl->ki = 1;
+        }
+        ctrl->integral_limit = ctrl->max_correction / ctrl->ki;
+    }
+}
+
+void pi_control_reset(pi_control_t *ctrl)
+{
+    memset(ctrl->window, 0, sizeof(ctrl->window));
+    ctrl->window_pos = 0;
+    ctrl->integral = 0;
+    ctrl->correction = 0;
+}
+
+static int64_t clamp_s64(int64_t x, int64_t limit)
+{
+    if(x > limit)
+    {
+        return limit;
+    }
+    else if(x < -limit)
+    {
+        return -limit;
+    }
+    return x;
+}
+
+int64_t pi_control_update(pi_control_t *ctrl, int32_t error)
+{
+    const int64_t max_correction = ctrl->max_correction;
+
+    if(ctrl->kp == 0)
+    {
+        return 0;
+    }
+
+    if(ctrl->ki != 0)
+    {
+        int64_t added = error;
+        int64_t removed = 0;
+
+        // Anti-windup. Hold the integral while the correction is at its limit and the error would push it further.
+        if(((ctrl->correction >= max_correction) && (error > 0)) ||
+           ((ctrl->correction <= -max_correction) && (error < 0)))
+        {
+            added = 0;
+        }
+
+        if(ctrl->config.integrator_window != 0)
+        {
+            removed = ctrl->window[ctrl->window_pos];
+        }
+
+        // What is added is limited so that the sum over the window stays exact
+        int64_t integral = clamp_s64(ctrl->integral - removed + added, ctrl->integral_limit);
+        added = integral - (ctrl->integral - removed);
+        ctrl->integral = integral;
+
+        if(ctrl->config.integrator_window != 0)
+        {
+            ctrl->window[ctrl->window_pos] = (int32_t)added;
+            ctrl->window_pos = (ctrl->window_pos + 1 == ctrl->config.integrator_window) ? 0 : ctrl->window_pos + 1;
+        }
+    }
+
+    // Limit the error first so that the product cannot overflow
+    int64_t error_limit = max_correction / ctrl->kp + 1;
+    int64_t correction = ctrl->kp * clamp_s64(error, error_limit) + ctrl->ki * ctrl->integral;
+
+    ctrl->correction = clamp_s64(correction, max_correction);
+    return ctrl->correction;
+}
@@ -0,0 +1,86 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#ifndef PI_CONTROL_H
+#define PI_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// This file contains functions shared between the ASRC example application and the ASRC simulator code
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#define PI_CONTROL_MAX_WINDOW   (128)
+
+typedef struct {
+    uint32_t time_constant_ms;  ///< Time constant of the proportional loop
+    uint32_t integral_time_ms;  ///< Time for the integral term to match the proportional one for a constant error. 0 for P only control
+    uint32_t integrator_window; ///< Number of updates summed by the integral term, at most PI_CONTROL_MAX_WINDOW. 0 to sum all of them
+    uint32_t max_correction_ppm; ///< Limit of the correction, relative to the nominal rate ratio
+} pi_control_config_t;
+
+/**
+ * PI controller that keeps the fill level of the buffer after an ASRC at its set point by
+ * correcting the ASRC rate ratio.
+ *
+ * The gains are derived from the nominal rates by pi_control_set_rates(), so the same
+ * time constants hold at every rate. A correction of d in the rate ratio fs_in/fs_out
+ * changes the rate that the buffer fills at by -d * fs_out^2 / fs_in samples per second.
+ *
+ * The integral term stops accumulating while the correction is at its limit and
+ * accumulating would push it further, and is itself limited to the correction limit, so
+ * it does not wind up while the buffer level is far from the set point.
+ */
+typedef struct {
+    pi_control_config_t config;
+    int64_t kp;                 ///< Correction per sample of error
+    int64_t ki;                 ///< Correction per sample of error summed over the updates
+    int64_t max_correction;     ///< In Q(28+32) rate ratio units
+    int64_t integral_limit;
+
+    int32_t window[PI_CONTROL_MAX_WINDOW];
+    uint32_t window_pos;
+    int64_t integral;           ///< Error summed over the window
+    int64_t correction;
+} pi_control_t;
+
+/**
+ * @brief Initialise a PI controller. It gives no correction until pi_control_set_rates() is called.
+ *
+ * @param ctrl
+ * @param config Copied into ctrl
+ */
+void pi_control_init(pi_control_t *ctrl, const pi_control_config_t *config);
+
+/**
+ * @brief Derive the gains for a pair of nominal rates and reset the controller.
+ *
+ * @param ctrl
+ * @param fs_in Nominal rate of the ASRC input
+ * @param fs_out Nominal rate of the ASRC output, which the buffer level is counted at
+ * @param update_period_us Time between calls to pi_control_update()
+ */
+void pi_control_set_rates(pi_control_t *ctrl, uint32_t fs_in, uint32_t fs_out, uint32_t update_period_us);
+
+/**
+ * @brief Clear the integral term and the correction, keeping the gains.
+ *
+ * @param ctrl
+ */
+void pi_control_reset(pi_control_t *ctrl);
+
+/**
+ * @brief Compute the correction for the latest buffer level.
+ *
+ * @param ctrl
+ * @param error Buffer level minus its set point, in samples
+ * @return int64_t Correction to add to the rate ratio, in Q(28+32) format
+ */
+int64_t pi_control_update(pi_control_t *ctrl, int32_t error);
+
+#ifdef __cplusplus
+ }
+#endif
+#endif
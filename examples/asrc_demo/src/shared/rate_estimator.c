@@ -0,0 +1,150 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <string.h>
+#include "rate_estimator.h"
+
+void rate_estimator_init(rate_estimator_t *est, const rate_estimator_config_t *config)
+{
+    memset(est, 0, sizeof(*est));
+    est->config = *config;
+    if(est->config.n_buckets > RATE_ESTIMATOR_MAX_BUCKETS)
+    {
+        est->config.n_buckets = RATE_ESTIMATOR_MAX_BUCKETS;
+    }
+    est->nominal_ticks_per_sample_q16 = (uint32_t)(((uint64_t)config->ticks_per_second << 16) / config->nominal_rate);
+}
+
+static bool is_outlier(const rate_estimator_t *est, uint32_t ticks, uint32_t samples)
+{
+    if(est->config.outlier_shift == 0)
+    {
+        return false;
+    }
+
+    uint32_t expected = (uint32_t)(((uint64_t)samples * est->nominal_ticks_per_sample_q16) >> 16);
+    uint32_t tolerance = expected >> est->config.outlier_shift;
+    uint32_t diff = (ticks > expected) ? ticks - expected : expected - ticks;
+
+    return diff > tolerance;
+}
+
+static void close_bucket(rate_estimator_t *est)
+{
+    uint32_t slot;
+
+    if(est->n_full_buckets == est->config.n_buckets)
+    {
+        // Replace the oldest bucket
+        slot = est->oldest_bucket;
+        est->sum_samples -= est->bucket_samples[slot];
+        est->sum_ticks -= est->bucket_ticks[slot];
+        est->oldest_bucket = (slot + 1 == est->config.n_buckets) ? 0 : slot + 1;
+    }
+    else
+    {
+        slot = (est->oldest_bucket + est->n_full_buckets) % est->config.n_buckets;
+        est->n_full_buckets++;
+    }
+
+    est->bucket_samples[slot] = est->cur_samples;
+    est->bucket_ticks[slot] = est->cur_ticks;
+    est->sum_samples += est->cur_samples;
+    est->sum_ticks += est->cur_ticks;
+
+    est->cur_samples = 0;
+    est->cur_ticks = 0;
+    est->cur_updates = 0;
+}
+
+void rate_estimator_add(rate_estimator_t *est, uint32_t ticks, uint32_t samples)
+{
+    est->pending_samples += samples;
+    est->pending_ticks += ticks;
+
+    if(is_outlier(est, est->pending_ticks, est->pending_samples) && (est->n_outliers < est->config.max_outliers))
+    {
+        est->n_outliers++;
+        est->total_outliers++;
+        return;
+    }
+    est->n_outliers = 0;
+
+    est->cur_samples += est->pending_samples;
+    est->cur_ticks += est->pending_ticks;
+    est->cur_updates++;
+    est->pending_samples = 0;
+    est->pending_ticks = 0;
+
+    if(((est->config.bucket_ticks != 0) && (est->cur_ticks >= est->config.bucket_ticks)) ||
+       ((est->config.bucket_updates != 0) && (est->cur_updates >= est->config.bucket_updates)))
+    {
+        close_bucket(est);
+    }
+}
+
+void rate_estimator_add_timestamp(rate_estimator_t *est, uint32_t timestamp, uint32_t samples)
+{
+    if(!est->have_timestamp)
+    {
+        est->have_timestamp = true;
+        est->last_timestamp = timestamp;
+        return;
+    }
+
+    // The span is correct across a timer wrap, as long as it is shorter than the timer period
+    uint32_t ticks = timestamp - est->last_timestamp;
+    est->last_timestamp = timestamp;
+    rate_estimator_add(est, ticks, samples);
+}
+
+rate_estimate_t rate_estimator_get(const rate_estimator_t *est)
+{
+    rate_estimate_t rate;
+
+    rate.samples = est->sum_samples + est->cur_samples;
+    rate.ticks = est->sum_ticks + est->cur_ticks;
+
+    if(rate.ticks == 0)
+    {
+        rate.samples = est->config.nominal_rate;
+        rate.ticks = est->config.ticks_per_second;
+    }
+    return rate;
+}
+
+uint64_t rate_estimator_ratio(rate_estimate_t num, rate_estimate_t den)
+{
+    uint64_t dividend = (uint64_t)num.samples * den.ticks;
+    uint64_t divisor = (uint64_t)num.ticks * den.samples;
+
+    if((dividend == 0) || (divisor == 0))
+    {
+        return 0;
+    }
+
+    // Keep 8 bits of headroom in the remainder, for the long division below. This drops at
+    // most a few bits below 2^-48 of the ratio.
+    while(divisor >> 56)
+    {
+        dividend >>= 1;
+        divisor >>= 1;
+    }
+
+    uint64_t quotient = dividend / divisor;
+    uint64_t remainder = dividend % divisor;
+
+    // Ratios of the supported rates are well below 2^(64 - RATE_ESTIMATOR_RATIO_Q)
+    for(int bits = RATE_ESTIMATOR_RATIO_Q; bits > 0; bits -= 8)
+    {
+        int step = (bits < 8) ? bits : 8;
+        remainder <<= step;
+        quotient = (quotient << step) | (remainder / divisor);
+        remainder = remainder % divisor;
+    }
+
+    if(remainder >= divisor - remainder)
+    {
+        quotient++;
+    }
+    return quotient;
+}
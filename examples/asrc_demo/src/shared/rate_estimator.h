@@ -0,0 +1,128 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#ifndef RATE_ESTIMATOR_H
+#define RATE_ESTIMATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// This file contains functions shared between the ASRC example application and the ASRC simulator code
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#define RATE_ESTIMATOR_MAX_BUCKETS  (64)
+
+/** Q format of the rate ratios returned by rate_estimator_ratio(), as taken by asrc_process() */
+#define RATE_ESTIMATOR_RATIO_Q      (28+32)
+
+/**
+ * A sample rate, as the number of samples counted over a number of timer ticks.
+ *
+ * Both are kept as integers so that ratios of rates can be computed exactly. The ticks
+ * of a window must fit in 32 bits, which is almost 43 seconds of a 100MHz timer.
+ */
+typedef struct {
+    uint32_t samples;
+    uint32_t ticks;
+} rate_estimate_t;
+
+typedef struct {
+    uint32_t nominal_rate;      ///< Samples per second. Used for outlier rejection and returned until there is any data
+    uint32_t ticks_per_second;  ///< Rate of the timer that the spans are measured with
+    uint32_t n_buckets;         ///< Length of the averaging window in buckets, at most RATE_ESTIMATOR_MAX_BUCKETS
+    uint32_t bucket_ticks;      ///< A bucket is closed once it spans this many ticks. 0 to not close buckets on time
+    uint32_t bucket_updates;    ///< A bucket is closed once it has had this many updates. 0 to not close buckets on count
+    uint32_t outlier_shift;     ///< An update is held back when its span is off the nominal one by more than 1/2^outlier_shift. 0 to accept every update
+    uint32_t max_outliers;      ///< Number of updates in a row that can be held back, after which the span is accepted anyway
+} rate_estimator_config_t;
+
+/**
+ * Moving average of a sample rate over a window of buckets.
+ *
+ * The window totals are kept as running sums, so updating and reading the estimate is
+ * O(1) whatever the window length.
+ *
+ * An update whose span does not match its sample count at the nominal rate, such as one
+ * from a late timestamp, is held back and merged with the next update. The timestamp
+ * jitter then cancels out within the merged span instead of landing at a bucket edge.
+ */
+typedef struct {
+    rate_estimator_config_t config;
+    uint32_t nominal_ticks_per_sample_q16;
+
+    uint32_t bucket_samples[RATE_ESTIMATOR_MAX_BUCKETS];
+    uint32_t bucket_ticks[RATE_ESTIMATOR_MAX_BUCKETS];
+    uint32_t oldest_bucket;
+    uint32_t n_full_buckets;
+    uint32_t sum_samples;       ///< Total of the full buckets
+    uint32_t sum_ticks;
+
+    uint32_t cur_samples;       ///< Bucket being filled
+    uint32_t cur_ticks;
+    uint32_t cur_updates;
+
+    uint32_t pending_samples;   ///< Updates held back as outliers
+    uint32_t pending_ticks;
+    uint32_t n_outliers;
+    uint32_t total_outliers;
+
+    uint32_t last_timestamp;
+    bool have_timestamp;
+} rate_estimator_t;
+
+/**
+ * @brief Initialise or reset a rate estimator.
+ *
+ * @param est
+ * @param config Copied into est
+ */
+void rate_estimator_init(rate_estimator_t *est, const rate_estimator_config_t *config);
+
+/**
+ * @brief Add a number of samples counted over a span of ticks.
+ *
+ * @param est
+ * @param ticks Span of the update
+ * @param samples Samples counted over the span
+ */
+void rate_estimator_add(rate_estimator_t *est, uint32_t ticks, uint32_t samples);
+
+/**
+ * @brief Add the samples that arrived at a timestamp.
+ *
+ * The samples are counted over the span since the previous timestamp. The samples that
+ * come with the first timestamp after rate_estimator_init() only start the first span.
+ *
+ * @param est
+ * @param timestamp Timer value, which may wrap
+ * @param samples Samples that arrived at the timestamp
+ */
+void rate_estimator_add_timestamp(rate_estimator_t *est, uint32_t timestamp, uint32_t samples);
+
+/**
+ * @brief Get the rate averaged over the window, including the bucket being filled.
+ *
+ * @param est
+ * @return rate_estimate_t The nominal rate when no update has been accepted yet
+ */
+rate_estimate_t rate_estimator_get(const rate_estimator_t *est);
+
+/**
+ * @brief Ratio of two rates, (num.samples * den.ticks) / (num.ticks * den.samples).
+ *
+ * Computed with integer division only, rounded to the nearest RATE_ESTIMATOR_RATIO_Q LSB.
+ * The ratio must be below 2^(64 - RATE_ESTIMATOR_RATIO_Q), which all ratios of the
+ * supported sample rates are.
+ *
+ * @param num Rate of the ASRC input
+ * @param den Rate of the ASRC output
+ * @return uint64_t The ratio in Q(RATE_ESTIMATOR_RATIO_Q) format, 0 if either rate is 0
+ */
+uint64_t rate_estimator_ratio(rate_estimate_t num, rate_estimate_t den);
+
+#ifdef __cplusplus
+ }
+#endif
+#endif
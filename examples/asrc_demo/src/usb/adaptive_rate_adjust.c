@@ -1,4 +1,4 @@
-// Copyright 2022-2023 XMOS LIMITED.
+// Copyright 2022-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #define DEBUG_UNIT ADAPTIVE_USB
@@ -40,7 +40,7 @@ typedef struct usb_audio_rate_packet_desc {
 } usb_audio_rate_packet_desc_t;
 
 static QueueHandle_t data_event_queue = NULL;
-usb_rate_calc_info_t g_usb_rate_calc_info[2] = {{0,0}, {0,0}};
+rate_estimate_t g_usb_rate_calc_info[2] = {{0,0}, {0,0}};
 
 static uint32_t timestamp_from_sofs = 0;
 
@@ -1,4 +1,4 @@
-// Copyright 2022-2023 XMOS LIMITED.
+// Copyright 2022-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #include <stdint.h>
@@ -6,7 +6,6 @@
 
 #include "rate_server.h"
 
-#include "xmath/xmath.h"
 #define TOTAL_TAIL_SECONDS 16
 #define STORED_PER_SECOND 4
 
@@ -28,7 +27,7 @@ void reset_state(uint32_t direction)
 }
 
 
-usb_rate_calc_info_t determine_USB_audio_rate(uint32_t timestamp,
+rate_estimate_t determine_USB_audio_rate(uint32_t timestamp,
                                     uint32_t data_length,
                                     uint32_t direction
 #ifdef DEBUG_ADAPTIVE
@@ -37,12 +36,7 @@ usb_rate_calc_info_t determine_USB_audio_rate(uint32_t timestamp,
 #endif
 )
 {
-    static uint32_t data_lengths[2][TOTAL_STORED];
-    static uint32_t time_buckets[2][TOTAL_STORED];
-    static uint32_t current_data_bucket_size[2];
-    static uint32_t first_timestamp[2];
-    static bool buckets_full[2];
-    static uint32_t times_overflowed[2];
+    static rate_estimator_t usb_rate_estimator[2];
 
     data_length = data_length / (CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_RX * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX); // Number of samples per channels per transaction
 
@@ -54,79 +48,37 @@ usb_rate_calc_info_t determine_USB_audio_rate(uint32_t timestamp,
 
     if (first_time[direction])
     {
-        first_time[direction] = false;
-        first_timestamp[direction] = timestamp;
+        // A packet is normally 1ms after the previous one. One whose SOF timestamp is more than 125us off
+        // that, for its number of samples, is merged with the next one.
+        const rate_estimator_config_t config = {
+            .nominal_rate = appconfUSB_AUDIO_SAMPLE_RATE,
+            .ticks_per_second = REF_CLOCK_TICKS_PER_SECOND,
+            .n_buckets = TOTAL_STORED,
+            .bucket_ticks = REF_CLOCK_TICKS_PER_STORED_AVG,
+            .bucket_updates = 0,
+            .outlier_shift = 3,
+            .max_outliers = 8,
+        };
 
-        // Because we use "first_time" to also reset the rate determinator,
-        // reset all the static variables to default.
-        current_data_bucket_size[direction] = 0;
-        times_overflowed[direction] = 0;
-        buckets_full[direction] = false;
+        first_time[direction] = false;
 
-        for (int i = 0; i < TOTAL_STORED; i++)
-        {
-            data_lengths[direction][i] = 0;
-            time_buckets[direction][i] = 0;
-        }
+        // Because we use "first_time" to also reset the rate determinator, reinitialise it here
+        rate_estimator_init(&usb_rate_estimator[direction], &config);
+        rate_estimator_add_timestamp(&usb_rate_estimator[direction], timestamp, data_length);
 
-        return (usb_rate_calc_info_t){appconfUSB_AUDIO_SAMPLE_RATE, REF_CLOCK_TICKS_PER_SECOND};
+        return (rate_estimate_t){appconfUSB_AUDIO_SAMPLE_RATE, REF_CLOCK_TICKS_PER_SECOND};
     }
 
-    current_data_bucket_size[direction] += data_length;
-
-
-
-    // total_timespan is always correct regardless of whether the reference clock has overflowed.
-    // The point at which it becomes incorrect is the point at which it would overflow - the
-    // point at which timestamp == first_timestamp again. This will be at 42.95 seconds of operation.
-    // If current_data_bucket_size overflows we have bigger issues, so this case is not guarded.
+    // The timestamps are correct regardless of whether the reference clock has overflowed, but the total
+    // time in the window must stay below the 42.95 seconds it takes the reference clock to overflow.
+    rate_estimator_add_timestamp(&usb_rate_estimator[direction], timestamp, data_length);
 
-    uint32_t timespan = timestamp - first_timestamp[direction];
-
-
-    usb_rate_calc_info_t result = {0, 0};
-    uint32_t total_data_intermed = current_data_bucket_size[direction] + sum_array(data_lengths[direction], TOTAL_STORED);
-    uint32_t total_timespan = timespan + sum_array(time_buckets[direction], TOTAL_STORED);
-    result.total_data_samples = total_data_intermed;
-    result.total_ticks = total_timespan;
-
-
-    if (timespan >= REF_CLOCK_TICKS_PER_STORED_AVG)
-    {
-        if (buckets_full[direction])
-        {
-            // We've got enough data for a new bucket - replace the oldest bucket data with this new data
-            uint32_t oldest_bucket = times_overflowed[direction] % TOTAL_STORED;
-
-            time_buckets[direction][oldest_bucket] = timespan;
-            data_lengths[direction][oldest_bucket] = current_data_bucket_size[direction];
-
-            current_data_bucket_size[direction] = 0;
-            first_timestamp[direction] = timestamp;
-
-            times_overflowed[direction]++;
-        }
-        else
-        {
-            // We've got enough data for this bucket - save this one and start the next one
-            time_buckets[direction][times_overflowed[direction]] = timespan;
-            data_lengths[direction][times_overflowed[direction]] = current_data_bucket_size[direction];
-
-            current_data_bucket_size[direction] = 0;
-            first_timestamp[direction] = timestamp;
-
-            times_overflowed[direction]++;
-            if (times_overflowed[direction] == TOTAL_STORED)
-            {
-                buckets_full[direction] = true;
-            }
-        }
-    }
+    rate_estimate_t result = rate_estimator_get(&usb_rate_estimator[direction]);
 
 #ifdef DEBUG_ADAPTIVE
-    #define DEBUG_QUANT 4
+    #define DEBUG_QUANT 2
 
-    uint32_t debug_out[DEBUG_QUANT] = {result, data_per_sample, total_data_intermed, total_timespan};
+    uint32_t debug_out[DEBUG_QUANT] = {result.samples, result.ticks};
     for (int i = 0; i < DEBUG_QUANT; i++)
     {
         debug[i] = debug_out[i];
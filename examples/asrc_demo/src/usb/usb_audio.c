@@ -1,4 +1,4 @@
-// Copyright 2022-2023 XMOS LIMITED.
+// Copyright 2022-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 /*
  * The MIT License (MIT)
@@ -50,8 +50,9 @@
 #include "rate_server.h"
 #include "dbcalc.h"
 #include "avg_buffer_level.h"
+#include "pi_control.h"
 #include "adaptive_rate_callback.h"
-#include "div.h"
+#include "spsc_ring.h"
 
 // Audio controls
 // Current states
@@ -71,15 +72,20 @@ static bool host_streaming_out = false;
 
 static StreamBufferHandle_t samples_to_host_stream_buf;
 static StreamBufferHandle_t samples_from_host_stream_buf;
-static StreamBufferHandle_t rx_buffer;
+/* Reassembles USB transactions into nominal sized ones. Only touched from
+ * the TinyUSB task. */
+static uint8_t rx_buffer_storage[SPSC_RING_POW2_CEIL(2 * CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ)];
+static spsc_ring_t rx_buffer;
 static TaskHandle_t usb_audio_out_asrc_handle;
 
 static uint64_t g_usb_to_i2s_rate_ratio = 0;
 static uint32_t samples_to_host_stream_buf_size_bytes = 0;
 static bool g_i2s_sr_change_detected = false;
+static uint32_t g_usb_in_latency_us = 0;         // Measured in usb_audio_out_asrc()
+static uint32_t g_i2s_send_buf_latency_us = 0;   // Measured on the I2S tile
 static bool samples_to_host_buf_ready_to_read = false;
 
-extern usb_rate_calc_info_t g_usb_rate_calc_info[2];
+extern rate_estimate_t g_usb_rate_calc_info[2];
 
 
 #define USB_FRAMES_PER_ASRC_INPUT_FRAME (USB_TO_I2S_ASRC_BLOCK_LENGTH / (appconfUSB_AUDIO_SAMPLE_RATE / 1000))
@@ -257,98 +263,15 @@ typedef int32_t samp_t;
 #endif
 
 
-static inline int32_t get_avg_window_size_log2(uint32_t i2s_rate)
-{
-    // The window size is calculated using the simulation framework to ensure that it is large enough that we get stable windowed averages
-    if((i2s_rate == 192000) || (i2s_rate == 176400))
-    {
-        return 12;
-    }
-    else if((i2s_rate == 96000) || (i2s_rate == 88200))
-    {
-        return 11;
-    }
-    else if((i2s_rate == 48000) || (i2s_rate == 44100))
-    {
-        return 11;
-    }
-    else
-    {
-        xassert(0);
-    }
-    return 0;
-}
-
-
-static inline sw_pll_q24_t get_Kp_for_usb_buffer_control(int32_t nominal_i2s_rate)
-{
-    // The Kp constants are generated using the simulation framework, largely through trial and error, to get values using which
-    // the calculated correction factor stablises the buffer level.
-    sw_pll_q24_t Kp = 0;
-    if(((int)nominal_i2s_rate == (int)44100) || ((int)nominal_i2s_rate == (int)48000))
-    {
-        Kp = KP_USB_BUF_CONTROL_FS48;
-    }
-    else if(((int)nominal_i2s_rate == (int)88200) || ((int)nominal_i2s_rate == (int)96000))
-    {
-        Kp = KP_USB_BUF_CONTROL_FS96;
-    }
-    else if(((int)nominal_i2s_rate == (int)176400) || ((int)nominal_i2s_rate == (int)192000))
-    {
-        Kp = KP_USB_BUF_CONTROL_FS192;
-    }
-    return Kp;
-}
-
-static inline int64_t calc_usb_buffer_based_correction(int32_t nominal_i2s_rate, buffer_calc_state_t *long_term_buf_state, buffer_calc_state_t *short_term_buf_state)
-{
-    sw_pll_q24_t Kp = get_Kp_for_usb_buffer_control(nominal_i2s_rate);
-    int64_t max_allowed_correction = (int64_t)1500 << 32;
-    int64_t total_error = 0;
-
-    // Correct based on short term average only when creeping outside the guard band
-    if(short_term_buf_state->flag_stable_avg == true)
-    {
-        if(short_term_buf_state->avg_buffer_level > 200)
-        {
-            total_error = max_allowed_correction;
-            return total_error;
-        }
-        else if(short_term_buf_state->avg_buffer_level < -200)
-        {
-            total_error = -(max_allowed_correction);
-            return total_error;
-        }
-    }
-    if(long_term_buf_state->flag_stable_avg == true)
-    {
-        int64_t error_p = ((int64_t)Kp * (int64_t)(long_term_buf_state->avg_buffer_level - long_term_buf_state->stable_avg_level));
-
-        total_error = (int64_t)(error_p << 8);
-        if(total_error > max_allowed_correction)
-        {
-            total_error = max_allowed_correction;
-        }
-        else if(total_error < -(max_allowed_correction))
-        {
-            total_error = -(max_allowed_correction);
-        }
-    }
-
-    return total_error;
-
-}
-
 void usb_audio_send(int32_t *frame_buffer_ptr, // buffer containing interleaved samples [samps][ch] format
                     size_t frame_count,
                     size_t num_chans)
 {
-    #define RATE_MONITOR_TRIGGER_INTERVAL (16)
     static int32_t prev_i2s_sampling_rate = 0;
     static uint32_t num_samples_to_host_buf_writes = 0;
     static uint32_t num_dummy_writes = 0;
-    static buffer_calc_state_t long_term_buf_state;
-    static buffer_calc_state_t short_term_buf_state;
+    static buffer_calc_state_t buf_state;
+    static pi_control_t usb_buf_control;
 #if CHECK_SAMPLES_TO_HOST_BUF_WRITE_TIME
     static uint32_t prev_ts = 0;
 #endif
@@ -383,11 +306,16 @@ void usb_audio_send(int32_t *frame_buffer_ptr, // buffer containing interleaved
 
         if((prev_i2s_sampling_rate != current_i2s_rate) && (current_i2s_rate != 0))
         {
-            // The window size and buffer_level_stable_threahold are calculated using the simulation
-            // framework to ensure that they are large enough that we get stable windowed averages
-            int32_t window_len_log2 = get_avg_window_size_log2(current_i2s_rate);
-            init_calc_buffer_level_state(&long_term_buf_state, window_len_log2, 4);
-            init_calc_buffer_level_state(&short_term_buf_state, 9, 4);
+            init_calc_buffer_level_state(&buf_state, appconfI2S_TO_USB_AVG_WINDOW_LOG2, appconfI2S_TO_USB_AVG_STABLE_THRESHOLD);
+
+            const pi_control_config_t usb_buf_control_config = {
+                .time_constant_ms = appconfI2S_TO_USB_PI_TIME_CONSTANT_MS,
+                .integral_time_ms = appconfI2S_TO_USB_PI_INTEGRAL_TIME_MS,
+                .integrator_window = appconfPI_INTEGRATOR_WINDOW,
+                .max_correction_ppm = appconfPI_MAX_CORRECTION_PPM,
+            };
+            pi_control_init(&usb_buf_control, &usb_buf_control_config);
+            pi_control_set_rates(&usb_buf_control, current_i2s_rate, appconfUSB_AUDIO_SAMPLE_RATE, RATE_MONITOR_UPDATE_PERIOD_US(current_i2s_rate));
 
             rtos_printf("I2S SR change detected in usb_audio_send(). prev SR %d, new SR %d\n", prev_i2s_sampling_rate, current_i2s_rate);
             // Set this flag and wait for it to be cleared from tud_audio_tx_done_pre_load_cb(), which it will, after resetting the samples_to_host_stream_buf. We wait
@@ -406,8 +334,7 @@ void usb_audio_send(int32_t *frame_buffer_ptr, // buffer containing interleaved
 
                 int32_t usb_buffer_level_from_half = (int32_t)((int32_t)xStreamBufferBytesAvailable(samples_to_host_stream_buf) - (samples_to_host_stream_buf_size_bytes / 2)) / (int32_t)8;    //Level w.r.t. half full in samples
 
-                calc_avg_buffer_level(&long_term_buf_state, usb_buffer_level_from_half, !samples_to_host_buf_ready_to_read); // Keep resetting the buffer state till samples_to_host_buf_ready_to_read is true, i.e we start reading out of the samples_to_host buffer
-                calc_avg_buffer_level(&short_term_buf_state, usb_buffer_level_from_half, !samples_to_host_buf_ready_to_read);
+                calc_avg_buffer_level(&buf_state, usb_buffer_level_from_half, !samples_to_host_buf_ready_to_read); // Keep resetting the buffer state till samples_to_host_buf_ready_to_read is true, i.e we start reading out of the samples_to_host buffer
 
                 num_samples_to_host_buf_writes += 1;
                 if(num_samples_to_host_buf_writes % RATE_MONITOR_TRIGGER_INTERVAL == 0)
@@ -420,7 +347,16 @@ void usb_audio_send(int32_t *frame_buffer_ptr, // buffer containing interleaved
 
 #endif
                     usb_rate_info.samples_to_host_buf_fill_level = usb_buffer_level_from_half;
-                    usb_rate_info.buffer_based_correction = calc_usb_buffer_based_correction(current_i2s_rate, &long_term_buf_state, &short_term_buf_state);
+                    if(buf_state.flag_stable_avg)
+                    {
+                        usb_rate_info.buffer_based_correction = pi_control_update(&usb_buf_control, buf_state.avg_buffer_level - buf_state.stable_avg_level);
+                    }
+                    else
+                    {
+                        // The buffer has been reset, so has the set point
+                        pi_control_reset(&usb_buf_control);
+                        usb_rate_info.buffer_based_correction = 0;
+                    }
                     intertile_send = true; // Trigger rate monitoring on the other tile
                 }
             }
@@ -440,14 +376,14 @@ void usb_audio_send(int32_t *frame_buffer_ptr, // buffer containing interleaved
     }
     if(intertile_send == true)
     {
-        usb_rate_info.usb_data_rate = (float_s32_t){0,0};
-        if((usb_rate_info.spkr_itf_open) && (g_usb_rate_calc_info[TUSB_DIR_OUT].total_ticks != 0)) // Calculate rate from the TUSB_DIR_OUT if spkr_itf is open otherwise calculate from the TUSB_DIR_IN direction
+        usb_rate_info.usb_rate = (rate_estimate_t){0,0};
+        if((usb_rate_info.spkr_itf_open) && (g_usb_rate_calc_info[TUSB_DIR_OUT].ticks != 0)) // Calculate rate from the TUSB_DIR_OUT if spkr_itf is open otherwise calculate from the TUSB_DIR_IN direction
         {
-            usb_rate_info.usb_data_rate = float_div((float_s32_t){g_usb_rate_calc_info[TUSB_DIR_OUT].total_data_samples, 0}, (float_s32_t){g_usb_rate_calc_info[TUSB_DIR_OUT].total_ticks, 0});
+            usb_rate_info.usb_rate = g_usb_rate_calc_info[TUSB_DIR_OUT];
         }
-        else if(usb_rate_info.mic_itf_open && g_usb_rate_calc_info[TUSB_DIR_IN].total_ticks != 0)
+        else if(usb_rate_info.mic_itf_open && g_usb_rate_calc_info[TUSB_DIR_IN].ticks != 0)
         {
-            usb_rate_info.usb_data_rate = float_div((float_s32_t){g_usb_rate_calc_info[TUSB_DIR_IN].total_data_samples, 0}, (float_s32_t){g_usb_rate_calc_info[TUSB_DIR_IN].total_ticks, 0});
+            usb_rate_info.usb_rate = g_usb_rate_calc_info[TUSB_DIR_IN];
         }
 
         i2s_to_usb_rate_info_t i2s_rate_info;
@@ -473,6 +409,7 @@ void usb_audio_send(int32_t *frame_buffer_ptr, // buffer containing interleaved
 
         // Update ratio only when both rates are valid
         g_usb_to_i2s_rate_ratio = i2s_rate_info.usb_to_i2s_rate_ratio;
+        g_i2s_send_buf_latency_us = i2s_rate_info.i2s_send_buf_latency_us;
 
     }
 }
@@ -495,59 +432,35 @@ void usb_audio_out_asrc(void *arg)
 
     rtos_intertile_t *intertile_ctx = (rtos_intertile_t *)arg;
 
-    // Initialise channel 0 ASRC instance
-    asrc_state_t asrc_state[CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX][ASRC_CHANNELS_PER_INSTANCE];                                               // ASRC state machine state
-    int asrc_stack[CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX][ASRC_CHANNELS_PER_INSTANCE][ASRC_STACK_LENGTH_MULT * USB_TO_I2S_ASRC_BLOCK_LENGTH]; // Buffer between filter stages
-    asrc_ctrl_t asrc_ctrl[CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX][ASRC_CHANNELS_PER_INSTANCE];                                                 // Control structure
-    asrc_adfir_coefs_t asrc_adfir_coefs[CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX];
-
-    for (int ch = 0; ch < CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX; ch++)
-    {
-        for (int ui = 0; ui < ASRC_CHANNELS_PER_INSTANCE; ui++)
-        {
-            // Set state, stack and coefs into ctrl structure
-            asrc_ctrl[ch][ui].psState = &asrc_state[ch][ui];
-            asrc_ctrl[ch][ui].piStack = asrc_stack[ch][ui];
-            asrc_ctrl[ch][ui].piADCoefs = asrc_adfir_coefs[ch].iASRCADFIRCoefs;
-        }
-    }
-
-    // Initialise ASRC
-    //  Create init ctx for the ch1 asrc running in another thread
-    asrc_init_t asrc_init_ctx;
-    asrc_init_ctx.fs_in = appconfUSB_AUDIO_SAMPLE_RATE;
-    asrc_init_ctx.fs_out = 0; // Will be notified at runtime
-    asrc_init_ctx.n_in_samples = USB_TO_I2S_ASRC_BLOCK_LENGTH;
-    asrc_init_ctx.asrc_ctrl_ptr = &asrc_ctrl[1][0];
-    (void)rtos_osal_queue_create(&asrc_init_ctx.asrc_queue, "asrc_q", 1, sizeof(asrc_process_frame_ctx_t *));
-    (void)rtos_osal_queue_create(&asrc_init_ctx.asrc_ret_queue, "asrc_ret_q", 1, sizeof(int));
-
-    rtos_osal_thread_t asrc_ch1_thread;
-
-    // Create 2nd channel ASRC task
-    (void)rtos_osal_thread_create(
-        (rtos_osal_thread_t *)&asrc_ch1_thread,
-        (char *)"ASRC_1ch",
-        (rtos_osal_entry_function_t)asrc_one_channel_task,
-        (void *)(&asrc_init_ctx),
-        (size_t)RTOS_THREAD_STACK_SIZE(asrc_one_channel_task),
-        (unsigned int)appconfAUDIO_PIPELINE_TASK_PRIORITY);
-
-    fs_code_t in_fs_code;
-    fs_code_t out_fs_code;
+    // All the channels go through one multi-channel ASRC, split across appconfUSB_TO_I2S_ASRC_WORKERS threads
+    static asrc_mc_t asrc_mc;
+    asrc_mc_init(&asrc_mc,
+                 CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX,
+                 appconfUSB_TO_I2S_ASRC_WORKERS,
+                 USB_TO_I2S_ASRC_BLOCK_LENGTH,
+                 USB_TO_I2S_ASRC_BLOCK_LENGTH * 4 + USB_TO_I2S_ASRC_BLOCK_LENGTH,
+                 appconfAUDIO_PIPELINE_TASK_PRIORITY);
+
+    const uint32_t fs_in = appconfUSB_AUDIO_SAMPLE_RATE;
+    uint32_t fs_out = 0; // Will be notified at runtime
     uint64_t nominal_fs_ratio;
 #if PROFILE_ASRC
     uint32_t max_time = 0;
 #endif
 
-    int32_t frame_samples[CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX][USB_TO_I2S_ASRC_BLOCK_LENGTH * 4 + USB_TO_I2S_ASRC_BLOCK_LENGTH];             // TODO calculate size properly
     int32_t frame_samples_interleaved[USB_TO_I2S_ASRC_BLOCK_LENGTH * 4 + USB_TO_I2S_ASRC_BLOCK_LENGTH][CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX]; // TODO calculate size properly
 
-    asrc_process_frame_ctx_t asrc_ctx;
+    // Samples left waiting in the USB receive buffers after each ASRC input block is read, and the time
+    // from the read until the ASRC output is taken by the I2S tile, in us
+    buffer_calc_state_t usb_in_level_state;
+    buffer_calc_state_t asrc_time_state;
+    init_calc_buffer_level_state(&usb_in_level_state, 6, 0);
+    init_calc_buffer_level_state(&asrc_time_state, 6, 0);
+
     for (;;)
     {
         samp_t usb_audio_out_frame[USB_TO_I2S_ASRC_BLOCK_LENGTH][CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX];
-        int32_t usb_audio_out_frame_deinterleaved[CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX][USB_TO_I2S_ASRC_BLOCK_LENGTH];
+        int32_t asrc_in_frame[USB_TO_I2S_ASRC_BLOCK_LENGTH][CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX];
         size_t bytes_received = 0;
 
         /*
@@ -556,25 +469,28 @@ void usb_audio_out_asrc(void *arg)
          */
         (void)ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
         bytes_received = xStreamBufferReceive(samples_from_host_stream_buf, usb_audio_out_frame, sizeof(usb_audio_out_frame), 0);
+        uint32_t read_time = get_reference_time();
+        int32_t usb_in_level = (int32_t)((xStreamBufferBytesAvailable(samples_from_host_stream_buf) + spsc_ring_count(&rx_buffer)) /
+                                         (sizeof(samp_t) * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX));
         uint32_t current_i2s_rate = get_i2s_nominal_sampling_rate();
 
         if(current_i2s_rate == 0)
         {
             continue;
         }
-        if (asrc_init_ctx.fs_out != current_i2s_rate)
+        if (fs_out != current_i2s_rate)
         {
             // Time to initialise asrc
             g_usb_to_i2s_rate_ratio = (uint64_t)0;
-            asrc_init_ctx.fs_out = current_i2s_rate;
-            in_fs_code = samp_rate_to_code(asrc_init_ctx.fs_in); // Sample rate code 0..5
-            out_fs_code = samp_rate_to_code(asrc_init_ctx.fs_out);
-            rtos_printf("USB tile initialising ASRC for fs_in %lu, fs_out %lu\n", asrc_init_ctx.fs_in, asrc_init_ctx.fs_out);
-
-            // Initialise both channel ASRCs
-            nominal_fs_ratio = asrc_init(in_fs_code, out_fs_code, &asrc_ctrl[0][0], ASRC_CHANNELS_PER_INSTANCE, asrc_init_ctx.n_in_samples, ASRC_DITHER_SETTING);
-            nominal_fs_ratio = asrc_init(in_fs_code, out_fs_code, &asrc_ctrl[1][0], ASRC_CHANNELS_PER_INSTANCE, asrc_init_ctx.n_in_samples, ASRC_DITHER_SETTING);
-            // Skip this frame since we're too late anayway from 2 asrc_init() calls, each taking 12500 cycles
+            fs_out = current_i2s_rate;
+            rtos_printf("USB tile initialising ASRC for fs_in %lu, fs_out %lu\n", fs_in, fs_out);
+
+            // Initialise all the channels
+            nominal_fs_ratio = asrc_mc_set_rates(&asrc_mc, fs_in, fs_out);
+            calc_avg_buffer_level(&usb_in_level_state, 0, true);
+            calc_avg_buffer_level(&asrc_time_state, 0, true);
+            g_usb_in_latency_us = 0;
+            // Skip this frame since we're too late anayway from the asrc_init() calls, each taking 12500 cycles
             continue;
         }
 
@@ -588,46 +504,17 @@ void usb_audio_out_asrc(void *arg)
         uint32_t start = get_reference_time();
 #endif
 
-        for (int ch = 0; ch < CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX; ch++)
+        for (int i = 0; i < USB_TO_I2S_ASRC_BLOCK_LENGTH; i++)
         {
-            for (int i = 0; i < USB_TO_I2S_ASRC_BLOCK_LENGTH; i++)
+            for (int ch = 0; ch < CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX; ch++)
             {
-                usb_audio_out_frame_deinterleaved[ch][i] = usb_audio_out_frame[i][ch] << src_32_shift;
                 // This is taking 4 MIPS. Can be optimised if needed.
-                usb_audio_out_frame_deinterleaved[ch][i] = volume_scale(vol_mul_h2d[ch % CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX], usb_audio_out_frame_deinterleaved[ch][i]);
+                asrc_in_frame[i][ch] = volume_scale(vol_mul_h2d[ch], (int32_t)usb_audio_out_frame[i][ch] << src_32_shift);
             }
         }
 
-        // Send to the other channel ASRC task
-        asrc_ctx.input_samples = &usb_audio_out_frame_deinterleaved[1][0];
-        asrc_ctx.output_samples = &frame_samples[1][0];
-        asrc_ctx.fs_ratio = current_rate_ratio;
-        asrc_process_frame_ctx_t *ptr = &asrc_ctx;
-
-
-        (void)rtos_osal_queue_send(&asrc_init_ctx.asrc_queue, &ptr, RTOS_OSAL_WAIT_FOREVER);
-
-        // Call asrc on this block of samples. Reuse frame_samples now that its copied into aec_reference_audio_samples
-
-        unsigned n_samps_out = asrc_process((int *)&usb_audio_out_frame_deinterleaved[0][0], (int *)&frame_samples[0][0], current_rate_ratio, &asrc_ctrl[0][0]);
-
-
-        unsigned n_samps_out_ch1;
-        rtos_osal_queue_receive(&asrc_init_ctx.asrc_ret_queue, &n_samps_out_ch1, RTOS_OSAL_WAIT_FOREVER);
-
-        if (n_samps_out != n_samps_out_ch1)
-        {
-            rtos_printf("Error: USB to I2S ASRC. ch0 and ch1 returned different number of samples: ch0 %u, ch1 %u\n", n_samps_out, n_samps_out_ch1);
-            xassert(0);
-        }
+        unsigned n_samps_out = asrc_mc_process(&asrc_mc, &asrc_in_frame[0][0], &frame_samples_interleaved[0][0], current_rate_ratio);
 
-        for (int ch = 0; ch < CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX; ch++)
-        {
-            for (int i = 0; i < n_samps_out; i++)
-            {
-                frame_samples_interleaved[i][ch] = frame_samples[ch][i];
-            }
-        }
 #if PROFILE_ASRC
         uint32_t end = get_reference_time();
         if(max_time < (end - start))
@@ -649,10 +536,30 @@ void usb_audio_out_asrc(void *arg)
                 appconfUSB_AUDIO_PORT,
                 frame_samples_interleaved,
                 n_samps_out * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX * sizeof(int32_t));
+
+            calc_avg_buffer_level(&usb_in_level_state, usb_in_level, false);
+            calc_avg_buffer_level(&asrc_time_state, (int)((get_reference_time() - read_time) / 100), false);
+            if (usb_in_level_state.flag_first_done && asrc_time_state.flag_first_done)
+            {
+                // On average a sample of the block waits for half a block on top of the samples left behind it
+                g_usb_in_latency_us = (uint32_t)(((uint64_t)(usb_in_level_state.avg_buffer_level + USB_TO_I2S_ASRC_BLOCK_LENGTH / 2) * 1000000) / fs_in) +
+                                      asrc_time_state.avg_buffer_level;
+            }
         }
     }
 }
 
+void usb_audio_get_usb_to_i2s_latency(usb_to_i2s_latency_t *latency)
+{
+    latency->usb_in_us = g_usb_in_latency_us;
+    latency->i2s_send_us = g_i2s_send_buf_latency_us;
+    latency->total_us = 0;
+    if (spkr_interface_open && (latency->usb_in_us != 0) && (latency->i2s_send_us != 0))
+    {
+        latency->total_us = latency->usb_in_us + latency->i2s_send_us;
+    }
+}
+
 //--------------------------------------------------------------------+
 // Application Callback API Implementations
 //--------------------------------------------------------------------+
@@ -1014,7 +921,6 @@ bool tud_audio_rx_done_post_read_cb(uint8_t rhport,
 {
     (void)rhport;
 
-    uint8_t rx_data[CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ];
     samp_t usb_audio_frames[AUDIO_FRAMES_PER_USB_FRAME][CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX];
     const size_t stream_buffer_send_byte_count = sizeof(usb_audio_frames);
 
@@ -1027,44 +933,56 @@ bool tud_audio_rx_done_post_read_cb(uint8_t rhport,
     }
 
     /*
-     * rx_data is a holding space to recieve the latest USB transaction.
-     * If it fits, we then push into rx_buffer. This could be a nominal-size transaction, or it could not be.
+     * The latest USB transaction is read straight into rx_buffer. This could
+     * be a nominal-size transaction, or it could not be.
      * We then only push nominal size transactions into the stream buffer.
      * Hopefully this doesn't cause timing issues in the pipeline.
      */
 
-    if (sizeof(rx_data) >= n_bytes_received)
-    {
-        tud_audio_read(rx_data, n_bytes_received);
-    }
-    else
+    if (spsc_ring_space(&rx_buffer) >= n_bytes_received)
     {
-        /*
-         * I don't believe we ever get here because I think the EP FIFO will complain before this,
-         * but better safe than sorry
-         */
-        rtos_printf("Rx'd too much USB data in one transaction, cannot read\n");
-        return false;
-    }
+        uint16_t n_bytes_read = 0;
 
-    if (xStreamBufferSpacesAvailable(rx_buffer) >= n_bytes_received)
-    {
-        xStreamBufferSend(rx_buffer, rx_data, n_bytes_received, 0);
+        /* Two regions when the transaction wraps around the end of rx_buffer */
+        while (n_bytes_read < n_bytes_received)
+        {
+            uint32_t region_bytes;
+            uint8_t *region = spsc_ring_write_region(&rx_buffer, &region_bytes);
+
+            if (region_bytes > (uint32_t)(n_bytes_received - n_bytes_read))
+            {
+                region_bytes = n_bytes_received - n_bytes_read;
+            }
+            tud_audio_read(region, region_bytes);
+            spsc_ring_write_commit(&rx_buffer, region_bytes);
+            n_bytes_read += region_bytes;
+        }
     }
     else
     {
+        /* Still read the transaction out of the endpoint FIFO, so that it is
+         * dropped now rather than delivered late */
+        uint8_t discard[64];
+        uint16_t n_bytes_read = 0;
+
+        while (n_bytes_read < n_bytes_received)
+        {
+            uint16_t len = n_bytes_received - n_bytes_read;
+
+            if (len > sizeof(discard))
+            {
+                len = sizeof(discard);
+            }
+            tud_audio_read(discard, len);
+            n_bytes_read += len;
+        }
         rtos_printf("Rx'd too much total USB data, cannot buffer\n");
         return false;
     }
 
-    if (xStreamBufferBytesAvailable(rx_buffer) >= sizeof(usb_audio_frames))
+    if (spsc_ring_count(&rx_buffer) >= sizeof(usb_audio_frames))
     {
-        size_t num_rx_total = 0;
-        while (num_rx_total < sizeof(usb_audio_frames))
-        {
-            size_t num_rx = xStreamBufferReceive(rx_buffer, &usb_audio_frames[num_rx_total], sizeof(usb_audio_frames) - num_rx_total, 0);
-            num_rx_total += num_rx;
-        }
+        spsc_ring_read(&rx_buffer, usb_audio_frames, sizeof(usb_audio_frames));
     }
     else
     {
@@ -1253,7 +1171,7 @@ bool tud_audio_set_itf_cb(uint8_t rhport,
          * closing it first */
         spkr_interface_open = false;
         xStreamBufferReset(samples_from_host_stream_buf);
-        xStreamBufferReset(rx_buffer);
+        spsc_ring_reset(&rx_buffer);
     }
 #endif
 #if AUDIO_INPUT_ENABLED
@@ -1365,7 +1283,7 @@ void usb_audio_init(rtos_intertile_t *intertile_ctx,
 
     UserHostActive_GPO_Init(); // Initialise host active GPO port
 
-    rx_buffer = xStreamBufferCreate(2 * CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ, 0);
+    spsc_ring_init(&rx_buffer, rx_buffer_storage, sizeof(rx_buffer_storage[0]), sizeof(rx_buffer_storage));
 
     /*
      * Note: Given the way that the USB callback notifies usb_audio_out_asrc,
@@ -1377,9 +1295,11 @@ void usb_audio_init(rtos_intertile_t *intertile_ctx,
     /*
      * Note: The USB callback waits until there are at least 2 VFE frames
      * in this buffer before starting to send to the host, so the size of
-     * this buffer MUST be AT LEAST 2 VFE frames.
+     * this buffer MUST be AT LEAST 2 VFE frames. The level is held within a few
+     * samples of half full, which leaves room for one ASRC output block at
+     * 44.1kHz and the SOF jitter each side.
      */
-    samples_to_host_stream_buf_size_bytes = 4 * sizeof(samp_t) * I2S_TO_USB_ASRC_BLOCK_LENGTH * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX;
+    samples_to_host_stream_buf_size_bytes = 3 * sizeof(samp_t) * I2S_TO_USB_ASRC_BLOCK_LENGTH * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX;
 
     samples_to_host_stream_buf = xStreamBufferCreate(samples_to_host_stream_buf_size_bytes, 0);
 
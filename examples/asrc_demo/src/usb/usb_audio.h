@@ -1,4 +1,4 @@
-// Copyright 2021-2023 XMOS LIMITED.
+// Copyright 2021-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #ifndef USB_AUDIO_H_
@@ -26,5 +26,19 @@ void usb_audio_send(int32_t *frame_buffer_ptr,
 
 void usb_audio_init(rtos_intertile_t *intertile_ctx, unsigned priority);
 
+/*
+ * Latency of the USB -> ASRC -> I2S path, measured from the buffer levels.
+ * The fixed delays of the ASRC filters and of the I2S driver and DAC are not
+ * included. Each field is 0 until it has been measured, and total_us is 0
+ * while the speaker interface is closed.
+ */
+typedef struct {
+    uint32_t usb_in_us;     /* USB receive buffering and the ASRC processing */
+    uint32_t i2s_send_us;   /* I2S send buffer */
+    uint32_t total_us;
+} usb_to_i2s_latency_t;
+
+void usb_audio_get_usb_to_i2s_latency(usb_to_i2s_latency_t *latency);
+
 
 #endif /* USB_AUDIO_H_ */
@@ -26,6 +26,8 @@
 
 #include "usb_descriptors.h"
 #include "tusb.h"
+#include "rtos_intertile.h"
+#include "usb_audio.h"
 
 #define XMOS_VID        0x20B1
 #define XCORE_VOICE_PID 0x4001
@@ -70,6 +72,9 @@ uint8_t const* tud_descriptor_device_cb(void)
 // Microsoft OS 2.0 Descriptors, Table 8
 #define MS_OS_20_DESCRIPTOR_INDEX 7
 
+// Vendor request for the measured USB -> ASRC -> I2S latency, returned as a usb_to_i2s_latency_t
+#define REQUEST_GET_USB_TO_I2S_LATENCY  0x21
+
 #define BOS_TOTAL_LEN      (TUD_BOS_DESC_LEN + TUD_BOS_MICROSOFT_OS_DESC_LEN)
 
 uint8_t const desc_bos[] =
@@ -319,6 +324,17 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_requ
                 return false;
             }
 
+        case REQUEST_GET_USB_TO_I2S_LATENCY:
+        {
+            // Sent from the data stage, so it can't be on the stack
+            static usb_to_i2s_latency_t latency;
+
+            if (stage != CONTROL_STAGE_SETUP) return true;
+            if (request->bmRequestType_bit.direction != TUSB_DIR_IN) return false;
+            usb_audio_get_usb_to_i2s_latency(&latency);
+            return tud_control_xfer(rhport, request, &latency, sizeof(latency));
+        }
+
         default:
             return false;
     }
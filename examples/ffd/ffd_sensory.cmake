@@ -11,6 +11,17 @@ set(SENSORY_COMMAND_SEARCH_HEADER_FILE "${FFD_SRC_ROOT}/model/${MODEL_LANGUAGE}/
 set(SENSORY_COMMAND_SEARCH_SOURCE_FILE "${FFD_SRC_ROOT}/model/${MODEL_LANGUAGE}/command-pc62w-6.4.0-op10-prod-search.c")
 set(SENSORY_COMMAND_NET_FILE "${FFD_SRC_ROOT}/model/${MODEL_LANGUAGE}/command-pc62w-6.4.0-op10-prod-net.bin.nibble_swapped")
 
+# Wake word model, only compiled in when appconfINTENT_WAKEWORD_MODEL_ENABLED is set.
+# The English model is shared with the low power FFD example; there is no Mandarin one.
+if(MODEL_LANGUAGE STREQUAL "english_usa")
+    set(SENSORY_WAKEWORD_MODEL_ROOT "${FFD_SRC_ROOT}/../low_power_ffd/model")
+    set(SENSORY_WAKEWORD_COMPILE_DEFINITIONS
+        WAKEWORD_NET_SOURCE_FILE="${SENSORY_WAKEWORD_MODEL_ROOT}/wakeword-pc60w-6.1.0-op10-prod-net.c"
+        WAKEWORD_SEARCH_HEADER_FILE="${SENSORY_WAKEWORD_MODEL_ROOT}/wakeword-pc60w-6.1.0-op10-prod-search.h"
+        WAKEWORD_SEARCH_SOURCE_FILE="${SENSORY_WAKEWORD_MODEL_ROOT}/wakeword-pc60w-6.1.0-op10-prod-search.c"
+    )
+endif()
+
 #**********************
 # Gather Sources
 #**********************
@@ -87,6 +98,7 @@ set(APP_COMPILE_DEFINITIONS
     QSPI_FLASH_MODEL_START_ADDRESS=${MODEL_START_ADDRESS}
     QSPI_FLASH_CALIBRATION_ADDRESS=${CALIBRATION_PATTERN_START_ADDRESS}
     COMMAND_SEARCH_SOURCE_FILE="${SENSORY_COMMAND_SEARCH_SOURCE_FILE}"
+    ${SENSORY_WAKEWORD_COMPILE_DEFINITIONS}
     ASR_SENSORY=1
 )
 
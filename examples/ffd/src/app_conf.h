@@ -32,6 +32,11 @@
 #define appconfAUDIO_PLAYBACK_ENABLED           1
 #endif
 
+/* Heap used to keep the shortest audio responses decoded in SRAM */
+#ifndef appconfAUDIO_RESPONSE_CACHE_BYTES
+#define appconfAUDIO_RESPONSE_CACHE_BYTES       (16 * 1024)
+#endif
+
 /* Intent Engine Configuration */
 #define appconfINTENT_FRAME_BUFFER_MULT      (8*2)       /* total buffer size is this value * MIC_ARRAY_CONFIG_SAMPLES_PER_FRAME */
 #define appconfINTENT_SAMPLE_BLOCK_LENGTH    240
@@ -56,6 +61,21 @@
 #define appconfINTENT_RAW_OUTPUT   0
 #endif
 
+/* Run a small wake word model on its own thread, with the command model on a
+ * second thread that only runs after the wake word. The wake word model is
+ * compiled in from WAKEWORD_NET_SOURCE_FILE and WAKEWORD_SEARCH_SOURCE_FILE,
+ * which ffd_sensory.cmake sets for the English model only. Sensory only. */
+#ifndef appconfINTENT_WAKEWORD_MODEL_ENABLED
+#define appconfINTENT_WAKEWORD_MODEL_ENABLED   0
+#endif
+
+/* Keep the ASR running while an audio response plays, so that a command
+ * spoken over the response is not lost. The response is subtracted from the
+ * ASR samples. */
+#ifndef appconfINTENT_BARGE_IN_ENABLED
+#define appconfINTENT_BARGE_IN_ENABLED   1
+#endif
+
 /* Maximum number of detected intents to hold */
 #ifndef appconfINTENT_QUEUE_LEN
 #define appconfINTENT_QUEUE_LEN     10
@@ -148,6 +168,12 @@
 #define appconfAUDIO_PIPELINE_SKIP_AGC   0
 #endif
 
+/* The pipeline emits the ASR channel as int16, which is what the intent
+ * engine takes. Must be 1. */
+#ifndef appconfAUDIO_PIPELINE_ASR_INT16
+#define appconfAUDIO_PIPELINE_ASR_INT16  1
+#endif
+
 #ifndef appconfI2S_AUDIO_SAMPLE_RATE
 #define appconfI2S_AUDIO_SAMPLE_RATE appconfAUDIO_PIPELINE_SAMPLE_RATE
 #endif
@@ -37,6 +37,10 @@
 #include "sw_pll.h"
 #endif
 
+#if !appconfAUDIO_PIPELINE_ASR_INT16
+#error "The intent engine takes int16 samples, appconfAUDIO_PIPELINE_ASR_INT16 must be 1"
+#endif
+
 #ifndef MEM_ANALYSIS_ENABLED
 #define MEM_ANALYSIS_ENABLED 0
 #endif
@@ -142,7 +146,8 @@ int audio_pipeline_output(void *output_app_data,
                           size_t frame_count)
 {
 #if ON_TILE(AUDIO_PIPELINE_OUTPUT_TILE_NO) && appconfINTENT_ENABLED
-    intent_engine_sample_push((int32_t *)output_audio_frames, frame_count);
+    // Channel 0 holds the int16 ASR samples, see appconfAUDIO_PIPELINE_ASR_INT16
+    intent_engine_sample_push((asr_sample_t *)output_audio_frames, frame_count);
 #endif // ON_TILE(AUDIO_PIPELINE_OUTPUT_TILE_NO) && appconfINTENT_ENABLED
 
     return AUDIO_PIPELINE_FREE_FRAME;
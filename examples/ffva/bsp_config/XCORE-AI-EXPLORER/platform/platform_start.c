@@ -13,6 +13,7 @@
 /* App headers */
 #include "platform_conf.h"
 #include "platform/driver_instances.h"
+#include "audio_pipeline_subframe.h"
 #include "aic3204.h"
 #include "usb_support.h"
 
@@ -135,7 +136,7 @@ static void i2s_start(void)
             rtos_i2s_mclk_bclk_ratio(appconfAUDIO_CLOCK_FREQUENCY, appconfPIPELINE_AUDIO_SAMPLE_RATE),
             I2S_MODE_I2S,
             2.2 * MIC_ARRAY_CONFIG_SAMPLES_PER_FRAME,
-            1.2 * MIC_ARRAY_CONFIG_SAMPLES_PER_FRAME,
+            1.2 * AP_FRAME_ADVANCE,
             appconfI2S_INTERRUPT_CORE);
 #endif
 #endif
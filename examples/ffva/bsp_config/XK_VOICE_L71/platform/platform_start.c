@@ -13,6 +13,7 @@
 /* App headers */
 #include "platform_conf.h"
 #include "platform/driver_instances.h"
+#include "audio_pipeline_subframe.h"
 #include "dac3101.h"
 #include "usb_support.h"
 
@@ -124,7 +125,7 @@ static void i2s_start(void)
             rtos_i2s_mclk_bclk_ratio(appconfAUDIO_CLOCK_FREQUENCY, appconfI2S_AUDIO_SAMPLE_RATE),
             I2S_MODE_I2S,
             2.2 * appconfAUDIO_PIPELINE_FRAME_ADVANCE,
-            1.2 * appconfAUDIO_PIPELINE_FRAME_ADVANCE * (appconfI2S_TDM_ENABLED ? 3 : 1),
+            1.2 * AP_FRAME_ADVANCE * (appconfI2S_TDM_ENABLED ? 3 : 1),
             appconfI2S_INTERRUPT_CORE);
 #endif
 #endif
@@ -8,6 +8,7 @@ set(APP_INCLUDES
     ${CMAKE_CURRENT_LIST_DIR}/src
     ${CMAKE_CURRENT_LIST_DIR}/src/control
     ${CMAKE_CURRENT_LIST_DIR}/src/dfu_int
+    ${CMAKE_CURRENT_LIST_DIR}/src/stage_stats_int
     ${CMAKE_CURRENT_LIST_DIR}/src/usb
 )
 
@@ -29,6 +29,7 @@
 #define appconfWW_SAMPLES_PORT         6
 #define appconfAUDIOPIPELINE_PORT      7
 #define appconfI2S_OUTPUT_SLAVE_PORT   8
+#define appconfSTAGE_STATS_PORT        9
 
 #ifndef appconfINTENT_ENGINE_READY_SYNC_PORT
 #define appconfINTENT_ENGINE_READY_SYNC_PORT      18
@@ -204,6 +205,19 @@
 #define appconfUSB_AUDIO_MODE      appconfUSB_AUDIO_RELEASE
 #endif
 
+/*
+ * Only send the reference and raw mic planes from tile 1 when an output
+ * uses them. I2S master outputs the reference, and with TDM the mics too.
+ * USB testing mode outputs all 6 channels.
+ */
+#define appconfUSB_AUDIO_ALL_CHANNELS   (appconfUSB_ENABLED && appconfUSB_AUDIO_MODE == appconfUSB_AUDIO_TESTING)
+#define appconfI2S_OUTPUT_REF           (appconfI2S_ENABLED && appconfI2S_MODE == appconfI2S_MODE_MASTER)
+#define appconfI2S_OUTPUT_MIC           (appconfI2S_OUTPUT_REF && appconfI2S_TDM_ENABLED)
+#ifndef appconfAUDIO_PIPELINE_WIRE_PLANES
+#define appconfAUDIO_PIPELINE_WIRE_PLANES  ((appconfUSB_AUDIO_ALL_CHANNELS || appconfI2S_OUTPUT_REF ? AP_WIRE_PLANE_REF : 0) | \
+                                            (appconfUSB_AUDIO_ALL_CHANNELS || appconfI2S_OUTPUT_MIC ? AP_WIRE_PLANE_MIC : 0))
+#endif
+
 #define appconfSPI_AUDIO_RELEASE   0
 #define appconfSPI_AUDIO_TESTING   1
 #ifndef appconfSPI_AUDIO_MODE
@@ -11,6 +11,7 @@
 #include "device_control_i2c.h"
 #include "servicer.h"
 #include "dfu_servicer.h"
+#include "stage_stats_servicer.h"
 
 #if appconfI2C_DFU_ENABLED && ON_TILE(I2C_CTRL_TILE_NO)
 static device_control_t device_control_i2c_ctx_s;
@@ -149,6 +150,9 @@ control_ret_t servicer_write_cmd(control_resource_info_t *res_info, control_cmd_
         case DFU_CONTROLLER_SERVICER_RESID:
             return dfu_servicer_write_cmd(res_info, cmd, payload, payload_len);
         break;
+        case STAGE_STATS_SERVICER_RESID:
+            return stage_stats_servicer_write_cmd(res_info, cmd, payload, payload_len);
+        break;
     }
     return CONTROL_SUCCESS;
 }
@@ -163,6 +167,9 @@ control_ret_t servicer_read_cmd(control_resource_info_t *res_info, control_cmd_t
         case DFU_CONTROLLER_SERVICER_RESID:
             ret = dfu_servicer_read_cmd(res_info, cmd, payload, payload_len);
             break;
+        case STAGE_STATS_SERVICER_RESID:
+            ret = stage_stats_servicer_read_cmd(res_info, cmd, payload, payload_len);
+            break;
     }
     return ret;
 }
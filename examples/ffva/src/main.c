@@ -14,6 +14,7 @@
 /* Library headers */
 #include "rtos_printf.h"
 #include "src.h"
+#include "xmath/xmath.h"
 
 /* App headers */
 #include "app_conf.h"
@@ -24,6 +25,7 @@
 #include "usb_audio.h"
 #include "audio_pipeline.h"
 #include "dfu_servicer.h"
+#include "stage_stats_servicer.h"
 
 /* Headers used for the WW intent engine */
 #if appconfINTENT_ENABLED
@@ -239,11 +241,12 @@ int audio_pipeline_output(void *output_app_data,
 #endif
 #if appconfINTENT_ENABLED
 
-    int32_t ww_samples[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
-    for (int j=0; j<appconfAUDIO_PIPELINE_FRAME_ADVANCE; j++) {
-        /* ASR output is first */
-        ww_samples[j] = (uint32_t) *(output_audio_frames+j);
-    }
+    /* ASR output is first */
+    asr_sample_t ww_samples[appconfAUDIO_PIPELINE_FRAME_ADVANCE] __attribute__((aligned(8)));
+    vect_s32_to_vect_s16(ww_samples,
+                         (int32_t *)output_audio_frames,
+                         frame_count,
+                         16);
 
     intent_engine_sample_push(ww_samples,
                               frame_count);
@@ -389,6 +392,29 @@ void startup_task(void *arg)
         appconfDEVICE_CONTROL_I2C_PRIORITY,
         NULL
     );
+
+    servicer_t servicer_stage_stats;
+    stage_stats_servicer_init(&servicer_stage_stats);
+
+    xTaskCreate(
+        stage_stats_servicer,
+        "Stage stats servicer",
+        RTOS_THREAD_STACK_SIZE(stage_stats_servicer),
+        &servicer_stage_stats,
+        appconfDEVICE_CONTROL_I2C_PRIORITY,
+        NULL
+    );
+#endif
+
+#if appconfI2C_DFU_ENABLED && !ON_TILE(I2C_CTRL_TILE_NO)
+    xTaskCreate(
+        stage_stats_remote,
+        "Stage stats remote",
+        RTOS_THREAD_STACK_SIZE(stage_stats_remote),
+        NULL,
+        appconfDEVICE_CONTROL_I2C_PRIORITY,
+        NULL
+    );
 #endif
 
 #if appconfINTENT_ENABLED && ON_TILE(0)
@@ -0,0 +1,50 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+// STAGE_STATS_SERVICER_RESID commands
+enum e_stage_stats_servicer_resid_cmds
+{
+#ifndef STAGE_STATS_SERVICER_RESID_NUM_STAGES
+    STAGE_STATS_SERVICER_RESID_NUM_STAGES = 0,
+#endif
+#ifndef STAGE_STATS_SERVICER_RESID_SELECT_STAGE
+    STAGE_STATS_SERVICER_RESID_SELECT_STAGE = 1,
+#endif
+#ifndef STAGE_STATS_SERVICER_RESID_STAGE_STATS
+    STAGE_STATS_SERVICER_RESID_STAGE_STATS = 2,
+#endif
+#ifndef STAGE_STATS_SERVICER_RESID_RESET
+    STAGE_STATS_SERVICER_RESID_RESET = 3,
+#endif
+    NUM_STAGE_STATS_SERVICER_RESID_CMDS = 4
+};
+
+// STAGE_STATS_SERVICER_RESID number of elements
+// number of values of type uint8_t expected by STAGE_STATS_SERVICER_RESID_NUM_STAGES
+#define STAGE_STATS_SERVICER_RESID_NUM_STAGES_NUM_VALUES (1)
+// number of values of type uint8_t expected by STAGE_STATS_SERVICER_RESID_SELECT_STAGE
+#define STAGE_STATS_SERVICER_RESID_SELECT_STAGE_NUM_VALUES (1)
+// number of values of type uint8_t expected by STAGE_STATS_SERVICER_RESID_STAGE_STATS
+#define STAGE_STATS_SERVICER_RESID_STAGE_STATS_NUM_VALUES (40)
+// number of values of type uint8_t expected by STAGE_STATS_SERVICER_RESID_RESET
+#define STAGE_STATS_SERVICER_RESID_RESET_NUM_VALUES (1)
+
+/*
+ * STAGE_STATS_SERVICER_RESID_STAGE_STATS payload, for the stage chosen with
+ * STAGE_STATS_SERVICER_RESID_SELECT_STAGE. Stages on the control tile are
+ * numbered first, then those on the other tile. All values are little endian.
+ *
+ *   byte  0       tile the stage runs on
+ *   bytes 1..15   stage name, NUL terminated
+ *   bytes 16..19  frames recorded
+ *   bytes 20..23  min stage time, 100MHz ticks
+ *   bytes 24..27  average stage time
+ *   bytes 28..31  p99 stage time
+ *   bytes 32..35  max stage time
+ *   bytes 36..39  frames over the frame deadline
+ */
+#define STAGE_STATS_NAME_BYTES (15)
@@ -0,0 +1,17 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+
+// STAGE_STATS_SERVICER_RESID command map
+// This array may be unused as servicers can be moved between tiles
+// Unused variable warnings are suppressed in this header file
+static control_cmd_info_t stage_stats_servicer_resid_cmd_map[] =
+{
+    { STAGE_STATS_SERVICER_RESID_NUM_STAGES, STAGE_STATS_SERVICER_RESID_NUM_STAGES_NUM_VALUES, sizeof(uint8_t), CMD_READ_ONLY },
+    { STAGE_STATS_SERVICER_RESID_SELECT_STAGE, STAGE_STATS_SERVICER_RESID_SELECT_STAGE_NUM_VALUES, sizeof(uint8_t), CMD_READ_WRITE },
+    { STAGE_STATS_SERVICER_RESID_STAGE_STATS, STAGE_STATS_SERVICER_RESID_STAGE_STATS_NUM_VALUES, sizeof(uint8_t), CMD_READ_ONLY },
+    { STAGE_STATS_SERVICER_RESID_RESET, STAGE_STATS_SERVICER_RESID_RESET_NUM_VALUES, sizeof(uint8_t), CMD_WRITE_ONLY },
+};
+#pragma clang diagnostic pop
@@ -0,0 +1,225 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#define DEBUG_UNIT STAGE_STATS_SERVICER
+#ifndef DEBUG_PRINT_ENABLE_STAGE_STATS_SERVICER
+#define DEBUG_PRINT_ENABLE_STAGE_STATS_SERVICER 0
+#endif
+#include "debug_print.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <platform.h>
+#include <xassert.h>
+
+#include "app_conf.h"
+#include "platform/platform_conf.h"
+#include "platform/driver_instances.h"
+#include "servicer.h"
+#include "stage_stats_servicer.h"
+#include "stage_stats_cmds.h"
+#include "stage_stats.h"
+
+/* Requests sent from the servicer to stage_stats_remote() on the other tile */
+enum {
+    STAGE_STATS_REMOTE_COUNT,
+    STAGE_STATS_REMOTE_GET,
+    STAGE_STATS_REMOTE_RESET,
+};
+
+typedef struct {
+    uint8_t op;
+    uint8_t index;
+} stage_stats_remote_req_t;
+
+static uint8_t selected_stage;
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+/* Fills in a STAGE_STATS_SERVICER_RESID_STAGE_STATS payload for a stage on this tile */
+static void stage_stats_pack(int id, uint8_t *payload)
+{
+    stage_stats_summary_t summary;
+    stage_stats_get(id, &summary);
+
+    memset(payload, 0, STAGE_STATS_SERVICER_RESID_STAGE_STATS_NUM_VALUES);
+    payload[0] = THIS_XCORE_TILE;
+    if (summary.name != NULL) {
+        strncpy((char *)&payload[1], summary.name, STAGE_STATS_NAME_BYTES - 1);
+    }
+    put_u32(&payload[16], summary.frames);
+    put_u32(&payload[20], summary.min_ticks);
+    put_u32(&payload[24], summary.avg_ticks);
+    put_u32(&payload[28], summary.p99_ticks);
+    put_u32(&payload[32], summary.max_ticks);
+    put_u32(&payload[36], summary.deadline_misses);
+}
+
+/* Sends a request to the other tile and waits for its reply */
+static void stage_stats_remote_call(uint8_t op, uint8_t index, uint8_t *reply)
+{
+    stage_stats_remote_req_t req = {
+        .op = op,
+        .index = index,
+    };
+
+    rtos_intertile_tx(intertile_ctx, appconfSTAGE_STATS_PORT, &req, sizeof(req));
+
+    size_t len = rtos_intertile_rx_len(intertile_ctx, appconfSTAGE_STATS_PORT, portMAX_DELAY);
+    xassert(len == STAGE_STATS_SERVICER_RESID_STAGE_STATS_NUM_VALUES);
+    rtos_intertile_rx_data(intertile_ctx, reply, len);
+}
+
+void stage_stats_remote(void *args)
+{
+    (void) args;
+    uint8_t reply[STAGE_STATS_SERVICER_RESID_STAGE_STATS_NUM_VALUES];
+
+    for (;;) {
+        stage_stats_remote_req_t req;
+        size_t len = rtos_intertile_rx_len(intertile_ctx, appconfSTAGE_STATS_PORT, portMAX_DELAY);
+        xassert(len == sizeof(req));
+        rtos_intertile_rx_data(intertile_ctx, &req, len);
+
+        memset(reply, 0, sizeof(reply));
+        switch (req.op) {
+        case STAGE_STATS_REMOTE_COUNT:
+            reply[0] = stage_stats_count();
+            break;
+        case STAGE_STATS_REMOTE_GET:
+            if (req.index < stage_stats_count()) {
+                stage_stats_pack(req.index, reply);
+            }
+            break;
+        case STAGE_STATS_REMOTE_RESET:
+            stage_stats_reset();
+            break;
+        }
+
+        rtos_intertile_tx(intertile_ctx, appconfSTAGE_STATS_PORT, reply, sizeof(reply));
+    }
+}
+
+void stage_stats_servicer_init(servicer_t *servicer)
+{
+    #include "stage_stats_cmds_map.h"
+    // Servicer resource info
+    static control_resource_info_t stage_stats_res_info[NUM_RESOURCES_STAGE_STATS_SERVICER];
+
+    memset(servicer, 0, sizeof(servicer_t));
+    servicer->id = STAGE_STATS_SERVICER_RESID;
+    servicer->start_io = 0;
+    servicer->num_resources = NUM_RESOURCES_STAGE_STATS_SERVICER;
+
+    servicer->res_info = &stage_stats_res_info[0];
+    // Servicer resource
+    servicer->res_info[0].resource = STAGE_STATS_SERVICER_RESID;
+    servicer->res_info[0].command_map.num_commands = NUM_STAGE_STATS_SERVICER_RESID_CMDS;
+    servicer->res_info[0].command_map.commands = stage_stats_servicer_resid_cmd_map;
+}
+
+void stage_stats_servicer(void *args) {
+    device_control_servicer_t servicer_ctx;
+
+    servicer_t *servicer = (servicer_t*)args;
+    xassert(servicer != NULL);
+
+    control_resid_t *resources = (control_resid_t*)pvPortMalloc(servicer->num_resources * sizeof(control_resid_t));
+    for(int i=0; i<servicer->num_resources; i++)
+    {
+        resources[i] = servicer->res_info[i].resource;
+    }
+
+    control_ret_t dc_ret;
+    debug_printf("Calling device_control_servicer_register(), servicer ID %d, on tile %d, core %d.\n", servicer->id, THIS_XCORE_TILE, rtos_core_id_get());
+
+    dc_ret = device_control_servicer_register(&servicer_ctx,
+                                            device_control_ctxs,
+                                            1,
+                                            resources, servicer->num_resources);
+    xassert(dc_ret == CONTROL_SUCCESS);
+    (void) dc_ret;
+
+    vPortFree(resources);
+
+    for(;;){
+        device_control_servicer_cmd_recv(&servicer_ctx, read_cmd, write_cmd, servicer, RTOS_OSAL_WAIT_FOREVER);
+    }
+}
+
+control_ret_t stage_stats_servicer_read_cmd(control_resource_info_t *res_info, control_cmd_t cmd, uint8_t *payload, size_t payload_len)
+{
+    control_ret_t ret = CONTROL_SUCCESS;
+    uint8_t cmd_id = CONTROL_CMD_CLEAR_READ(cmd);
+    uint8_t reply[STAGE_STATS_SERVICER_RESID_STAGE_STATS_NUM_VALUES];
+    (void) res_info;
+
+    memset(payload, 0, payload_len);
+
+    debug_printf("stage_stats_servicer_read_cmd, cmd_id: %d.\n", cmd_id);
+
+    int local_count = stage_stats_count();
+
+    switch (cmd_id)
+    {
+    case STAGE_STATS_SERVICER_RESID_NUM_STAGES:
+        stage_stats_remote_call(STAGE_STATS_REMOTE_COUNT, 0, reply);
+        payload[0] = local_count + reply[0];
+        break;
+
+    case STAGE_STATS_SERVICER_RESID_SELECT_STAGE:
+        payload[0] = selected_stage;
+        break;
+
+    case STAGE_STATS_SERVICER_RESID_STAGE_STATS:
+        if (selected_stage < local_count) {
+            stage_stats_pack(selected_stage, payload);
+        } else {
+            stage_stats_remote_call(STAGE_STATS_REMOTE_GET, selected_stage - local_count, reply);
+            memcpy(payload, reply, STAGE_STATS_SERVICER_RESID_STAGE_STATS_NUM_VALUES);
+        }
+        break;
+
+    default:
+        debug_printf("CONTROL_ERROR\n");
+        ret = CONTROL_ERROR;
+        break;
+    }
+
+    return ret;
+}
+
+control_ret_t stage_stats_servicer_write_cmd(control_resource_info_t *res_info, control_cmd_t cmd, const uint8_t *payload, size_t payload_len)
+{
+    control_ret_t ret = CONTROL_SUCCESS;
+    uint8_t cmd_id = CONTROL_CMD_CLEAR_READ(cmd);
+    uint8_t reply[STAGE_STATS_SERVICER_RESID_STAGE_STATS_NUM_VALUES];
+    (void) res_info;
+    (void) payload_len;
+
+    debug_printf("stage_stats_servicer_write_cmd, cmd_id: %d.\n", cmd_id);
+
+    switch (cmd_id)
+    {
+    case STAGE_STATS_SERVICER_RESID_SELECT_STAGE:
+        selected_stage = payload[0];
+        break;
+
+    case STAGE_STATS_SERVICER_RESID_RESET:
+        stage_stats_reset();
+        stage_stats_remote_call(STAGE_STATS_REMOTE_RESET, 0, reply);
+        break;
+
+    default:
+        debug_printf("CONTROL_ERROR\n");
+        ret = CONTROL_ERROR;
+        break;
+    }
+
+    return ret;
+}
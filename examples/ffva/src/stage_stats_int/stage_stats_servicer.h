@@ -0,0 +1,57 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#pragma once
+
+#include "servicer.h"
+
+#define STAGE_STATS_SERVICER_RESID      (241)
+#define NUM_RESOURCES_STAGE_STATS_SERVICER (1)
+
+/**
+ * @brief Audio pipeline stage statistics servicer task.
+ *
+ * This task answers device control reads of the stage_stats counters of the
+ * audio pipeline stages on both tiles. It must run on the control tile.
+ *
+ * \param args      Pointer to the Servicer's state data structure
+ */
+void stage_stats_servicer(void *args);
+
+/**
+ * @brief Stage statistics servicer initialisation function.
+ * \param servicer      Pointer to the Servicer's state data structure
+ */
+void stage_stats_servicer_init(servicer_t *servicer);
+
+/**
+ * @brief Task that returns the stage_stats counters of the tile it runs on
+ * to the stage statistics servicer. It must run on the tile that is not the
+ * control tile.
+ *
+ * \param args      Unused
+ */
+void stage_stats_remote(void *args);
+
+/**
+ * @brief Stage statistics servicer read command handler
+ *
+ * @param res_info          Resource info of the current command
+ * @param cmd               Command ID of this command
+ * @param payload           Pointer to the payload to fill with the read data
+ * @param payload_len       Length in bytes of the read command payload
+ * @return control_ret_t    CONTROL_SUCCESS if command handled successfully,
+ *                          otherwise control_ret_t error status indicating the error.
+ */
+control_ret_t stage_stats_servicer_read_cmd(control_resource_info_t *res_info, control_cmd_t cmd, uint8_t *payload, size_t payload_len);
+
+/**
+ * @brief Stage statistics servicer write command handler
+ *
+ * @param res_info          Resource info of the current command
+ * @param cmd               Command ID of this command
+ * @param payload           Pointer to the payload that contains the write data
+ * @param payload_len       Length in bytes of the write command payload
+ * @return control_ret_t    CONTROL_SUCCESS if command handled successfully,
+ *                          otherwise control_ret_t error status indicating the error.
+ */
+control_ret_t stage_stats_servicer_write_cmd(control_resource_info_t *res_info, control_cmd_t cmd, const uint8_t *payload, size_t payload_len);
@@ -44,6 +44,7 @@
 #include "rtos_intertile.h"
 
 #include "audio_pipeline.h"
+#include "audio_pipeline_subframe.h"
 
 #include "app_conf.h"
 
@@ -73,6 +74,19 @@ static TaskHandle_t usb_audio_out_task_handle;
 
 #define USB_FRAMES_PER_VFE_FRAME (appconfAUDIO_PIPELINE_FRAME_ADVANCE / (appconfAUDIO_PIPELINE_SAMPLE_RATE / 1000))
 
+#if (appconfAUDIO_PIPELINE_FRAME_ADVANCE % (appconfAUDIO_PIPELINE_SAMPLE_RATE / 1000)) != 0
+#error appconfAUDIO_PIPELINE_FRAME_ADVANCE must be a whole number of 1 ms USB frames
+#endif
+
+/*
+ * The pipeline output comes a block of AP_FRAME_ADVANCE samples at a time,
+ * as AP_SUBFRAMES frames back to back. Sending to the host starts once a
+ * block and a frame are buffered, so a block is left to cover the gap to
+ * the next one. With a 240 sample frame advance this is 2 frames, as before.
+ */
+#define SAMPLES_TO_HOST_START_FRAMES    (AP_FRAME_ADVANCE + appconfAUDIO_PIPELINE_FRAME_ADVANCE)
+#define SAMPLES_TO_HOST_BUF_FRAMES      (2 * AP_FRAME_ADVANCE + appconfAUDIO_PIPELINE_FRAME_ADVANCE)
+
 //--------------------------------------------------------------------+
 // Device callbacks
 //--------------------------------------------------------------------+
@@ -669,8 +683,8 @@ bool tud_audio_tx_done_pre_load_cb(uint8_t rhport,
 
     bytes_available = xStreamBufferBytesAvailable(samples_to_host_stream_buf);
 
-    if (bytes_available >= 2 * sizeof(samp_t) * appconfAUDIO_PIPELINE_FRAME_ADVANCE * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX) {
-        /* wait until we have 2 full audio pipeline output frames in the buffer */
+    if (bytes_available >= sizeof(samp_t) * SAMPLES_TO_HOST_START_FRAMES * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX) {
+        /* wait until we have a full audio pipeline output block and frame in the buffer */
         ready = 1;
     }
 
@@ -817,11 +831,12 @@ void usb_audio_init(rtos_intertile_t *intertile_ctx,
                                             0);
 
     /*
-     * Note: The USB callback waits until there are at least 2 VFE frames
-     * in this buffer before starting to send to the host, so the size of
-     * this buffer MUST be AT LEAST 2 VFE frames.
+     * Note: The USB callback waits until there are SAMPLES_TO_HOST_START_FRAMES
+     * in this buffer before starting to send to the host, and the pipeline
+     * then adds a whole block at a time, so this buffer MUST hold at least
+     * that plus a block.
      */
-    samples_to_host_stream_buf = xStreamBufferCreate(3 * sizeof(samp_t) * appconfAUDIO_PIPELINE_FRAME_ADVANCE * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX,
+    samples_to_host_stream_buf = xStreamBufferCreate(sizeof(samp_t) * SAMPLES_TO_HOST_BUF_FRAMES * CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX,
                                             0);
 
     xTaskCreate((TaskFunction_t) usb_audio_out_task, "usb_audio_out_task", portTASK_STACK_DEPTH(usb_audio_out_task), intertile_ctx, priority, &usb_audio_out_task_handle);
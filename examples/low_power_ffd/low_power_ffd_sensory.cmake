@@ -104,6 +104,7 @@ set(APP_COMMON_LINK_LIBRARIES
     sln_voice::app::asr::sensory
     rtos::drivers::clock_control
     sln_voice::app::asr::device_memory
+    spsc_ring
 )
 
 #**********************
@@ -47,6 +47,12 @@
 #define appconfINTENT_FRAME_BUFFER_MULT         (8*2)       /* total buffer size is this value * MIC_ARRAY_CONFIG_SAMPLES_PER_FRAME */
 #define appconfINTENT_SAMPLE_BLOCK_LENGTH       240
 
+/* Maximum number of queued bricks passed to the ASR in one asr_process_batch()
+ * call, e.g. when catching up on the audio buffered while in low power */
+#ifndef appconfINTENT_BATCH_MAX_BRICKS
+#define appconfINTENT_BATCH_MAX_BRICKS          8
+#endif
+
 /* Maximum delay between a wake up phrase and command phrase */
 #ifndef appconfINTENT_RESET_DELAY_MS
 #define appconfINTENT_RESET_DELAY_MS            4000
@@ -95,9 +101,24 @@
 #endif
 
 /* The number of frames to store in the ring buffer, where each frame contains
- * appconfAUDIO_PIPELINE_FRAME_ADVANCE samples. */
+ * appconfAUDIO_PIPELINE_FRAME_ADVANCE samples. The storage is rounded up to a
+ * power of two number of samples, so 17 frames of 240 samples (255 ms) are
+ * held in a 4096 sample buffer. */
 #ifndef appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES
-#define appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES 20
+#define appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES 17
+#endif
+
+/* The number of processed frames that can wait for the ring buffer drain
+ * task, while it is blocked pushing the backlog to the intent engine. */
+#ifndef appconfAUDIO_PIPELINE_BUFFER_INPUT_FRAMES
+#define appconfAUDIO_PIPELINE_BUFFER_INPUT_FRAMES 4
+#endif
+
+/* How long the intent engine's sample receiver waits for space in its stream
+ * buffer before dropping samples. This throttles the ring buffer drain to the
+ * rate at which the ASR consumes the backlog. */
+#ifndef appconfINTENT_SAMPLES_SEND_TIMEOUT_MS
+#define appconfINTENT_SAMPLES_SEND_TIMEOUT_MS   30
 #endif
 
 #ifndef appconfLOW_POWER_SWITCH_CLK_DIV_ENABLE
@@ -142,6 +163,12 @@
 #define appconfAUDIO_PIPELINE_SKIP_AGC          0
 #endif
 
+/* The pipeline emits the ASR channel as int16, which is what the intent
+ * engine takes. Must be 1. */
+#ifndef appconfAUDIO_PIPELINE_ASR_INT16
+#define appconfAUDIO_PIPELINE_ASR_INT16         1
+#endif
+
 #ifndef appconfI2S_AUDIO_SAMPLE_RATE
 #define appconfI2S_AUDIO_SAMPLE_RATE            appconfAUDIO_PIPELINE_SAMPLE_RATE
 #endif
@@ -159,6 +186,7 @@
 /* Task Priorities */
 #define appconfSTARTUP_TASK_PRIORITY                (configMAX_PRIORITIES / 2 + 5)
 #define appconfAUDIO_PIPELINE_TASK_PRIORITY    	    (configMAX_PRIORITIES / 2)
+#define appconfAUDIO_PIPELINE_BUFFER_TASK_PRIORITY  (configMAX_PRIORITIES / 2)
 #define appconfINTENT_MODEL_RUNNER_TASK_PRIORITY    (configMAX_PRIORITIES - 2)
 #define appconfINTENT_HMI_TASK_PRIORITY             (configMAX_PRIORITIES / 2)
 #define appconfGPIO_RPC_PRIORITY                    (configMAX_PRIORITIES / 2)
@@ -71,7 +71,7 @@ static uint32_t timeout_event = TIMEOUT_EVENT_NONE;
 static uint32_t asr_halted = 0;
 
 static void vIntentTimerCallback(TimerHandle_t pxTimer);
-static void receive_audio_frames(StreamBufferHandle_t input_queue, asr_sample_t *buf);
+static size_t receive_audio_frames(StreamBufferHandle_t input_queue, asr_sample_t *buf);
 static void timeout_event_handler(TimerHandle_t pxTimer);
 static void hold_intent_state(TimerHandle_t pxTimer);
 static void hold_full_power(TimerHandle_t pxTimer);
@@ -83,10 +83,17 @@ static void vIntentTimerCallback(TimerHandle_t pxTimer)
     timeout_event |= TIMEOUT_EVENT_INTENT;
 }
 
-static void receive_audio_frames(StreamBufferHandle_t input_queue, asr_sample_t *buf)
+/*
+ * Blocks until one brick has been received, then takes any further whole
+ * bricks that are already queued, such as the audio buffered while in low
+ * power, up to appconfINTENT_BATCH_MAX_BRICKS. Returns the number of bricks.
+ */
+static size_t receive_audio_frames(StreamBufferHandle_t input_queue, asr_sample_t *buf)
 {
+    const size_t brick_bytes = SAMPLES_PER_ASR * sizeof(asr_sample_t);
     uint8_t *buf_ptr = (uint8_t*)buf;
-    size_t buf_len = SAMPLES_PER_ASR * sizeof(asr_sample_t);
+    size_t buf_len = brick_bytes;
+    size_t available;
 
     do {
         size_t bytes_rxed = xStreamBufferReceive(input_queue,
@@ -96,6 +103,18 @@ static void receive_audio_frames(StreamBufferHandle_t input_queue, asr_sample_t
         buf_len -= bytes_rxed;
         buf_ptr += bytes_rxed;
     } while (buf_len > 0);
+
+    available = xStreamBufferBytesAvailable(input_queue) / brick_bytes;
+    if (available > appconfINTENT_BATCH_MAX_BRICKS - 1) {
+        available = appconfINTENT_BATCH_MAX_BRICKS - 1;
+    }
+    if (available > 0) {
+        /* Whole bricks are already queued, so this does not block */
+        buf_len = xStreamBufferReceive(input_queue, buf_ptr, available * brick_bytes, 0);
+        xassert(buf_len == available * brick_bytes);
+    }
+
+    return 1 + available;
 }
 
 static void timeout_event_handler(TimerHandle_t pxTimer)
@@ -204,7 +223,7 @@ void intent_engine_low_power_accept(void)
 void intent_engine_task(void *args)
 {
     StreamBufferHandle_t input_queue = (StreamBufferHandle_t)args;
-    asr_sample_t buf[SAMPLES_PER_ASR] = {0};
+    static asr_sample_t buf[SAMPLES_PER_ASR * appconfINTENT_BATCH_MAX_BRICKS] = {0};
     asr_error_t asr_error = ASR_OK;
     asr_result_t asr_result;
 
@@ -242,29 +261,30 @@ void intent_engine_task(void *args)
             continue;
         }
 
-        receive_audio_frames(input_queue, buf);
-
-        if (run_asr == 0)
-            continue;
-
-        asr_error = asr_process(asr_ctx, buf, SAMPLES_PER_ASR);
-
-        if (asr_error == ASR_OK) {
-            asr_error = asr_get_result(asr_ctx, &asr_result);
-        }
-
-        if (asr_error == ASR_EVALUATION_EXPIRED || asr_halted) {
-            xTimerStop(int_eng_tmr, 0);
-            timeout_event = TIMEOUT_EVENT_NONE;
-            asr_halted = 1;
-            run_asr = 0;
-            led_indicate_end_of_eval();
-            debug_printf("ASR evaluation ended. Restart device to restore operation.\n");
-        } else if (asr_error != ASR_OK) {
-            debug_printf("ASR error on tile %d: %d\n", THIS_XCORE_TILE, asr_error);
-        } else if (IS_COMMAND(asr_result.id)) {
-            hold_intent_state(int_eng_tmr);
-            intent_engine_process_asr_result(asr_result.id);
+        size_t brick_count = receive_audio_frames(input_queue, buf);
+
+        /* A backlog of bricks is processed in one call, which returns early
+         * on a result so that each result is handled in order. */
+        for (size_t brick = 0; run_asr && brick < brick_count; ) {
+            size_t bricks_processed = 0;
+
+            asr_error = asr_process_batch(asr_ctx, &buf[brick * SAMPLES_PER_ASR], SAMPLES_PER_ASR,
+                                          brick_count - brick, &bricks_processed, &asr_result);
+            brick += bricks_processed;
+
+            if (asr_error == ASR_EVALUATION_EXPIRED || asr_halted) {
+                xTimerStop(int_eng_tmr, 0);
+                timeout_event = TIMEOUT_EVENT_NONE;
+                asr_halted = 1;
+                run_asr = 0;
+                led_indicate_end_of_eval();
+                debug_printf("ASR evaluation ended. Restart device to restore operation.\n");
+            } else if (asr_error != ASR_OK) {
+                debug_printf("ASR error on tile %d: %d\n", THIS_XCORE_TILE, asr_error);
+            } else if (IS_COMMAND(asr_result.id)) {
+                hold_intent_state(int_eng_tmr);
+                intent_engine_process_asr_result(asr_result.id);
+            }
         }
     }
 }
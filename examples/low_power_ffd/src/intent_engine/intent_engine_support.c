@@ -59,7 +59,10 @@ static void intent_engine_intertile_samples_in_task(void *arg)
                 samples,
                 bytes_received);
 
-        if (xStreamBufferSend(samples_to_engine_stream_buf, samples, sizeof(samples), 0) != sizeof(samples)) {
+        /* Waiting for space holds off the sender on the other tile, which
+         * paces the low power audio buffer drain to the rate of the ASR. */
+        if (xStreamBufferSend(samples_to_engine_stream_buf, samples, sizeof(samples),
+                              pdMS_TO_TICKS(appconfINTENT_SAMPLES_SEND_TIMEOUT_MS)) != sizeof(samples)) {
             rtos_printf("lost output samples for intent\n");
         }
     }
@@ -33,6 +33,10 @@
 #include "power/power_control.h"
 #include "power/low_power_audio_buffer.h"
 
+#if !appconfAUDIO_PIPELINE_ASR_INT16
+#error "The ASR takes int16 samples, appconfAUDIO_PIPELINE_ASR_INT16 must be 1"
+#endif
+
 #ifndef MEM_ANALYSIS_ENABLED
 #define MEM_ANALYSIS_ENABLED 0
 #endif
@@ -104,12 +108,8 @@ int audio_pipeline_output(void *output_app_data,
 {
 #if ON_TILE(AUDIO_PIPELINE_OUTPUT_TILE_NO)
 
-    asr_sample_t asr_buf[appconfAUDIO_PIPELINE_FRAME_ADVANCE] = {0};
-
-    for (int i = 0; i < frame_count; i++) {
-        asr_buf[i] = ((int32_t *)output_audio_frames)[i] >> 16;
-    }
-    vPortFree(output_audio_frames);
+    // Channel 0 holds the int16 ASR samples, see appconfAUDIO_PIPELINE_ASR_INT16
+    asr_sample_t *asr_buf = (asr_sample_t *)output_audio_frames;
 
     wakeword_result_t ww_res = wakeword_handler((asr_sample_t *)asr_buf, frame_count);
 
@@ -126,20 +126,9 @@ int audio_pipeline_output(void *output_app_data,
     }
 
 #if LOW_POWER_AUDIO_BUFFER_ENABLED
-    const uint32_t max_dequeue_packets = 1;
-    const uint32_t max_dequeued_samples = (max_dequeue_packets * appconfAUDIO_PIPELINE_FRAME_ADVANCE);
-
-    if (power_control_state_get() == POWER_STATE_FULL) {
-        if (low_power_audio_buffer_dequeue(max_dequeue_packets) == max_dequeued_samples) {
-            // Max data has been dequeued, enqueue the newest data.
-            low_power_audio_buffer_enqueue(asr_buf, frame_count);
-        } else {
-            // More data can be sent.
-            intent_engine_sample_push(asr_buf, frame_count);
-        }
-    } else {
-        low_power_audio_buffer_enqueue(asr_buf, frame_count);
-    }
+    // The drain task buffers the frame and, at full power, forwards the
+    // backlog ahead of it to the intent engine.
+    low_power_audio_buffer_frame_send(asr_buf, frame_count);
 #else // LOW_POWER_AUDIO_BUFFER_ENABLED
     if (power_control_state_get() == POWER_STATE_FULL) {
         intent_engine_sample_push(asr_buf, frame_count);
@@ -147,7 +136,7 @@ int audio_pipeline_output(void *output_app_data,
 #endif // LOW_POWER_AUDIO_BUFFER_ENABLED
 #endif // ON_TILE(AUDIO_PIPELINE_OUTPUT_TILE_NO)
 
-    return AUDIO_PIPELINE_DONT_FREE_FRAME;
+    return AUDIO_PIPELINE_FREE_FRAME;
 }
 
 void vApplicationMallocFailedHook(void)
@@ -215,6 +204,9 @@ void startup_task(void *arg)
     // Wait until the intent engine is initialized before starting the
     // audio pipeline.
     intent_engine_ready_sync();
+#if LOW_POWER_AUDIO_BUFFER_ENABLED
+    low_power_audio_buffer_drain_task_create(appconfAUDIO_PIPELINE_BUFFER_TASK_PRIORITY);
+#endif
     audio_pipeline_init(NULL, NULL);
 
     set_local_tile_processor_clk_div(1);
@@ -38,4 +38,25 @@ void low_power_audio_buffer_enqueue(asr_sample_t *samples, size_t num_samples);
  */
 uint32_t low_power_audio_buffer_dequeue(uint32_t num_packets);
 
+/**
+ * Create the task that owns the ring buffer. Every processed frame is
+ * enqueued by this task. At full power it pushes the buffered frames to the
+ * intent engine, oldest first, as fast as the intent engine accepts them,
+ * then carries on with live frames as they arrive.
+ *
+ * \param priority      The priority of the task.
+ */
+void low_power_audio_buffer_drain_task_create(unsigned priority);
+
+/**
+ * Hand a processed frame to the drain task. Does not block; the frame is
+ * dropped if the drain task has fallen appconfAUDIO_PIPELINE_BUFFER_INPUT_FRAMES
+ * frames behind.
+ *
+ * \param samples       The pointer to the samples of the frame.
+ * \param num_samples   The number of samples, which must be
+ *                      appconfAUDIO_PIPELINE_FRAME_ADVANCE.
+ */
+void low_power_audio_buffer_frame_send(asr_sample_t *samples, size_t num_samples);
+
 #endif // LOW_POWER_AUDIO_BUFFER_H_
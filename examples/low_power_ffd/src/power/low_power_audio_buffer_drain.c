@@ -0,0 +1,82 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* System headers */
+#include <stdint.h>
+#include <platform.h>
+#include <xs1.h>
+
+/* FreeRTOS headers */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* Library headers */
+#include "rtos_printf.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "low_power_audio_buffer.h"
+#include "power_control.h"
+#include "power_state.h"
+
+#if LOW_POWER_AUDIO_BUFFER_ENABLED
+
+/* Processed frames waiting to be enqueued by the drain task */
+static QueueHandle_t frame_queue = NULL;
+
+/*
+ * The ring buffer is only accessed from this task, so the audio pipeline
+ * never blocks on it. At full power one buffered frame is pushed per pass.
+ * intent_engine_sample_push() blocks while the intent engine's stream buffer
+ * is full, so the backlog drains at the rate the ASR consumes it, and live
+ * frames that arrive meanwhile are enqueued behind it between pushes. Once
+ * the backlog is gone each live frame is pushed as soon as it arrives.
+ */
+static void low_power_audio_buffer_drain_task(void *arg)
+{
+    asr_sample_t frame[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+    uint32_t pushed = 0;
+
+    (void) arg;
+
+    for (;;) {
+        /* Only wait for a new frame when there is nothing left to push */
+        TickType_t wait = pushed ? 0 : portMAX_DELAY;
+
+        while (xQueueReceive(frame_queue, frame, wait) == pdPASS) {
+            low_power_audio_buffer_enqueue(frame, appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+            wait = 0;
+        }
+
+        pushed = 0;
+        if (power_control_state_get() == POWER_STATE_FULL) {
+            pushed = low_power_audio_buffer_dequeue(1);
+        }
+    }
+}
+
+void low_power_audio_buffer_frame_send(asr_sample_t *samples, size_t num_samples)
+{
+    configASSERT(num_samples == appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+
+    if (xQueueSend(frame_queue, samples, 0) != pdPASS) {
+        rtos_printf("lost output samples for low power audio buffer\n");
+    }
+}
+
+void low_power_audio_buffer_drain_task_create(unsigned priority)
+{
+    frame_queue = xQueueCreate(appconfAUDIO_PIPELINE_BUFFER_INPUT_FRAMES,
+                               appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(asr_sample_t));
+    configASSERT(frame_queue);
+
+    xTaskCreate((TaskFunction_t)low_power_audio_buffer_drain_task,
+                "lp_buf_drain",
+                RTOS_THREAD_STACK_SIZE(low_power_audio_buffer_drain_task),
+                NULL,
+                priority,
+                NULL);
+}
+
+#endif // LOW_POWER_AUDIO_BUFFER_ENABLED
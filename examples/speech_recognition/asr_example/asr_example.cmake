@@ -4,6 +4,7 @@ target_sources(asr_example
     PRIVATE
         ${CMAKE_CURRENT_LIST_DIR}/asr_example_impl.c
         ${SOLUTION_VOICE_ROOT_PATH}/modules/asr/device_memory/device_memory.c
+        ${SOLUTION_VOICE_ROOT_PATH}/modules/asr/asr.c
 )
 target_include_directories(asr_example
     PUBLIC
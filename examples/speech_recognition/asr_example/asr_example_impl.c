@@ -67,10 +67,11 @@ asr_error_t asr_process(asr_port_t *ctx, int16_t *audio_buf, size_t buf_len)
     //       external memory into SRAM using the asr_read_ext or asr_read_ext_async 
     //       functions before performing any math with the coeffs.  
     int wait_handle; 
-    int32_t scratch_data[0];
+    // Room for one word from the model plus a terminator for atoi
+    int32_t scratch_data[2] = {0};
 
     // read data from the model in another thread
-    wait_handle = devmem_read_ext_async(mock_asr->devmem_ctx, scratch_data, (const void *)((unsigned)mock_asr->model+12), sizeof(int32_t));
+    wait_handle = devmem_read_ext_async(mock_asr->devmem_ctx, scratch_data, (const void *)((uintptr_t)mock_asr->model+12), sizeof(int32_t));
     
     // could do some other work here
 
@@ -81,7 +82,7 @@ asr_error_t asr_process(asr_port_t *ctx, int16_t *audio_buf, size_t buf_len)
     // could do some other work here
 
     // read data from the model in another thread
-    wait_handle = devmem_read_ext_async(mock_asr->devmem_ctx, scratch_data, (const void *)((unsigned)mock_asr->model+20), sizeof(int32_t));
+    wait_handle = devmem_read_ext_async(mock_asr->devmem_ctx, scratch_data, (const void *)((uintptr_t)mock_asr->model+20), sizeof(int32_t));
 
     // block until read is finished, then do something with the data
     devmem_read_ext_wait(mock_asr->devmem_ctx, wait_handle);
@@ -160,6 +160,44 @@ asr_error_t asr_process(asr_port_t *ctx, int16_t *audio_buf, size_t buf_len)
     }
 }
 
+asr_error_t asr_process_batch(asr_port_t *ctx, int16_t *audio_buf, size_t brick_len, size_t brick_count,
+                              size_t *bricks_processed, asr_result_t *result)
+{
+    asr_error_t asr_error = ASR_OK;
+    size_t b = 0;
+
+    // DSpotter takes up to DSPOTTER_FRAME_SAMPLE samples per call, so pass in as
+    // many whole bricks at a time as fit. The UART dump only records short calls.
+#ifdef UART_DUMP_RECORD
+    const size_t bricks_per_call = 1;
+#else
+    const size_t bricks_per_call = (brick_len < DSPOTTER_FRAME_SAMPLE) ? (DSPOTTER_FRAME_SAMPLE / brick_len) : 1;
+#endif
+
+    memset(result, 0, sizeof(asr_result_t));
+
+    while (b < brick_count) {
+        size_t n = brick_count - b;
+        if (n > bricks_per_call) {
+            n = bricks_per_call;
+        }
+        asr_error = asr_process(ctx, &audio_buf[b * brick_len], n * brick_len);
+        b += n;
+
+        if (asr_error == ASR_OK) {
+            // A result is ready
+            asr_error = asr_get_result(ctx, result);
+            break;
+        } else if (asr_error != ASR_ERROR) {
+            break;
+        }
+        // As from asr_process, ASR_ERROR is returned while more samples are needed
+    }
+
+    *bricks_processed = b;
+    return asr_error;
+}
+
 asr_error_t asr_get_result(asr_port_t *ctx, asr_result_t *result)
 {
     char szCommand[64];
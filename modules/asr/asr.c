@@ -0,0 +1,37 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <stddef.h>
+#include <string.h>
+
+/* Library headers */
+#include "asr.h"
+
+__attribute__((weak))
+asr_error_t asr_process_batch(asr_port_t *ctx, int16_t *audio_buf, size_t brick_len, size_t brick_count,
+                              size_t *bricks_processed, asr_result_t *result)
+{
+    asr_error_t asr_error = ASR_OK;
+    size_t b = 0;
+
+    xassert(bricks_processed);
+    xassert(result);
+
+    memset(result, 0, sizeof(asr_result_t));
+
+    while (b < brick_count) {
+        asr_error = asr_process(ctx, &audio_buf[b * brick_len], brick_len);
+        b++;
+
+        if (asr_error == ASR_OK) {
+            asr_error = asr_get_result(ctx, result);
+        }
+        if (asr_error != ASR_OK || result->id != 0) {
+            break;
+        }
+    }
+
+    *bricks_processed = b;
+    return asr_error;
+}
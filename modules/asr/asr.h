@@ -125,6 +125,32 @@ asr_error_t asr_get_attributes(asr_port_t *ctx, asr_attributes_t *attributes);
  */
 asr_error_t asr_process(asr_port_t *ctx, int16_t *audio_buf, size_t buf_len);
 
+/**
+ * Process a batch of consecutive audio bricks.
+ *
+ * Used to catch up on a backlog of audio, for example after waking from low
+ * power, faster than one asr_process call per brick allows. Processing stops
+ * after the first brick that produces a result or an error, so no detection
+ * is lost; call again with the remaining bricks to continue.
+ *
+ * A weak default that calls asr_process and asr_get_result for each brick is
+ * provided. Ports can override it to amortize per call setup, model fetches
+ * and result polling over the batch.
+ *
+ * \param ctx              A pointer to the ASR port context.
+ * \param audio_buf        A pointer to brick_count * brick_len 16-bit PCM samples.
+ * \param brick_len        The number of PCM samples in each brick.
+ * \param brick_count      The number of bricks in audio_buf.
+ * \param bricks_processed The number of bricks consumed. At least one if
+ *                         brick_count is not zero.
+ * \param result           The result of the last brick processed. The id is
+ *                         0 if nothing was detected.
+ *
+ * \returns Success or the error code of the last brick processed.
+ */
+asr_error_t asr_process_batch(asr_port_t *ctx, int16_t *audio_buf, size_t brick_len, size_t brick_count,
+                              size_t *bricks_processed, asr_result_t *result);
+
 /**
  * Get the most recent results.
  *
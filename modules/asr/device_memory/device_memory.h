@@ -47,6 +47,12 @@ typedef struct devmem_manager_struct
 
 #define IS_FLASH(a)     IS_SWMEM(a)
 
+/**
+ * Returned by devmem_read_ext_async when the read could not be started.
+ * Waiting on it returns straight away.
+ */
+#define DEVMEM_READ_EXT_ASYNC_ERROR     (-2)
+
 /**
  * Memory allocation function that allows the application 
  * to provide an alternative implementation.
@@ -100,6 +106,10 @@ void devmem_read_ext(devmem_manager_t *ctx, void *dest, const void * src, size_t
  * \param n        Number of bytes to read.
  * 
  * \returns        A handle that can be used in a call to devmem_read_ext_wait.
+ *                 Every handle must be waited on exactly once, and dest must
+ *                 not be used until it has been. Returns
+ *                 DEVMEM_READ_EXT_ASYNC_ERROR without reading anything if
+ *                 too many reads are outstanding.
  */
 int devmem_read_ext_async(devmem_manager_t *ctx, void *dest, const void * src, size_t n);
 
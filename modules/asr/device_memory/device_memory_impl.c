@@ -12,6 +12,9 @@
 
 /* FreeRTOS headers */
 #include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
 
 /* Library headers */
 #include "rtos_printf.h"
@@ -23,6 +26,78 @@
 #include "device_memory.h"
 #include "device_memory_impl.h"
 
+/* Number of asynchronous reads that can be outstanding at once */
+#ifndef appconfDEVMEM_ASYNC_QUEUE_LEN
+#define appconfDEVMEM_ASYNC_QUEUE_LEN   4
+#endif
+
+/* Priority of the thread that performs flash reads. Defaults to that of the
+ * ASR thread so a prefetch runs on another core alongside it. */
+#ifndef appconfDEVMEM_READER_TASK_PRIORITY
+#ifdef appconfINTENT_MODEL_RUNNER_TASK_PRIORITY
+#define appconfDEVMEM_READER_TASK_PRIORITY  appconfINTENT_MODEL_RUNNER_TASK_PRIORITY
+#else
+#define appconfDEVMEM_READER_TASK_PRIORITY  (configMAX_PRIORITIES - 2)
+#endif
+#endif
+
+/* Handle returned for a read that completed before devmem_read_ext_async returned */
+#define DEVMEM_ASYNC_HANDLE_DONE    (-1)
+_Static_assert(DEVMEM_ASYNC_HANDLE_DONE != DEVMEM_READ_EXT_ASYNC_ERROR, "Handles must differ");
+
+typedef struct {
+    void *dest;
+    const void *src;
+    size_t n;
+    int handle;     /* Handle of the read using this slot, or DEVMEM_ASYNC_HANDLE_DONE when free */
+    SemaphoreHandle_t done;
+} devmem_async_req_t;
+
+static devmem_async_req_t async_reqs[appconfDEVMEM_ASYNC_QUEUE_LEN];
+static QueueHandle_t async_queue = NULL;        /* Indices into async_reqs[] waiting for the reader */
+static SemaphoreHandle_t async_slots = NULL;    /* Counts the free entries in async_reqs[] */
+static int async_next_handle = 0;
+static SemaphoreHandle_t flash_lock = NULL;     /* Held across each low level flash read */
+static int reader_started = 0;                  /* Set when the first asynchronous flash read starts the reader */
+
+/* Size of the SRAM cache in front of synchronous flash reads. 0 disables it. */
+#ifndef appconfDEVMEM_CACHE_SIZE_BYTES
+#define appconfDEVMEM_CACHE_SIZE_BYTES  0
+#endif
+
+/* Cache line size. Must be a power of 2 and a multiple of 4. */
+#ifndef appconfDEVMEM_CACHE_BLOCK_BYTES
+#define appconfDEVMEM_CACHE_BLOCK_BYTES 256
+#endif
+
+#ifndef appconfDEVMEM_CACHE_WAYS
+#define appconfDEVMEM_CACHE_WAYS        4
+#endif
+
+#if appconfDEVMEM_CACHE_SIZE_BYTES > 0
+#define DEVMEM_CACHE_SETS   (appconfDEVMEM_CACHE_SIZE_BYTES / (appconfDEVMEM_CACHE_BLOCK_BYTES * appconfDEVMEM_CACHE_WAYS))
+
+#if (appconfDEVMEM_CACHE_BLOCK_BYTES & (appconfDEVMEM_CACHE_BLOCK_BYTES - 1)) || (appconfDEVMEM_CACHE_BLOCK_BYTES % 4)
+#error appconfDEVMEM_CACHE_BLOCK_BYTES must be a power of 2 and a multiple of 4
+#endif
+#if DEVMEM_CACHE_SETS < 1
+#error appconfDEVMEM_CACHE_SIZE_BYTES must hold at least appconfDEVMEM_CACHE_WAYS blocks
+#endif
+
+typedef struct {
+    uintptr_t block;        /* Flash address of the cached block */
+    uint32_t last_used;     /* Value of cache_clock when last hit, for LRU replacement */
+    uint8_t valid;
+    uint8_t pinned;         /* Never evicted, see devmem_cache_pin() */
+} devmem_cache_line_t;
+
+static devmem_cache_line_t cache_lines[DEVMEM_CACHE_SETS][appconfDEVMEM_CACHE_WAYS];
+static uint8_t __attribute__((aligned(8))) cache_data[DEVMEM_CACHE_SETS][appconfDEVMEM_CACHE_WAYS][appconfDEVMEM_CACHE_BLOCK_BYTES];
+static uint32_t cache_clock = 0;
+static devmem_cache_stats_t cache_stats;
+static SemaphoreHandle_t cache_lock = NULL;
+#endif
+
 void asr_printf(const char * format, ...) {
     va_list args;
     va_start(args, format);
@@ -41,28 +116,251 @@ void devmem_free_local(void *ptr) {
     vPortFree(ptr);
 }
 
+/* Reads flash on the calling thread. The lock keeps the low level flash
+ * driver from being entered by a synchronous read and the reader thread at
+ * once. */
+static void devmem_flash_read(void *dest, const void *src, size_t n) {
+    //uint32_t s = get_reference_time();
+    int retval = -1;
+    xSemaphoreTake(flash_lock, portMAX_DELAY);
+    while (retval == -1) {
+        // Need to subtract off XS1_SWMEM_BASE because qspi flash driver accounts for the offset
+        retval = rtos_qspi_flash_fast_read_mode_ll(qspi_flash_ctx, (uint8_t *)dest, (unsigned)(src - XS1_SWMEM_BASE), n, qspi_fast_flash_read_transfer_raw);
+    }
+    xSemaphoreGive(flash_lock);
+    //uint32_t d = get_reference_time() - s;
+    //printf("%d, %0.01f (us), %0.04f (M/s)\n", n, d / 100.0f, (n / 1000000.0f ) / (d / 100000000.0f));
+}
+
+/* Performs the queued asynchronous flash reads in order */
+static void devmem_reader_task(void *arg) {
+    (void) arg;
+
+    for (;;) {
+        int slot;
+        xQueueReceive(async_queue, &slot, portMAX_DELAY);
+        devmem_async_req_t *req = &async_reqs[slot];
+        devmem_flash_read(req->dest, req->src, req->n);
+        xSemaphoreGive(req->done);
+    }
+}
+
+__attribute__((fptrgroup("devmem_read_ext_async_fptr_grp")))
+int devmem_read_ext_async_local(void *dest, const void *src, size_t n) {
+    if (!IS_FLASH(src)) {
+        memcpy(dest, src, n);
+        return DEVMEM_ASYNC_HANDLE_DONE;
+    }
+
+    if (xSemaphoreTake(async_slots, 0) != pdTRUE) {
+        return DEVMEM_READ_EXT_ASYNC_ERROR;
+    }
+
+    int slot = -1;
+    int handle;
+    int start_reader;
+    taskENTER_CRITICAL();
+    start_reader = !reader_started;
+    reader_started = 1;
+    for (int i = 0; i < appconfDEVMEM_ASYNC_QUEUE_LEN; i++) {
+        if (async_reqs[i].handle == DEVMEM_ASYNC_HANDLE_DONE) {
+            slot = i;
+            break;
+        }
+    }
+    xassert(slot >= 0);
+    // The slot index is recoverable from the handle, the rest tells apart reuses of the slot
+    handle = async_next_handle * appconfDEVMEM_ASYNC_QUEUE_LEN + slot;
+    async_next_handle = (async_next_handle + 1) & 0xFFFFF;
+    async_reqs[slot].handle = handle;
+    taskEXIT_CRITICAL();
+
+    if (start_reader) {
+        /* Ports that never read asynchronously do not pay for the thread */
+        xTaskCreate((TaskFunction_t)devmem_reader_task,
+                    "devmem_reader",
+                    RTOS_THREAD_STACK_SIZE(devmem_reader_task),
+                    NULL,
+                    appconfDEVMEM_READER_TASK_PRIORITY,
+                    NULL);
+    }
+
+    async_reqs[slot].dest = dest;
+    async_reqs[slot].src = src;
+    async_reqs[slot].n = n;
+    xQueueSend(async_queue, &slot, portMAX_DELAY);
+
+    return handle;
+}
+
+__attribute__((fptrgroup("devmem_read_ext_wait_fptr_grp")))
+void devmem_read_ext_wait_local(int handle) {
+    if (handle == DEVMEM_ASYNC_HANDLE_DONE || handle == DEVMEM_READ_EXT_ASYNC_ERROR) {
+        return;
+    }
+
+    xassert(handle >= 0);
+    devmem_async_req_t *req = &async_reqs[handle % appconfDEVMEM_ASYNC_QUEUE_LEN];
+    xassert(req->handle == handle);
+
+    xSemaphoreTake(req->done, portMAX_DELAY);
+    req->handle = DEVMEM_ASYNC_HANDLE_DONE;
+    xSemaphoreGive(async_slots);
+}
+
+#if appconfDEVMEM_CACHE_SIZE_BYTES > 0
+/* Returns the cached copy of the block at flash address block, reading it in
+ * if need be, or NULL if every way of its set is pinned to other blocks.
+ * Must be called with cache_lock held. */
+static uint8_t *devmem_cache_lookup(uintptr_t block, int pin) {
+    const unsigned set = (block / appconfDEVMEM_CACHE_BLOCK_BYTES) % DEVMEM_CACHE_SETS;
+    devmem_cache_line_t *lines = cache_lines[set];
+    int victim = -1;
+
+    cache_clock++;
+    for (int w = 0; w < appconfDEVMEM_CACHE_WAYS; w++) {
+        if (lines[w].valid && lines[w].block == block) {
+            cache_stats.hits++;
+            lines[w].last_used = cache_clock;
+            if (pin && !lines[w].pinned) {
+                lines[w].pinned = 1;
+                cache_stats.pinned_bytes += appconfDEVMEM_CACHE_BLOCK_BYTES;
+            }
+            return cache_data[set][w];
+        }
+    }
+
+    for (int w = 0; w < appconfDEVMEM_CACHE_WAYS; w++) {
+        if (!lines[w].valid) {
+            victim = w;
+            break;
+        }
+        if (!lines[w].pinned &&
+            (victim < 0 || (int32_t)(lines[w].last_used - lines[victim].last_used) < 0)) {
+            victim = w;
+        }
+    }
+    if (victim < 0) {
+        return NULL;
+    }
+
+    cache_stats.misses++;
+    if (lines[victim].valid) {
+        cache_stats.evictions++;
+    }
+    devmem_flash_read(cache_data[set][victim], (const void *)block, appconfDEVMEM_CACHE_BLOCK_BYTES);
+    lines[victim].block = block;
+    lines[victim].last_used = cache_clock;
+    lines[victim].valid = 1;
+    lines[victim].pinned = pin;
+    if (pin) {
+        cache_stats.pinned_bytes += appconfDEVMEM_CACHE_BLOCK_BYTES;
+    }
+    return cache_data[set][victim];
+}
+
+static void devmem_cache_read(void *dest, const void *src, size_t n) {
+    uintptr_t addr = (uintptr_t)src;
+    uint8_t *out = dest;
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    while (n > 0) {
+        const uintptr_t block = addr & ~(uintptr_t)(appconfDEVMEM_CACHE_BLOCK_BYTES - 1);
+        const size_t offset = addr - block;
+        const size_t len = (n < appconfDEVMEM_CACHE_BLOCK_BYTES - offset) ? n : appconfDEVMEM_CACHE_BLOCK_BYTES - offset;
+        const uint8_t *line = devmem_cache_lookup(block, 0);
+
+        if (line != NULL) {
+            memcpy(out, line + offset, len);
+        } else {
+            cache_stats.uncached++;
+            devmem_flash_read(out, (const void *)addr, len);
+        }
+        addr += len;
+        out += len;
+        n -= len;
+    }
+    xSemaphoreGive(cache_lock);
+}
+#endif
+
+size_t devmem_cache_pin(const void *src, size_t n) {
+#if appconfDEVMEM_CACHE_SIZE_BYTES > 0
+    xassert(cache_lock != NULL);
+    xassert(IS_FLASH(src));
+
+    uintptr_t block = (uintptr_t)src & ~(uintptr_t)(appconfDEVMEM_CACHE_BLOCK_BYTES - 1);
+    const uintptr_t end = (uintptr_t)src + n;
+    size_t pinned = 0;
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    for (; block < end; block += appconfDEVMEM_CACHE_BLOCK_BYTES) {
+        if (devmem_cache_lookup(block, 1) == NULL) {
+            break;
+        }
+        pinned = block + appconfDEVMEM_CACHE_BLOCK_BYTES - (uintptr_t)src;
+    }
+    xSemaphoreGive(cache_lock);
+
+    return pinned < n ? pinned : n;
+#else
+    (void) src;
+    (void) n;
+    return 0;
+#endif
+}
+
+void devmem_cache_get_stats(devmem_cache_stats_t *stats) {
+#if appconfDEVMEM_CACHE_SIZE_BYTES > 0
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    *stats = cache_stats;
+    xSemaphoreGive(cache_lock);
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
+
 __attribute__((fptrgroup("devmem_read_ext_fptr_grp")))
 void devmem_read_ext_local(void *dest, const void *src, size_t n) {
     //rtos_printf("devmem_read_ext_local  dest=0x%x    src=0x%x    size=%d\n", dest, src, n);
     if (IS_FLASH(src)) {
-        //uint32_t s = get_reference_time();
-        int retval = -1; 
-        while (retval == -1) {
-            // Need to subtract off XS1_SWMEM_BASE because qspi flash driver accounts for the offset
-            retval = rtos_qspi_flash_fast_read_mode_ll(qspi_flash_ctx, (uint8_t *)dest, (unsigned)(src - XS1_SWMEM_BASE), n, qspi_fast_flash_read_transfer_raw);
-        }
-        //uint32_t d = get_reference_time() - s;
-        //printf("%d, %0.01f (us), %0.04f (M/s)\n", n, d / 100.0f, (n / 1000000.0f ) / (d / 100000000.0f));
+#if appconfDEVMEM_CACHE_SIZE_BYTES > 0
+        devmem_cache_read(dest, src, n);
+#else
+        devmem_flash_read(dest, src, n);
+#endif
     } else {
         memcpy(dest, src, n);
     }    
 }
 
+static void devmem_async_init(void) {
+    if (async_queue != NULL) {
+        return;     // Shared by every devmem context on this tile
+    }
+
+    for (int i = 0; i < appconfDEVMEM_ASYNC_QUEUE_LEN; i++) {
+        async_reqs[i].handle = DEVMEM_ASYNC_HANDLE_DONE;
+        async_reqs[i].done = xSemaphoreCreateBinary();
+        xassert(async_reqs[i].done);
+    }
+    async_slots = xSemaphoreCreateCounting(appconfDEVMEM_ASYNC_QUEUE_LEN, appconfDEVMEM_ASYNC_QUEUE_LEN);
+    async_queue = xQueueCreate(appconfDEVMEM_ASYNC_QUEUE_LEN, sizeof(int));
+    flash_lock = xSemaphoreCreateMutex();
+    xassert(async_slots && async_queue && flash_lock);
+
+#if appconfDEVMEM_CACHE_SIZE_BYTES > 0
+    cache_lock = xSemaphoreCreateMutex();
+    xassert(cache_lock);
+#endif
+}
+
 void devmem_init(devmem_manager_t *devmem_ctx) {
     xassert(devmem_ctx);    
+    devmem_async_init();
     devmem_ctx->malloc = devmem_malloc_local;
     devmem_ctx->free = devmem_free_local;
     devmem_ctx->read_ext = devmem_read_ext_local;
-    devmem_ctx->read_ext_async = NULL;  // not supported in this application
-    devmem_ctx->read_ext_wait = NULL;   // not supported in this application
+    devmem_ctx->read_ext_async = devmem_read_ext_async_local;
+    devmem_ctx->read_ext_wait = devmem_read_ext_wait_local;
 }
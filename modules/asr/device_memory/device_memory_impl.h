@@ -7,4 +7,35 @@
 
 void devmem_init(devmem_manager_t *devmem_ctx);
 
-#endif // DEVICE_MEMORY_IMPL_H
\ No newline at end of file
+/**
+ * Counters for the SRAM cache in front of synchronous flash reads, which is
+ * enabled by setting appconfDEVMEM_CACHE_SIZE_BYTES. Hits, misses and
+ * evictions are counted per cache block touched by a read.
+ */
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t uncached;      /* Blocks read straight from flash as every way of their set was pinned */
+    uint32_t pinned_bytes;
+} devmem_cache_stats_t;
+
+/**
+ * Loads a region of flash into the cache and keeps it there. Call after
+ * devmem_init(), typically for the parts of a model read on every brick.
+ *
+ * \param src  Flash address of the region.
+ * \param n    Size of the region in bytes.
+ *
+ * \returns     Number of bytes from src that were pinned. This is less than
+ *              n when the sets the region maps to are full of pinned blocks,
+ *              and 0 when the cache is disabled.
+ */
+size_t devmem_cache_pin(const void *src, size_t n);
+
+/**
+ * Gets the cache counters since devmem_init().
+ */
+void devmem_cache_get_stats(devmem_cache_stats_t *stats);
+
+#endif // DEVICE_MEMORY_IMPL_H
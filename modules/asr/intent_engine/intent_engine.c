@@ -10,6 +10,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "stream_buffer.h"
+#include "semphr.h"
 
 /* App headers */
 #include "app_conf.h"
@@ -19,19 +20,32 @@
 #include "asr.h"
 #include "device_memory_impl.h"
 #include "leds.h"
+#include "spsc_ring.h"
 
 #if ON_TILE(ASR_TILE_NO)
 
 #if ASR_SENSORY
-    #define IS_KEYWORD(id)    (id == 17)
-    #define IS_COMMAND(id)    (id > 0 && id != 17)
+    #define KEYWORD_ID        (17)
+    #define IS_KEYWORD(id)    (id == KEYWORD_ID)
+    #define IS_COMMAND(id)    (id > 0 && id != KEYWORD_ID)
 #elif ASR_CYBERON
-    #define IS_KEYWORD(id)    (id == 1)
+    #define KEYWORD_ID        (1)
+    #define IS_KEYWORD(id)    (id == KEYWORD_ID)
     #define IS_COMMAND(id)    (id >= 2)
 #else
 #error "Model has to be either Sensory or Cyberon"
 #endif
 
+/* Run a separate wake word model on this thread and the command model on a
+ * second thread. See intent_engine_task(). */
+#ifndef appconfINTENT_WAKEWORD_MODEL_ENABLED
+#define appconfINTENT_WAKEWORD_MODEL_ENABLED    0
+#endif
+
+#if appconfINTENT_WAKEWORD_MODEL_ENABLED && !ASR_SENSORY
+#error "appconfINTENT_WAKEWORD_MODEL_ENABLED requires an ASR port that supports two instances"
+#endif
+
 
 #define SAMPLES_PER_ASR                 (appconfINTENT_SAMPLE_BLOCK_LENGTH)
 #define STOP_LISTENING_SOUND_WAV_ID     (0)
@@ -49,6 +63,45 @@ void* grammar = NULL;
 // to be added so the address in in the SwMem range.
 uint16_t *model = (uint16_t *) (XS1_SWMEM_BASE + QSPI_FLASH_MODEL_START_ADDRESS);
 
+#if appconfINTENT_WAKEWORD_MODEL_ENABLED
+
+// This define is referenced by the model source/header files.
+#ifndef ALIGNED
+#define ALIGNED(x) __attribute__ ((aligned((x))))
+#endif
+
+// The wake word model is small enough to be compiled in and run from SRAM
+#define WAKEWORD_NET_VAR       dnn_wakeword_netLabel
+#define WAKEWORD_SEARCH_VAR    gs_wakeword_grammarLabel
+
+#if !defined(WAKEWORD_NET_SOURCE_FILE) || !defined(WAKEWORD_SEARCH_SOURCE_FILE)
+#error "appconfINTENT_WAKEWORD_MODEL_ENABLED requires WAKEWORD_NET_SOURCE_FILE and WAKEWORD_SEARCH_SOURCE_FILE to be defined by the application"
+#endif
+
+#include WAKEWORD_NET_SOURCE_FILE
+
+#ifdef WAKEWORD_SEARCH_HEADER_FILE
+#include WAKEWORD_SEARCH_HEADER_FILE
+#endif
+
+#include WAKEWORD_SEARCH_SOURCE_FILE
+
+/* Any detection by the wake word model counts as the keyword */
+#define IS_WAKEWORD(id)    ((id) > 0)
+
+/* Number of bricks that the command model may fall behind the wake word
+ * model by before audio is dropped. Must be a power of two. */
+#ifndef appconfINTENT_COMMAND_QUEUE_BRICKS
+#define appconfINTENT_COMMAND_QUEUE_BRICKS  (16)
+#endif
+
+#if (appconfINTENT_COMMAND_QUEUE_BRICKS & (appconfINTENT_COMMAND_QUEUE_BRICKS - 1)) || \
+    (appconfINTENT_COMMAND_QUEUE_BRICKS < appconfINTENT_BATCH_MAX_BRICKS)
+#error "appconfINTENT_COMMAND_QUEUE_BRICKS must be a power of two of at least appconfINTENT_BATCH_MAX_BRICKS"
+#endif
+
+#endif /* appconfINTENT_WAKEWORD_MODEL_ENABLED */
+
 typedef enum intent_state {
     STATE_EXPECTING_WAKEWORD,
     STATE_EXPECTING_COMMAND,
@@ -64,12 +117,33 @@ static intent_state_t intent_state;
 static asr_port_t asr_ctx;
 static devmem_manager_t devmem_ctx;
 
+/* Held while intent_state is changed and the result is acted on, as the
+ * wake word and command threads can both have a result at the same time */
+static SemaphoreHandle_t intent_state_lock;
+
 static uint32_t timeout_event = TIMEOUT_EVENT_NONE;
 
+#if appconfINTENT_WAKEWORD_MODEL_ENABLED
+static asr_port_t wakeword_asr_ctx;
+static devmem_manager_t wakeword_devmem_ctx;
+static TaskHandle_t command_task_handle;
+
+/*
+ * The audio is received once, into a slot of brick_ring. The wake word model
+ * processes it in place and, while a command is expected, the slots are then
+ * committed to the command thread which processes the same memory.
+ */
+static asr_sample_t brick_storage[appconfINTENT_COMMAND_QUEUE_BRICKS][SAMPLES_PER_ASR];
+static spsc_ring_t brick_ring = SPSC_RING_INIT(brick_storage);
+
+/* Set by the wake word thread when a new command session starts */
+static volatile int command_reset_pending;
+#endif
+
 static void vIntentTimerCallback(TimerHandle_t pxTimer);
-static void receive_audio_frames(StreamBufferHandle_t input_queue, int32_t *buf,
-                                 int16_t *buf_short, size_t *buf_short_index);
+static size_t receive_audio_frames(StreamBufferHandle_t input_queue, asr_sample_t *buf, size_t max_bricks);
 static void timeout_event_handler(TimerHandle_t pxTimer);
+static void intent_state_update(TimerHandle_t pxTimer, asr_result_t *asr_result);
 
 static void vIntentTimerCallback(TimerHandle_t pxTimer)
 {
@@ -83,11 +157,18 @@ static void vIntentTimerCallback(TimerHandle_t pxTimer)
     }
 }
 
-static void receive_audio_frames(StreamBufferHandle_t input_queue, int32_t *buf,
-                                 int16_t *buf_short, size_t *buf_short_index)
+/*
+ * Blocks until one brick has been received, then takes any further whole
+ * bricks that are already queued, up to max_bricks. The stream buffer
+ * carries the int16 ASR samples, so the bricks are received straight into
+ * buf. Returns the number of bricks.
+ */
+static size_t receive_audio_frames(StreamBufferHandle_t input_queue, asr_sample_t *buf, size_t max_bricks)
 {
+    const size_t brick_bytes = SAMPLES_PER_ASR * sizeof(asr_sample_t);
     uint8_t *buf_ptr = (uint8_t*)buf;
-    size_t buf_len = appconfINTENT_SAMPLE_BLOCK_LENGTH * sizeof(int32_t);
+    size_t buf_len = brick_bytes;
+    size_t available;
 
     do {
         size_t bytes_rxed = xStreamBufferReceive(input_queue,
@@ -98,26 +179,135 @@ static void receive_audio_frames(StreamBufferHandle_t input_queue, int32_t *buf,
         buf_ptr += bytes_rxed;
     } while (buf_len > 0);
 
-    for (int i = 0; i < appconfINTENT_SAMPLE_BLOCK_LENGTH; i++) {
-        buf_short[(*buf_short_index)++] = buf[i] >> 16;
+    available = xStreamBufferBytesAvailable(input_queue) / brick_bytes;
+    if (available > max_bricks - 1) {
+        available = max_bricks - 1;
     }
+    if (available > 0) {
+        /* Whole bricks are already queued, so this does not block */
+        buf_len = xStreamBufferReceive(input_queue, buf_ptr, available * brick_bytes, 0);
+        xassert(buf_len == available * brick_bytes);
+    }
+
+    return 1 + available;
 }
 
 static void timeout_event_handler(TimerHandle_t pxTimer)
 {
     if (timeout_event & TIMEOUT_EVENT_INTENT) {
+        xSemaphoreTake(intent_state_lock, portMAX_DELAY);
         timeout_event &= ~TIMEOUT_EVENT_INTENT;
         intent_engine_play_response(STOP_LISTENING_SOUND_WAV_ID);
         led_indicate_waiting();
         intent_state = STATE_EXPECTING_WAKEWORD;
+        xSemaphoreGive(intent_state_lock);
     }
 }
 asr_result_t last_asr_result = {0};
 
+static void intent_state_update(TimerHandle_t pxTimer, asr_result_t *asr_result)
+{
+    int word_id = asr_result->id;
+
+    xSemaphoreTake(intent_state_lock, portMAX_DELAY);
+
+    memcpy(&last_asr_result, asr_result, sizeof(asr_result_t));
+
+    if (!IS_KEYWORD(word_id) && !IS_COMMAND(word_id)) {
+        xSemaphoreGive(intent_state_lock);
+        return;
+    }
+
+#if appconfINTENT_RAW_OUTPUT
+    intent_engine_process_asr_result(word_id);
+#else
+    if (intent_state == STATE_EXPECTING_WAKEWORD && IS_KEYWORD(word_id)) {
+        led_indicate_listening();
+        xTimerStart(pxTimer, 0);
+        intent_engine_process_asr_result(word_id);
+        intent_state = STATE_EXPECTING_COMMAND;
+    } else if (intent_state == STATE_EXPECTING_COMMAND && IS_COMMAND(word_id)) {
+        xTimerReset(pxTimer, 0);
+        intent_engine_process_asr_result(word_id);
+        intent_state = STATE_PROCESSING_COMMAND;
+    } else if (intent_state == STATE_EXPECTING_COMMAND && IS_KEYWORD(word_id)) {
+        xTimerReset(pxTimer, 0);
+        intent_engine_process_asr_result(word_id);
+        // remain in STATE_EXPECTING_COMMAND state
+    } else if (intent_state == STATE_PROCESSING_COMMAND && IS_KEYWORD(word_id)) {
+        xTimerReset(pxTimer, 0);
+        intent_engine_process_asr_result(word_id);
+        intent_state = STATE_EXPECTING_COMMAND;
+    } else if (intent_state == STATE_PROCESSING_COMMAND && IS_COMMAND(word_id)) {
+        xTimerReset(pxTimer, 0);
+        intent_engine_process_asr_result(word_id);
+        // remain in STATE_PROCESSING_COMMAND state
+    }
+#endif
+
+    xSemaphoreGive(intent_state_lock);
+}
+
+#if appconfINTENT_WAKEWORD_MODEL_ENABLED
+/*
+ * Runs the command model on the bricks that the wake word thread commits to
+ * brick_ring, and sleeps while no command is expected.
+ */
+#pragma stackfunction 1000
+static void intent_engine_command_task(void *args)
+{
+    TimerHandle_t int_eng_tmr = (TimerHandle_t)args;
+    asr_error_t asr_error;
+    asr_result_t asr_result;
+
+    while (1)
+    {
+        uint32_t brick_count;
+        asr_sample_t *bricks = (asr_sample_t *)spsc_ring_peek(&brick_ring, &brick_count);
+
+        if (brick_count == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        if (command_reset_pending) {
+            command_reset_pending = 0;
+            asr_reset(asr_ctx);
+        }
+
+        size_t bricks_processed = 0;
+
+        asr_error = asr_process_batch(asr_ctx, bricks, SAMPLES_PER_ASR, brick_count,
+                                      &bricks_processed, &asr_result);
+        spsc_ring_read_commit(&brick_ring, bricks_processed);
+
+        if (asr_error == ASR_EVALUATION_EXPIRED) {
+            led_indicate_end_of_eval();
+            continue;
+        }
+        if (asr_error != ASR_OK) continue;
+
+        // The keyword is left to the wake word model
+        if (IS_COMMAND(asr_result.id)) {
+            intent_state_update(int_eng_tmr, &asr_result);
+        }
+    }
+}
+#endif
+
+/*
+ * With appconfINTENT_WAKEWORD_MODEL_ENABLED, this thread runs the wake word
+ * model on every brick, so that its latency does not depend on the load of
+ * the command model, and the command model runs on intent_engine_command_task.
+ * The command model is only given audio from the wake word until the intent
+ * times out. Otherwise this thread runs the single model, which detects both
+ * the keyword and the commands.
+ */
 #pragma stackfunction 1000
 void intent_engine_task(void *args)
 {
     intent_state = STATE_EXPECTING_WAKEWORD;
+    intent_state_lock = xSemaphoreCreateMutex();
 
     StreamBufferHandle_t input_queue = (StreamBufferHandle_t)args;
     TimerHandle_t int_eng_tmr = xTimerCreate(
@@ -131,80 +321,107 @@ void intent_engine_task(void *args)
     printf("Call asr_init(). model = 0x%x, grammar = 0x%x\n", (unsigned int) model, (unsigned int) grammar);
     asr_ctx = asr_init((int32_t *)model, (int32_t *)grammar, &devmem_ctx);
 
-    int32_t buf[appconfINTENT_SAMPLE_BLOCK_LENGTH] = {0};
-    int16_t buf_short[SAMPLES_PER_ASR] = {0};
-
     asr_reset(asr_ctx);
 
+#if appconfINTENT_WAKEWORD_MODEL_ENABLED
+    /* Receives a batch while the command thread has fallen too far behind */
+    static asr_sample_t overrun_buf[SAMPLES_PER_ASR * appconfINTENT_BATCH_MAX_BRICKS] = {0};
+    asr_port_t task_asr_ctx;
+    int forwarding = 0;
+
+    devmem_init(&wakeword_devmem_ctx);
+    wakeword_asr_ctx = asr_init((int32_t *)WAKEWORD_NET_VAR, (int32_t *)WAKEWORD_SEARCH_VAR, &wakeword_devmem_ctx);
+    asr_reset(wakeword_asr_ctx);
+    task_asr_ctx = wakeword_asr_ctx;
+
+    xTaskCreate((TaskFunction_t)intent_engine_command_task,
+                "intent_cmd",
+                RTOS_THREAD_STACK_SIZE(intent_engine_command_task),
+                int_eng_tmr,
+                uxTaskPriorityGet(NULL),
+                &command_task_handle);
+#else
+    static asr_sample_t buf[SAMPLES_PER_ASR * appconfINTENT_BATCH_MAX_BRICKS] = {0};
+    asr_port_t task_asr_ctx = asr_ctx;
+#endif
+
     /* Alert other tile to start the audio pipeline */
     intent_engine_ready_sync();
 
     asr_error_t asr_error;
     asr_result_t asr_result;
-    int word_id;
-
-    size_t buf_short_index = 0;
 
     while (1)
     {
         timeout_event_handler(int_eng_tmr);
-        receive_audio_frames(input_queue, buf, buf_short, &buf_short_index);
 
-        if (buf_short_index < SAMPLES_PER_ASR)
-            continue;
+#if appconfINTENT_WAKEWORD_MODEL_ENABLED
+        uint32_t max_bricks;
+        asr_sample_t *buf = (asr_sample_t *)spsc_ring_write_region(&brick_ring, &max_bricks);
+
+        if (max_bricks == 0) {
+            buf = overrun_buf;
+            max_bricks = appconfINTENT_BATCH_MAX_BRICKS;
+        } else if (max_bricks > appconfINTENT_BATCH_MAX_BRICKS) {
+            max_bricks = appconfINTENT_BATCH_MAX_BRICKS;
+        }
+#else
+        const size_t max_bricks = appconfINTENT_BATCH_MAX_BRICKS;
+#endif
 
-        buf_short_index = 0; // reset the offset into the buffer of int16s.
-                             // Note, we do not need to overlap the window of samples.
-                             // This is handled in the ASR ports.
+        // Note, we do not need to overlap the window of samples.
+        // This is handled in the ASR ports.
+        size_t brick_count = receive_audio_frames(input_queue, buf, max_bricks);
 
-        // this application does not support barge-in
+#if appconfINTENT_BARGE_IN_ENABLED
+        // The audio response is removed from the samples, so the ASR keeps
+        // listening while it plays and the user can talk over it.
+        intent_engine_echo_subtract(buf, brick_count * SAMPLES_PER_ASR);
+#else
+        // barge-in is not enabled
         //   so, we need to check if an audio response is playing and skip to the next
         //   audio frame because the playback may trigger the ASR.
         if (intent_handler_response_playing()) continue;
+#endif
 
-        asr_error = asr_process(asr_ctx, buf_short, SAMPLES_PER_ASR);
-        if (asr_error == ASR_EVALUATION_EXPIRED) {
-            led_indicate_end_of_eval();
-            continue;
-        }
-        if (asr_error != ASR_OK) continue;
-
-        asr_error = asr_get_result(asr_ctx, &asr_result);
-        memcpy(&last_asr_result, &asr_result, sizeof(asr_result_t));
+        // A backlog of bricks is processed in one call, which returns early
+        // on a result so that each result is handled in order.
+        for (size_t brick = 0; brick < brick_count; ) {
+            size_t bricks_processed = 0;
 
-        if (asr_error != ASR_OK) continue;
+            asr_error = asr_process_batch(task_asr_ctx, &buf[brick * SAMPLES_PER_ASR], SAMPLES_PER_ASR,
+                                          brick_count - brick, &bricks_processed, &asr_result);
+            brick += bricks_processed;
 
-        word_id = asr_result.id;
-
-        if (!IS_KEYWORD(word_id) && !IS_COMMAND(word_id)) continue;
+            if (asr_error == ASR_EVALUATION_EXPIRED) {
+                led_indicate_end_of_eval();
+                continue;
+            }
+            if (asr_error != ASR_OK) continue;
 
+#if appconfINTENT_WAKEWORD_MODEL_ENABLED
+            if (!IS_WAKEWORD(asr_result.id)) continue;
+            asr_result.id = KEYWORD_ID;
+#endif
+            intent_state_update(int_eng_tmr, &asr_result);
+        }
 
-    #if appconfINTENT_RAW_OUTPUT
-        intent_engine_process_asr_result(word_id);
-    #else
-        if (intent_state == STATE_EXPECTING_WAKEWORD && IS_KEYWORD(word_id)) {
-            led_indicate_listening();
-            xTimerStart(int_eng_tmr, 0);
-            intent_engine_process_asr_result(word_id);
-            intent_state = STATE_EXPECTING_COMMAND;
-        } else if (intent_state == STATE_EXPECTING_COMMAND && IS_COMMAND(word_id)) {
-            xTimerReset(int_eng_tmr, 0);
-            intent_engine_process_asr_result(word_id);
-            intent_state = STATE_PROCESSING_COMMAND;
-        } else if (intent_state == STATE_EXPECTING_COMMAND && IS_KEYWORD(word_id)) {
-            xTimerReset(int_eng_tmr, 0);
-            intent_engine_process_asr_result(word_id);
-            // remain in STATE_EXPECTING_COMMAND state
-        } else if (intent_state == STATE_PROCESSING_COMMAND && IS_KEYWORD(word_id)) {
-            xTimerReset(int_eng_tmr, 0);
-            intent_engine_process_asr_result(word_id);
-            intent_state = STATE_EXPECTING_COMMAND;
-        } else if (intent_state == STATE_PROCESSING_COMMAND && IS_COMMAND(word_id)) {
-            xTimerReset(int_eng_tmr, 0);
-            intent_engine_process_asr_result(word_id);
-            // remain in STATE_PROCESSING_COMMAND state
+#if appconfINTENT_WAKEWORD_MODEL_ENABLED
+        /* Only this thread moves intent_state to or from
+         * STATE_EXPECTING_WAKEWORD, so it can be read here without the lock. */
+        if (!appconfINTENT_RAW_OUTPUT && intent_state == STATE_EXPECTING_WAKEWORD) {
+            forwarding = 0;
+        } else if (buf == overrun_buf) {
+            rtos_printf("command model overrun, lost %u bricks\n", (unsigned) brick_count);
+        } else {
+            if (!forwarding) {
+                forwarding = 1;
+                command_reset_pending = 1;
+            }
+            spsc_ring_write_commit(&brick_ring, brick_count);
+            xTaskNotifyGive(command_task_handle);
         }
-    #endif
+#endif
     }
 }
 
@@ -8,9 +8,44 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "app_conf.h"
 #include "asr.h"
 #include "rtos_intertile.h"
 
+/* Maximum number of queued bricks passed to asr_process_batch() at once */
+#ifndef appconfINTENT_BATCH_MAX_BRICKS
+#define appconfINTENT_BATCH_MAX_BRICKS  (4)
+#endif
+
+/* Keep the ASR running while an audio response plays, with the response
+ * subtracted from the ASR samples. See intent_engine_echo.c. */
+#ifndef appconfINTENT_BARGE_IN_ENABLED
+#define appconfINTENT_BARGE_IN_ENABLED  0
+#endif
+
+/* Longest delay from the DAC to the ASR input that is searched for. The
+ * delay itself is measured on the first responses played. */
+#ifndef appconfINTENT_BARGE_IN_MAX_DELAY_SAMPLES
+#define appconfINTENT_BARGE_IN_MAX_DELAY_SAMPLES    (4000)
+#endif
+
+/* Length of the echo filter, which starts just before the measured delay
+ * and covers the room response */
+#ifndef appconfINTENT_BARGE_IN_FILTER_TAPS
+#define appconfINTENT_BARGE_IN_FILTER_TAPS          (256)
+#endif
+
+/* Normalized LMS step size, between 0 and 1 */
+#ifndef appconfINTENT_BARGE_IN_STEP_SIZE
+#define appconfINTENT_BARGE_IN_STEP_SIZE            (0.1f)
+#endif
+
+/* Print the measured delay, and the time taken by the echo filter after
+ * each response */
+#ifndef appconfINTENT_BARGE_IN_STATS
+#define appconfINTENT_BARGE_IN_STATS                0
+#endif
+
 int32_t intent_engine_create(uint32_t priority, void *args);
 void intent_engine_ready_sync(void);
 
@@ -18,15 +53,24 @@ void intent_engine_task(void *args);
 void intent_engine_task_create(unsigned priority);
 void intent_engine_intertile_task_create(uint32_t priority);
 
-int32_t intent_engine_sample_push(int32_t *buf, size_t frames);
+int32_t intent_engine_sample_push(asr_sample_t *buf, size_t frames);
 void intent_engine_samples_send_local(
         size_t frame_count,
-        int32_t *processed_audio_frame);
+        asr_sample_t *processed_audio_frame);
 void intent_engine_samples_send_remote(
         rtos_intertile_t *intertile,
         size_t frame_count,
-        int32_t *processed_audio_frame);
+        asr_sample_t *processed_audio_frame);
+
 
+/* Queue samples of the audio response once they have been handed to I2S */
+void intent_engine_playback_ref_push(const int16_t *samples, size_t n);
+/* Count samples put in the ASR input stream buffer, to line the response up with them */
+void intent_engine_echo_mic_arrived(size_t n);
+/* Subtract the audio response from ASR samples in place */
+void intent_engine_echo_subtract(asr_sample_t *buf, size_t n);
+/* Delay from the DAC to the ASR input in samples, or -1 until it is measured */
+int32_t intent_engine_echo_delay(void);
 
 void intent_engine_stream_buf_reset(void);
 void intent_engine_play_response(int wav_id);
@@ -0,0 +1,372 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <platform.h>
+#include <xs1.h>
+#include <math.h>
+#include <string.h>
+#include <xcore/hwtimer.h>
+
+/* FreeRTOS headers */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "intent_engine.h"
+#include "spsc_ring.h"
+
+#if appconfINTENT_BARGE_IN_ENABLED && ON_TILE(ASR_TILE_NO)
+
+/*
+ * Removes the audio response from the ASR samples so that the ASR can keep
+ * running while a response plays.
+ *
+ * The response is not part of the audio pipeline reference, so the echo is
+ * subtracted here, on the int16 ASR samples, with a normalized LMS filter
+ * whose reference is the PCM sent to the DAC.
+ *
+ * Each reference block is given the index of the ASR input sample that was
+ * arriving when the block started to play, and is placed on a timeline
+ * indexed by ASR input sample. The delay from the DAC to the ASR input is
+ * then the same for every response, whatever the batching of the ASR. It is
+ * measured by cross-correlating the envelopes of the reference and of the
+ * ASR input over the first second of response audio, and the filter runs
+ * from then on with its first taps just before the measured delay.
+ */
+
+#define ECHO_TAPS           (appconfINTENT_BARGE_IN_FILTER_TAPS)
+#define ECHO_MAX_DELAY      (appconfINTENT_BARGE_IN_MAX_DELAY_SAMPLES)
+#define ECHO_SAMPLE_RATE    (appconfAUDIO_PIPELINE_SAMPLE_RATE)
+
+/* Reference samples older than this are no longer used */
+#define ECHO_HISTORY        (ECHO_MAX_DELAY + ECHO_TAPS)
+/* Room for the history and for the reference queued ahead of the ASR */
+#define ECHO_TIMELINE_LEN   SPSC_RING_POW2_CEIL(ECHO_HISTORY + \
+                                appconfINTENT_FRAME_BUFFER_MULT * appconfAUDIO_PIPELINE_FRAME_ADVANCE)
+#define ECHO_TIMELINE_MASK  (ECHO_TIMELINE_LEN - 1)
+
+#define ECHO_REF_BLOCK_LEN  (appconfAUDIO_PIPELINE_FRAME_ADVANCE)
+#define ECHO_REF_BLOCKS     SPSC_RING_POW2_CEIL(appconfINTENT_BATCH_MAX_BRICKS + 2)
+
+/* The delay search works on envelopes of this many samples, 1 ms */
+#define ECHO_ENV_BLOCK      (ECHO_SAMPLE_RATE / 1000)
+#define ECHO_ENV_LAGS       (ECHO_MAX_DELAY / ECHO_ENV_BLOCK)
+/* Envelope blocks with response audio needed for a delay estimate, 1 s */
+#define ECHO_ENV_MIN_BLOCKS (1000)
+/* Smallest normalized correlation accepted as the echo */
+#define ECHO_ENV_MIN_CORR   (0.3f)
+/* Filter taps kept ahead of the measured delay, for its resolution */
+#define ECHO_PRE_DELAY      (ECHO_TAPS / 8)
+
+typedef struct {
+    uint32_t pos;       /* ASR input sample index of samples[0] */
+    uint32_t n;
+    int16_t samples[ECHO_REF_BLOCK_LEN];
+} echo_ref_block_t;
+
+static echo_ref_block_t ref_storage[ECHO_REF_BLOCKS];
+static spsc_ring_t ref_ring = SPSC_RING_INIT(ref_storage);
+
+/* Written by the thread that fills the ASR stream buffer, read by the
+ * playback thread */
+static uint32_t mic_arrived;
+static uint32_t mic_arrived_time;
+
+/* Playback thread state */
+static uint32_t ref_play_end;
+static int ref_play_started;
+
+/* Intent engine thread state from here on */
+static int16_t timeline[ECHO_TIMELINE_LEN];
+static uint32_t mic_pos;
+static uint32_t ref_end;
+static int active;
+
+static float weights[ECHO_TAPS];
+/* The last ECHO_TAPS reference samples, stored twice so that the window
+ * starting at hist_pos is always contiguous */
+static float hist[2 * ECHO_TAPS];
+static size_t hist_pos;
+static float hist_energy;
+
+/* Measured delay, or -1 until it is known */
+static int32_t delay = -1;
+
+static struct {
+    float ref[ECHO_ENV_LAGS];
+    float corr[ECHO_ENV_LAGS];
+    size_t ref_pos;
+    uint32_t ref_acc;
+    uint32_t mic_acc;
+    size_t count;
+    uint32_t total;     /* Envelope blocks summed */
+    uint32_t blocks;    /* Envelope blocks with response audio */
+    float sum_ref, sum_ref2;
+    float sum_mic, sum_mic2;
+} env;
+
+static struct {
+    uint32_t samples;
+    uint32_t ticks;
+} stats;
+
+void intent_engine_echo_mic_arrived(size_t n)
+{
+    taskENTER_CRITICAL();
+    mic_arrived += n;
+    mic_arrived_time = get_reference_time();
+    taskEXIT_CRITICAL();
+}
+
+void intent_engine_playback_ref_push(const int16_t *samples, size_t n)
+{
+    uint32_t count;
+    uint32_t time;
+    uint32_t elapsed;
+    uint32_t pos;
+
+    taskENTER_CRITICAL();
+    count = mic_arrived;
+    time = mic_arrived_time;
+    taskEXIT_CRITICAL();
+
+    /* The ASR input sample arriving now. Input arrives a frame at a time. */
+    elapsed = (uint32_t)(((uint64_t)(get_reference_time() - time) * ECHO_SAMPLE_RATE) / XS1_TIMER_HZ);
+    if (elapsed > appconfAUDIO_PIPELINE_FRAME_ADVANCE) {
+        elapsed = appconfAUDIO_PIPELINE_FRAME_ADVANCE;
+    }
+    pos = count + elapsed;
+
+    /* The block is called once it has been handed to I2S. It plays straight
+     * after the previous block if that has not finished, and now otherwise. */
+    if (ref_play_started && (int32_t)(pos - ref_play_end) < 0) {
+        pos = ref_play_end;
+    }
+    ref_play_started = 1;
+
+    while (n > 0) {
+        echo_ref_block_t *blk;
+        uint32_t space;
+
+        blk = spsc_ring_write_region(&ref_ring, &space);
+        if (space == 0) {
+            rtos_printf("barge-in reference overrun\n");
+            break;
+        }
+        blk->pos = pos;
+        blk->n = (n > ECHO_REF_BLOCK_LEN) ? ECHO_REF_BLOCK_LEN : n;
+        memcpy(blk->samples, samples, blk->n * sizeof(int16_t));
+        spsc_ring_write_commit(&ref_ring, 1);
+
+        pos += blk->n;
+        samples += blk->n;
+        n -= blk->n;
+    }
+    ref_play_end = pos;
+}
+
+/* Places the queued reference blocks on the timeline */
+static void ref_blocks_receive(void)
+{
+    echo_ref_block_t blk;
+
+    while (spsc_ring_read(&ref_ring, &blk, 1) == 1) {
+        int32_t ahead = (int32_t)(blk.pos - mic_pos);
+
+        if (ahead < -(int32_t)ECHO_HISTORY ||
+            ahead + (int32_t)blk.n > (int32_t)(ECHO_TIMELINE_LEN - ECHO_HISTORY)) {
+            rtos_printf("barge-in reference out of range, %d samples ahead\n", ahead);
+            continue;
+        }
+        for (uint32_t i = 0; i < blk.n; i++) {
+            timeline[(blk.pos + i) & ECHO_TIMELINE_MASK] = blk.samples[i];
+        }
+        if (!active || (int32_t)(blk.pos + blk.n - ref_end) > 0) {
+            ref_end = blk.pos + blk.n;
+        }
+        active = 1;
+    }
+}
+
+/* Accumulates the cross-correlation of one envelope block */
+static void env_block_add(void)
+{
+    const float r = (float)env.ref_acc * (1.0f / (ECHO_ENV_BLOCK * 32768.0f));
+    const float m = (float)env.mic_acc * (1.0f / (ECHO_ENV_BLOCK * 32768.0f));
+    size_t idx = env.ref_pos;
+
+    env.ref[env.ref_pos] = r;
+    env.ref_pos = (env.ref_pos + 1 == ECHO_ENV_LAGS) ? 0 : env.ref_pos + 1;
+
+    for (int lag = 0; lag < ECHO_ENV_LAGS; lag++) {
+        env.corr[lag] += m * env.ref[idx];
+        idx = (idx == 0) ? ECHO_ENV_LAGS - 1 : idx - 1;
+    }
+
+    env.sum_ref += r;
+    env.sum_ref2 += r * r;
+    env.sum_mic += m;
+    env.sum_mic2 += m * m;
+    env.total++;
+    if (env.ref_acc > 0) {
+        env.blocks++;
+    }
+    env.ref_acc = 0;
+    env.mic_acc = 0;
+    env.count = 0;
+}
+
+/*
+ * Sets the delay from the envelope correlation peak, once there is enough
+ * response audio. A weak peak, such as with the speaker muted, is discarded.
+ */
+static void env_delay_estimate(void)
+{
+    const float n = (float)env.total;
+    int best = 0;
+    float norm;
+    float peak;
+
+    if (env.blocks < ECHO_ENV_MIN_BLOCKS) {
+        return;
+    }
+
+    for (int lag = 1; lag < ECHO_ENV_LAGS; lag++) {
+        if (env.corr[lag] > env.corr[best]) {
+            best = lag;
+        }
+    }
+
+    /* Remove the mean, which adds about the same amount at every lag */
+    peak = env.corr[best] - env.sum_ref * env.sum_mic / n;
+    norm = (env.sum_ref2 - env.sum_ref * env.sum_ref / n) *
+           (env.sum_mic2 - env.sum_mic * env.sum_mic / n);
+
+    /* A peak at the last lag is most likely an echo beyond the search */
+    if (best < ECHO_ENV_LAGS - 1 && norm > 0.0f && peak > ECHO_ENV_MIN_CORR * sqrtf(norm)) {
+        delay = best * ECHO_ENV_BLOCK - ECHO_PRE_DELAY;
+        if (delay < 0) {
+            delay = 0;
+        }
+#if appconfINTENT_BARGE_IN_STATS
+        rtos_printf("barge-in echo delay %d samples\n", best * ECHO_ENV_BLOCK);
+    } else {
+        rtos_printf("barge-in echo not found, measuring again\n");
+#endif
+    }
+    memset(&env, 0, sizeof(env));
+}
+
+static void echo_end(void)
+{
+    if (delay < 0) {
+        env_delay_estimate();
+    }
+    memset(env.ref, 0, sizeof(env.ref));
+    env.ref_pos = 0;
+
+#if appconfINTENT_BARGE_IN_STATS
+    if (stats.samples > 0) {
+        /* Share of the intent engine thread, as a percentage of real time */
+        uint32_t ticks_per_sample = XS1_TIMER_HZ / ECHO_SAMPLE_RATE;
+        uint32_t permille = (uint32_t)(((uint64_t)stats.ticks * 1000) / ((uint64_t)stats.samples * ticks_per_sample));
+        rtos_printf("barge-in filter %u.%u%% of real time over %u samples\n",
+                    permille / 10, permille % 10, stats.samples);
+    }
+#endif
+    stats.samples = 0;
+    stats.ticks = 0;
+
+    /* The filter weights are kept, as the echo path of the next response
+     * is likely to be the same */
+    memset(timeline, 0, sizeof(timeline));
+    memset(hist, 0, sizeof(hist));
+    hist_energy = 0.0f;
+    active = 0;
+}
+
+static int16_t echo_subtract_sample(int16_t mic)
+{
+    const float x = (float)timeline[(mic_pos - delay) & ECHO_TIMELINE_MASK] * (1.0f / 32768.0f);
+    const float d = (float)mic * (1.0f / 32768.0f);
+    const float *window;
+    float y = 0.0f;
+    float e;
+    float step;
+
+    /* Slide the window by one sample. The slot taken by the newest
+     * sample holds the oldest one. */
+    hist_pos = (hist_pos == 0) ? ECHO_TAPS - 1 : hist_pos - 1;
+    hist_energy += x * x - hist[hist_pos] * hist[hist_pos];
+    if (hist_energy < 0.0f) {
+        hist_energy = 0.0f;
+    }
+    hist[hist_pos] = x;
+    hist[hist_pos + ECHO_TAPS] = x;
+    window = &hist[hist_pos];
+
+    for (int t = 0; t < ECHO_TAPS; t++) {
+        y += weights[t] * window[t];
+    }
+    e = d - y;
+
+    step = appconfINTENT_BARGE_IN_STEP_SIZE * e / (hist_energy + 1e-6f);
+    for (int t = 0; t < ECHO_TAPS; t++) {
+        weights[t] += step * window[t];
+    }
+
+    e *= 32768.0f;
+    if (e > INT16_MAX) {
+        e = INT16_MAX;
+    } else if (e < INT16_MIN) {
+        e = INT16_MIN;
+    }
+    return (int16_t)e;
+}
+
+void intent_engine_echo_subtract(asr_sample_t *buf, size_t n)
+{
+    uint32_t start = get_reference_time();
+
+    ref_blocks_receive();
+
+    if (!active) {
+        mic_pos += n;
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (delay < 0) {
+            const int16_t x = timeline[mic_pos & ECHO_TIMELINE_MASK];
+            env.ref_acc += (x < 0) ? -x : x;
+            env.mic_acc += (buf[i] < 0) ? -buf[i] : buf[i];
+            if (++env.count == ECHO_ENV_BLOCK) {
+                env_block_add();
+            }
+        } else {
+            buf[i] = (asr_sample_t)echo_subtract_sample(buf[i]);
+        }
+
+        /* Nothing further back than the history is read again */
+        timeline[(mic_pos - ECHO_HISTORY) & ECHO_TIMELINE_MASK] = 0;
+        mic_pos++;
+    }
+
+    if (delay >= 0) {
+        stats.samples += n;
+        stats.ticks += get_reference_time() - start;
+    }
+
+    if ((int32_t)(mic_pos - ref_end) >= (int32_t)ECHO_HISTORY) {
+        echo_end();
+    }
+}
+
+int32_t intent_engine_echo_delay(void)
+{
+    return (delay < 0) ? -1 : delay + ECHO_PRE_DELAY;
+}
+
+#endif /* appconfINTENT_BARGE_IN_ENABLED && ON_TILE(ASR_TILE_NO) */
@@ -120,7 +120,7 @@ int32_t intent_engine_create(uint32_t priority, void *args)
 }
 #endif /* appconfINTENT_ENABLED && ON_TILE(ASR_TILE_NO) */
 
-int32_t intent_engine_sample_push(int32_t *buf, size_t frames)
+int32_t intent_engine_sample_push(asr_sample_t *buf, size_t frames)
 {
 #if appconfINTENT_ENABLED && ON_TILE(AUDIO_PIPELINE_OUTPUT_TILE_NO)
 #if ASR_TILE_NO == AUDIO_PIPELINE_OUTPUT_TILE_NO
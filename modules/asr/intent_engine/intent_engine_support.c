@@ -35,14 +35,14 @@ void intent_engine_stream_buf_reset(void)
 void intent_engine_samples_send_remote(
         rtos_intertile_t *intertile,
         size_t frame_count,
-        int32_t *processed_audio_frame)
+        asr_sample_t *processed_audio_frame)
 {
     configASSERT(frame_count == appconfAUDIO_PIPELINE_FRAME_ADVANCE);
 
     rtos_intertile_tx(intertile,
                       appconfINTENT_MODEL_RUNNER_SAMPLES_PORT,
                       processed_audio_frame,
-                      sizeof(int32_t) * frame_count);
+                      sizeof(asr_sample_t) * frame_count);
 }
 
 #else /* ON_TILE(AUDIO_PIPELINE_OUTPUT_TILE_NO) */
@@ -52,7 +52,7 @@ static void intent_engine_intertile_samples_in_task(void *arg)
     (void) arg;
 
     for (;;) {
-        int32_t samples[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+        asr_sample_t samples[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
         size_t bytes_received;
 
         bytes_received = rtos_intertile_rx_len(
@@ -67,9 +67,13 @@ static void intent_engine_intertile_samples_in_task(void *arg)
                 samples,
                 bytes_received);
 
-        if (xStreamBufferSend(samples_to_engine_stream_buf, samples, sizeof(samples), 0) != sizeof(samples)) {
+        size_t bytes_sent = xStreamBufferSend(samples_to_engine_stream_buf, samples, sizeof(samples), 0);
+        if (bytes_sent != sizeof(samples)) {
             rtos_printf("lost output samples for intent\n");
         }
+#if appconfINTENT_BARGE_IN_ENABLED
+        intent_engine_echo_mic_arrived(bytes_sent / sizeof(asr_sample_t));
+#endif
     }
 }
 
@@ -101,15 +105,19 @@ void intent_engine_intertile_task_create(uint32_t priority)
 
 void intent_engine_samples_send_local(
         size_t frame_count,
-        int32_t *processed_audio_frame)
+        asr_sample_t *processed_audio_frame)
 {
     configASSERT(frame_count == appconfAUDIO_PIPELINE_FRAME_ADVANCE);
 
     if(samples_to_engine_stream_buf != NULL) {
-        size_t bytes_to_send = sizeof(int32_t) * frame_count;
-        if (xStreamBufferSend(samples_to_engine_stream_buf, processed_audio_frame, bytes_to_send, 0) != bytes_to_send) {
+        size_t bytes_to_send = sizeof(asr_sample_t) * frame_count;
+        size_t bytes_sent = xStreamBufferSend(samples_to_engine_stream_buf, processed_audio_frame, bytes_to_send, 0);
+        if (bytes_sent != bytes_to_send) {
             rtos_printf("lost local output samples for intent\n");
         }
+#if appconfINTENT_BARGE_IN_ENABLED
+        intent_engine_echo_mic_arrived(bytes_sent / sizeof(asr_sample_t));
+#endif
 
     } else {
         rtos_printf("intent engine streambuffer not ready\n");
@@ -4,6 +4,8 @@
 /* STD headers */
 #include <platform.h>
 #include <xs1.h>
+#include <stdint.h>
+#include <string.h>
 
 /* FreeRTOS headers */
 #include "FreeRTOS.h"
@@ -18,6 +20,18 @@
 #include "fs_support.h"
 #include "ff.h"
 #include "dr_wav_freertos_port.h"
+#include "intent_engine.h"
+
+/* Number of responses that can wait to be played */
+#ifndef appconfAUDIO_RESPONSE_QUEUE_LEN
+#define appconfAUDIO_RESPONSE_QUEUE_LEN     4
+#endif
+
+/* Heap used to hold the shortest responses decoded, so that they play
+ * without reading the filesystem. 0 disables the cache. */
+#ifndef appconfAUDIO_RESPONSE_CACHE_BYTES
+#define appconfAUDIO_RESPONSE_CACHE_BYTES   0
+#endif
 
 static const char *audio_files_en[] = {
     "50.wav",   /* sleep */
@@ -42,58 +56,292 @@ static const char *audio_files_en[] = {
 
 #define NUM_FILES (sizeof(audio_files_en) / sizeof(char *))
 
-static int16_t file_audio[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+#define RESPONSE_BLOCK_FRAMES   (appconfAUDIO_PIPELINE_FRAME_ADVANCE)
+/* One block is decoded while the other is sent to I2S */
+#define RESPONSE_BLOCK_COUNT    (2)
+
+typedef struct {
+    int32_t id;
+    uint32_t generation;    /* Value of play_generation when queued */
+} response_cmd_t;
+
+typedef struct {
+    int16_t samples[RESPONSE_BLOCK_FRAMES];
+    size_t frames;
+    uint32_t generation;
+} response_block_t;
+
+/* The response being decoded, either from the cache or from its file */
+typedef struct {
+    const int16_t *pcm;
+    size_t pcm_frames;
+    size_t pcm_pos;
+    FIL file;
+    drwav wav;
+} response_stream_t;
+
+typedef struct {
+    int16_t *pcm;
+    size_t frames;
+} response_cache_t;
+
+static response_block_t blocks[RESPONSE_BLOCK_COUNT];
+static response_cache_t cache[NUM_FILES];
+static response_stream_t stream;
 static int32_t i2s_audio[2*(appconfAUDIO_PIPELINE_FRAME_ADVANCE)];
-static drwav *wav_files = NULL;
 
-#pragma stackfunction 3000
+static QueueHandle_t q_cmd = NULL;      /* response_cmd_t, responses waiting to be played */
+static QueueHandle_t q_free = NULL;     /* Indices of the blocks that can be decoded into */
+static QueueHandle_t q_full = NULL;     /* Indices of the decoded blocks, in play order */
 
-int32_t audio_response_init(void) {
-    FRESULT result = 0;
-    FIL *files = pvPortMalloc(NUM_FILES * sizeof(FIL));
-    wav_files = pvPortMalloc(NUM_FILES * sizeof(drwav));
-
-    configASSERT(files);
-    configASSERT(wav_files);
-    configASSERT(file_audio);
-    configASSERT(i2s_audio);
-
-    for (int i=0; i<NUM_FILES; i++) {
-        result = f_open(&files[i], audio_files_en[i], FA_READ);
-        if (result == FR_OK) {
-            drwav_init(
-                    &wav_files[i],
+/* Incremented by a stop or preempt, which discards everything queued or
+ * decoded before it */
+static volatile uint32_t play_generation = 0;
+static volatile bool reader_busy = false;
+
+static void audio_response_reader_task(void *args);
+static void audio_response_output_task(void *args);
+
+static bool response_open(response_stream_t *s, int32_t id)
+{
+    if (id < 0 || id >= NUM_FILES) {  //max id should be (NUM_FILES - 1)
+        rtos_printf("No audio response for id %d\n", id);
+        return false;
+    }
+
+    if (cache[id].pcm != NULL) {
+        s->pcm = cache[id].pcm;
+        s->pcm_frames = cache[id].frames;
+        s->pcm_pos = 0;
+        return true;
+    }
+
+    s->pcm = NULL;
+    if (f_open(&s->file, audio_files_en[id], FA_READ) != FR_OK) {
+        rtos_printf("Failed to open %s\n", audio_files_en[id]);
+        return false;
+    }
+    if (!drwav_init(&s->wav,
                     drwav_read_proc_port,
                     drwav_seek_proc_port,
-                    &files[i],
-                    &drwav_memory_cbs);
-        } else {
-            configASSERT(0);
+                    &s->file,
+                    &drwav_memory_cbs)) {
+        rtos_printf("Failed to parse %s\n", audio_files_en[id]);
+        f_close(&s->file);
+        return false;
+    }
+    return true;
+}
+
+/* Returns the number of frames read. The rest of dst is zeroed. */
+static size_t response_read(response_stream_t *s, int16_t *dst, size_t frames)
+{
+    size_t frames_read;
+
+    memset(dst, 0x00, frames * sizeof(int16_t));
+
+    if (s->pcm != NULL) {
+        frames_read = s->pcm_frames - s->pcm_pos;
+        if (frames_read > frames) {
+            frames_read = frames;
         }
+        memcpy(dst, &s->pcm[s->pcm_pos], frames_read * sizeof(int16_t));
+        s->pcm_pos += frames_read;
+    } else {
+        frames_read = drwav_read_pcm_frames_s16(&s->wav, frames, dst);
+    }
+    return frames_read;
+}
+
+static void response_close(response_stream_t *s)
+{
+    if (s->pcm == NULL) {
+        drwav_uninit(&s->wav);
+        f_close(&s->file);
     }
-    return 0;
 }
 
+#if appconfAUDIO_RESPONSE_CACHE_BYTES > 0
+/*
+ * Decodes the shortest responses into the heap until the cache budget is
+ * used. The short prompts are the chimes, which are also played the most.
+ */
+static void response_cache_fill(void)
+{
+    size_t frames[NUM_FILES];
+    bool tried[NUM_FILES] = {false};
+    size_t budget = appconfAUDIO_RESPONSE_CACHE_BYTES;
+
+    for (int i = 0; i < NUM_FILES; i++) {
+        frames[i] = SIZE_MAX;
+        if (response_open(&stream, i)) {
+            frames[i] = (size_t)stream.wav.totalPCMFrameCount;
+            response_close(&stream);
+        }
+    }
+
+    while (1) {
+        int shortest = -1;
+
+        for (int i = 0; i < NUM_FILES; i++) {
+            if (!tried[i] && frames[i] > 0 && frames[i] <= budget / sizeof(int16_t) &&
+                (shortest < 0 || frames[i] < frames[shortest])) {
+                shortest = i;
+            }
+        }
+        if (shortest < 0) {
+            break;
+        }
+        tried[shortest] = true;
+
+        int16_t *pcm = pvPortMalloc(frames[shortest] * sizeof(int16_t));
+        if (pcm == NULL) {
+            break;
+        }
+        if (!response_open(&stream, shortest)) {
+            vPortFree(pcm);
+            continue;
+        }
+        cache[shortest].frames = response_read(&stream, pcm, frames[shortest]);
+        cache[shortest].pcm = pcm;
+        response_close(&stream);
+        budget -= frames[shortest] * sizeof(int16_t);
+        rtos_printf("Cached audio response %s, %u frames\n", audio_files_en[shortest], (unsigned) frames[shortest]);
+    }
+}
+#endif
+
 #pragma stackfunction 3000
+int32_t audio_response_init(void) {
+    q_cmd = xQueueCreate(appconfAUDIO_RESPONSE_QUEUE_LEN, sizeof(response_cmd_t));
+    q_free = xQueueCreate(RESPONSE_BLOCK_COUNT, sizeof(uint8_t));
+    q_full = xQueueCreate(RESPONSE_BLOCK_COUNT, sizeof(uint8_t));
+
+    configASSERT(q_cmd);
+    configASSERT(q_free);
+    configASSERT(q_full);
+
+    for (uint8_t i = 0; i < RESPONSE_BLOCK_COUNT; i++) {
+        xQueueSend(q_free, &i, 0);
+    }
+
+#if appconfAUDIO_RESPONSE_CACHE_BYTES > 0
+    response_cache_fill();
+#endif
+
+    /* Both threads run at the priority of the calling thread, which is then
+     * free to handle the next intent */
+    xTaskCreate((TaskFunction_t)audio_response_reader_task,
+                "audio_response_rd",
+                RTOS_THREAD_STACK_SIZE(audio_response_reader_task),
+                NULL,
+                uxTaskPriorityGet(NULL),
+                NULL);
+    xTaskCreate((TaskFunction_t)audio_response_output_task,
+                "audio_response",
+                RTOS_THREAD_STACK_SIZE(audio_response_output_task),
+                NULL,
+                uxTaskPriorityGet(NULL),
+                NULL);
+    return 0;
+}
+
 void audio_response_play(int32_t id) {
-    drwav tmp;
-    size_t framesRead = 0;
-
-    if (wav_files != NULL) {
-        if (id < NUM_FILES){  //max id should be (NUM_FILES - 1)
-            tmp = wav_files[id];
-        } else {
-            rtos_printf("No audio response for id %d\n", id);
-            return;
+    response_cmd_t cmd = {
+        .id = id,
+        .generation = play_generation,
+    };
+
+    if (q_cmd == NULL) {
+        rtos_printf("audio response not initialized\n");
+    } else if (xQueueSend(q_cmd, &cmd, 0) != pdPASS) {
+        rtos_printf("audio response queue full, dropped id %d\n", id);
+    }
+}
+
+void audio_response_stop(void) {
+    if (q_cmd == NULL) {
+        return;
+    }
+    /* The blocks already decoded and the response being decoded are dropped
+     * as soon as their generation no longer matches */
+    play_generation++;
+    xQueueReset(q_cmd);
+}
+
+void audio_response_preempt(int32_t id) {
+    audio_response_stop();
+    audio_response_play(id);
+}
+
+bool audio_response_playing(void) {
+    return reader_busy ||
+           (q_cmd != NULL && uxQueueMessagesWaiting(q_cmd) > 0) ||
+           (q_free != NULL && uxQueueMessagesWaiting(q_free) < RESPONSE_BLOCK_COUNT);
+}
+
+/*
+ * Decodes the queued responses into the free blocks, staying up to
+ * RESPONSE_BLOCK_COUNT blocks ahead of the output thread, so that reading
+ * the filesystem does not hold up I2S.
+ */
+#pragma stackfunction 3000
+static void audio_response_reader_task(void *args) {
+    response_cmd_t cmd;
+    uint8_t idx;
+
+    (void) args;
+
+    while (1) {
+        /* The response stays queued until it is marked busy, so that
+         * audio_response_playing() does not miss it */
+        xQueuePeek(q_cmd, &cmd, portMAX_DELAY);
+        reader_busy = true;
+
+        if (xQueueReceive(q_cmd, &cmd, 0) != pdPASS ||
+            cmd.generation != play_generation ||
+            !response_open(&stream, cmd.id)) {
+            reader_busy = false;
+            continue;
+        }
+
+        while (1) {
+            xQueueReceive(q_free, &idx, portMAX_DELAY);
+            if (cmd.generation != play_generation) {
+                xQueueSend(q_free, &idx, 0);
+                break;
+            }
+
+            response_block_t *block = &blocks[idx];
+            block->frames = response_read(&stream, block->samples, RESPONSE_BLOCK_FRAMES);
+            block->generation = cmd.generation;
+            xQueueSend(q_full, &idx, portMAX_DELAY);
+
+            if (block->frames != RESPONSE_BLOCK_FRAMES) {
+                break;
+            }
         }
 
-        while(1) {
-            memset(file_audio, 0x00, sizeof(file_audio));
-            framesRead = drwav_read_pcm_frames_s16(&tmp, appconfAUDIO_PIPELINE_FRAME_ADVANCE, file_audio);
-            memset(i2s_audio, 0x00, sizeof(i2s_audio));
-            for (int i=0; i<framesRead; i++) {
-                i2s_audio[(2*i)+0] = (int32_t) file_audio[i] << 16;
-                i2s_audio[(2*i)+1] = (int32_t) file_audio[i] << 16;
+        response_close(&stream);
+        reader_busy = false;
+    }
+}
+
+#pragma stackfunction 1000
+static void audio_response_output_task(void *args) {
+    uint8_t idx;
+
+    (void) args;
+
+    while (1) {
+        xQueueReceive(q_full, &idx, portMAX_DELAY);
+
+        response_block_t *block = &blocks[idx];
+
+        if (block->generation == play_generation && block->frames > 0) {
+            for (int i=0; i<RESPONSE_BLOCK_FRAMES; i++) {
+                i2s_audio[(2*i)+0] = (int32_t) block->samples[i] << 16;
+                i2s_audio[(2*i)+1] = (int32_t) block->samples[i] << 16;
             }
             if (appconfI2S_MODE == appconfI2S_MODE_MASTER)
             {
@@ -111,12 +359,14 @@ void audio_response_play(int32_t id) {
                 // Invalid I2S mode
                 xassert(0);
             }
-            if (framesRead != appconfAUDIO_PIPELINE_FRAME_ADVANCE) {
-                drwav_seek_to_pcm_frame(&tmp, 0);
-                break;
-            }
+#if appconfINTENT_BARGE_IN_ENABLED
+            /* Queued once I2S has taken the block, which is then played
+             * after the blocks before it. The rest of a short last block is
+             * zeros, which are played too. */
+            intent_engine_playback_ref_push(block->samples, RESPONSE_BLOCK_FRAMES);
+#endif
         }
-    } else {
-        rtos_printf("wav files not initialized\n");
+
+        xQueueSend(q_free, &idx, 0);
     }
 }
@@ -4,10 +4,23 @@
 #ifndef AUDIO_RESPONSE_H_
 #define AUDIO_RESPONSE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/* Fills the response cache and starts the playback threads */
 int32_t audio_response_init(void);
 
+/* Queues a response to be played after those already queued, and returns
+ * without waiting for it */
 void audio_response_play(int32_t id);
 
+/* Stops the response playing and drops the queued ones */
+void audio_response_stop(void);
+
+/* Plays a response straight away, in place of any playing or queued */
+void audio_response_preempt(int32_t id);
+
+/* True while a response is playing or waiting to be played */
+bool audio_response_playing(void);
+
 #endif /* AUDIO_RESPONSE_H_ */
@@ -25,8 +25,6 @@
 
 #if ON_TILE(ASR_TILE_NO)
 
-static bool audio_response_playing = 0;
-
 static void proc_keyword_res(void *args) {
     QueueHandle_t q_intent = (QueueHandle_t) args;
     int32_t id = 0;
@@ -79,15 +77,19 @@ static void proc_keyword_res(void *args) {
         rtos_uart_tx_write(uart_tx_ctx, (uint8_t*)&buf_uart, sizeof(uint32_t));
 #endif
 #if appconfAUDIO_PLAYBACK_ENABLED
-        audio_response_playing = true;
-        audio_response_play(id);
-        audio_response_playing = false;
+        // A response still playing is for an older intent, so it is cut
+        // short rather than delaying this one
+        audio_response_preempt(id);
 #endif
     }
 }
 
 bool intent_handler_response_playing() {
-    return audio_response_playing;
+#if appconfAUDIO_PLAYBACK_ENABLED
+    return audio_response_playing();
+#else
+    return false;
+#endif
 }
 
 int32_t intent_handler_create(uint32_t priority, void *args)
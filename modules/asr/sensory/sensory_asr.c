@@ -1,4 +1,4 @@
-// Copyright 2022-2023 XMOS LIMITED.
+// Copyright 2022-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #include <string.h>
@@ -20,21 +20,36 @@ typedef struct sensory_asr_struct
     int32_t duration;
     int32_t word_id;
     appStruct_T app;
+    int32_t in_use;
+    devmem_manager_t *devmem_ctx;
 
 } sensory_asr_t;
 
-static devmem_manager_t *devmem_ctx = NULL;
-static sensory_asr_t sensory_asr;
+static sensory_asr_t sensory_asr_instances[SENSORY_ASR_MAX_INSTANCES];
 
 /**
- * Wrapper for devmem_read_ext called by libTHFMicro.
+ * Wrappers for devmem_read_ext called by libTHFMicro. The library passes no
+ * context, so each instance gets its own wrapper to find its device memory
+ * manager.
 **/
+#if SENSORY_ASR_MAX_INSTANCES > 2
+#error "Add an xcore_memcpy wrapper for each Sensory ASR instance"
+#endif
+
 __attribute__((fptrgroup("sensory_asr_xcore_memcpy_fptr_grp")))
-static void xcore_memcpy(void * dst, const void * src, size_t size) \
+static void xcore_memcpy_0(void * dst, const void * src, size_t size) \
 {
-    devmem_read_ext(devmem_ctx, dst, src, size);
+    devmem_read_ext(sensory_asr_instances[0].devmem_ctx, dst, src, size);
 }
 
+#if SENSORY_ASR_MAX_INSTANCES > 1
+__attribute__((fptrgroup("sensory_asr_xcore_memcpy_fptr_grp")))
+static void xcore_memcpy_1(void * dst, const void * src, size_t size) \
+{
+    devmem_read_ext(sensory_asr_instances[1].devmem_ctx, dst, src, size);
+}
+#endif
+
 /**
  * Return TRUE if ptr is in SwMem (flash) address range.
 **/
@@ -49,11 +64,26 @@ static BOOL xcore_is_flash(const void * ptr)
 asr_port_t asr_init(int32_t *model, int32_t *grammar, devmem_manager_t *devmem)
 {
     errors_t error;
-    appStruct_T *app = &(sensory_asr.app);
-    t2siStruct *t = &(app->_t);
+    sensory_asr_t *sensory_asr = NULL;
     unsigned int sppSize;
-    sensory_asr.brick_count = 0;
-    devmem_ctx = devmem;
+    int instance;
+
+    for (instance = 0; instance < SENSORY_ASR_MAX_INSTANCES; instance++) {
+        if (!sensory_asr_instances[instance].in_use) {
+            sensory_asr = &sensory_asr_instances[instance];
+            break;
+        }
+    }
+    if (sensory_asr == NULL) {
+        asr_printf("ERROR: All %d Sensory ASR instances are in use\n", SENSORY_ASR_MAX_INSTANCES);
+        return NULL;
+    }
+
+    appStruct_T *app = &(sensory_asr->app);
+    t2siStruct *t = &(app->_t);
+    devmem_manager_t *devmem_ctx = devmem;
+    sensory_asr->brick_count = 0;
+    sensory_asr->devmem_ctx = devmem;
 
     memset((void *) app, 0, sizeof(appStruct_T)); // Most app parameters can be zero
 
@@ -67,7 +97,11 @@ asr_port_t asr_init(int32_t *model, int32_t *grammar, devmem_manager_t *devmem)
     t->maxTokens = SENSORY_ASR_MAX_TOKENS ? SENSORY_ASR_MAX_TOKENS : MAX_TOKENS;
     t->sdet_type = SENSORY_ASR_SDET_TYPE;
     // Both these functions MUST be set for xcore if model is in ROM (must copy from ROM to work at all)
-    t->devMemCpy = xcore_memcpy;
+#if SENSORY_ASR_MAX_INSTANCES > 1
+    t->devMemCpy = (instance == 0) ? xcore_memcpy_0 : xcore_memcpy_1;
+#else
+    t->devMemCpy = xcore_memcpy_0;
+#endif
     t->devIsFlash = xcore_is_flash;
     t->romCacheSize = SENSORY_ASR_ADDITIONAL_ROM_CACHE;
 
@@ -112,7 +146,8 @@ asr_port_t asr_init(int32_t *model, int32_t *grammar, devmem_manager_t *devmem)
     }
 
     asr_printf("SensoryProcessInit succeeded\n");
-    return (asr_port_t) &sensory_asr;
+    sensory_asr->in_use = 1;
+    return (asr_port_t) sensory_asr;
 }
 
 #pragma stackfunction 250
@@ -253,6 +288,7 @@ asr_error_t asr_release(asr_port_t *ctx)
     sensory_asr_t *sensory_asr = (sensory_asr_t *) ctx;
     appStruct_T *app = &(sensory_asr->app);
     t2siStruct *t = &(app->_t);
+    devmem_manager_t *devmem_ctx = sensory_asr->devmem_ctx;
 
     if (t->spp) {
         devmem_free(devmem_ctx, (void *) t-> spp);
@@ -262,6 +298,7 @@ asr_error_t asr_release(asr_port_t *ctx)
         devmem_free(devmem_ctx, (void *) app->audioBufferStart);
         app->audioBufferStart = 0;
     }
+    sensory_asr->in_use = 0;
 
     ctx = NULL;
     return ASR_OK;
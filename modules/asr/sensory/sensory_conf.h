@@ -1,4 +1,4 @@
-// Copyright 2022-2023 XMOS LIMITED.
+// Copyright 2022-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #ifndef SENSORY_CONF_H_
@@ -32,6 +32,12 @@
 #define SENSORY_ASR_MAX_TOKENS              (500)
 #endif
 
+#ifndef SENSORY_ASR_MAX_INSTANCES
+// Number of models that can be initialized at once, for example a
+// wake word model alongside a command model
+#define SENSORY_ASR_MAX_INSTANCES           (2)
+#endif
+
 #ifndef SENSORY_ASR_SDET_TYPE
 // Use SDET_LPSD for Low Power Sound Detect
 #define SENSORY_ASR_SDET_TYPE               (SDET_NONE)
@@ -3,13 +3,93 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "aec_defines.h"
 #include "aec_api.h"
 
+/* Set to 0 to always run the full AEC, even when the reference has been silent for a long time */
+#ifndef AEC_REF_IDLE_FAST_PATH
+#define AEC_REF_IDLE_FAST_PATH (1)
+#endif
+
+/* Reference level below which the reference is considered idle */
+#ifndef AEC_REF_IDLE_THRESHOLD_dB
+#define AEC_REF_IDLE_THRESHOLD_dB (-60)
+#endif
+
 /* This is an example of processing one frame of data through the AEC pipeline stage. The example runs on 1 thread and
  * can be compiled for both bare metal and x86.
  */
 static unsigned X_energy_recalc_bin = 0;
+
+#if AEC_REF_IDLE_FAST_PATH
+static int ref_idle_frames = 0;
+static float_s32_t ref_idle_threshold = {0, 0};
+
+/* Returns non-zero once the reference has been idle for longer than the main filter. At that point every frame in the
+ * X FIFO is silent, so the echo estimate is zero and the error equals the mic input.
+ */
+static int aec_ref_idle(
+        const aec_state_t *main_state,
+        const int32_t (*x_data)[AEC_FRAME_ADVANCE])
+{
+    if(ref_idle_threshold.mant == 0) {
+        ref_idle_threshold = f64_to_float_s32(pow(10, AEC_REF_IDLE_THRESHOLD_dB/20.0));
+    }
+
+    if(aec_detect_input_activity(x_data, ref_idle_threshold, main_state->shared_state->num_x_channels)) {
+        ref_idle_frames = 0;
+        return 0;
+    }
+    if(ref_idle_frames <= main_state->num_phases) {
+        ref_idle_frames++;
+        return 0;
+    }
+    return 1;
+}
+
+/* Reference idle fast path. The X FIFO, X energies and filters are left untouched, so they are exactly as they were
+ * after the last (silent) reference frame when the reference returns. Only the mic side state that carries across
+ * frames is kept up to date: the output overlap, the error EMA energy and the time domain estimated mic input.
+ */
+static void aec_process_frame_ref_idle(
+        aec_state_t *main_state,
+        aec_state_t *shadow_state,
+        int32_t (*output_main)[AEC_FRAME_ADVANCE],
+        int32_t (*output_shadow)[AEC_FRAME_ADVANCE])
+{
+    int num_y_channels = main_state->shared_state->num_y_channels;
+
+    for(int ch=0; ch<num_y_channels; ch++) {
+        const bfp_s32_t *y = &main_state->shared_state->y[ch];
+        aec_state_t *states[2] = {main_state, shadow_state};
+
+        // With a silent X FIFO, y_hat is zero and the error is the mic input frame
+        for(int i=0; i<2; i++) {
+            bfp_s32_t *error = &states[i]->error[ch];
+            memcpy(error->data, y->data, AEC_PROC_FRAME_LENGTH*sizeof(int32_t));
+            error->length = AEC_PROC_FRAME_LENGTH;
+            error->exp = y->exp;
+            error->hr = y->hr;
+        }
+        main_state->y_hat[ch].length = AEC_PROC_FRAME_LENGTH;
+        bfp_s32_set(&main_state->y_hat[ch], 0, -31);
+
+        aec_calc_output(main_state, &output_main[ch], ch);
+        if(output_shadow != NULL) {
+            aec_calc_output(shadow_state, &output_shadow[ch], ch);
+        }
+        else {
+            aec_calc_output(shadow_state, NULL, ch);
+        }
+
+        bfp_s32_t temp;
+        bfp_s32_init(&temp, &output_main[ch][0], -31, AEC_FRAME_ADVANCE, 1);
+        aec_calc_time_domain_ema_energy(&main_state->error_ema_energy[ch], &temp, 0, AEC_FRAME_ADVANCE, &main_state->shared_state->config_params);
+    }
+}
+#endif
+
 void aec_process_frame_1thread(
         aec_state_t *main_state,
         aec_state_t *shadow_state,
@@ -36,6 +116,14 @@ void aec_process_frame_1thread(
                 AEC_PROC_FRAME_LENGTH - AEC_FRAME_ADVANCE, AEC_FRAME_ADVANCE, &main_state->shared_state->config_params);
     }
 
+#if AEC_REF_IDLE_FAST_PATH
+    // Skip the spectral processing and filter adaptation while there is no echo to cancel
+    if(aec_ref_idle(main_state, x_data)) {
+        aec_process_frame_ref_idle(main_state, shadow_state, output_main, output_shadow);
+        return;
+    }
+#endif
+
     // Calculate mic input spectrum for all num_y_channels of mic input
     /* The spectrum calculation is done in place. Taking mic input as example, after the aec_forward_fft() call
      * main_state->shared_state->Y[ch].data and main_state->shared_state->y[ch].data point to the same memory address.
@@ -0,0 +1,274 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "aec_defines.h"
+#include "aec_api.h"
+
+/* This is the same processing as aec_process_frame_1thread(), split across the calling thread and a worker thread.
+ *
+ * The frame is processed in a number of steps. Within a step the main filter work is done on the calling thread
+ * (thread 0) and the shadow filter work on the worker (thread 1), or the work is split by channel where there is no
+ * main/shadow split. Both threads meet at a barrier at the end of each step. Steps that touch both filters, or state
+ * shared between them, are run on the calling thread alone between the parallel steps.
+ *
+ * aec_process_frame_2threads_init() must be called once before the first frame.
+ */
+
+typedef struct {
+    aec_state_t *main_state;
+    aec_state_t *shadow_state;
+    int32_t (*output_main)[AEC_FRAME_ADVANCE];
+    int32_t (*output_shadow)[AEC_FRAME_ADVANCE];
+    int num_y_channels;
+    int num_x_channels;
+} aec_2threads_frame_t;
+
+/* Steps are dispatched with a switch rather than through a function pointer
+ * so that the worker's stack usage can be determined at build time.
+ */
+typedef enum {
+    AEC_STEP_INPUT_SPECTRUM,
+    AEC_STEP_X_FIFO_ENERGY,
+    AEC_STEP_ERROR_AND_Y_HAT,
+    AEC_STEP_OUTPUT,
+    AEC_STEP_ERROR_SPECTRUM,
+    AEC_STEP_FILTER_ADAPT,
+} aec_2threads_step_t;
+
+static struct {
+    SemaphoreHandle_t start;
+    SemaphoreHandle_t done;
+    aec_2threads_step_t step;
+    aec_2threads_frame_t *frame;
+} worker;
+
+static unsigned X_energy_recalc_bin = 0;
+
+/* Thread 0 takes the mic channels, thread 1 the reference channels */
+static void step_input_spectrum(aec_2threads_frame_t *frame, int thread)
+{
+    aec_shared_state_t *shared_state = frame->main_state->shared_state;
+
+    if (thread == 0) {
+        for(int ch=0; ch<frame->num_y_channels; ch++) {
+            aec_calc_time_domain_ema_energy(&shared_state->y_ema_energy[ch], &shared_state->y[ch],
+                    AEC_PROC_FRAME_LENGTH - AEC_FRAME_ADVANCE, AEC_FRAME_ADVANCE, &shared_state->config_params);
+            aec_forward_fft(&shared_state->Y[ch], &shared_state->y[ch]);
+        }
+    } else {
+        for(int ch=0; ch<frame->num_x_channels; ch++) {
+            aec_calc_time_domain_ema_energy(&shared_state->x_ema_energy[ch], &shared_state->x[ch],
+                    AEC_PROC_FRAME_LENGTH - AEC_FRAME_ADVANCE, AEC_FRAME_ADVANCE, &shared_state->config_params);
+            aec_forward_fft(&shared_state->X[ch], &shared_state->x[ch]);
+        }
+    }
+}
+
+static void step_X_fifo_energy(aec_2threads_frame_t *frame, int thread)
+{
+    aec_state_t *state = (thread == 0) ? frame->main_state : frame->shadow_state;
+
+    for(int ch=0; ch<frame->num_x_channels; ch++) {
+        aec_calc_X_fifo_energy(state, ch, X_energy_recalc_bin);
+    }
+}
+
+/* The main filter y_hat is only produced by thread 0 itself, so its inverse FFT stays on thread 0 */
+static void step_Error_and_Y_hat(aec_2threads_frame_t *frame, int thread)
+{
+    aec_state_t *state = (thread == 0) ? frame->main_state : frame->shadow_state;
+
+    for(int ch=0; ch<frame->num_y_channels; ch++) {
+        aec_calc_Error_and_Y_hat(state, ch);
+    }
+    for(int ch=0; ch<frame->num_y_channels; ch++) {
+        aec_inverse_fft(&state->error[ch], &state->Error[ch]);
+    }
+    if (thread == 0) {
+        for(int ch=0; ch<frame->num_y_channels; ch++) {
+            aec_inverse_fft(&state->y_hat[ch], &state->Y_hat[ch]);
+        }
+    }
+}
+
+static void step_output(aec_2threads_frame_t *frame, int thread)
+{
+    aec_state_t *main_state = frame->main_state;
+    aec_state_t *shadow_state = frame->shadow_state;
+
+    if (thread == 0) {
+        for(int ch=0; ch<frame->num_y_channels; ch++) {
+            aec_calc_coherence(main_state, ch);
+        }
+        for(int ch=0; ch<frame->num_y_channels; ch++) {
+            aec_calc_output(main_state, &frame->output_main[ch], ch);
+        }
+        for(int ch=0; ch<frame->num_y_channels; ch++) {
+            bfp_s32_t temp;
+            bfp_s32_init(&temp, &frame->output_main[ch][0], -31, AEC_FRAME_ADVANCE, 1);
+            aec_calc_time_domain_ema_energy(&main_state->error_ema_energy[ch], &temp, 0, AEC_FRAME_ADVANCE, &main_state->shared_state->config_params);
+        }
+    } else {
+        for(int ch=0; ch<frame->num_y_channels; ch++) {
+            if(frame->output_shadow != NULL) {
+                aec_calc_output(shadow_state, &frame->output_shadow[ch], ch);
+            }
+            else {
+                aec_calc_output(shadow_state, NULL, ch);
+            }
+        }
+    }
+}
+
+/* Thread 1 also takes the mic spectrum energy, which both filters compare against */
+static void step_Error_spectrum(aec_2threads_frame_t *frame, int thread)
+{
+    aec_state_t *state = (thread == 0) ? frame->main_state : frame->shadow_state;
+
+    for(int ch=0; ch<frame->num_y_channels; ch++) {
+        aec_forward_fft(&state->Error[ch], &state->error[ch]);
+        aec_calc_freq_domain_energy(&state->overall_Error[ch], &state->Error[ch]);
+    }
+    if (thread == 1) {
+        aec_shared_state_t *shared_state = frame->main_state->shared_state;
+        for(int ch=0; ch<frame->num_y_channels; ch++) {
+            aec_calc_freq_domain_energy(&shared_state->overall_Y[ch], &shared_state->Y[ch]);
+        }
+    }
+}
+
+static void step_filter_adapt(aec_2threads_frame_t *frame, int thread)
+{
+    aec_state_t *state = (thread == 0) ? frame->main_state : frame->shadow_state;
+
+    for(int ch=0; ch<frame->num_x_channels; ch++) {
+        aec_calc_normalisation_spectrum(state, ch, thread);
+    }
+    for(int ych=0; ych<frame->num_y_channels; ych++) {
+        for(int xch=0; xch<frame->num_x_channels; xch++) {
+            aec_calc_T(state, ych, xch);
+        }
+        aec_filter_adapt(state, ych);
+    }
+}
+
+static void step_run(aec_2threads_frame_t *frame, aec_2threads_step_t step, int thread)
+{
+    switch (step) {
+    case AEC_STEP_INPUT_SPECTRUM:
+        step_input_spectrum(frame, thread);
+        break;
+    case AEC_STEP_X_FIFO_ENERGY:
+        step_X_fifo_energy(frame, thread);
+        break;
+    case AEC_STEP_ERROR_AND_Y_HAT:
+        step_Error_and_Y_hat(frame, thread);
+        break;
+    case AEC_STEP_OUTPUT:
+        step_output(frame, thread);
+        break;
+    case AEC_STEP_ERROR_SPECTRUM:
+        step_Error_spectrum(frame, thread);
+        break;
+    case AEC_STEP_FILTER_ADAPT:
+        step_filter_adapt(frame, thread);
+        break;
+    }
+}
+
+static void aec_2threads_worker(void *arg)
+{
+    (void) arg;
+
+    for (;;) {
+        xSemaphoreTake(worker.start, portMAX_DELAY);
+        step_run(worker.frame, worker.step, 1);
+        xSemaphoreGive(worker.done);
+    }
+}
+
+/* Runs step on both threads and waits for both to finish */
+static void run_step(aec_2threads_frame_t *frame, aec_2threads_step_t step)
+{
+    worker.step = step;
+    worker.frame = frame;
+    xSemaphoreGive(worker.start);
+
+    step_run(frame, step, 0);
+
+    xSemaphoreTake(worker.done, portMAX_DELAY);
+}
+
+void aec_process_frame_2threads_init(unsigned priority)
+{
+    worker.start = xSemaphoreCreateBinary();
+    worker.done = xSemaphoreCreateBinary();
+    configASSERT(worker.start != NULL && worker.done != NULL);
+
+    BaseType_t ret = xTaskCreate((TaskFunction_t) aec_2threads_worker,
+                                 "aec_worker",
+                                 configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(aec_2threads_worker),
+                                 NULL,
+                                 priority,
+                                 NULL);
+    configASSERT(ret == pdPASS);
+    (void) ret;
+}
+
+void aec_process_frame_2threads(
+        aec_state_t *main_state,
+        aec_state_t *shadow_state,
+        int32_t (*output_main)[AEC_FRAME_ADVANCE],
+        int32_t (*output_shadow)[AEC_FRAME_ADVANCE],
+        const int32_t (*y_data)[AEC_FRAME_ADVANCE],
+        const int32_t (*x_data)[AEC_FRAME_ADVANCE])
+{
+    aec_2threads_frame_t frame = {
+        .main_state = main_state,
+        .shadow_state = shadow_state,
+        .output_main = output_main,
+        .output_shadow = output_shadow,
+        .num_y_channels = main_state->shared_state->num_y_channels,
+        .num_x_channels = main_state->shared_state->num_x_channels,
+    };
+
+    configASSERT(worker.start != NULL);
+
+    aec_frame_init(main_state, shadow_state, y_data, x_data);
+
+    run_step(&frame, AEC_STEP_INPUT_SPECTRUM);
+
+    run_step(&frame, AEC_STEP_X_FIFO_ENERGY);
+
+    X_energy_recalc_bin += 1;
+    if(X_energy_recalc_bin == (AEC_PROC_FRAME_LENGTH/2) + 1) {
+        X_energy_recalc_bin = 0;
+    }
+
+    // The X FIFO is shared by both filters, so it is updated before either uses it
+    for(int ch=0; ch<frame.num_x_channels; ch++) {
+        aec_update_X_fifo_and_calc_sigmaXX(main_state, ch);
+    }
+    aec_update_X_fifo_1d(main_state);
+    aec_update_X_fifo_1d(shadow_state);
+
+    run_step(&frame, AEC_STEP_ERROR_AND_Y_HAT);
+
+    run_step(&frame, AEC_STEP_OUTPUT);
+
+    run_step(&frame, AEC_STEP_ERROR_SPECTRUM);
+
+    // May copy one filter into the other, so runs on its own
+    aec_compare_filters_and_calc_mu(
+            main_state,
+            shadow_state);
+
+    run_step(&frame, AEC_STEP_FILTER_ADAPT);
+}
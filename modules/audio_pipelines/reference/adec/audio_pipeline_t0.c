@@ -12,6 +12,7 @@
 #include "timers.h"
 #include "queue.h"
 #include "stream_buffer.h"
+#include "rtos_printf.h"
 
 /* Library headers */
 #include "generic_pipeline.h"
@@ -27,15 +28,16 @@
 #include "app_conf.h"
 #include "audio_pipeline.h"
 #include "audio_pipeline_dsp.h"
+#include "audio_pipeline_wire.h"
+#include "frame_pool.h"
+#include "stage_stats.h"
 #include "platform/driver_instances.h"
 
-#if appconfAUDIO_PIPELINE_FRAME_ADVANCE != 240
-#error This pipeline is only configured for 240 frame advance
-#endif
-
 #define VNR_AGC_THRESHOLD (0.5)
 
 #if ON_TILE(0)
+static frame_pool_t frame_pool;
+
 static ic_stage_ctx_t DWORD_ALIGNED ic_stage_state = {};
 static vnr_pred_stage_ctx_t DWORD_ALIGNED vnr_pred_stage_state = {};
 static ns_stage_ctx_t DWORD_ALIGNED ns_stage_state = {};
@@ -45,21 +47,40 @@ static void *audio_pipeline_input_i(void *input_app_data)
 {
     frame_data_t *frame_data;
 
-    frame_data = pvPortMalloc(sizeof(frame_data_t));
-    memset(frame_data, 0x00, sizeof(frame_data_t));
-
-    size_t bytes_received = 0;
-    bytes_received = rtos_intertile_rx_len(
-            intertile_ctx,
-            appconfAUDIOPIPELINE_PORT,
-            portMAX_DELAY);
-
-    xassert(bytes_received == sizeof(frame_data_t));
-
-    rtos_intertile_rx_data(
-            intertile_ctx,
-            frame_data,
-            bytes_received);
+    frame_data = frame_pool_acquire(&frame_pool);
+
+    /* Frames tile 0 cannot use, such as from a build with a different
+     * wire format, are dropped and the next one is received instead */
+    for (;;) {
+        size_t bytes_received = 0;
+        bytes_received = rtos_intertile_rx_len(
+                intertile_ctx,
+                appconfAUDIOPIPELINE_PORT,
+                portMAX_DELAY);
+
+        if (bytes_received > AP_WIRE_MAX_BYTES) {
+            /* Too long for the frame, so it is read out into a buffer of its own */
+            void *msg = pvPortMalloc(bytes_received);
+            configASSERT(msg != NULL);
+            rtos_intertile_rx_data(
+                    intertile_ctx,
+                    msg,
+                    bytes_received);
+            vPortFree(msg);
+            rtos_printf("Dropped a %u byte audio pipeline frame\n", (unsigned) bytes_received);
+            continue;
+        }
+
+        rtos_intertile_rx_data(
+                intertile_ctx,
+                ap_wire_rx_buffer(frame_data),
+                bytes_received);
+
+        if (ap_wire_unpack(frame_data, bytes_received) == 0) {
+            break;
+        }
+        rtos_printf("Dropped an audio pipeline frame of an unsupported format\n");
+    }
 
     return frame_data;
 }
@@ -67,21 +88,40 @@ static void *audio_pipeline_input_i(void *input_app_data)
 static int audio_pipeline_output_i(frame_data_t *frame_data,
                                    void *output_app_data)
 {
-    return audio_pipeline_output(output_app_data,
-                               (int32_t **)frame_data->samples,
-                               6,
-                               appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+    frame_samples_to_output_plane(frame_data);
+
+    /* The frame goes back to the pool whatever audio_pipeline_output()
+     * returns, so it must not hold on to the samples */
+#if (AP_SUBFRAMES > 1)
+    for (int i = 0; i < AP_SUBFRAMES; i++) {
+        int32_t subframe[6][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+
+        ap_subframe_get((int32_t *)subframe, (int32_t *)frame_data->samples[AP_OUTPUT_PLANE], 6, i);
+        audio_pipeline_output(output_app_data,
+                              (int32_t **)subframe,
+                              6,
+                              appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+    }
+#else
+    audio_pipeline_output(output_app_data,
+                          (int32_t **)frame_data->samples[AP_OUTPUT_PLANE],
+                          6,
+                          appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+#endif
+
+    frame_pool_release(&frame_pool, frame_data);
+
+    return AUDIO_PIPELINE_DONT_FREE_FRAME;
 }
 
 static void stage_vnr_and_ic(frame_data_t *frame_data)
 {
 #if appconfAUDIO_PIPELINE_SKIP_IC_AND_VNR
 #else
-    int32_t DWORD_ALIGNED ic_output[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
     ic_filter(&ic_stage_state.state,
-              frame_data->samples[0],
-              frame_data->samples[1],
-              ic_output);
+              frame_samples(frame_data, 0),
+              frame_samples(frame_data, 1),
+              frame_samples_next(frame_data, 0));
 
     vnr_pred_state_t *vnr_pred_state = &vnr_pred_stage_state.vnr_pred_state;
     ic_calc_vnr_pred(&ic_stage_state.state, &vnr_pred_state->input_vnr_pred, &vnr_pred_state->output_vnr_pred);
@@ -92,7 +132,7 @@ static void stage_vnr_and_ic(frame_data_t *frame_data)
     ic_adapt(&ic_stage_state.state, vnr_pred_stage_state.vnr_pred_state.input_vnr_pred);
 
     /* Intentionally ignoring comms ch from here on out */
-    memcpy(frame_data->samples, ic_output, appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+    frame_samples_flip(frame_data, 0);
 #endif
 }
 
@@ -100,13 +140,12 @@ static void stage_ns(frame_data_t *frame_data)
 {
 #if appconfAUDIO_PIPELINE_SKIP_NS
 #else
-    int32_t DWORD_ALIGNED ns_output[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
-    configASSERT(NS_FRAME_ADVANCE == appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+    configASSERT(NS_FRAME_ADVANCE == AP_FRAME_ADVANCE);
     ns_process_frame(
                 &ns_stage_state.state,
-                ns_output,
-                frame_data->samples[0]);
-    memcpy(frame_data->samples, ns_output, appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+                frame_samples_next(frame_data, 0),
+                frame_samples(frame_data, 0));
+    frame_samples_flip(frame_data, 0);
 #endif
 }
 
@@ -114,8 +153,7 @@ static void stage_agc(frame_data_t *frame_data)
 {
 #if appconfAUDIO_PIPELINE_SKIP_AGC
 #else
-    int32_t DWORD_ALIGNED agc_output[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
-    configASSERT(AGC_FRAME_ADVANCE == appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+    configASSERT(AGC_FRAME_ADVANCE == AP_FRAME_ADVANCE);
 
     agc_stage_state.md.vnr_flag = frame_data->vnr_pred_flag;
     agc_stage_state.md.aec_ref_power = frame_data->max_ref_energy;
@@ -123,13 +161,17 @@ static void stage_agc(frame_data_t *frame_data)
 
     agc_process_frame(
             &agc_stage_state.state,
-            agc_output,
-            frame_data->samples[0],
+            frame_samples_next(frame_data, 0),
+            frame_samples(frame_data, 0),
             &agc_stage_state.md);
-    memcpy(frame_data->samples, agc_output, appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+    frame_samples_flip(frame_data, 0);
 #endif
 }
 
+STAGE_STATS_WRAP(stage_vnr_and_ic)
+STAGE_STATS_WRAP(stage_ns)
+STAGE_STATS_WRAP(stage_agc)
+
 static void initialize_pipeline_stages(void)
 {
     ic_init(&ic_stage_state.state);
@@ -141,6 +183,11 @@ static void initialize_pipeline_stages(void)
     agc_stage_state.md.aec_corr_factor = AGC_META_DATA_NO_AEC;
 }
 
+void audio_pipeline_frame_pool_stats(frame_pool_stats_t *stats)
+{
+    frame_pool_get_stats(&frame_pool, stats);
+}
+
 void audio_pipeline_init(
     void *input_app_data,
     void *output_app_data)
@@ -148,18 +195,23 @@ void audio_pipeline_init(
     const int stage_count = 3;
 
     const pipeline_stage_t stages[] = {
-        (pipeline_stage_t)stage_vnr_and_ic,
-        (pipeline_stage_t)stage_ns,
-        (pipeline_stage_t)stage_agc,
+        (pipeline_stage_t)stage_vnr_and_ic_timed,
+        (pipeline_stage_t)stage_ns_timed,
+        (pipeline_stage_t)stage_agc_timed,
     };
 
     const configSTACK_DEPTH_TYPE stage_stack_sizes[] = {
-        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_vnr_and_ic) + RTOS_THREAD_STACK_SIZE(audio_pipeline_input_i),
-        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_ns),
-        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_agc) + RTOS_THREAD_STACK_SIZE(audio_pipeline_output_i),
+        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_vnr_and_ic_timed) + RTOS_THREAD_STACK_SIZE(audio_pipeline_input_i),
+        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_ns_timed),
+        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_agc_timed) + RTOS_THREAD_STACK_SIZE(audio_pipeline_output_i),
     };
 
+    FRAME_POOL_INIT(frame_pool, frame_data_t, FRAME_POOL_DEPTH(sizeof(stages) / sizeof(stages[0])));
+
     initialize_pipeline_stages();
+    STAGE_STATS_REGISTER(stage_vnr_and_ic);
+    STAGE_STATS_REGISTER(stage_ns);
+    STAGE_STATS_REGISTER(stage_agc);
 
     generic_pipeline_init((pipeline_input_t)audio_pipeline_input_i,
                         (pipeline_output_t)audio_pipeline_output_i,
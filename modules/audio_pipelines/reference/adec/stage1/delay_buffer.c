@@ -9,6 +9,90 @@ void delay_buffer_init(delay_buf_state_t *state, int default_delay_samples) {
     memset(state->delay_buffer, 0, sizeof(state->delay_buffer));
     memset(&state->curr_idx[0], 0, sizeof(state->curr_idx));
     state->delay_samples = default_delay_samples;
+    state->delay_frac_q31 = 0;
+}
+
+/* Copy n samples into the circular buffer starting at idx, in at most two segments */
+static void ring_write(int32_t *buf, int32_t idx, const int32_t *src, int32_t n) {
+    int32_t first = DELAY_BUF_MAX_DELAY_SAMPLES - idx;
+    if(first >= n) {
+        memcpy(&buf[idx], src, n*sizeof(int32_t));
+    }
+    else {
+        memcpy(&buf[idx], src, first*sizeof(int32_t));
+        memcpy(&buf[0], &src[first], (n - first)*sizeof(int32_t));
+    }
+}
+
+/* Copy n samples out of the circular buffer starting at idx, in at most two segments */
+static void ring_read(const int32_t *buf, int32_t idx, int32_t *dst, int32_t n) {
+    int32_t first = DELAY_BUF_MAX_DELAY_SAMPLES - idx;
+    if(first >= n) {
+        memcpy(dst, &buf[idx], n*sizeof(int32_t));
+    }
+    else {
+        memcpy(dst, &buf[idx], first*sizeof(int32_t));
+        memcpy(&dst[first], &buf[0], (n - first)*sizeof(int32_t));
+    }
+}
+
+/* Number of samples behind the write position that the oldest sample of a frame is read from */
+static int32_t delay_span(const delay_buf_state_t *delay_state) {
+    int32_t abs_delay_samples = (delay_state->delay_samples < 0) ? -delay_state->delay_samples : delay_state->delay_samples;
+    if(abs_delay_samples == DELAY_BUF_MAX_DELAY_SAMPLES) {
+        abs_delay_samples = 0; // Same wrap as get_delayed_sample()
+    }
+    return abs_delay_samples + ((delay_state->delay_frac_q31 != 0) ? 1 : 0);
+}
+
+/* Delays one frame of AP_FRAME_ADVANCE samples of channel ch in place. This gives the same
+ * result as calling get_delayed_sample() on each sample in turn, using block copies instead.
+ * When delay_frac_q31 is non zero the output is linearly interpolated between the samples
+ * delay_samples and delay_samples+1 behind the input.
+ */
+void get_delayed_frame_ch(delay_buf_state_t *delay_state, int32_t *samples, int32_t ch) {
+    const int32_t n = AP_FRAME_ADVANCE;
+    const uint32_t frac = delay_state->delay_frac_q31;
+    const int32_t taps = (frac != 0) ? n + 1 : n;
+    const int32_t span = delay_span(delay_state);
+    int32_t *buf = delay_state->delay_buffer[ch];
+    int32_t curr_idx = delay_state->curr_idx[ch];
+    int32_t frame[AP_FRAME_ADVANCE + 1];
+
+    configASSERT(span < DELAY_BUF_MAX_DELAY_SAMPLES);
+
+    int32_t read_idx = curr_idx - span;
+    if(read_idx < 0) {
+        read_idx += DELAY_BUF_MAX_DELAY_SAMPLES;
+    }
+
+    if(span > DELAY_BUF_MAX_DELAY_SAMPLES - n) {
+        // The end of the read overlaps the start of this frame's write, so read the old samples first
+        ring_read(buf, read_idx, frame, taps);
+        ring_write(buf, curr_idx, samples, n);
+        if(frac == 0) {
+            memcpy(samples, frame, n*sizeof(int32_t));
+        }
+    }
+    else {
+        // The start of the read may overlap the end of this frame's write, so write first
+        ring_write(buf, curr_idx, samples, n);
+        ring_read(buf, read_idx, (frac == 0) ? samples : frame, taps);
+    }
+
+    if(frac != 0) {
+        // frame[i] is one sample older than frame[i+1]
+        for(int i=0; i<n; i++) {
+            int64_t diff = (int64_t)frame[i] - frame[i+1];
+            samples[i] = frame[i+1] + (int32_t)((diff * frac) >> 31);
+        }
+    }
+
+    curr_idx += n;
+    if(curr_idx >= DELAY_BUF_MAX_DELAY_SAMPLES) {
+        curr_idx -= DELAY_BUF_MAX_DELAY_SAMPLES;
+    }
+    delay_state->curr_idx[ch] = curr_idx;
 }
 
 void get_delayed_sample(delay_buf_state_t *delay_state, int32_t *sample, int32_t ch) {
@@ -25,16 +109,22 @@ void get_delayed_sample(delay_buf_state_t *delay_state, int32_t *sample, int32_t
 
 void update_delay_samples(delay_buf_state_t *delay_state, int32_t num_samples) {
     delay_state->delay_samples = num_samples;
+    delay_state->delay_frac_q31 = 0;
+}
+
+void update_delay_samples_frac(delay_buf_state_t *delay_state, int32_t num_samples, uint32_t frac_q31) {
+    configASSERT(frac_q31 < 0x80000000);
+    delay_state->delay_samples = num_samples;
+    delay_state->delay_frac_q31 = frac_q31;
 }
 
 void reset_partial_delay_buffer(delay_buf_state_t *delay_state, int32_t ch) {
-    int32_t num_samples = delay_state->delay_samples;
+    // Reset the samples a frame is read from that are older than the current index
+    int32_t num_samples = delay_span(delay_state);
     if(!num_samples) {
         return;
     }
-    // Reset delay_state->delay_samples before the current index
 
-    num_samples = (num_samples < 0) ? -num_samples : num_samples;
     // Reset num_samples samples before curr_idx
     int32_t reset_start = (
             (DELAY_BUF_MAX_DELAY_SAMPLES + delay_state->curr_idx[ch] - num_samples)
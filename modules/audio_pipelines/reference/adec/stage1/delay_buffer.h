@@ -11,11 +11,15 @@ typedef struct {
     // index of the value for the samples to be stored in the buffer
     int32_t curr_idx[MAX_DELAY_BUF_CHANNELS];
     int32_t delay_samples;
+    // Fractional part of the delay, as an unsigned Q0.31 value in [0, 1). Applies to the same channels as delay_samples
+    uint32_t delay_frac_q31;
 } delay_buf_state_t;
 
 void delay_buffer_init(delay_buf_state_t *state, int default_delay_samples);
 void get_delayed_sample(delay_buf_state_t *delay_state, int32_t *sample, int32_t ch);
+void get_delayed_frame_ch(delay_buf_state_t *delay_state, int32_t *samples, int32_t ch);
 void update_delay_samples(delay_buf_state_t *delay_state, int32_t num_samples);
+void update_delay_samples_frac(delay_buf_state_t *delay_state, int32_t num_samples, uint32_t frac_q31);
 void reset_partial_delay_buffer(delay_buf_state_t *delay_state, int32_t ch);
 
 #endif /* DELAY_BUFFER_H_ */
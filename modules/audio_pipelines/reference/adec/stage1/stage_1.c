@@ -1,9 +1,18 @@
 // Copyright 2022-2023 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
+#include <math.h>
 #include "audio_pipeline_dsp.h"
 #include "stage_1.h"
 
+extern void aec_process_frame_2threads(
+        aec_state_t *main_state,
+        aec_state_t *shadow_state,
+        int32_t (*output_main)[AEC_FRAME_ADVANCE],
+        int32_t (*output_shadow)[AEC_FRAME_ADVANCE],
+        const int32_t (*y_data)[AEC_FRAME_ADVANCE],
+        const int32_t (*x_data)[AEC_FRAME_ADVANCE]);
+
 extern void aec_process_frame_1thread(
         aec_state_t *main_state,
         aec_state_t *shadow_state,
@@ -20,6 +29,108 @@ static void aec_switch_configuration(stage_1_state_t *state, aec_conf_t *conf)
             conf->num_main_filt_phases, conf->num_shadow_filt_phases);
 }
 
+/* Copies the main filter y0/x0 phases that are still inside the new filter once it is delayed by shift_samples.
+ * Returns the number of phases stashed. *first_phase is set to the first phase of the old filter that was stashed.
+ */
+static int stash_filter_phases(stage_1_state_t *state, int32_t shift_phases, int32_t new_num_phases, int32_t *first_phase)
+{
+#if (STAGE_1_REMAP_PHASES > 0)
+    int32_t old_num_phases = state->aec_main_state.num_phases;
+    int32_t lo = (shift_phases < 0) ? -shift_phases : 0;
+    int32_t hi = new_num_phases - shift_phases;
+    if(hi > old_num_phases) {
+        hi = old_num_phases;
+    }
+    int32_t count = hi - lo;
+    if(count > STAGE_1_REMAP_PHASES) {
+        count = STAGE_1_REMAP_PHASES;
+    }
+    if(count <= 0) {
+        return 0;
+    }
+    for(int i=0; i<count; i++) {
+        // The x0 phases come first in H_hat
+        bfp_complex_s32_t *src = &state->aec_main_state.H_hat[0][lo + i];
+        memcpy(&state->remap_phases[i][0], src->data, AEC_FD_FRAME_LENGTH*sizeof(complex_s32_t));
+        state->remap_exp[i] = src->exp;
+        state->remap_hr[i] = src->hr;
+    }
+    *first_phase = lo;
+    return count;
+#else
+    (void) state; (void) shift_phases; (void) new_num_phases; (void) first_phase;
+    return 0;
+#endif
+}
+
+/* Writes the stashed phases back into the re-initialised filter, shift_phases later, and applies the remaining
+ * sub-frame delay of shift_rem samples as a linear phase rotation of every bin.
+ */
+static void restore_filter_phases(stage_1_state_t *state, int count, int32_t first_phase, int32_t shift_phases, int32_t shift_rem)
+{
+#if (STAGE_1_REMAP_PHASES > 0)
+    bfp_complex_s32_t rot;
+    if(shift_rem != 0) {
+        complex_s32_t *r = &state->remap_phases[STAGE_1_REMAP_PHASES][0];
+        for(int k=0; k<AEC_FD_FRAME_LENGTH; k++) {
+            float theta = -2.0f * (float)M_PI * (float)k * (float)shift_rem / AEC_PROC_FRAME_LENGTH;
+            r[k].re = (int32_t)(cosf(theta) * (float)(1 << 30));
+            r[k].im = (int32_t)(sinf(theta) * (float)(1 << 30));
+        }
+        bfp_complex_s32_init(&rot, r, -30, AEC_FD_FRAME_LENGTH, 1);
+    }
+    for(int i=0; i<count; i++) {
+        bfp_complex_s32_t *dst = &state->aec_main_state.H_hat[0][first_phase + shift_phases + i];
+        memcpy(dst->data, &state->remap_phases[i][0], AEC_FD_FRAME_LENGTH*sizeof(complex_s32_t));
+        dst->exp = state->remap_exp[i];
+        dst->hr = state->remap_hr[i];
+        if(shift_rem != 0) {
+            bfp_complex_s32_mul(dst, dst, &rot);
+        }
+    }
+#else
+    (void) state; (void) count; (void) first_phase; (void) shift_phases; (void) shift_rem;
+#endif
+}
+
+/* Switches the AEC to the requested configuration.
+ *
+ * With STAGE_1_REMAP_PHASES > 0 this runs on the frame after the request, in place of the AEC, so the cost of
+ * aec_init() does not add to a frame that has already run the AEC and ADEC. With 0 it runs at the end of the
+ * requesting frame, as the switch always did. When switching back to normal AEC mode, the converged delay estimation filter
+ * is carried over, moved by the delay change made in the delay buffer since it was adapted.
+ * The X FIFO is not carried over, and refills over the next num_main_filt_phases frames.
+ */
+static void aec_apply_pending_configuration(stage_1_state_t *state)
+{
+    aec_conf_t *conf = state->aec_pending_conf;
+    int count = 0;
+    int32_t first_phase = 0;
+    int32_t shift = state->delay_state.delay_samples - state->aec_filter_delay_samples;
+    // Delaying the mic by shift samples delays the echo path, and so the filter, by the same amount
+    int32_t shift_phases = shift / AP_FRAME_ADVANCE;
+    int32_t shift_rem = shift - (shift_phases * AP_FRAME_ADVANCE);
+    if(shift_rem < 0) {
+        shift_phases -= 1;
+        shift_rem += AP_FRAME_ADVANCE;
+    }
+
+    // A delay estimation filter seeded with the old filter would bias the new estimate, so only remap into normal mode
+    if(conf == &state->aec_non_de_mode_conf) {
+        count = stash_filter_phases(state, shift_phases, conf->num_main_filt_phases, &first_phase);
+    }
+
+    aec_switch_configuration(state, conf);
+    if(conf == &state->aec_de_mode_conf) {
+        state->aec_main_state.shared_state->config_params.coh_mu_conf.adaption_config = AEC_ADAPTION_FORCE_ON;
+    }
+
+    restore_filter_phases(state, count, first_phase, shift_phases, shift_rem);
+
+    state->aec_filter_delay_samples = state->delay_state.delay_samples;
+    state->aec_pending_conf = NULL;
+}
+
 static inline void get_delayed_frame(
         int32_t (*input_y_data)[AP_FRAME_ADVANCE],
         int32_t (*input_x_data)[AP_FRAME_ADVANCE],
@@ -28,16 +139,12 @@ static inline void get_delayed_frame(
     int num_channels = (delay_state->delay_samples) > 0 ? AP_MAX_Y_CHANNELS : AP_MAX_X_CHANNELS;
     if (delay_state->delay_samples >= 0) {/** Requested Mic delay +ve => delay mic*/
         for(int ch=0; ch<num_channels; ch++) {
-            for(int i=0; i<AP_FRAME_ADVANCE; i++) {
-                get_delayed_sample(delay_state, &input_y_data[ch][i], ch);
-            }
+            get_delayed_frame_ch(delay_state, &input_y_data[ch][0], ch);
         }
     }
     else if (delay_state->delay_samples < 0) {/* Requested Mic delay negative => advance mic which can't be done, so delay reference*/
         for(int ch=0; ch<num_channels; ch++) {
-            for(int i=0; i<AP_FRAME_ADVANCE; i++) {
-                get_delayed_sample(delay_state, &input_x_data[ch][i], ch);
-            }
+            get_delayed_frame_ch(delay_state, &input_x_data[ch][0], ch);
         }
     }
     return;
@@ -55,6 +162,8 @@ void stage_1_init(stage_1_state_t *state, aec_conf_t *de_conf, aec_conf_t *non_d
 
     adec_init(&state->adec_state, adec_config);
     aec_switch_configuration(state, &state->aec_non_de_mode_conf);
+    state->aec_pending_conf = NULL;
+    state->aec_filter_delay_samples = state->delay_state.delay_samples;
 }
 
 /** Process a frame of data through AEC and ADEC*/
@@ -76,8 +185,27 @@ void stage_1_process_frame(stage_1_state_t *state, int32_t (*output_frame)[AP_FR
     /** Detect if there's activity on the reference channels*/
     *ref_active_flag = aec_detect_input_activity(input_x, state->ref_active_threshold, state->aec_main_state.shared_state->num_x_channels);
 
+    /** Finish an AEC config switch requested on the previous frame. AEC and ADEC are skipped for this frame*/
+    if(state->aec_pending_conf != NULL) {
+        aec_apply_pending_configuration(state);
+
+        for(int ch=0; ch<AP_MAX_Y_CHANNELS; ch++) {
+            memcpy(&output_frame[ch][0], &input_y[ch][0], AP_FRAME_ADVANCE*sizeof(int32_t));
+        }
+        *max_ref_energy = aec_calc_max_input_energy(input_x, state->aec_main_state.shared_state->num_x_channels);
+        for(int ch=0; ch<state->aec_main_state.shared_state->num_y_channels; ch++) {
+            aec_corr_factor[ch].mant = 0;
+            aec_corr_factor[ch].exp = 0;
+        }
+        return;
+    }
+
     /** AEC*/
+#if (NUM_AEC_THREADS > 1)
+    aec_process_frame_2threads(&state->aec_main_state, &state->aec_shadow_state, output_frame, NULL, input_y, input_x);
+#else
     aec_process_frame_1thread(&state->aec_main_state, &state->aec_shadow_state, output_frame, NULL, input_y, input_x);
+#endif
 
     /** Update metadata*/
     *max_ref_energy = aec_calc_max_input_energy(input_x, state->aec_main_state.shared_state->num_x_channels);
@@ -112,6 +240,7 @@ void stage_1_process_frame(stage_1_state_t *state, int32_t (*output_frame)[AP_FR
     //** Reset AEC state if needed*/
     if(adec_output.reset_aec_flag) {
         aec_reset_state(&state->aec_main_state, &state->aec_shadow_state);
+        state->aec_filter_delay_samples = state->delay_state.delay_samples;
     }
 
     /** Update delay buffer if there's a delay change requested by ADEC*/
@@ -137,16 +266,22 @@ void stage_1_process_frame(stage_1_state_t *state, int32_t (*output_frame)[AP_FR
          * requested as a result of force_de_cycle_trigger being set*/
         state->adec_state.adec_config.force_de_cycle_trigger = 0;
 
-        // Initialise AEC for delay estimation config
-        aec_switch_configuration(state, &state->aec_de_mode_conf);
-        state->aec_main_state.shared_state->config_params.coh_mu_conf.adaption_config = AEC_ADAPTION_FORCE_ON;
+        // Initialise AEC for delay estimation config on the next frame
+        state->aec_pending_conf = &state->aec_de_mode_conf;
         state->delay_estimator_enabled = 1;
         //printf("framenum %d: switch to de mode\n", framenum);
     } else if ((!adec_output.delay_estimator_enabled_flag && state->delay_estimator_enabled)) {
-        // Start AEC for normal aec config
-        aec_switch_configuration(state, &state->aec_non_de_mode_conf);
+        // Start AEC for normal aec config on the next frame
+        state->aec_pending_conf = &state->aec_non_de_mode_conf;
         state->delay_estimator_enabled = 0;
         //printf("framenum %d: switch to aec mode\n", framenum);
 
     }
+
+#if (STAGE_1_REMAP_PHASES == 0)
+    /** With no filter to carry over, switch on this frame so that the next one runs the AEC*/
+    if(state->aec_pending_conf != NULL) {
+        aec_apply_pending_configuration(state);
+    }
+#endif
 }
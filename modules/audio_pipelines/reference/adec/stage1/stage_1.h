@@ -13,6 +13,13 @@
 #define REF_ACTIVE_THRESHOLD_dB (-60) // Reference input level above which it is considered active
 #define HOLD_AEC_LIMIT_SECONDS (3) // Keep AEC enabled for atleast 3seconds after detecting reference as inactive. Used only in alt arch configuration
 
+// Max. number of converged main filter phases carried over when switching from delay estimation back to normal AEC mode.
+// Each phase needs AEC_FD_FRAME_LENGTH complex samples of RAM. When above 0, each switch is applied on the frame after
+// it is requested, which outputs the mic input. Set to 0 to restart the filter from zero and switch on the requesting frame.
+#ifndef STAGE_1_REMAP_PHASES
+#define STAGE_1_REMAP_PHASES (5)
+#endif
+
 typedef struct {
     uint8_t num_x_channels;
     uint8_t num_y_channels;
@@ -34,10 +41,19 @@ typedef struct {
     // Delay Buffer
     delay_buf_state_t DWORD_ALIGNED delay_state;
 
+#if (STAGE_1_REMAP_PHASES > 0)
+    // Filter phases kept across an AEC reconfiguration. The extra phase holds the per bin rotation for the sub-frame delay change
+    complex_s32_t DWORD_ALIGNED remap_phases[STAGE_1_REMAP_PHASES + 1][AEC_FD_FRAME_LENGTH];
+    exponent_t remap_exp[STAGE_1_REMAP_PHASES];
+    headroom_t remap_hr[STAGE_1_REMAP_PHASES];
+#endif
+
     //Top level
     aec_conf_t aec_de_mode_conf;
     aec_conf_t aec_non_de_mode_conf;
     int32_t delay_estimator_enabled;
+    aec_conf_t *aec_pending_conf; // Configuration to switch the AEC to at the start of the next frame, or NULL
+    int32_t aec_filter_delay_samples; // Delay buffer delay the current AEC filter was adapted with
     float_s32_t ref_active_threshold; //-60dB
 
     //alt-arch
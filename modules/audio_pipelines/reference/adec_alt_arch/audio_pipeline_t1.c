@@ -2,6 +2,7 @@
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 /* STD headers */
+#include <stddef.h>
 #include <string.h>
 #include <stdint.h>
 #include <xcore/hwtimer.h>
@@ -21,13 +22,22 @@
 #include "app_conf.h"
 #include "audio_pipeline.h"
 #include "audio_pipeline_dsp.h"
+#include "audio_pipeline_wire.h"
+#include "frame_pool.h"
+#include "stage_stats.h"
 #include "stage_1.h"
 
-#if appconfAUDIO_PIPELINE_FRAME_ADVANCE != 240
-#error This pipeline is only configured for 240 frame advance
+/* The AEC stage flips the sample planes, so start on the other plane for its
+ * output to land on the one ap_wire_pack() sends without a copy */
+#if appconfAUDIO_PIPELINE_SKIP_AEC
+#define AP_INPUT_PLANE AP_OUTPUT_PLANE
+#else
+#define AP_INPUT_PLANE (AP_OUTPUT_PLANE ^ 1)
 #endif
 
 #if ON_TILE(1)
+static frame_pool_t frame_pool;
+
 // Stage1 - AEC, DE, ADEC
 static stage_1_state_t DWORD_ALIGNED stage_1_state;
 static aec_conf_t aec_de_mode_conf;
@@ -38,17 +48,35 @@ static void *audio_pipeline_input_i(void *input_app_data)
 {
     frame_data_t *frame_data;
 
-    frame_data = pvPortMalloc(sizeof(frame_data_t));
-    memset(frame_data, 0x00, sizeof(frame_data_t));
+    frame_data = frame_pool_acquire(&frame_pool);
+
+    /* The sample planes are all written below or by the stages, so only the
+     * per frame context that follows them needs clearing */
+    memset(&frame_data->cur_plane, 0x00, sizeof(frame_data_t) - offsetof(frame_data_t, cur_plane));
+
+#if (AP_SUBFRAMES > 1)
+    for (int i = 0; i < AP_SUBFRAMES; i++) {
+        int32_t subframe[4][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
 
+        audio_pipeline_input(input_app_data,
+                           (int32_t **)subframe,
+                           4,
+                           appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+        ap_subframe_put((int32_t *)frame_data->aec_reference_audio_samples, (int32_t *)subframe, 4, i);
+    }
+#else
     audio_pipeline_input(input_app_data,
                        (int32_t **)frame_data->aec_reference_audio_samples,
                        4,
                        appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+#endif
 
     frame_data->vnr_pred_flag = 0;
 
-    memcpy(frame_data->samples, frame_data->mic_samples_passthrough, sizeof(frame_data->samples));
+    memcpy(frame_data->samples[AP_INPUT_PLANE], frame_data->mic_samples_passthrough, sizeof(frame_data->samples[AP_INPUT_PLANE]));
+    for (int ch = 0; ch < appconfAUDIO_PIPELINE_CHANNELS; ch++) {
+        frame_data->cur_plane[ch] = AP_INPUT_PLANE;
+    }
 
     return frame_data;
 }
@@ -56,31 +84,36 @@ static void *audio_pipeline_input_i(void *input_app_data)
 static int audio_pipeline_output_i(frame_data_t *frame_data,
                                    void *output_app_data)
 {
+    size_t len;
+    void *msg = ap_wire_pack(frame_data, &len);
+
     rtos_intertile_tx(intertile_ctx,
                       appconfAUDIOPIPELINE_PORT,
-                      frame_data,
-                      sizeof(frame_data_t));
-    return AUDIO_PIPELINE_FREE_FRAME;
+                      msg,
+                      len);
+    frame_pool_release(&frame_pool, frame_data);
+
+    return AUDIO_PIPELINE_DONT_FREE_FRAME;
 }
 
 static void stage_aec(frame_data_t *frame_data)
 {
 #if appconfAUDIO_PIPELINE_SKIP_AEC
 #else
-    int32_t DWORD_ALIGNED stage_1_out[AEC_MAX_Y_CHANNELS][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
-
     stage_1_process_frame(&stage_1_state,
-                          &stage_1_out[0],
+                          frame_samples_plane(frame_data, 1),
                           &frame_data->max_ref_energy,
                           &frame_data->aec_corr_factor,
                           &frame_data->ref_active_flag,
-                          frame_data->samples,
+                          frame_samples_plane(frame_data, 0),
                           frame_data->aec_reference_audio_samples);
 
-    memcpy(frame_data->samples, stage_1_out, AEC_MAX_Y_CHANNELS * appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+    frame_samples_flip_all(frame_data);
 #endif
 }
 
+STAGE_STATS_WRAP(stage_aec)
+
 static void initialize_pipeline_stages(void)
 {
     aec_non_de_mode_conf.num_y_channels = 1;
@@ -97,6 +130,15 @@ static void initialize_pipeline_stages(void)
     adec_conf.bypass = 1; // Bypass automatic DE correction
     adec_conf.force_de_cycle_trigger = 1; // Force a delay correction cycle, so that delay correction happens once after initialisation. Make sure this is set back to 0 after adec has requested a transition into DE mode once, to stop any further delay correction (automatic or forced) by ADEC
     stage_1_init(&stage_1_state, &aec_de_mode_conf, &aec_non_de_mode_conf, &adec_conf);
+
+#if (NUM_AEC_THREADS > 1)
+    aec_process_frame_2threads_init(appconfAUDIO_PIPELINE_TASK_PRIORITY);
+#endif
+}
+
+void audio_pipeline_frame_pool_stats(frame_pool_stats_t *stats)
+{
+    frame_pool_get_stats(&frame_pool, stats);
 }
 
 void audio_pipeline_init(
@@ -106,15 +148,18 @@ void audio_pipeline_init(
     const int stage_count = 1;
 
     const pipeline_stage_t stages[] = {
-        (pipeline_stage_t)stage_aec,
+        (pipeline_stage_t)stage_aec_timed,
     };
 
     const configSTACK_DEPTH_TYPE stage_stack_sizes[] = {
-        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_aec) + RTOS_THREAD_STACK_SIZE(audio_pipeline_output_i) + RTOS_THREAD_STACK_SIZE(audio_pipeline_input_i),
+        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_aec_timed) + RTOS_THREAD_STACK_SIZE(audio_pipeline_output_i) + RTOS_THREAD_STACK_SIZE(audio_pipeline_input_i),
 
     };
 
+    FRAME_POOL_INIT(frame_pool, frame_data_t, FRAME_POOL_DEPTH(sizeof(stages) / sizeof(stages[0])));
+
     initialize_pipeline_stages();
+    STAGE_STATS_REGISTER(stage_aec);
 
     generic_pipeline_init((pipeline_input_t)audio_pipeline_input_i,
                         (pipeline_output_t)audio_pipeline_output_i,
@@ -6,6 +6,7 @@
 
 #include <stdint.h>
 #include "app_conf.h"
+#include "frame_pool.h"
 
 #define AUDIO_PIPELINE_DONT_FREE_FRAME 0
 #define AUDIO_PIPELINE_FREE_FRAME      1
@@ -26,4 +27,11 @@ int audio_pipeline_output(
         size_t ch_count,
         size_t frame_count);
 
+/**
+ * Reports the usage of the frame pool on the calling tile. A non-zero
+ * exhausted count means the pool is too small for the pipeline depth, see
+ * appconfAUDIO_PIPELINE_FRAME_POOL_EXTRA_FRAMES.
+ */
+void audio_pipeline_frame_pool_stats(frame_pool_stats_t *stats);
+
 #endif /* AUDIO_PIPELINE_H_ */
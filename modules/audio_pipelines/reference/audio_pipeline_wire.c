@@ -0,0 +1,106 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* App headers */
+#include "audio_pipeline_dsp.h"
+#include "audio_pipeline_wire.h"
+
+/* The header must fit in the unused plane and keep the samples aligned */
+_Static_assert(AP_OUTPUT_PLANE > 0, "The header is placed in the plane before AP_OUTPUT_PLANE");
+_Static_assert(sizeof(ap_wire_header_t) % 8 == 0, "ap_wire_header_t must be a multiple of 8 bytes");
+_Static_assert(sizeof(ap_wire_header_t) <= AP_WIRE_PLANE_BYTES, "ap_wire_header_t must fit in a sample plane");
+
+static size_t message_len(uint8_t planes)
+{
+    size_t len = sizeof(ap_wire_header_t) + AP_WIRE_PLANE_BYTES;
+
+    if (planes & AP_WIRE_PLANE_REF) {
+        len += AP_WIRE_PLANE_BYTES;
+    }
+    if (planes & AP_WIRE_PLANE_MIC) {
+        len += AP_WIRE_PLANE_BYTES;
+    }
+    return len;
+}
+
+void *ap_wire_rx_buffer(frame_data_t *frame_data)
+{
+    return (uint8_t *)frame_data->samples[AP_OUTPUT_PLANE] - sizeof(ap_wire_header_t);
+}
+
+void *ap_wire_pack(frame_data_t *frame_data, size_t *len)
+{
+    const uint8_t planes = appconfAUDIO_PIPELINE_WIRE_PLANES;
+    ap_wire_header_t header = {
+        .version = AP_WIRE_VERSION,
+        .planes = planes,
+        .channels = appconfAUDIO_PIPELINE_CHANNELS,
+        .ref_active_flag = frame_data->ref_active_flag != 0,
+        .frame_advance = AP_FRAME_ADVANCE,
+        .reserved = 0,
+        .max_ref_energy = frame_data->max_ref_energy,
+        .aec_corr_factor = frame_data->aec_corr_factor,
+    };
+
+    /* This is a no-op when tile 1 has arranged for its last stage to write
+     * to AP_OUTPUT_PLANE. It frees up the other plane for the header. */
+    frame_samples_to_output_plane(frame_data);
+
+    if ((planes & AP_WIRE_PLANE_MIC) && !(planes & AP_WIRE_PLANE_REF)) {
+        /* Close the gap left by the reference */
+        memcpy(frame_data->aec_reference_audio_samples,
+               frame_data->mic_samples_passthrough,
+               AP_WIRE_PLANE_BYTES);
+    }
+
+    void *msg = ap_wire_rx_buffer(frame_data);
+    memcpy(msg, &header, sizeof(header));
+
+    *len = message_len(planes);
+    return msg;
+}
+
+int ap_wire_unpack(frame_data_t *frame_data, size_t len)
+{
+    ap_wire_header_t header;
+
+    if (len < sizeof(header)) {
+        return -1;
+    }
+    memcpy(&header, ap_wire_rx_buffer(frame_data), sizeof(header));
+
+    if (header.version != AP_WIRE_VERSION ||
+        (header.planes & ~(AP_WIRE_PLANE_REF | AP_WIRE_PLANE_MIC)) != 0 ||
+        header.channels != appconfAUDIO_PIPELINE_CHANNELS ||
+        header.frame_advance != AP_FRAME_ADVANCE ||
+        len != message_len(header.planes)) {
+        return -1;
+    }
+
+    if ((header.planes & AP_WIRE_PLANE_MIC) && !(header.planes & AP_WIRE_PLANE_REF)) {
+        memcpy(frame_data->mic_samples_passthrough,
+               frame_data->aec_reference_audio_samples,
+               AP_WIRE_PLANE_BYTES);
+    }
+    if (!(header.planes & AP_WIRE_PLANE_REF)) {
+        memset(frame_data->aec_reference_audio_samples, 0, AP_WIRE_PLANE_BYTES);
+    }
+    if (!(header.planes & AP_WIRE_PLANE_MIC)) {
+        memset(frame_data->mic_samples_passthrough, 0, AP_WIRE_PLANE_BYTES);
+    }
+
+    for (int ch = 0; ch < appconfAUDIO_PIPELINE_CHANNELS; ch++) {
+        frame_data->cur_plane[ch] = AP_OUTPUT_PLANE;
+    }
+    frame_data->vnr_pred_flag = 0;
+    frame_data->max_ref_energy = header.max_ref_energy;
+    frame_data->aec_corr_factor = header.aec_corr_factor;
+    frame_data->ref_active_flag = header.ref_active_flag;
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef AUDIO_PIPELINE_WIRE_H_
+#define AUDIO_PIPELINE_WIRE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_conf.h"
+#include "audio_pipeline_dsp.h"
+
+/**
+ * Intertile frame format, sent from tile 1 to tile 0.
+ *
+ * A message is an ap_wire_header_t followed by the current plane of the
+ * processed samples and then the optional reference and raw mic planes
+ * named in the header, each appconfAUDIO_PIPELINE_CHANNELS channels of
+ * AP_FRAME_ADVANCE samples.
+ *
+ * The header is written into the unused sample plane, directly ahead of the
+ * processed samples, so packing and unpacking do not copy any samples when
+ * all the planes are sent.
+ *
+ * Bump AP_WIRE_VERSION when the format changes.
+ */
+#define AP_WIRE_VERSION         (1)
+
+#define AP_WIRE_PLANE_REF       (1 << 0)
+#define AP_WIRE_PLANE_MIC       (1 << 1)
+
+/**
+ * The optional planes sent to tile 0. Applications that do not output the
+ * reference or raw mic audio can leave them out to save intertile
+ * bandwidth, in which case tile 0 sees zeros in their place. Sending both
+ * costs the same as the whole frame did before this format, 5784 bytes.
+ * Each plane left out saves 1920 bytes.
+ */
+#ifndef appconfAUDIO_PIPELINE_WIRE_PLANES
+#define appconfAUDIO_PIPELINE_WIRE_PLANES   (AP_WIRE_PLANE_REF | AP_WIRE_PLANE_MIC)
+#endif
+
+typedef struct {
+    uint8_t version;
+    uint8_t planes;             /* AP_WIRE_PLANE_* flags */
+    uint8_t channels;
+    uint8_t ref_active_flag;
+    uint16_t frame_advance;
+    uint16_t reserved;
+    float_s32_t max_ref_energy;
+    float_s32_t aec_corr_factor;
+} ap_wire_header_t;
+
+#define AP_WIRE_PLANE_BYTES     (appconfAUDIO_PIPELINE_CHANNELS * AP_FRAME_ADVANCE * sizeof(int32_t))
+#define AP_WIRE_MAX_BYTES       (sizeof(ap_wire_header_t) + 3 * AP_WIRE_PLANE_BYTES)
+
+/**
+ * Packs a frame for rtos_intertile_tx(). The frame must not be used again
+ * other than to be released.
+ *
+ * \param frame_data  The frame to send.
+ * \param len         Set to the length of the message.
+ *
+ * \returns the start of the message, which lies within frame_data.
+ */
+void *ap_wire_pack(frame_data_t *frame_data, size_t *len);
+
+/**
+ * Returns where in frame_data a received message of up to
+ * AP_WIRE_MAX_BYTES must be placed for ap_wire_unpack().
+ */
+void *ap_wire_rx_buffer(frame_data_t *frame_data);
+
+/**
+ * Unpacks a message received into ap_wire_rx_buffer(). On return every
+ * channel is on AP_OUTPUT_PLANE and the per frame context is set.
+ *
+ * \returns 0 on success, or -1 if the message is not a supported version or
+ *          does not match this pipeline's configuration. The frame's
+ *          contents are then undefined, and it should be dropped.
+ */
+int ap_wire_unpack(frame_data_t *frame_data, size_t len);
+
+#endif /* AUDIO_PIPELINE_WIRE_H_ */
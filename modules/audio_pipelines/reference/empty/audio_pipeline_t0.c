@@ -20,19 +20,17 @@
 #include "app_conf.h"
 #include "audio_pipeline.h"
 #include "audio_pipeline_dsp.h"
-
-#if appconfAUDIO_PIPELINE_FRAME_ADVANCE != 240
-#error This pipeline is only configured for 240 frame advance
-#endif
+#include "frame_pool.h"
 
 #if ON_TILE(0)
+static frame_pool_t frame_pool;
 
 static void *audio_pipeline_input_i(void *input_app_data)
 {
     frame_data_t *frame_data;
 
-    frame_data = pvPortMalloc(sizeof(frame_data_t));
-    memset(frame_data, 0x00, sizeof(frame_data_t));
+    /* Every byte of the frame is overwritten by the received frame */
+    frame_data = frame_pool_acquire(&frame_pool);
 
     size_t bytes_received = 0;
     bytes_received = rtos_intertile_rx_len(
@@ -53,10 +51,16 @@ static void *audio_pipeline_input_i(void *input_app_data)
 static int audio_pipeline_output_i(frame_data_t *frame_data,
                                    void *output_app_data)
 {
-    return audio_pipeline_output(output_app_data,
-                               (int32_t **)frame_data->samples,
-                               6,
-                               appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+    /* The frame goes back to the pool whatever audio_pipeline_output()
+     * returns, so it must not hold on to the samples */
+    audio_pipeline_output(output_app_data,
+                          (int32_t **)frame_data->samples,
+                          6,
+                          appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+
+    frame_pool_release(&frame_pool, frame_data);
+
+    return AUDIO_PIPELINE_DONT_FREE_FRAME;
 }
 
 void empty_stage(void)
@@ -69,6 +73,11 @@ static void initialize_pipeline_stages(void)
     ;
 }
 
+void audio_pipeline_frame_pool_stats(frame_pool_stats_t *stats)
+{
+    frame_pool_get_stats(&frame_pool, stats);
+}
+
 void audio_pipeline_init(
     void *input_app_data,
     void *output_app_data)
@@ -85,6 +94,8 @@ void audio_pipeline_init(
         configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(empty_stage) + RTOS_THREAD_STACK_SIZE(audio_pipeline_output_i),
     };
 
+    FRAME_POOL_INIT(frame_pool, frame_data_t, FRAME_POOL_DEPTH(sizeof(stages) / sizeof(stages[0])));
+
     initialize_pipeline_stages();
 
     generic_pipeline_init((pipeline_input_t)audio_pipeline_input_i,
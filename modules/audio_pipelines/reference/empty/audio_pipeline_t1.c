@@ -20,17 +20,15 @@
 #include "app_conf.h"
 #include "audio_pipeline.h"
 #include "audio_pipeline_dsp.h"
-
-#if appconfAUDIO_PIPELINE_FRAME_ADVANCE != 240
-#error This pipeline is only configured for 240 frame advance
-#endif
+#include "frame_pool.h"
 
 #if ON_TILE(1)
+static frame_pool_t frame_pool;
 
 static void *audio_pipeline_input_i(void *input_app_data)
 {
     frame_data_t *frame_data;
-    frame_data = pvPortMalloc(sizeof(frame_data_t));
+    frame_data = frame_pool_acquire(&frame_pool);
     memset(frame_data, 0x00, sizeof(frame_data_t));
 
     audio_pipeline_input(input_app_data,
@@ -52,7 +50,9 @@ static int audio_pipeline_output_i(frame_data_t *frame_data,
                       frame_data,
                       sizeof(frame_data_t));
 
-    return AUDIO_PIPELINE_FREE_FRAME;
+    frame_pool_release(&frame_pool, frame_data);
+
+    return AUDIO_PIPELINE_DONT_FREE_FRAME;
 }
 
 void empty_stage(void)
@@ -65,6 +65,11 @@ static void initialize_pipeline_stages(void)
     ;
 }
 
+void audio_pipeline_frame_pool_stats(frame_pool_stats_t *stats)
+{
+    frame_pool_get_stats(&frame_pool, stats);
+}
+
 void audio_pipeline_init(
     void *input_app_data,
     void *output_app_data)
@@ -80,6 +85,8 @@ void audio_pipeline_init(
         configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(empty_stage) + RTOS_THREAD_STACK_SIZE(audio_pipeline_output_i),
     };
 
+    FRAME_POOL_INIT(frame_pool, frame_data_t, FRAME_POOL_DEPTH(sizeof(stages) / sizeof(stages[0])));
+
     initialize_pipeline_stages();
 
     generic_pipeline_init((pipeline_input_t)audio_pipeline_input_i,
@@ -5,15 +5,16 @@
 #define AUDIO_PIPELINE_DSP_H_
 
 #include <stdint.h>
+#include <string.h>
 #include "FreeRTOS.h"
 #include "stream_buffer.h"
 #include "app_conf.h"
+#include "audio_pipeline_subframe.h"
 #include <stdint.h>
 
 /* Pipeline config */
 #define AP_MAX_Y_CHANNELS (2)
 #define AP_MAX_X_CHANNELS (2)
-#define AP_FRAME_ADVANCE (240)
 
 /* AEC config */
 #define AEC_MAX_Y_CHANNELS   (AP_MAX_Y_CHANNELS)
@@ -21,6 +22,13 @@
 #define AEC_MAIN_FILTER_PHASES    (10)
 #define AEC_SHADOW_FILTER_PHASES    (5)
 
+/* Number of threads the AEC runs on, 1 or 2. With 2 threads the main and
+ * shadow filter work is split between the stage's own thread and a worker.
+ */
+#ifndef NUM_AEC_THREADS
+#define NUM_AEC_THREADS (1)
+#endif
+
 /* Delay buffer config */
 #define MAX_DELAY_BUF_CHANNELS (2)
 #define DELAY_BUF_MAX_DELAY_MS                ( 150 )
@@ -35,13 +43,27 @@
 #include "vnr_inference_api.h"
 
 
+/* Processed samples are double buffered. Each stage reads a channel from its
+ * current plane and writes its output into the other plane, then flips that
+ * channel's plane index, so no stage needs a scratch buffer or a copy.
+ */
+#define AP_SAMPLE_PLANES (2)
+
+/* The plane that is contiguous with aec_reference_audio_samples, and so is
+ * the one passed to audio_pipeline_output()
+ */
+#define AP_OUTPUT_PLANE (AP_SAMPLE_PLANES - 1)
+
 /* Note: Changing the order here will effect the channel order for
  * audio_pipeline_input() and audio_pipeline_output()
  */
 typedef struct {
-    int32_t samples[appconfAUDIO_PIPELINE_CHANNELS][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
-    int32_t aec_reference_audio_samples[appconfAUDIO_PIPELINE_CHANNELS][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
-    int32_t mic_samples_passthrough[appconfAUDIO_PIPELINE_CHANNELS][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+    int32_t samples[AP_SAMPLE_PLANES][appconfAUDIO_PIPELINE_CHANNELS][AP_FRAME_ADVANCE];
+    int32_t aec_reference_audio_samples[appconfAUDIO_PIPELINE_CHANNELS][AP_FRAME_ADVANCE];
+    int32_t mic_samples_passthrough[appconfAUDIO_PIPELINE_CHANNELS][AP_FRAME_ADVANCE];
+
+    /* Current plane of samples[] for each channel */
+    int32_t cur_plane[appconfAUDIO_PIPELINE_CHANNELS];
 
     /* Below is additional context needed by other stages on a per frame basis */
     int32_t vnr_pred_flag;
@@ -50,6 +72,58 @@ typedef struct {
     int32_t ref_active_flag;
 } frame_data_t;
 
+/* Returns the current samples of channel ch */
+static inline int32_t *frame_samples(frame_data_t *frame_data, int ch)
+{
+    return frame_data->samples[frame_data->cur_plane[ch]][ch];
+}
+
+/* Returns the buffer a stage should write the new samples of channel ch to */
+static inline int32_t *frame_samples_next(frame_data_t *frame_data, int ch)
+{
+    return frame_data->samples[frame_data->cur_plane[ch] ^ 1][ch];
+}
+
+/* Makes the samples written to frame_samples_next() current */
+static inline void frame_samples_flip(frame_data_t *frame_data, int ch)
+{
+    frame_data->cur_plane[ch] ^= 1;
+}
+
+/* For stages that process all channels at once, which requires that every
+ * channel is on the same plane. Returns the current or next plane.
+ */
+static inline int32_t (*frame_samples_plane(frame_data_t *frame_data, int next))[AP_FRAME_ADVANCE]
+{
+    for (int ch = 1; ch < appconfAUDIO_PIPELINE_CHANNELS; ch++) {
+        configASSERT(frame_data->cur_plane[ch] == frame_data->cur_plane[0]);
+    }
+    return frame_data->samples[frame_data->cur_plane[0] ^ (next ? 1 : 0)];
+}
+
+/* Flips every channel, see frame_samples_plane() */
+static inline void frame_samples_flip_all(frame_data_t *frame_data)
+{
+    for (int ch = 0; ch < appconfAUDIO_PIPELINE_CHANNELS; ch++) {
+        frame_samples_flip(frame_data, ch);
+    }
+}
+
+/* Moves any channel that is not on AP_OUTPUT_PLANE onto it. Called once
+ * before the frame is handed to audio_pipeline_output().
+ */
+static inline void frame_samples_to_output_plane(frame_data_t *frame_data)
+{
+    for (int ch = 0; ch < appconfAUDIO_PIPELINE_CHANNELS; ch++) {
+        if (frame_data->cur_plane[ch] != AP_OUTPUT_PLANE) {
+            memcpy(frame_data->samples[AP_OUTPUT_PLANE][ch],
+                   frame_data->samples[frame_data->cur_plane[ch]][ch],
+                   AP_FRAME_ADVANCE * sizeof(int32_t));
+            frame_data->cur_plane[ch] = AP_OUTPUT_PLANE;
+        }
+    }
+}
+
 typedef struct stage_delay_ctx {
     StreamBufferHandle_t delay_buf;
 } stage_delay_ctx_t;
@@ -88,7 +162,7 @@ typedef struct agc_stage_ctx {
 #define AP_INPUT_SAMPLES_MIC_DELAY_SIZE_PER_CHAN        ( 16000*ABS(appconfINPUT_SAMPLES_MIC_DELAY_MS)/1000 )
 #define AP_INPUT_SAMPLES_MIC_DELAY_CHAN_CNT             ( (appconfINPUT_SAMPLES_MIC_DELAY_MS > 0) ? AEC_MAX_Y_CHANNELS : AEC_MAX_X_CHANNELS )
 #define AP_INPUT_SAMPLES_MIC_DELAY_SIZE_CHAN            ( AP_INPUT_SAMPLES_MIC_DELAY_SIZE_PER_CHAN * AP_INPUT_SAMPLES_MIC_DELAY_CHAN_CNT )
-#define AP_INPUT_SAMPLES_MIC_DELAY_SIZE_CUR_FRAME_WORDS ( AP_INPUT_SAMPLES_MIC_DELAY_CHAN_CNT * appconfAUDIO_PIPELINE_FRAME_ADVANCE)
+#define AP_INPUT_SAMPLES_MIC_DELAY_SIZE_CUR_FRAME_WORDS ( AP_INPUT_SAMPLES_MIC_DELAY_CHAN_CNT * AP_FRAME_ADVANCE)
 #define AP_INPUT_SAMPLES_MIC_DELAY_CUR_FRAME_BYTES      ( AP_INPUT_SAMPLES_MIC_DELAY_SIZE_CUR_FRAME_WORDS * sizeof(int32_t))
 #define AP_INPUT_SAMPLES_MIC_DELAY_BUF_SIZE_BYTES       ( AP_INPUT_SAMPLES_MIC_DELAY_SIZE_CHAN * sizeof(int32_t) )
 
@@ -100,4 +174,21 @@ void aec_process_frame_1thread(
         const int32_t (*y_data)[AEC_FRAME_ADVANCE],
         const int32_t (*x_data)[AEC_FRAME_ADVANCE]);
 
+void aec_process_frame_2threads(
+        aec_state_t *main_state,
+        aec_state_t *shadow_state,
+        int32_t (*output_main)[AEC_FRAME_ADVANCE],
+        int32_t (*output_shadow)[AEC_FRAME_ADVANCE],
+        const int32_t (*y_data)[AEC_FRAME_ADVANCE],
+        const int32_t (*x_data)[AEC_FRAME_ADVANCE]);
+
+/**
+ * Create the worker thread used by aec_process_frame_2threads().
+ * Must be called once before the first frame when NUM_AEC_THREADS > 1.
+ *
+ * \param priority  Priority of the worker thread. This should match the
+ *                  priority of the pipeline stage that runs the AEC.
+ */
+void aec_process_frame_2threads_init(unsigned priority);
+
 #endif /* AUDIO_PIPELINE_DSP_H_ */
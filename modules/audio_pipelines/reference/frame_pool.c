@@ -0,0 +1,94 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <stdint.h>
+#include <string.h>
+
+/* FreeRTOS headers */
+#include "FreeRTOS.h"
+
+/* App headers */
+#include "frame_pool.h"
+
+/*
+ * Keeps the compiler from reordering the ring accesses around the index
+ * updates. The other task only sees a slot once the index that publishes
+ * it has been written.
+ */
+#define FRAME_POOL_BARRIER() __asm__ volatile("" ::: "memory")
+
+void frame_pool_init(frame_pool_t *pool,
+                     void *storage,
+                     void **free_ring,
+                     size_t frame_size,
+                     size_t frame_count)
+{
+    configASSERT(pool != NULL && storage != NULL && free_ring != NULL);
+    configASSERT(frame_count > 0);
+    configASSERT(((uintptr_t)storage & 0x7) == 0);
+    configASSERT((frame_size & 0x7) == 0);
+
+    memset(pool, 0, sizeof(frame_pool_t));
+    pool->storage = storage;
+    pool->frame_size = frame_size;
+    pool->frame_count = frame_count;
+    pool->free_ring = free_ring;
+
+    for (size_t i = 0; i < frame_count; i++) {
+        free_ring[i] = pool->storage + (i * frame_size);
+    }
+}
+
+void *frame_pool_acquire(frame_pool_t *pool)
+{
+    void *frame;
+
+    /* Free-running counts, so the difference is correct across wrapping */
+    const uint32_t available = pool->frame_count + pool->pool_released - pool->pool_acquired;
+
+    if (available == 0) {
+        pool->exhausted++;
+        frame = pvPortMalloc(pool->frame_size);
+        configASSERT(frame != NULL);
+    } else {
+        FRAME_POOL_BARRIER();
+        frame = pool->free_ring[pool->free_tail];
+        pool->free_tail = (pool->free_tail + 1) % pool->frame_count;
+        pool->pool_acquired++;
+    }
+
+    pool->acquired++;
+    const uint32_t in_use = pool->acquired - pool->released;
+    if (in_use > pool->high_water) {
+        pool->high_water = in_use;
+    }
+
+    return frame;
+}
+
+void frame_pool_release(frame_pool_t *pool, void *frame)
+{
+    const uint8_t *p = frame;
+
+    if (p >= pool->storage && p < pool->storage + (pool->frame_count * pool->frame_size)) {
+        pool->free_ring[pool->free_head] = frame;
+        pool->free_head = (pool->free_head + 1) % pool->frame_count;
+        FRAME_POOL_BARRIER();
+        pool->pool_released++;
+    } else {
+        vPortFree(frame);
+    }
+
+    pool->released++;
+}
+
+void frame_pool_get_stats(frame_pool_t *pool, frame_pool_stats_t *stats)
+{
+    const uint32_t released = pool->released;
+
+    stats->frame_count = pool->frame_count;
+    stats->in_use = pool->acquired - released;
+    stats->high_water = pool->high_water;
+    stats->exhausted = pool->exhausted;
+}
@@ -0,0 +1,99 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef FRAME_POOL_H_
+#define FRAME_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_conf.h"
+
+/**
+ * Number of frames a pool holds in addition to one per pipeline stage, to
+ * cover the frames owned by the input and output callbacks.
+ */
+#ifndef appconfAUDIO_PIPELINE_FRAME_POOL_EXTRA_FRAMES
+#define appconfAUDIO_PIPELINE_FRAME_POOL_EXTRA_FRAMES   2
+#endif
+
+#define FRAME_POOL_DEPTH(stage_count)   ((stage_count) + appconfAUDIO_PIPELINE_FRAME_POOL_EXTRA_FRAMES)
+
+/**
+ * A fixed size pool of pipeline frames.
+ *
+ * Frames are acquired by the pipeline input callback and released by the
+ * output callback. These run in the first and last stage tasks, so the pool
+ * is a single producer, single consumer ring of free frames and needs no
+ * locks. Every counter has a single writer.
+ *
+ * If the pool is exhausted the frame is allocated from the heap instead and
+ * the exhaustion is counted; frame_pool_release() tells the two apart.
+ */
+typedef struct {
+    uint8_t *storage;
+    size_t frame_size;
+    size_t frame_count;
+    void **free_ring;
+
+    /* Written by frame_pool_release() only */
+    uint32_t free_head;
+    volatile uint32_t pool_released;
+    volatile uint32_t released;
+
+    /* Written by frame_pool_acquire() only */
+    uint32_t free_tail;
+    uint32_t pool_acquired;
+    volatile uint32_t acquired;
+    volatile uint32_t high_water;
+    volatile uint32_t exhausted;
+} frame_pool_t;
+
+typedef struct {
+    uint32_t frame_count;
+    uint32_t in_use;        /* Frames currently acquired, including heap frames */
+    uint32_t high_water;    /* Most frames that have been in use at once */
+    uint32_t exhausted;     /* Acquires that fell back to the heap */
+} frame_pool_stats_t;
+
+/**
+ * Initializes a pool over caller provided storage.
+ *
+ * \param pool          The pool to initialize.
+ * \param storage       frame_count frames of frame_size bytes. Must be
+ *                      double word aligned.
+ * \param free_ring     frame_count pointers used to track the free frames.
+ * \param frame_size    Size of each frame in bytes, a multiple of 8.
+ * \param frame_count   Number of frames in storage.
+ */
+void frame_pool_init(frame_pool_t *pool,
+                     void *storage,
+                     void **free_ring,
+                     size_t frame_size,
+                     size_t frame_count);
+
+/**
+ * Returns a frame from the pool. The contents of the frame are undefined.
+ * Must only be called from one task.
+ */
+void *frame_pool_acquire(frame_pool_t *pool);
+
+/**
+ * Returns a frame obtained from frame_pool_acquire() to the pool. Must only
+ * be called from one task.
+ */
+void frame_pool_release(frame_pool_t *pool, void *frame);
+
+void frame_pool_get_stats(frame_pool_t *pool, frame_pool_stats_t *stats);
+
+/**
+ * Defines the storage for, and initializes, a pool of frame_count frames of
+ * type frame_type.
+ */
+#define FRAME_POOL_INIT(pool, frame_type, frame_count) do { \
+        static frame_type __attribute__((aligned(8))) pool##_storage[frame_count]; \
+        static void *pool##_free_ring[frame_count]; \
+        frame_pool_init(&(pool), pool##_storage, pool##_free_ring, sizeof(frame_type), (frame_count)); \
+    } while (0)
+
+#endif /* FRAME_POOL_H_ */
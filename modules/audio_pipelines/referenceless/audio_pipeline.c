@@ -1,4 +1,4 @@
-// Copyright 2022-2023 XMOS LIMITED.
+// Copyright 2022-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 /* STD headers */
@@ -23,6 +23,8 @@
 /* App headers */
 #include "app_conf.h"
 #include "audio_pipeline.h"
+#include "audio_pipeline_subframe.h"
+#include "stage_stats.h"
 
 #define VNR_AGC_THRESHOLD              (0.5)
 #define EMA_ENERGY_ALPHA               (0.25)
@@ -33,16 +35,12 @@
  * audio_pipeline_input() and audio_pipeline_output()
  */
 typedef struct {
-    int32_t samples[appconfAUDIO_PIPELINE_CHANNELS][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+    int32_t samples[appconfAUDIO_PIPELINE_CHANNELS][AP_FRAME_ADVANCE];
     float_s32_t input_vnr_pred;
     float_s32_t output_vnr_pred;
     control_flag_e control_flag;
 } frame_data_t;
 
-#if appconfAUDIO_PIPELINE_FRAME_ADVANCE != 240
-#error This pipeline is only configured for 240 frame advance
-#endif
-
 typedef struct ic_stage_ctx {
     ic_state_t state;
 } ic_stage_ctx_t;
@@ -80,10 +78,22 @@ static void *audio_pipeline_input_i(void *input_app_data)
     frame_data = pvPortMalloc(sizeof(frame_data_t));
     memset(frame_data, 0x00, sizeof(frame_data_t));
 
+#if (AP_SUBFRAMES > 1)
+    for (int i = 0; i < AP_SUBFRAMES; i++) {
+        int32_t subframe[appconfAUDIO_PIPELINE_CHANNELS][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+
+        audio_pipeline_input(input_app_data,
+                           (int32_t **)subframe,
+                           2,
+                           appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+        ap_subframe_put((int32_t *)frame_data->samples, (int32_t *)subframe, appconfAUDIO_PIPELINE_CHANNELS, i);
+    }
+#else
     audio_pipeline_input(input_app_data,
                        (int32_t **)frame_data->samples,
                        2,
                        appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+#endif
     frame_data->input_vnr_pred = f32_to_float_s32(0.0);
     frame_data->output_vnr_pred = f32_to_float_s32(0.0);
     frame_data->control_flag = ADAPT;
@@ -100,10 +110,29 @@ static int audio_pipeline_output_i(frame_data_t *frame_data,
         trace_data->control_flag = (int)frame_data->control_flag;
     }
 
+#if (AP_SUBFRAMES > 1)
+    /* Only this stage's task uses the subframe, so it is reused for every
+     * one. The application must copy it out rather than keep it. */
+    static int32_t DWORD_ALIGNED subframe[appconfAUDIO_PIPELINE_CHANNELS][appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+
+    for (int i = 0; i < AP_SUBFRAMES; i++) {
+        int ret;
+
+        ap_subframe_get((int32_t *)subframe, (int32_t *)frame_data->samples, appconfAUDIO_PIPELINE_CHANNELS, i);
+        ret = audio_pipeline_output(output_app_data,
+                                    (int32_t **)subframe,
+                                    4,
+                                    appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+        configASSERT(ret == AUDIO_PIPELINE_FREE_FRAME);
+        (void) ret;
+    }
+    return AUDIO_PIPELINE_FREE_FRAME;
+#else
     return audio_pipeline_output(output_app_data,
                                (int32_t **)frame_data->samples,
                                4,
                                appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+#endif
 }
 
 static void stage_vnr_and_ic(frame_data_t *frame_data)
@@ -112,7 +141,7 @@ static void stage_vnr_and_ic(frame_data_t *frame_data)
     (void) frame_data;
 #else
 
-    int32_t DWORD_ALIGNED ic_output[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
+    int32_t DWORD_ALIGNED ic_output[AP_FRAME_ADVANCE];
 
     ic_filter(&ic_stage_state.state,
               frame_data->samples[0],
@@ -129,7 +158,7 @@ static void stage_vnr_and_ic(frame_data_t *frame_data)
     frame_data->output_vnr_pred = vnr_pred_stage_state.vnr_pred_state.output_vnr_pred;
     frame_data->control_flag = ic_stage_state.state.ic_adaption_controller_state.control_flag;
 
-    memcpy(frame_data->samples, ic_output, appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+    memcpy(frame_data->samples, ic_output, AP_FRAME_ADVANCE * sizeof(int32_t));
 #endif
 }
 
@@ -138,23 +167,47 @@ static void stage_ns(frame_data_t *frame_data)
 #if appconfAUDIO_PIPELINE_SKIP_NS
     (void) frame_data;
 #else
-    int32_t DWORD_ALIGNED ns_output[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
-    configASSERT(NS_FRAME_ADVANCE == appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+    int32_t DWORD_ALIGNED ns_output[AP_FRAME_ADVANCE];
+    configASSERT(NS_FRAME_ADVANCE == AP_FRAME_ADVANCE);
     ns_process_frame(
                 &ns_stage_state.state,
                 ns_output,
                 frame_data->samples[0]);
-    memcpy(frame_data->samples, ns_output, appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+    memcpy(frame_data->samples, ns_output, AP_FRAME_ADVANCE * sizeof(int32_t));
 #endif
 }
 
+#if appconfAUDIO_PIPELINE_ASR_INT16
+/*
+ * Packs the int16 ASR samples of each output subframe at the start of that
+ * subframe's slice of channel 0, so they stay in place through
+ * ap_subframe_get().
+ */
+static void asr_int16_put(int32_t *ch0, const int32_t *src)
+{
+    for (int i = 0; i < AP_SUBFRAMES; i++) {
+        vect_s32_to_vect_s16((int16_t *)&ch0[i * appconfAUDIO_PIPELINE_FRAME_ADVANCE],
+                             &src[i * appconfAUDIO_PIPELINE_FRAME_ADVANCE],
+                             appconfAUDIO_PIPELINE_FRAME_ADVANCE,
+                             16);
+    }
+}
+#endif
+
 static void stage_agc(frame_data_t *frame_data)
 {
 #if appconfAUDIO_PIPELINE_SKIP_AGC
+#if appconfAUDIO_PIPELINE_ASR_INT16
+    int32_t DWORD_ALIGNED ns_output[AP_FRAME_ADVANCE];
+
+    memcpy(ns_output, frame_data->samples[0], AP_FRAME_ADVANCE * sizeof(int32_t));
+    asr_int16_put(frame_data->samples[0], ns_output);
+#else
     (void) frame_data;
+#endif
 #else
-    int32_t DWORD_ALIGNED agc_output[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
-    configASSERT(AGC_FRAME_ADVANCE == appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+    int32_t DWORD_ALIGNED agc_output[AP_FRAME_ADVANCE];
+    configASSERT(AGC_FRAME_ADVANCE == AP_FRAME_ADVANCE);
 
     agc_stage_state.md.vnr_flag = float_s32_gt(frame_data->output_vnr_pred, f32_to_float_s32(VNR_AGC_THRESHOLD));
 
@@ -163,10 +216,18 @@ static void stage_agc(frame_data_t *frame_data)
             agc_output,
             frame_data->samples[0],
             &agc_stage_state.md);
-    memcpy(frame_data->samples, agc_output, appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+#if appconfAUDIO_PIPELINE_ASR_INT16
+    asr_int16_put(frame_data->samples[0], agc_output);
+#else
+    memcpy(frame_data->samples, agc_output, AP_FRAME_ADVANCE * sizeof(int32_t));
+#endif
 #endif
 }
 
+STAGE_STATS_WRAP(stage_vnr_and_ic)
+STAGE_STATS_WRAP(stage_ns)
+STAGE_STATS_WRAP(stage_agc)
+
 static void initialize_pipeline_stages(void) {
 #if !appconfAUDIO_PIPELINE_SKIP_IC_AND_VNR
     ic_init(&ic_stage_state.state);
@@ -194,18 +255,21 @@ void audio_pipeline_init(
     const int stage_count = 3;
 
     const pipeline_stage_t stages[] = {
-        (pipeline_stage_t)stage_vnr_and_ic,
-        (pipeline_stage_t)stage_ns,
-        (pipeline_stage_t)stage_agc,
+        (pipeline_stage_t)stage_vnr_and_ic_timed,
+        (pipeline_stage_t)stage_ns_timed,
+        (pipeline_stage_t)stage_agc_timed,
     };
 
     const configSTACK_DEPTH_TYPE stage_stack_sizes[] = {
-        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_vnr_and_ic) + RTOS_THREAD_STACK_SIZE(audio_pipeline_input_i),
-        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_ns),
-        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_agc) + RTOS_THREAD_STACK_SIZE(audio_pipeline_output_i),
+        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_vnr_and_ic_timed) + RTOS_THREAD_STACK_SIZE(audio_pipeline_input_i),
+        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_ns_timed),
+        configMINIMAL_STACK_SIZE + RTOS_THREAD_STACK_SIZE(stage_agc_timed) + RTOS_THREAD_STACK_SIZE(audio_pipeline_output_i),
     };
 
     initialize_pipeline_stages();
+    STAGE_STATS_REGISTER(stage_vnr_and_ic);
+    STAGE_STATS_REGISTER(stage_ns);
+    STAGE_STATS_REGISTER(stage_agc);
 
     trace_data = (trace_data_t *) output_app_data;
     generic_pipeline_init((pipeline_input_t)audio_pipeline_input_i,
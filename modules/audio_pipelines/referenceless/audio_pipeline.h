@@ -1,4 +1,4 @@
-// Copyright 2022-2023 XMOS LIMITED.
+// Copyright 2022-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #ifndef AUDIO_PIPELINE_H_
@@ -7,6 +7,22 @@
 #include <stdint.h>
 #include "app_conf.h"
 
+/**
+ * Set to 1 for the AGC stage to emit the ASR channel as int16. Channel 0 of
+ * each frame passed to audio_pipeline_output() then starts with
+ * appconfAUDIO_PIPELINE_FRAME_ADVANCE packed int16 samples, the AGC output
+ * shifted right by 16 with rounding and saturation, and can be given to the
+ * ASR as (int16_t *)output_audio_frames. The other channels are unchanged.
+ */
+#ifndef appconfAUDIO_PIPELINE_ASR_INT16
+#define appconfAUDIO_PIPELINE_ASR_INT16 0
+#endif
+
+/*
+ * When appconfAUDIO_PIPELINE_FRAME_ADVANCE is less than 240, the frames given
+ * to audio_pipeline_output() share one buffer, so it must copy them and
+ * return AUDIO_PIPELINE_FREE_FRAME.
+ */
 #define AUDIO_PIPELINE_DONT_FREE_FRAME 0
 #define AUDIO_PIPELINE_FREE_FRAME      1
 
@@ -0,0 +1,136 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <stdint.h>
+#include <string.h>
+
+/* FreeRTOS headers */
+#include "FreeRTOS.h"
+
+/* App headers */
+#include "stage_stats.h"
+
+#if appconfAUDIO_PIPELINE_STAGE_STATS_XSCOPE
+#include <xscope.h>
+#endif
+
+typedef struct {
+    const char *name;
+    /* Written only by the stage's own thread */
+    uint32_t frames;
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint64_t total_ticks;
+    uint32_t deadline_misses;
+    uint32_t hist[STAGE_STATS_HIST_BINS];
+    uint32_t reset_ack;
+    /* Written only by stage_stats_reset() */
+    volatile uint32_t reset_req;
+} stage_stats_t;
+
+static stage_stats_t stage_stats[STAGE_STATS_MAX_STAGES];
+static int stage_stats_num;
+
+static void stage_stats_clear(stage_stats_t *s)
+{
+    s->frames = 0;
+    s->min_ticks = UINT32_MAX;
+    s->max_ticks = 0;
+    s->total_ticks = 0;
+    s->deadline_misses = 0;
+    memset(s->hist, 0, sizeof(s->hist));
+}
+
+int stage_stats_register(const char *name)
+{
+    configASSERT(stage_stats_num < STAGE_STATS_MAX_STAGES);
+
+    stage_stats_t *s = &stage_stats[stage_stats_num];
+    s->name = name;
+    s->reset_req = 0;
+    s->reset_ack = 0;
+    stage_stats_clear(s);
+
+    return stage_stats_num++;
+}
+
+void stage_stats_record(int id, uint32_t ticks)
+{
+    if (id < 0) {
+        return;
+    }
+    stage_stats_t *s = &stage_stats[id];
+
+    if (s->reset_ack != s->reset_req) {
+        s->reset_ack = s->reset_req;
+        stage_stats_clear(s);
+    }
+
+    s->frames++;
+    s->total_ticks += ticks;
+    if (ticks < s->min_ticks) {
+        s->min_ticks = ticks;
+    }
+    if (ticks > s->max_ticks) {
+        s->max_ticks = ticks;
+    }
+    if (ticks > STAGE_STATS_DEADLINE_TICKS) {
+        s->deadline_misses++;
+    }
+
+    uint32_t bin = ticks / STAGE_STATS_HIST_BIN_TICKS;
+    if (bin >= STAGE_STATS_HIST_BINS) {
+        bin = STAGE_STATS_HIST_BINS - 1;
+    }
+    s->hist[bin]++;
+
+#if appconfAUDIO_PIPELINE_STAGE_STATS_XSCOPE
+    xscope_int(AUDIO_PIPELINE_STAGE_TICKS, ((uint32_t) id << 24) | (ticks > 0xFFFFFF ? 0xFFFFFF : ticks));
+#endif
+}
+
+int stage_stats_count(void)
+{
+    return stage_stats_num;
+}
+
+void stage_stats_get(int id, stage_stats_summary_t *summary)
+{
+    configASSERT(id >= 0 && id < stage_stats_num);
+    const stage_stats_t *s = &stage_stats[id];
+
+    memset(summary, 0, sizeof(*summary));
+    summary->name = s->name;
+
+    uint32_t frames = s->frames;
+    if (frames == 0 || s->reset_ack != s->reset_req) {
+        return;
+    }
+
+    summary->frames = frames;
+    summary->min_ticks = s->min_ticks;
+    summary->avg_ticks = (uint32_t) (s->total_ticks / frames);
+    summary->max_ticks = s->max_ticks;
+    summary->deadline_misses = s->deadline_misses;
+
+    /* Frames in the slowest 1% */
+    uint32_t tail = frames / 100;
+    uint32_t above = 0;
+    int bin = STAGE_STATS_HIST_BINS - 1;
+    while (bin > 0 && above + s->hist[bin] <= tail) {
+        above += s->hist[bin];
+        bin--;
+    }
+    summary->p99_ticks = (bin == STAGE_STATS_HIST_BINS - 1) ? summary->max_ticks : (uint32_t) (bin + 1) * STAGE_STATS_HIST_BIN_TICKS;
+    if (summary->p99_ticks > summary->max_ticks) {
+        summary->p99_ticks = summary->max_ticks;
+    }
+}
+
+void stage_stats_reset(void)
+{
+    for (int i = 0; i < stage_stats_num; i++) {
+        stage_stats[i].reset_req++;
+    }
+}
@@ -0,0 +1,122 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef STAGE_STATS_H_
+#define STAGE_STATS_H_
+
+#include <stdint.h>
+#include "app_conf.h"
+#include "audio_pipeline_subframe.h"
+
+/**
+ * Set to 1 to time every pipeline stage wrapped with STAGE_STATS_WRAP().
+ * When 0 the wrappers only call the stage.
+ */
+#ifndef appconfAUDIO_PIPELINE_STAGE_STATS
+#define appconfAUDIO_PIPELINE_STAGE_STATS 1
+#endif
+
+/**
+ * Set to 1 to also send every stage time to the host on the xscope probe
+ * AUDIO_PIPELINE_STAGE_TICKS. The application's config.xscope must declare
+ * this probe. Each value holds the stage ID in the top 8 bits and the stage
+ * time, in reference clock ticks saturated to 24 bits, in the rest.
+ */
+#ifndef appconfAUDIO_PIPELINE_STAGE_STATS_XSCOPE
+#define appconfAUDIO_PIPELINE_STAGE_STATS_XSCOPE 0
+#endif
+
+/** Maximum number of stages that can be registered on one tile */
+#ifndef STAGE_STATS_MAX_STAGES
+#define STAGE_STATS_MAX_STAGES 4
+#endif
+
+/** Stage time above which a block counts as a missed deadline, in 100MHz reference clock ticks */
+#define STAGE_STATS_DEADLINE_TICKS (AP_FRAME_ADVANCE * (100000000 / 16000))
+
+/** Number of histogram bins used for the p99 estimate. The bins cover twice the deadline. */
+#define STAGE_STATS_HIST_BINS 32
+#define STAGE_STATS_HIST_BIN_TICKS ((2 * STAGE_STATS_DEADLINE_TICKS) / STAGE_STATS_HIST_BINS)
+
+/**
+ * Summary of the time taken by one stage since start up or the last
+ * stage_stats_reset(). Times are in 100MHz reference clock ticks.
+ */
+typedef struct {
+    const char *name;
+    uint32_t frames;
+    uint32_t min_ticks;
+    uint32_t avg_ticks;
+    uint32_t max_ticks;
+    /** Upper edge of the histogram bin holding the 99th percentile */
+    uint32_t p99_ticks;
+    /** Frames that took longer than STAGE_STATS_DEADLINE_TICKS */
+    uint32_t deadline_misses;
+} stage_stats_summary_t;
+
+/**
+ * Register a stage. Called once for each stage before the pipeline starts.
+ *
+ * \param name  Name of the stage. The string must outlive the statistics.
+ *
+ * \returns The ID of the stage, to pass to stage_stats_record().
+ */
+int stage_stats_register(const char *name);
+
+/**
+ * Record the time taken by one frame of a stage. Each stage must only be
+ * recorded from one thread.
+ */
+void stage_stats_record(int id, uint32_t ticks);
+
+/** Number of stages registered on this tile */
+int stage_stats_count(void);
+
+/**
+ * Get the summary of a stage. This may be called from any thread. As the
+ * stage may be recording at the same time, the fields are not guaranteed to
+ * come from the same frame.
+ */
+void stage_stats_get(int id, stage_stats_summary_t *summary);
+
+/**
+ * Clear the statistics of every stage on this tile. Each stage clears its own
+ * statistics before it next records, so this may be called from any thread.
+ */
+void stage_stats_reset(void);
+
+#if appconfAUDIO_PIPELINE_STAGE_STATS
+#include <xcore/hwtimer.h>
+
+/**
+ * Define stage_fn##_timed(), a pipeline_stage_t that calls stage_fn and
+ * records how long it took. STAGE_STATS_REGISTER(stage_fn) must be called
+ * before the pipeline starts. Pass stage_fn##_timed to generic_pipeline_init(),
+ * and use it in RTOS_THREAD_STACK_SIZE().
+ */
+#define STAGE_STATS_WRAP(stage_fn)                                  \
+    static int stage_fn##_stats_id = -1;                            \
+    static void stage_fn##_timed(void *frame_data)                  \
+    {                                                               \
+        uint32_t start = get_reference_time();                      \
+        stage_fn(frame_data);                                       \
+        stage_stats_record(stage_fn##_stats_id,                     \
+                           get_reference_time() - start);           \
+    }
+
+#define STAGE_STATS_REGISTER(stage_fn) \
+    (stage_fn##_stats_id = stage_stats_register(#stage_fn))
+
+#else
+
+#define STAGE_STATS_WRAP(stage_fn)                                  \
+    static void stage_fn##_timed(void *frame_data)                  \
+    {                                                               \
+        stage_fn(frame_data);                                       \
+    }
+
+#define STAGE_STATS_REGISTER(stage_fn) ((void) 0)
+
+#endif /* appconfAUDIO_PIPELINE_STAGE_STATS */
+
+#endif /* STAGE_STATS_H_ */
@@ -0,0 +1,68 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef AUDIO_PIPELINE_SUBFRAME_H_
+#define AUDIO_PIPELINE_SUBFRAME_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "app_conf.h"
+
+/**
+ * Number of samples per channel the DSP stages process at a time. The AEC,
+ * IC, NS and AGC libraries are built for this block size.
+ */
+#define AP_FRAME_ADVANCE (240)
+
+/**
+ * The pipeline exchanges audio with the application in frames of
+ * appconfAUDIO_PIPELINE_FRAME_ADVANCE samples, which may be 240 or any
+ * divisor of it (e.g. 120 or 80). The pipeline gathers AP_SUBFRAMES of them
+ * into each block on the way in and splits the block again on the way out,
+ * handing the subframes of a block to the application back to back.
+ *
+ * This shortens the application's I/O period, not the pipeline latency. A
+ * sample still waits for the rest of its block at the input, and buffers
+ * after the output must still hold a whole block until the next one comes
+ * out, so they are sized by AP_FRAME_ADVANCE.
+ */
+#define AP_SUBFRAMES (AP_FRAME_ADVANCE / appconfAUDIO_PIPELINE_FRAME_ADVANCE)
+
+#if (AP_FRAME_ADVANCE % appconfAUDIO_PIPELINE_FRAME_ADVANCE) != 0
+#error appconfAUDIO_PIPELINE_FRAME_ADVANCE must be a divisor of 240
+#endif
+
+/**
+ * Copies subframe i of a block out to a frame of ch_count channels of
+ * appconfAUDIO_PIPELINE_FRAME_ADVANCE samples.
+ *
+ * \param frame     [ch_count][appconfAUDIO_PIPELINE_FRAME_ADVANCE] destination.
+ * \param block     [ch_count][AP_FRAME_ADVANCE] source.
+ * \param ch_count  Number of channels.
+ * \param i         Subframe index, 0 to AP_SUBFRAMES - 1.
+ */
+static inline void ap_subframe_get(int32_t *frame, const int32_t *block, size_t ch_count, int i)
+{
+    for (size_t ch = 0; ch < ch_count; ch++) {
+        memcpy(&frame[ch * appconfAUDIO_PIPELINE_FRAME_ADVANCE],
+               &block[ch * AP_FRAME_ADVANCE + i * appconfAUDIO_PIPELINE_FRAME_ADVANCE],
+               appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+    }
+}
+
+/**
+ * Copies a frame of ch_count channels of appconfAUDIO_PIPELINE_FRAME_ADVANCE
+ * samples into subframe i of a block. See ap_subframe_get().
+ */
+static inline void ap_subframe_put(int32_t *block, const int32_t *frame, size_t ch_count, int i)
+{
+    for (size_t ch = 0; ch < ch_count; ch++) {
+        memcpy(&block[ch * AP_FRAME_ADVANCE + i * appconfAUDIO_PIPELINE_FRAME_ADVANCE],
+               &frame[ch * appconfAUDIO_PIPELINE_FRAME_ADVANCE],
+               appconfAUDIO_PIPELINE_FRAME_ADVANCE * sizeof(int32_t));
+    }
+}
+
+#endif /* AUDIO_PIPELINE_SUBFRAME_H_ */
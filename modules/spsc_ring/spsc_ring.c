@@ -0,0 +1,169 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if __xcore__
+#include <xcore/assert.h>
+#else
+#include <assert.h>
+#define xassert assert
+#endif
+
+/* App headers */
+#include "spsc_ring.h"
+
+/*
+ * The index owned by the other side is loaded with acquire semantics and
+ * the own index is stored with release semantics, so the element data is
+ * always written before the index that publishes it is seen.
+ *
+ * The threads of an xcore tile share one memory and do not reorder
+ * accesses to it, so there only the compiler needs to be held back.
+ */
+#if __xcore__
+#define RING_COMPILER_BARRIER() __asm__ volatile("" ::: "memory")
+
+static inline uint32_t load_acquire(const volatile uint32_t *p)
+{
+    uint32_t v = *p;
+    RING_COMPILER_BARRIER();
+    return v;
+}
+
+static inline void store_release(volatile uint32_t *p, uint32_t v)
+{
+    RING_COMPILER_BARRIER();
+    *p = v;
+}
+#else
+static inline uint32_t load_acquire(const volatile uint32_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(volatile uint32_t *p, uint32_t v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+#endif
+
+void spsc_ring_init(spsc_ring_t *ring, void *storage, size_t elem_size, uint32_t capacity)
+{
+    xassert(ring != NULL && storage != NULL && elem_size > 0);
+    xassert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    ring->buf = storage;
+    ring->elem_size = elem_size;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+void spsc_ring_reset(spsc_ring_t *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+uint32_t spsc_ring_count(const spsc_ring_t *ring)
+{
+    /* Free running indices, the difference is right across the 2^32 wrap */
+    return load_acquire(&ring->head) - load_acquire(&ring->tail);
+}
+
+uint32_t spsc_ring_space(const spsc_ring_t *ring)
+{
+    return ring->capacity - spsc_ring_count(ring);
+}
+
+void *spsc_ring_write_region(spsc_ring_t *ring, uint32_t *n)
+{
+    const uint32_t head = ring->head;
+    const uint32_t space = ring->capacity - (head - load_acquire(&ring->tail));
+    const uint32_t offset = head & ring->mask;
+    const uint32_t to_end = ring->capacity - offset;
+
+    *n = (space < to_end) ? space : to_end;
+    return ring->buf + (size_t)offset * ring->elem_size;
+}
+
+void spsc_ring_write_commit(spsc_ring_t *ring, uint32_t n)
+{
+    const uint32_t head = ring->head;
+
+    xassert(n <= ring->capacity - (head - load_acquire(&ring->tail)));
+    store_release(&ring->head, head + n);
+}
+
+const void *spsc_ring_peek(const spsc_ring_t *ring, uint32_t *n)
+{
+    const uint32_t tail = ring->tail;
+    const uint32_t count = load_acquire(&ring->head) - tail;
+    const uint32_t offset = tail & ring->mask;
+    const uint32_t to_end = ring->capacity - offset;
+
+    *n = (count < to_end) ? count : to_end;
+    return ring->buf + (size_t)offset * ring->elem_size;
+}
+
+void spsc_ring_read_commit(spsc_ring_t *ring, uint32_t n)
+{
+    const uint32_t tail = ring->tail;
+
+    xassert(n <= load_acquire(&ring->head) - tail);
+    store_release(&ring->tail, tail + n);
+}
+
+uint32_t spsc_ring_write(spsc_ring_t *ring, const void *src, uint32_t n)
+{
+    const uint8_t *p = src;
+    uint32_t written = 0;
+
+    /* At most two regions, the second one starting at the top of the storage */
+    for (int i = 0; i < 2 && written < n; i++) {
+        uint32_t region;
+        void *dst = spsc_ring_write_region(ring, &region);
+
+        if (region == 0) {
+            break;
+        }
+        if (region > n - written) {
+            region = n - written;
+        }
+        memcpy(dst, p, (size_t)region * ring->elem_size);
+        spsc_ring_write_commit(ring, region);
+        p += (size_t)region * ring->elem_size;
+        written += region;
+    }
+
+    return written;
+}
+
+uint32_t spsc_ring_read(spsc_ring_t *ring, void *dst, uint32_t n)
+{
+    uint8_t *p = dst;
+    uint32_t read = 0;
+
+    for (int i = 0; i < 2 && read < n; i++) {
+        uint32_t region;
+        const void *src = spsc_ring_peek(ring, &region);
+
+        if (region == 0) {
+            break;
+        }
+        if (region > n - read) {
+            region = n - read;
+        }
+        memcpy(p, src, (size_t)region * ring->elem_size);
+        spsc_ring_read_commit(ring, region);
+        p += (size_t)region * ring->elem_size;
+        read += region;
+    }
+
+    return read;
+}
@@ -0,0 +1,168 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+/* STD headers */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Single producer, single consumer ring buffer.
+ *
+ * The capacity is a power of two number of elements. The read and write
+ * indices run freely and are only masked when the storage is addressed, so
+ * a full ring and an empty ring never look the same and no full/empty flags
+ * are needed.
+ *
+ * Only the producer moves the write index and only the consumer moves the
+ * read index. Either side may be a thread or an ISR, and no lock is needed
+ * as long as there is exactly one of each. A caller that is both producer
+ * and consumer may use the read side to drop old data before writing.
+ *
+ * spsc_ring_write_region()/spsc_ring_write_commit() and
+ * spsc_ring_peek()/spsc_ring_read_commit() give direct access to the
+ * storage so that data can be produced or consumed in place.
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t elem_size;
+    /** Number of elements in buf, always a power of two */
+    uint32_t capacity;
+    uint32_t mask;
+    /** Write index, only stored by the producer */
+    volatile uint32_t head;
+    /** Read index, only stored by the consumer */
+    volatile uint32_t tail;
+} spsc_ring_t;
+
+/**
+ * Static initializer for a ring buffer over an array, as an alternative to
+ * spsc_ring_init(). The array length must be a power of two.
+ */
+#define SPSC_RING_INIT(storage) { \
+    (uint8_t *)(storage), \
+    sizeof((storage)[0]), \
+    sizeof(storage) / sizeof((storage)[0]), \
+    sizeof(storage) / sizeof((storage)[0]) - 1, \
+    0, \
+    0 }
+
+/**
+ * Smallest power of two that is greater than or equal to n, for 0 < n <= 2^31.
+ * Can be used to size storage at compile time.
+ */
+#define SPSC_RING_POW2_CEIL(n) (SPSC_RING_SMEAR_((uint32_t)(n) - 1) + 1)
+
+/* Sets every bit below the highest set bit of v */
+#define SPSC_RING_SMEAR_(v) \
+    ((v) | ((v) >> 1) | ((v) >> 2) | ((v) >> 3) | \
+     ((v) >> 4) | ((v) >> 5) | ((v) >> 6) | ((v) >> 7) | \
+     ((v) >> 8) | ((v) >> 9) | ((v) >> 10) | ((v) >> 11) | \
+     ((v) >> 12) | ((v) >> 13) | ((v) >> 14) | ((v) >> 15) | \
+     ((v) >> 16) | ((v) >> 17) | ((v) >> 18) | ((v) >> 19) | \
+     ((v) >> 20) | ((v) >> 21) | ((v) >> 22) | ((v) >> 23) | \
+     ((v) >> 24) | ((v) >> 25) | ((v) >> 26) | ((v) >> 27) | \
+     ((v) >> 28) | ((v) >> 29) | ((v) >> 30) | ((v) >> 31))
+
+/**
+ * Initialize a ring buffer over caller supplied storage. The ring is empty
+ * afterwards.
+ *
+ * \param ring      The ring buffer.
+ * \param storage   At least capacity * elem_size bytes, aligned for the
+ *                  element type.
+ * \param elem_size Size of one element in bytes.
+ * \param capacity  Number of elements. Must be a power of two.
+ */
+void spsc_ring_init(spsc_ring_t *ring, void *storage, size_t elem_size, uint32_t capacity);
+
+/**
+ * Empty the ring buffer. Must not be called while the producer or the
+ * consumer is using it.
+ *
+ * \param ring      The ring buffer.
+ */
+void spsc_ring_reset(spsc_ring_t *ring);
+
+/**
+ * \param ring      The ring buffer.
+ * \return          The number of elements that can be read.
+ */
+uint32_t spsc_ring_count(const spsc_ring_t *ring);
+
+/**
+ * \param ring      The ring buffer.
+ * \return          The number of elements that can be written.
+ */
+uint32_t spsc_ring_space(const spsc_ring_t *ring);
+
+/**
+ * Copy elements into the ring buffer. Called by the producer only.
+ *
+ * \param ring      The ring buffer.
+ * \param src       The elements to write.
+ * \param n         The number of elements to write.
+ * \return          The number of elements written, which is less than n when
+ *                  the ring buffer fills up.
+ */
+uint32_t spsc_ring_write(spsc_ring_t *ring, const void *src, uint32_t n);
+
+/**
+ * Copy elements out of the ring buffer. Called by the consumer only.
+ *
+ * \param ring      The ring buffer.
+ * \param dst       Where to put the elements.
+ * \param n         The number of elements to read.
+ * \return          The number of elements read, which is less than n when
+ *                  the ring buffer runs empty.
+ */
+uint32_t spsc_ring_read(spsc_ring_t *ring, void *dst, uint32_t n);
+
+/**
+ * Get the free space that can be written in place, up to the end of the
+ * storage. Called by the producer only. The elements become visible to the
+ * consumer when spsc_ring_write_commit() is called.
+ *
+ * \param ring      The ring buffer.
+ * \param n         Set to the number of contiguous free elements. The free
+ *                  space that wraps to the start of the storage is returned
+ *                  by the next call, after a commit.
+ * \return          The first free element.
+ */
+void *spsc_ring_write_region(spsc_ring_t *ring, uint32_t *n);
+
+/**
+ * Publish elements written in place. Called by the producer only.
+ *
+ * \param ring      The ring buffer.
+ * \param n         The number of elements written, at most the space
+ *                  available.
+ */
+void spsc_ring_write_commit(spsc_ring_t *ring, uint32_t n);
+
+/**
+ * Get the elements that can be read in place, up to the end of the storage.
+ * Called by the consumer only. The elements stay in the ring buffer until
+ * spsc_ring_read_commit() is called.
+ *
+ * \param ring      The ring buffer.
+ * \param n         Set to the number of contiguous elements. The elements
+ *                  that wrap to the start of the storage are returned by the
+ *                  next call, after a commit.
+ * \return          The oldest element.
+ */
+const void *spsc_ring_peek(const spsc_ring_t *ring, uint32_t *n);
+
+/**
+ * Release elements to the producer. Called by the consumer only. Also used
+ * to drop elements without reading them.
+ *
+ * \param ring      The ring buffer.
+ * \param n         The number of elements consumed, at most the number
+ *                  available.
+ */
+void spsc_ring_read_commit(spsc_ring_t *ring, uint32_t n);
+
+#endif // SPSC_RING_H_
@@ -0,0 +1,52 @@
+## Host build of the ASR port API, for measuring the accuracy, processing
+## time and external memory traffic of a port without hardware.
+
+set(ASR_HOST_MODULE_PATH ${CMAKE_CURRENT_LIST_DIR}/../../modules/asr)
+
+set(CMAKE_OSX_ARCHITECTURES "" CACHE INTERNAL "")
+
+## The mock port from the speech_recognition example. Ports that ship a host
+## build of their engine can be added the same way.
+add_executable(asr_host_example
+    ${CMAKE_CURRENT_LIST_DIR}/src/main.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/devmem_host.c
+    ${CMAKE_CURRENT_LIST_DIR}/../pipeline_benchmark/src/wav_file.c
+    ${ASR_HOST_MODULE_PATH}/device_memory/device_memory.c
+    ${ASR_HOST_MODULE_PATH}/asr.c
+    ${CMAKE_CURRENT_LIST_DIR}/../../examples/speech_recognition/asr_example/asr_example_impl.c
+)
+
+target_include_directories(asr_host_example
+    PRIVATE
+        ${CMAKE_CURRENT_LIST_DIR}/src
+        ${CMAKE_CURRENT_LIST_DIR}/src/shim
+        ${CMAKE_CURRENT_LIST_DIR}/../pipeline_benchmark/src
+        ${ASR_HOST_MODULE_PATH}
+        ${ASR_HOST_MODULE_PATH}/device_memory
+)
+
+## fptrgroup is an xcore attribute used by device_memory.h
+target_compile_options(asr_host_example PRIVATE -O2 -g -Wno-attributes)
+
+## The barge-in echo filter of the intent engine, run on a recorded or
+## generated response and its echo
+add_executable(asr_host_barge_in
+    ${CMAKE_CURRENT_LIST_DIR}/src/barge_in.c
+    ${CMAKE_CURRENT_LIST_DIR}/../pipeline_benchmark/src/wav_file.c
+    ${ASR_HOST_MODULE_PATH}/intent_engine/intent_engine_echo.c
+    ${CMAKE_CURRENT_LIST_DIR}/../../modules/spsc_ring/spsc_ring.c
+)
+
+target_include_directories(asr_host_barge_in
+    PRIVATE
+        ${CMAKE_CURRENT_LIST_DIR}/src/barge_in_shim
+        ${CMAKE_CURRENT_LIST_DIR}/src/shim
+        ${CMAKE_CURRENT_LIST_DIR}/../pipeline_benchmark/src
+        ${CMAKE_CURRENT_LIST_DIR}/../../modules/spsc_ring
+        ${ASR_HOST_MODULE_PATH}
+        ${ASR_HOST_MODULE_PATH}/device_memory
+        ${ASR_HOST_MODULE_PATH}/intent_engine
+)
+
+target_compile_options(asr_host_barge_in PRIVATE -O2 -g -Wno-attributes)
+target_link_libraries(asr_host_barge_in PRIVATE m)
@@ -0,0 +1,341 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/*
+ * Host test of the intent engine barge-in echo filter.
+ *
+ * An audio response and the ASR input captured while it plays are run
+ * through intent_engine_echo.c on a simulated device clock. Response blocks
+ * are handed to a two block I2S buffer as the audio response thread does,
+ * ASR input frames arrive after the audio pipeline delay, and the intent
+ * engine takes them in batches of up to appconfINTENT_BATCH_MAX_BRICKS at
+ * random times. The test reports the measured echo delay and the echo
+ * reduction of each response, and fails if either is out of bounds.
+ *
+ * The response and the ASR input are either read from a recorded pair of
+ * WAV files, or generated, with the echo passed through a short room
+ * response and mixed with noise.
+ */
+
+/* STD headers */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* App headers */
+#include "app_conf.h"
+#include "intent_engine.h"
+#include "wav_file.h"
+
+#define BARGE_IN_SAMPLE_RATE    (appconfAUDIO_PIPELINE_SAMPLE_RATE)
+#define BARGE_IN_BLOCK          (appconfAUDIO_PIPELINE_FRAME_ADVANCE)
+#define BARGE_IN_TICKS          (100000000 / BARGE_IN_SAMPLE_RATE)
+
+/* Generated input */
+#define GEN_SECONDS             (60)
+#define GEN_RESPONSE_SECONDS    (2)
+#define GEN_ACOUSTIC_DELAY      (20)
+#define GEN_NOISE               (300)
+
+/* Default audio pipeline delay from capture to the ASR input, FFD */
+#define DEFAULT_PIPELINE_DELAY  (1200)
+/* Default bounds. The delay resolution is the 1 ms envelope block. */
+#define DEFAULT_DELAY_TOLERANCE (BARGE_IN_SAMPLE_RATE / 1000 * 3)
+#define DEFAULT_MIN_ERLE_DB     (10.0)
+
+static uint32_t sim_time;
+
+uint32_t get_reference_time(void)
+{
+    return sim_time;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [options] [playback.wav mic.wav]\n", name);
+    printf("  playback.wav  the response PCM as sent to the DAC, zero between responses\n");
+    printf("  mic.wav       the ASR input recorded on the same sample clock\n");
+    printf("                without files a %d s response and echo are generated\n", GEN_SECONDS);
+    printf("  -p samples    audio pipeline delay from capture to the ASR input, default %d\n",
+           DEFAULT_PIPELINE_DELAY);
+    printf("  -d samples    echo delay in the recording, checked against the measured delay\n");
+    printf("  -t samples    tolerance on the measured delay, default %d\n", DEFAULT_DELAY_TOLERANCE);
+    printf("  -e dB         smallest echo reduction accepted, default %.1f\n", DEFAULT_MIN_ERLE_DB);
+    printf("  -o out.wav    write the ASR input with the echo removed\n");
+    printf("WAV files must be %d Hz PCM, only the first channel is used\n", BARGE_IN_SAMPLE_RATE);
+}
+
+static int16_t *wav_load(const char *path, long *len)
+{
+    wav_file_t wav;
+    int32_t *planes;
+    int16_t *samples;
+
+    if (wav_file_open_read(&wav, path) != 0) {
+        printf("Cannot open %s\n", path);
+        return NULL;
+    }
+    if (wav.sample_rate != BARGE_IN_SAMPLE_RATE) {
+        printf("%s is %d Hz, not %d Hz\n", path, wav.sample_rate, BARGE_IN_SAMPLE_RATE);
+        wav_file_close(&wav);
+        return NULL;
+    }
+
+    planes = malloc(wav.num_frames * wav.num_channels * sizeof(int32_t));
+    samples = malloc(wav.num_frames * sizeof(int16_t));
+    *len = (long)wav_file_read_planes(&wav, planes, wav.num_frames);
+    for (long i = 0; i < *len; i++) {
+        samples[i] = (int16_t)(planes[i] >> 16);
+    }
+    free(planes);
+    wav_file_close(&wav);
+    return samples;
+}
+
+/* Responses of a few modulated tones and noise, a block aligned response
+ * every few seconds, and their echo through a short room response */
+static void generate(int16_t *played, int16_t *mic, long len)
+{
+    double phase = 0.0;
+    long t = BARGE_IN_SAMPLE_RATE / 2 / BARGE_IN_BLOCK * BARGE_IN_BLOCK;
+
+    memset(played, 0, len * sizeof(int16_t));
+    while (t < len) {
+        long end = t + GEN_RESPONSE_SECONDS * BARGE_IN_SAMPLE_RATE;
+
+        for (long i = t; i < end && i < len; i++) {
+            double v = 0.3 * sin(phase) + 0.2 * sin(2.7 * phase) +
+                       0.1 * ((rand() % 2001) - 1000) / 1000.0;
+            v *= 0.5 + 0.5 * sin((i - t) / 800.0);
+            phase += 2.0 * M_PI * 300.0 / BARGE_IN_SAMPLE_RATE * (1.0 + 0.3 * sin(i / 3000.0));
+            played[i] = (int16_t)(v * 20000.0);
+        }
+        t = end + 3 * BARGE_IN_SAMPLE_RATE + rand() % BARGE_IN_SAMPLE_RATE;
+        t = t / BARGE_IN_BLOCK * BARGE_IN_BLOCK;
+    }
+
+    for (long i = 0; i < len; i++) {
+        double m = (rand() % (2 * GEN_NOISE + 1)) - GEN_NOISE;
+        long j = i - GEN_ACOUSTIC_DELAY;
+
+        if (j >= 2) {
+            m += 0.5 * played[j] + 0.25 * played[j - 1] - 0.1 * played[j - 2];
+        }
+        mic[i] = (int16_t)m;
+    }
+}
+
+static int block_silent(const int16_t *samples)
+{
+    for (int i = 0; i < BARGE_IN_BLOCK; i++) {
+        if (samples[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    long pipeline_delay = DEFAULT_PIPELINE_DELAY;
+    long echo_delay = -1;
+    long tolerance = DEFAULT_DELAY_TOLERANCE;
+    double min_erle = DEFAULT_MIN_ERLE_DB;
+    const char *out_path = NULL;
+    const char *files[2];
+    int file_count = 0;
+    int16_t *played;
+    int16_t *mic;
+    int16_t *out;
+    long len;
+    long mic_len;
+    long arrived = 0;
+    long consumed = 0;
+    long next_batch = 0;
+    long response_start = -1;
+    long first_response_end = -1;
+    int32_t measured;
+    int fail = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] != '\0' && argv[i][2] == '\0' && i + 1 < argc) {
+            switch (argv[i][1]) {
+            case 'p': pipeline_delay = atol(argv[++i]); continue;
+            case 'd': echo_delay = atol(argv[++i]); continue;
+            case 't': tolerance = atol(argv[++i]); continue;
+            case 'e': min_erle = atof(argv[++i]); continue;
+            case 'o': out_path = argv[++i]; continue;
+            default: break;
+            }
+        } else if (argv[i][0] != '-' && file_count < 2) {
+            files[file_count++] = argv[i];
+            continue;
+        }
+        usage(argv[0]);
+        return 1;
+    }
+    if (file_count == 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    srand(1);
+    if (file_count == 2) {
+        played = wav_load(files[0], &len);
+        mic = wav_load(files[1], &mic_len);
+        if (played == NULL || mic == NULL) {
+            return 1;
+        }
+        if (mic_len < len) {
+            len = mic_len;
+        }
+    } else {
+        len = GEN_SECONDS * BARGE_IN_SAMPLE_RATE;
+        played = malloc(len * sizeof(int16_t));
+        mic = malloc(len * sizeof(int16_t));
+        generate(played, mic, len);
+        echo_delay = GEN_ACOUSTIC_DELAY;
+    }
+    len = len / BARGE_IN_BLOCK * BARGE_IN_BLOCK;
+    out = malloc(len * sizeof(int16_t));
+    memcpy(out, mic, len * sizeof(int16_t));
+
+    for (long t = 0; t < len + pipeline_delay + BARGE_IN_SAMPLE_RATE; t++) {
+        long captured = t - pipeline_delay;
+
+        sim_time = (uint32_t)((uint64_t)t * BARGE_IN_TICKS);
+
+        /*
+         * The audio response thread hands a block to I2S when there is
+         * room for it. The first block of a response plays straight away,
+         * and the next is handed over with it, a block ahead.
+         */
+        if (t % BARGE_IN_BLOCK == 0 && t < len) {
+            long next = t + BARGE_IN_BLOCK;
+
+            if (!block_silent(&played[t])) {
+                if (response_start < 0) {
+                    response_start = t;
+                    intent_engine_playback_ref_push(&played[t], BARGE_IN_BLOCK);
+                }
+                if (next < len && !block_silent(&played[next])) {
+                    intent_engine_playback_ref_push(&played[next], BARGE_IN_BLOCK);
+                }
+            } else if (response_start >= 0) {
+                if (first_response_end < 0) {
+                    first_response_end = t;
+                }
+                response_start = -1;
+            }
+        }
+
+        /* A frame arrives once its last sample has been through the pipeline */
+        if (captured >= 0 && captured < len && (captured + 1) % BARGE_IN_BLOCK == 0) {
+            arrived += BARGE_IN_BLOCK;
+            intent_engine_echo_mic_arrived(BARGE_IN_BLOCK);
+        }
+
+        if (t >= next_batch) {
+            long bricks = (arrived - consumed) / BARGE_IN_BLOCK;
+
+            if (bricks > appconfINTENT_BATCH_MAX_BRICKS) {
+                bricks = appconfINTENT_BATCH_MAX_BRICKS;
+            }
+            if (bricks > 0) {
+                intent_engine_echo_subtract(&out[consumed], bricks * BARGE_IN_BLOCK);
+                consumed += bricks * BARGE_IN_BLOCK;
+            }
+            next_batch = t + rand() % (BARGE_IN_SAMPLE_RATE / 20);
+        }
+    }
+
+    measured = intent_engine_echo_delay();
+    if (measured < 0) {
+        printf("Echo delay: not measured\n");
+        fail = 1;
+    } else {
+        /* The echo delay is counted from the DAC. The ASR input is further
+         * delayed by the audio pipeline. */
+        printf("Echo delay: %ld samples measured", (long)measured);
+        if (echo_delay >= 0) {
+            long expected = echo_delay + pipeline_delay;
+            printf(", %ld expected", expected);
+            if (labs(measured - expected) > tolerance) {
+                fail = 1;
+            }
+        }
+        printf("\n");
+    }
+
+    /* Echo reduction of each response with its echo tail, after the one
+     * used to measure the delay */
+    printf("Response  Start (s)  Echo reduction (dB)\n");
+    {
+        const long tail = appconfINTENT_BARGE_IN_FILTER_TAPS + (echo_delay > 0 ? echo_delay : 0);
+        int responses = 0;
+        double sum_erle = 0.0;
+        long start = -1;
+
+        for (long t = 0; t <= len; t += BARGE_IN_BLOCK) {
+            int silent = (t == len) || block_silent(&played[t]);
+
+            if (!silent && start < 0) {
+                start = t;
+            } else if (silent && start >= 0) {
+                long end = (t + tail < len) ? t + tail : len;
+                double in = 0.0;
+                double rem = 0.0;
+                double erle;
+
+                if (first_response_end >= 0 && start >= first_response_end) {
+                    for (long i = start; i < end; i++) {
+                        in += (double)mic[i] * mic[i];
+                        rem += (double)out[i] * out[i];
+                    }
+                    erle = 10.0 * log10((in + 1.0) / (rem + 1.0));
+                    responses++;
+                    sum_erle += erle;
+                    printf("%8d  %9.2f  %19.1f\n", responses,
+                           (double)start / BARGE_IN_SAMPLE_RATE, erle);
+                }
+                start = -1;
+            }
+        }
+
+        if (responses == 0) {
+            printf("No response after the first one, the echo reduction is not measured\n");
+            fail = 1;
+        } else {
+            printf("Average echo reduction: %.1f dB, %.1f dB required\n",
+                   sum_erle / responses, min_erle);
+            if (sum_erle / responses < min_erle) {
+                fail = 1;
+            }
+        }
+    }
+
+    if (out_path != NULL) {
+        wav_file_t wav;
+        int32_t *plane = malloc(len * sizeof(int32_t));
+
+        for (long i = 0; i < len; i++) {
+            plane[i] = (int32_t)out[i] << 16;
+        }
+        if (wav_file_open_write(&wav, out_path, 1, BARGE_IN_SAMPLE_RATE) == 0) {
+            wav_file_write_planes(&wav, plane, len);
+            wav_file_close(&wav);
+        } else {
+            printf("Cannot write %s\n", out_path);
+            fail = 1;
+        }
+        free(plane);
+    }
+
+    printf("%s\n", fail ? "FAIL" : "PASS");
+
+    free(played);
+    free(mic);
+    free(out);
+    return fail;
+}
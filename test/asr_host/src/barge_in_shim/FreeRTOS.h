@@ -0,0 +1,14 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_FREERTOS_H_
+#define HOST_SHIM_FREERTOS_H_
+
+/* STD headers */
+#include <assert.h>
+#include <stdio.h>
+
+#define configASSERT(x)     assert(x)
+#define rtos_printf         printf
+
+#endif /* HOST_SHIM_FREERTOS_H_ */
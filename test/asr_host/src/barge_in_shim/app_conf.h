@@ -0,0 +1,16 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_BARGE_IN_APP_CONF_H_
+#define HOST_BARGE_IN_APP_CONF_H_
+
+/* The FFD configuration of the intent engine. The barge-in options take
+ * their defaults from intent_engine.h unless given on the command line. */
+#define ASR_TILE_NO                             0
+#define appconfAUDIO_PIPELINE_SAMPLE_RATE       16000
+#define appconfAUDIO_PIPELINE_FRAME_ADVANCE     240
+#define appconfINTENT_FRAME_BUFFER_MULT         (8*2)
+#define appconfINTENT_SAMPLE_BLOCK_LENGTH       240
+#define appconfINTENT_BARGE_IN_ENABLED          1
+
+#endif /* HOST_BARGE_IN_APP_CONF_H_ */
@@ -0,0 +1,10 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_PLATFORM_H_
+#define HOST_SHIM_PLATFORM_H_
+
+/* The host runs the code of every tile */
+#define ON_TILE(t)  (1)
+
+#endif /* HOST_SHIM_PLATFORM_H_ */
@@ -0,0 +1,10 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_RTOS_INTERTILE_H_
+#define HOST_SHIM_RTOS_INTERTILE_H_
+
+/* Only named by the intent engine prototypes */
+typedef struct rtos_intertile_struct rtos_intertile_t;
+
+#endif /* HOST_SHIM_RTOS_INTERTILE_H_ */
@@ -0,0 +1,9 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_XS1_H_
+#define HOST_SHIM_XS1_H_
+
+#define XS1_TIMER_HZ    100000000
+
+#endif /* HOST_SHIM_XS1_H_ */
@@ -0,0 +1,136 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* App headers */
+#include "devmem_host.h"
+
+/* Reads complete before read_ext_async returns, so every handle is done */
+#define DEVMEM_HOST_ASYNC_HANDLE    (0)
+
+typedef struct {
+    size_t size;
+    /* Keeps the payload 8 byte aligned, as devmem_malloc on the device does */
+    uint64_t payload[];
+} heap_block_t;
+
+static void *model_map = NULL;
+static size_t model_map_size = 0;
+static devmem_host_stats_t host_stats;
+
+static void *devmem_host_malloc(size_t size)
+{
+    heap_block_t *block = malloc(sizeof(heap_block_t) + size);
+
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = size;
+    host_stats.heap_in_use += size;
+    if (host_stats.heap_in_use > host_stats.heap_peak) {
+        host_stats.heap_peak = host_stats.heap_in_use;
+    }
+    return block->payload;
+}
+
+static void devmem_host_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    heap_block_t *block = (heap_block_t *)((uint8_t *)ptr - offsetof(heap_block_t, payload));
+    host_stats.heap_in_use -= block->size;
+    free(block);
+}
+
+static void devmem_host_read_ext(void *dest, const void *src, size_t n)
+{
+    const uint8_t *base = model_map;
+
+    /* Everything read through the devmem API is expected to be model data */
+    xassert((const uint8_t *)src >= base && (const uint8_t *)src + n <= base + model_map_size);
+
+    memcpy(dest, src, n);
+    host_stats.read_count++;
+    host_stats.read_bytes += n;
+}
+
+static int devmem_host_read_ext_async(void *dest, const void *src, size_t n)
+{
+    devmem_host_read_ext(dest, src, n);
+    host_stats.async_count++;
+    return DEVMEM_HOST_ASYNC_HANDLE;
+}
+
+static void devmem_host_read_ext_wait(int handle)
+{
+    xassert(handle == DEVMEM_HOST_ASYNC_HANDLE);
+}
+
+void *devmem_host_init(devmem_manager_t *ctx, const char *model_path, size_t *model_size)
+{
+    struct stat st;
+    int fd;
+
+    xassert(ctx);
+    xassert(model_map == NULL);
+
+    fd = open(model_path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    model_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (model_map == MAP_FAILED) {
+        model_map = NULL;
+        return NULL;
+    }
+    model_map_size = st.st_size;
+
+    memset(&host_stats, 0, sizeof(host_stats));
+
+    ctx->malloc = devmem_host_malloc;
+    ctx->free = devmem_host_free;
+    ctx->read_ext = devmem_host_read_ext;
+    ctx->read_ext_async = devmem_host_read_ext_async;
+    ctx->read_ext_wait = devmem_host_read_ext_wait;
+
+    if (model_size != NULL) {
+        *model_size = model_map_size;
+    }
+    return model_map;
+}
+
+void devmem_host_deinit(void)
+{
+    if (model_map != NULL) {
+        munmap(model_map, model_map_size);
+        model_map = NULL;
+        model_map_size = 0;
+    }
+}
+
+void devmem_host_get_stats(devmem_host_stats_t *stats)
+{
+    xassert(stats);
+    *stats = host_stats;
+}
+
+void devmem_host_reset_read_stats(void)
+{
+    host_stats.read_count = 0;
+    host_stats.read_bytes = 0;
+    host_stats.async_count = 0;
+}
@@ -0,0 +1,49 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef DEVMEM_HOST_H_
+#define DEVMEM_HOST_H_
+
+/* STD headers */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Library headers */
+#include "device_memory.h"
+
+/**
+ * Counters kept by the host device memory backend. Only accesses made
+ * through the devmem API are seen, so a port that dereferences the model
+ * directly will under report its external memory traffic.
+ */
+typedef struct {
+    uint64_t read_count;        /* Calls to read_ext and read_ext_async */
+    uint64_t read_bytes;        /* Bytes copied out of the model file */
+    uint64_t async_count;       /* Calls to read_ext_async */
+    size_t   heap_in_use;       /* Bytes currently allocated with devmem_malloc */
+    size_t   heap_peak;         /* Peak of heap_in_use */
+} devmem_host_stats_t;
+
+/**
+ * Maps a model file read only and initializes a device memory manager that
+ * serves reads from the mapping, standing in for the flash on the device.
+ *
+ * \param ctx         The device memory manager to initialize.
+ * \param model_path  Path of the model file.
+ * \param model_size  Set to the size of the model in bytes. May be NULL.
+ *
+ * \returns the address of the mapped model, to be passed to asr_init(),
+ *          or NULL if the file cannot be mapped.
+ */
+void *devmem_host_init(devmem_manager_t *ctx, const char *model_path, size_t *model_size);
+
+/** Unmaps the model mapped by devmem_host_init() */
+void devmem_host_deinit(void);
+
+/** Copies the current counters into stats */
+void devmem_host_get_stats(devmem_host_stats_t *stats);
+
+/** Clears the read counters. The heap counters are unchanged. */
+void devmem_host_reset_read_stats(void);
+
+#endif /* DEVMEM_HOST_H_ */
@@ -0,0 +1,268 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/*
+ * Host harness for ASR ports.
+ *
+ * An ASR port built natively against the asr.h API is run over a labeled
+ * corpus of WAV files. The model is mapped from a file and served through a
+ * host device memory backend that counts every external read. The harness
+ * reports the detections per keyword, the time spent in asr_process() per
+ * brick and the external memory traffic, so that ports and models can be
+ * compared before they are run on hardware.
+ */
+
+/* STD headers */
+#include <libgen.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Library headers */
+#include "asr.h"
+
+/* App headers */
+#include "devmem_host.h"
+#include "wav_file.h"
+
+#define ASR_HOST_SAMPLE_RATE        (16000)
+/* Brick length used when the port does not report one, as on the device */
+#define ASR_HOST_DEFAULT_BRICK      (240)
+#define ASR_HOST_MAX_BRICK          (4096)
+#define ASR_HOST_MAX_KEYWORDS       (64)
+#define ASR_HOST_MAX_LINE           (PATH_MAX + 32)
+
+typedef struct {
+    uint16_t id;
+    unsigned files;             /* Corpus files labeled with this keyword */
+    unsigned detected;          /* Labeled files in which it was detected */
+    unsigned detections;        /* Detections in labeled files */
+    unsigned false_detections;  /* Detections in files with another label */
+} keyword_stats_t;
+
+static keyword_stats_t keywords[ASR_HOST_MAX_KEYWORDS];
+static int keyword_count;
+
+static unsigned long long time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static keyword_stats_t *keyword_get(uint16_t id)
+{
+    for (int i = 0; i < keyword_count; i++) {
+        if (keywords[i].id == id) {
+            return &keywords[i];
+        }
+    }
+    if (keyword_count == ASR_HOST_MAX_KEYWORDS) {
+        return NULL;
+    }
+    keywords[keyword_count].id = id;
+    return &keywords[keyword_count++];
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s model.dat corpus.txt\n", name);
+    printf("  model.dat   model file, passed to asr_init() through the host devmem backend\n");
+    printf("  corpus.txt  one \"<wav path> <keyword id>\" per line, id 0 for no keyword\n");
+    printf("              wav paths are relative to the corpus file, '#' starts a comment\n");
+    printf("              wav files must be %d Hz PCM, only the first channel is used\n",
+           ASR_HOST_SAMPLE_RATE);
+}
+
+int main(int argc, char *argv[])
+{
+    static int32_t planes[ASR_HOST_MAX_BRICK * 8];
+    static int16_t brick[ASR_HOST_MAX_BRICK];
+    char line[ASR_HOST_MAX_LINE];
+    char corpus_path[PATH_MAX];
+    char wav_path[PATH_MAX + ASR_HOST_MAX_LINE];
+    devmem_manager_t devmem_mgr;
+    asr_attributes_t attributes;
+    size_t brick_len = ASR_HOST_DEFAULT_BRICK;
+    size_t model_size = 0;
+
+    unsigned long long process_ns = 0;
+    unsigned long long max_brick_ns = 0;
+    unsigned long long brick_count = 0;
+    uint64_t max_brick_bytes = 0;
+    unsigned file_count = 0;
+    unsigned correct_count = 0;
+    unsigned error_count = 0;
+
+    if (argc != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int32_t *model = devmem_host_init(&devmem_mgr, argv[1], &model_size);
+    if (model == NULL) {
+        printf("Error: unable to map %s\n", argv[1]);
+        return 1;
+    }
+
+    FILE *corpus = fopen(argv[2], "r");
+    if (corpus == NULL) {
+        printf("Error: unable to read %s\n", argv[2]);
+        return 1;
+    }
+    snprintf(corpus_path, sizeof(corpus_path), "%s", argv[2]);
+    const char *corpus_dir = dirname(corpus_path);
+
+    asr_port_t asr_port = asr_init(model, NULL, &devmem_mgr);
+    if (asr_port == NULL) {
+        printf("Error: asr_init() failed for %s\n", argv[1]);
+        return 1;
+    }
+
+    if (asr_get_attributes(asr_port, &attributes) == ASR_OK && attributes.samples_per_brick > 0) {
+        brick_len = attributes.samples_per_brick;
+        printf("Engine %.10s, model %.10s, %zu bytes required\n",
+               attributes.engine_version, attributes.model_version, attributes.required_memory);
+    }
+    xassert(brick_len <= ASR_HOST_MAX_BRICK);
+
+    devmem_host_stats_t init_stats;
+    devmem_host_get_stats(&init_stats);
+    devmem_host_reset_read_stats();
+
+    printf("%-40s %6s %s\n", "File", "Label", "Detections");
+
+    while (fgets(line, sizeof(line), corpus) != NULL) {
+        char name[ASR_HOST_MAX_LINE];
+        unsigned label;
+        wav_file_t wav;
+
+        if (line[0] == '#' || sscanf(line, "%s %u", name, &label) != 2) {
+            continue;
+        }
+        if (name[0] == '/') {
+            snprintf(wav_path, sizeof(wav_path), "%s", name);
+        } else {
+            snprintf(wav_path, sizeof(wav_path), "%s/%s", corpus_dir, name);
+        }
+
+        if (wav_file_open_read(&wav, wav_path) != 0 || wav.sample_rate != ASR_HOST_SAMPLE_RATE ||
+            wav.num_channels > (int)(sizeof(planes) / sizeof(planes[0]) / brick_len)) {
+            printf("%-40s %6u unreadable or not %d Hz, skipped\n", name, label, ASR_HOST_SAMPLE_RATE);
+            wav_file_close(&wav);
+            error_count++;
+            continue;
+        }
+
+        int hit = 0;
+        int miss_fire = 0;
+
+        asr_reset(asr_port);
+        printf("%-40s %6u", name, label);
+
+        for (long done = 0; done < wav.num_frames; done += brick_len) {
+            asr_result_t result;
+            devmem_host_stats_t before, after;
+
+            /* Planes are left justified to 32 bits, channel 0 comes first */
+            wav_file_read_planes(&wav, planes, brick_len);
+            for (size_t i = 0; i < brick_len; i++) {
+                brick[i] = (int16_t)(planes[i] >> 16);
+            }
+
+            devmem_host_get_stats(&before);
+            unsigned long long start = time_ns();
+            asr_error_t asr_error = asr_process(asr_port, brick, brick_len);
+            unsigned long long elapsed = time_ns() - start;
+            devmem_host_get_stats(&after);
+
+            process_ns += elapsed;
+            if (elapsed > max_brick_ns) {
+                max_brick_ns = elapsed;
+            }
+            if (after.read_bytes - before.read_bytes > max_brick_bytes) {
+                max_brick_bytes = after.read_bytes - before.read_bytes;
+            }
+            brick_count++;
+
+            if (asr_error != ASR_OK || asr_get_result(asr_port, &result) != ASR_OK || result.id == 0) {
+                continue;
+            }
+
+            keyword_stats_t *kw = keyword_get(result.id);
+            if (kw == NULL) {
+                continue;
+            }
+            printf(" %u@%.2fs", result.id, (double)done / ASR_HOST_SAMPLE_RATE);
+            if (result.id == label) {
+                kw->detections++;
+                hit = 1;
+            } else {
+                kw->false_detections++;
+                miss_fire = 1;
+            }
+        }
+        printf("\n");
+        wav_file_close(&wav);
+
+        if (label != 0) {
+            keyword_stats_t *kw = keyword_get(label);
+            if (kw != NULL) {
+                kw->files++;
+                kw->detected += hit;
+            }
+        }
+        /* A file is correct if its keyword, and nothing else, was detected */
+        if (!miss_fire && (hit || label == 0)) {
+            correct_count++;
+        }
+        file_count++;
+    }
+    fclose(corpus);
+
+    devmem_host_stats_t stats;
+    devmem_host_get_stats(&stats);
+    asr_release(asr_port);
+    devmem_host_deinit();
+
+    if (brick_count == 0) {
+        printf("Error: %s contains no audio\n", argv[2]);
+        return 1;
+    }
+
+    const double audio_ns = (double)brick_count * brick_len * 1e9 / ASR_HOST_SAMPLE_RATE;
+    const double audio_s = audio_ns / 1e9;
+
+    unsigned false_total = 0;
+    printf("\n%-8s %8s %8s %10s %8s %10s\n", "Keyword", "Files", "Detected", "Recall", "Hits", "False");
+    for (int i = 0; i < keyword_count; i++) {
+        keyword_stats_t *kw = &keywords[i];
+        false_total += kw->false_detections;
+        printf("%-8u %8u %8u %9.1f%% %8u %10u\n", kw->id, kw->files, kw->detected,
+               kw->files ? 100.0 * kw->detected / kw->files : 0.0, kw->detections, kw->false_detections);
+    }
+
+    printf("\nFiles processed:       %u (%u skipped), %.1f s of audio\n", file_count, error_count, audio_s);
+    printf("Files correct:         %u (%.1f%%)\n", correct_count,
+           file_count ? 100.0 * correct_count / file_count : 0.0);
+    printf("False detections/hour: %.2f\n", false_total * 3600.0 / audio_s);
+    printf("Bricks processed:      %llu (%zu samples/brick)\n", brick_count, brick_len);
+    printf("asr_process() avg:     %.1f us/brick\n", process_ns / 1e3 / brick_count);
+    printf("asr_process() max:     %.1f us/brick (budget %.1f us)\n", max_brick_ns / 1e3,
+           brick_len * 1e6 / ASR_HOST_SAMPLE_RATE);
+    printf("Real time factor:      %.4f\n", process_ns / audio_ns);
+    printf("Model size:            %zu bytes\n", model_size);
+    printf("External reads init:   %llu bytes in %llu reads\n",
+           (unsigned long long)init_stats.read_bytes, (unsigned long long)init_stats.read_count);
+    printf("External reads:        %llu bytes in %llu reads (%llu async)\n",
+           (unsigned long long)stats.read_bytes, (unsigned long long)stats.read_count,
+           (unsigned long long)stats.async_count);
+    printf("External bytes/brick:  %.1f avg, %llu max\n",
+           (double)stats.read_bytes / brick_count, (unsigned long long)max_brick_bytes);
+    printf("External bandwidth:    %.1f kB/s of audio\n", stats.read_bytes / 1e3 / audio_s);
+    printf("Peak devmem_malloc:    %zu bytes\n", stats.heap_peak);
+
+    return 0;
+}
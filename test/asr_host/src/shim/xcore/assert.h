@@ -0,0 +1,12 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_XCORE_ASSERT_H_
+#define HOST_SHIM_XCORE_ASSERT_H_
+
+/* STD headers */
+#include <assert.h>
+
+#define xassert(x)  assert(x)
+
+#endif /* HOST_SHIM_XCORE_ASSERT_H_ */
@@ -0,0 +1,106 @@
+# Copyright 2024 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+import argparse
+import itertools
+import re
+import subprocess
+import sys
+
+# Runs one of the usb_in_i2s_out or i2s_in_usb_out applications, or their control models, for every combination of
+# buffer level control time constant, integral time, correction limit and averaging window, at each I2S rate and SOF
+# jitter, with a step in the rate ratio. It reports the settle time and the steady state buffer level error of each run,
+# and picks the setting with the best worst case over the rates and jitters.
+
+CONTROL_RE = r'control,([0-9]+),([0-9]+),([0-9]+),(-?[0-9.]+),(-?[0-9.]+),([0-9.]+),([0-9]+)'
+BUFFER_RE = r'buffer,(-?[0-9]+),(-?[0-9]+)'
+
+
+def run_one(args, i2s_rate, jitter_us, time_constant_ms, integral_time_ms, limit_ppm, window_log2):
+    cmd = [args.app,
+           "-t", str(time_constant_ms),
+           "-i", str(integral_time_ms),
+           "-w", str(args.window),
+           "-c", str(limit_ppm),
+           "-e", str(args.step),
+           "-m", str(args.minutes),
+           "-b", str(args.band)]
+    if window_log2 is not None:
+        cmd += ["-a", str(window_log2)]
+    if args.stable is not None:
+        cmd += ["-s", str(args.stable)]
+    if args.low_latency:
+        cmd += ["-l", "1"]
+    # Only the control models generate their own jitter
+    if jitter_us:
+        cmd += ["-j", str(jitter_us)]
+    cmd.append(str(i2s_rate))
+    if args.timestamps:
+        cmd.append(args.timestamps)
+
+    # The SystemC applications print the buffer levels as they run. Only the summary lines at the end are needed here.
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    control = None
+    buffer = (0, 0)
+    for line in result.stdout.splitlines():
+        if m := re.match(CONTROL_RE, line):
+            control = (float(m.group(5)), float(m.group(6)), int(m.group(7)))
+        elif m := re.match(BUFFER_RE, line):
+            buffer = (int(m.group(1)), int(m.group(2)))
+    if control is None:
+        print(f"No control summary from {' '.join(cmd)}", file=sys.stderr)
+        return None
+    return control + buffer
+
+
+def get_args():
+    parser = argparse.ArgumentParser("Script to sweep the buffer level control settings of the usb_in_i2s_out or i2s_in_usb_out application")
+    parser.add_argument("app", type=str, help="Path to the usb_in_i2s_out or i2s_in_usb_out application, or its _model")
+    parser.add_argument("i2s_rates", type=int, nargs="+", help="I2S rates to simulate")
+    parser.add_argument("--timestamps", type=str, help="Optional SOF timestamps file", default=None)
+    parser.add_argument("--time-constants", "-t", type=int, nargs="+", help="Time constants to try, in ms", default=[2000, 3000, 5000, 10000])
+    parser.add_argument("--integral-ratios", "-r", type=int, nargs="+", help="Integral times to try, as multiples of the time constant. 0 for P only control", default=[0, 2, 4, 8])
+    parser.add_argument("--limits", "-c", type=int, nargs="+", help="Correction limits to try, in ppm", default=[50])
+    parser.add_argument("--windows", "-a", type=int, nargs="+", help="log2 of the averaging windows to try. The application default if not given", default=[None])
+    parser.add_argument("--stable", "-s", type=int, help="Averages to wait for before the set point is taken. The application default if not given", default=None)
+    parser.add_argument("--jitters", "-j", type=float, nargs="+", help="SOF jitters to try, in us. Control models only", default=[0])
+    parser.add_argument("--window", "-w", type=int, help="Number of updates summed by the integral term. 0 to sum all of them", default=0)
+    parser.add_argument("--step", "-e", type=float, help="Step in the rate ratio, in ppm", default=20.0)
+    parser.add_argument("--band", "-b", type=int, help="Largest average buffer level error that counts as settled, in samples", default=2)
+    parser.add_argument("--minutes", "-m", type=float, help="Simulation time of each run", default=10)
+    parser.add_argument("--low-latency", "-l", action="store_true", help="Run usb_in_i2s_out in its low latency mode")
+    return parser.parse_args()
+
+
+if __name__ == "__main__":
+    args = get_args()
+
+    print("time_constant_ms,integral_time_ms,limit_ppm,window_log2,i2s_rate,jitter_us,settle_time_s,ss_mean_error,ss_max_error,buffer_min,buffer_max")
+    best = None
+    for time_constant_ms, ratio, limit_ppm, window_log2 in itertools.product(args.time_constants, args.integral_ratios, args.limits, args.windows):
+        integral_time_ms = time_constant_ms * ratio
+        worst = (0, 0.0)
+        settled = True
+        for i2s_rate, jitter_us in itertools.product(args.i2s_rates, args.jitters):
+            result = run_one(args, i2s_rate, jitter_us, time_constant_ms, integral_time_ms, limit_ppm, window_log2)
+            if result is None:
+                settled = False
+                continue
+            settle_time, ss_mean, ss_max, buffer_min, buffer_max = result
+            window = "" if window_log2 is None else window_log2
+            print(f"{time_constant_ms},{integral_time_ms},{limit_ppm},{window},{i2s_rate},{jitter_us},{settle_time},{ss_mean},{ss_max},{buffer_min},{buffer_max}", flush=True)
+            if settle_time < 0:
+                settled = False
+            worst = (max(worst[0], ss_max), max(worst[1], settle_time))
+
+        # Settling at every rate and jitter comes first, then the worst steady state error, then the worst settle time
+        if settled and (best is None or worst < best[0]):
+            best = (worst, time_constant_ms, integral_time_ms, limit_ppm, window_log2)
+
+    if best is None:
+        print("None of the settings settled at every rate and jitter", file=sys.stderr)
+    else:
+        (ss_max, settle_time), time_constant_ms, integral_time_ms, limit_ppm, window_log2 = best
+        window = "" if window_log2 is None else f", window log2 {window_log2}"
+        print(f"Best: time constant {time_constant_ms} ms, integral time {integral_time_ms} ms, limit {limit_ppm} ppm{window}, "
+              f"worst settle time {settle_time} s, worst steady state max error {ss_max}", file=sys.stderr)
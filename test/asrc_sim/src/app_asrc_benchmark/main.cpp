@@ -0,0 +1,275 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+#include "ASRC_wrapper.h"
+
+// Runs the lib_src ASRC C emulator at every rate pair and block size, at a fixed rate ratio, and reports its cost and
+// the quality of a converted sine tone. One CSV line per rate pair and block size.
+
+#define DEFAULT_SIM_TIME_SECS    (2.0)
+#define SINE_FREQ                (997.0)     // Not a sub-multiple of any of the rates
+#define SINE_AMPLITUDE           (0.5)       // -6 dBFS
+#define SETTLE_TIME_SECS         (0.1)       // Output skipped before the analysis, while the filters fill
+#define N_HARMONICS              (9)         // Highest harmonic removed from the noise for the SNR
+
+// Block sizes used by examples/asrc_demo/src/asrc_utils.h
+#define USB_TO_I2S_ASRC_BLOCK_LENGTH (96)
+#define I2S_TO_USB_ASRC_BLOCK_LENGTH (244)
+
+static const uint32_t rates[] = {44100, 48000, 88200, 96000, 176400, 192000};
+
+typedef struct
+{
+    double thd_n_db;
+    double snr_db;
+} quality_t;
+
+// Solves a x = b by Gaussian elimination with partial pivoting. a is n x n, row major, and is overwritten.
+static void solve(std::vector<double> &a, std::vector<double> &b, int n)
+{
+    for(int col = 0; col < n; col++)
+    {
+        int pivot = col;
+        for(int row = col + 1; row < n; row++)
+        {
+            if(fabs(a[row * n + col]) > fabs(a[pivot * n + col]))
+            {
+                pivot = row;
+            }
+        }
+        for(int k = 0; k < n; k++)
+        {
+            std::swap(a[col * n + k], a[pivot * n + k]);
+        }
+        std::swap(b[col], b[pivot]);
+
+        for(int row = col + 1; row < n; row++)
+        {
+            double f = a[row * n + col] / a[col * n + col];
+            for(int k = col; k < n; k++)
+            {
+                a[row * n + k] -= f * a[col * n + k];
+            }
+            b[row] -= f * b[col];
+        }
+    }
+    for(int row = n - 1; row >= 0; row--)
+    {
+        for(int k = row + 1; k < n; k++)
+        {
+            b[row] -= a[row * n + k] * b[k];
+        }
+        b[row] /= a[row * n + row];
+    }
+}
+
+// Least squares fit of DC and the sines and cosines of the first n_harmonics harmonics of freq.
+// Returns the power of the residual.
+static double residual_power(const std::vector<double> &x, double freq, double fs, int n_harmonics, double *fundamental_power)
+{
+    const int n = 1 + 2 * n_harmonics;
+    std::vector<double> ata(n * n, 0.0);
+    std::vector<double> atb(n, 0.0);
+    std::vector<double> basis(n);
+
+    for(size_t i = 0; i < x.size(); i++)
+    {
+        basis[0] = 1.0;
+        for(int h = 1; h <= n_harmonics; h++)
+        {
+            double phase = 2.0 * M_PI * freq * h * i / fs;
+            basis[2 * h - 1] = sin(phase);
+            basis[2 * h] = cos(phase);
+        }
+        for(int r = 0; r < n; r++)
+        {
+            for(int c = r; c < n; c++)
+            {
+                ata[r * n + c] += basis[r] * basis[c];
+            }
+            atb[r] += basis[r] * x[i];
+        }
+    }
+    for(int r = 0; r < n; r++)
+    {
+        for(int c = 0; c < r; c++)
+        {
+            ata[r * n + c] = ata[c * n + r];
+        }
+    }
+    solve(ata, atb, n);
+
+    if(fundamental_power != nullptr)
+    {
+        *fundamental_power = (atb[1] * atb[1] + atb[2] * atb[2]) / 2;
+    }
+
+    double residual = 0.0;
+    for(size_t i = 0; i < x.size(); i++)
+    {
+        double y = atb[0];
+        for(int h = 1; h <= n_harmonics; h++)
+        {
+            double phase = 2.0 * M_PI * freq * h * i / fs;
+            y += atb[2 * h - 1] * sin(phase) + atb[2 * h] * cos(phase);
+        }
+        residual += (x[i] - y) * (x[i] - y);
+    }
+    return residual / x.size();
+}
+
+// THD+N is everything but the fundamental, the SNR leaves out the harmonics as well.
+static quality_t measure_quality(const std::vector<double> &x, double freq, double fs)
+{
+    quality_t q;
+    double signal_power;
+    int n_harmonics = N_HARMONICS;
+
+    while(n_harmonics > 1 && n_harmonics * freq >= fs / 2)
+    {
+        n_harmonics--;
+    }
+
+    double thd_n_power = residual_power(x, freq, fs, 1, &signal_power);
+    double noise_power = residual_power(x, freq, fs, n_harmonics, nullptr);
+
+    q.thd_n_db = 10 * log10(thd_n_power / signal_power);
+    q.snr_db = 10 * log10(signal_power / noise_power);
+    return q;
+}
+
+static int benchmark(uint32_t fs_in, uint32_t fs_out, uint32_t block_size, double secs, double ppm)
+{
+    ASRCCtrl_profile_only_t *profile_info_ptr[MAX_ASRC_N_IO_CHANNELS];
+    uint32_t rand_seed[MAX_ASRC_N_IO_CHANNELS] = {0};
+
+    uint64_t nominal_rate_ratio = wrapper_asrc_init(&profile_info_ptr, fs_in, fs_out, block_size, 1, 1, ASRC_DITHER_OFF, rand_seed);
+    double nominal_rate_ratio_f = (double)nominal_rate_ratio / (uint64_t)((uint64_t)1 << (28 + 32));
+
+    // A rate ratio off by ppm plays the input as if it were at fs_in * (1 + ppm)
+    double rate_ratio_f = nominal_rate_ratio_f * (1 + ppm / 1000000);
+    uint64_t rate_ratio = (uint64_t)(rate_ratio_f * ((uint64_t)1 << (28 + 32)));
+    double out_freq = SINE_FREQ * (1 + ppm / 1000000);
+
+    uint32_t n_blocks = (uint32_t)(secs * fs_in / block_size);
+    std::vector<int32_t> input(block_size);
+    std::vector<int32_t> output(2 * (int)(block_size / rate_ratio_f) + 8);
+    std::vector<double> converted;
+    converted.reserve((size_t)(secs * fs_out) + output.size());
+
+    double elapsed_ns = 0;
+    uint64_t cycles = 0;
+    uint64_t n_out_total = 0;
+    uint64_t n_in_total = 0;
+
+    for(uint32_t b = 0; b < n_blocks; b++)
+    {
+        for(uint32_t i = 0; i < block_size; i++)
+        {
+            input[i] = (int32_t)(SINE_AMPLITUDE * INT32_MAX * sin(2.0 * M_PI * SINE_FREQ * n_in_total / fs_in));
+            n_in_total++;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+#if HAVE_TSC
+        uint64_t start_cycles = __rdtsc();
+#endif
+        uint32_t n_out = wrapper_asrc_process(&input[0], &output[0], rate_ratio);
+#if HAVE_TSC
+        cycles += __rdtsc() - start_cycles;
+#endif
+        elapsed_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if(n_out > output.size())
+        {
+            printf("ERROR: fs_in %u, fs_out %u, block %u produced %u samples, more than the output buffer\n", fs_in, fs_out, block_size, n_out);
+            return -1;
+        }
+        for(uint32_t i = 0; i < n_out; i++)
+        {
+            converted.push_back((double)output[i] / INT32_MAX);
+        }
+        n_out_total += n_out;
+    }
+
+    size_t skip = (size_t)(SETTLE_TIME_SECS * fs_out);
+    if(converted.size() <= 2 * skip)
+    {
+        printf("ERROR: not enough output for fs_in %u, fs_out %u, block %u. Run for longer\n", fs_in, fs_out, block_size);
+        return -1;
+    }
+    std::vector<double> analysed(converted.begin() + skip, converted.end());
+    quality_t q = measure_quality(analysed, out_freq, fs_out);
+
+    double out_samples_per_sec = n_out_total / (elapsed_ns * 1e-9);
+    printf("%u,%u,%u,%.0f,%.1f,", fs_in, fs_out, block_size, out_samples_per_sec, out_samples_per_sec / fs_out);
+    printf("%.1f,", elapsed_ns / n_out_total);
+#if HAVE_TSC
+    printf("%.1f,", (double)cycles / n_out_total);
+#else
+    printf("-,");
+#endif
+    printf("%.1f,%.1f\n", q.thd_n_db, q.snr_db);
+    return 0;
+}
+
+// Usage. From the build directory, run: ./asrc_benchmark [-t <seconds>] [-p <ppm>] [block sizes...] | tee bench.csv
+int main(int argc, char* argv[])
+{
+    double secs = DEFAULT_SIM_TIME_SECS;
+    double ppm = 0;
+    std::vector<uint32_t> block_sizes;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-t") && (i + 1 < argc))
+        {
+            secs = atof(argv[++i]);
+        }
+        else if(!strcmp(argv[i], "-p") && (i + 1 < argc))
+        {
+            ppm = atof(argv[++i]);
+        }
+        else if(atoi(argv[i]) > 0)
+        {
+            block_sizes.push_back(atoi(argv[i]));
+        }
+        else
+        {
+            printf("Usage:\nasrc_benchmark [-t <seconds of input>] [-p <rate ratio error in ppm>] [block sizes...]\nExiting\n");
+            return -1;
+        }
+    }
+    if(block_sizes.empty())
+    {
+        block_sizes.push_back(USB_TO_I2S_ASRC_BLOCK_LENGTH);
+        block_sizes.push_back(I2S_TO_USB_ASRC_BLOCK_LENGTH);
+    }
+
+    printf("fs_in,fs_out,block_size,out_samples_per_sec,x_realtime,ns_per_out_sample,cycles_per_out_sample,thd_n_db,snr_db\n");
+    for(uint32_t block_size : block_sizes)
+    {
+        for(uint32_t fs_in : rates)
+        {
+            for(uint32_t fs_out : rates)
+            {
+                if(benchmark(fs_in, fs_out, block_size, secs, ppm) != 0)
+                {
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+// Model of the buffer level control loop of one ASRC direction, without SystemC and without the ASRC itself.
+//
+// The buffer writes and reads are timed as in the usb_in_i2s_out and i2s_in_usb_out applications. The ASRC is replaced
+// by the number of output samples it gives for each input block at the rate ratio in use, so a run of many minutes takes
+// a fraction of a second. The buffer level averaging and the PI control are the ones that the ASRC demo application uses,
+// and the options and the control summary line are those of the SystemC applications, so python/gain_sweep.py can be
+// run on either.
+//
+// Built as usb_in_i2s_out_model, and as i2s_in_usb_out_model with MODEL_I2S_IN_USB_OUT set.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "config.h"
+#include "helpers.h"
+#include "avg_buffer_level.h"
+#include "pi_control.h"
+
+#ifndef MODEL_I2S_IN_USB_OUT
+#define MODEL_I2S_IN_USB_OUT (0)
+#endif
+
+#define DEFAULT_NOMINAL_USB_RATE (48000)
+#define DEFAULT_USB_DRIFT_PPM    (10)
+#define DEFAULT_SIM_TIME_MINS    (20)
+#define USB_FRAME_SAMPLES        (48)
+#define UPDATE_BLOCKS            (16)   // ASRC blocks between buffer level control updates
+#define Q60                      ((double)((uint64_t)1 << (28+32)))
+
+// Buffer level control defaults, as in the firmware
+#if MODEL_I2S_IN_USB_OUT
+#define APP_NAME                 "i2s_in_usb_out_model"
+#define ASRC_BLOCK_SIZE          (244)
+#define DEFAULT_PI_TIME_CONSTANT_MS (5000)
+#define DEFAULT_PI_INTEGRAL_TIME_MS (20000)
+#define DEFAULT_AVG_WINDOW_LOG2  (8)
+#define DEFAULT_AVG_STABLE_THRESHOLD (2)
+#else
+#define APP_NAME                 "usb_in_i2s_out_model"
+#define ASRC_BLOCK_SIZE          (96)
+#define DEFAULT_PI_TIME_CONSTANT_MS (5000)
+#define DEFAULT_PI_INTEGRAL_TIME_MS (10000)
+#define DEFAULT_AVG_WINDOW_LOG2  (9)
+#define DEFAULT_AVG_STABLE_THRESHOLD (2)
+#define LOW_LATENCY_AVG_WINDOW_LOG2 (6)
+#endif
+#define DEFAULT_PI_MAX_CORRECTION_PPM (50)
+
+static double g_now;
+
+double sim_seconds(config_t *app_config)
+{
+    (void)app_config;
+    return g_now;
+}
+
+// Uniform in [-1, 1), the same sequence on every run
+static double jitter_rand(void)
+{
+    static uint32_t state = 1;
+    state = state * 1664525u + 1013904223u;
+    return (double)(state >> 8) / (double)(1u << 23) - 1.0;
+}
+
+int main(int argc, char* argv[])
+{
+    config_t *app_config = new config_t;
+    app_config->nominal_usb_rate = DEFAULT_NOMINAL_USB_RATE;
+    app_config->usb_drift_ppm = DEFAULT_USB_DRIFT_PPM;
+    app_config->asrc_block_size = ASRC_BLOCK_SIZE;
+    app_config->sim_time_mins = DEFAULT_SIM_TIME_MINS;
+    app_config->pi_config.time_constant_ms = DEFAULT_PI_TIME_CONSTANT_MS;
+    app_config->pi_config.integral_time_ms = DEFAULT_PI_INTEGRAL_TIME_MS;
+    app_config->pi_config.integrator_window = 0;
+    app_config->pi_config.max_correction_ppm = DEFAULT_PI_MAX_CORRECTION_PPM;
+    app_config->rate_step_ppm = 0;
+    app_config->low_latency = false;
+    app_config->avg_window_log2 = -1;
+    app_config->avg_stable_threshold = DEFAULT_AVG_STABLE_THRESHOLD;
+    app_config->sof_jitter_us = 0;
+
+    int arg = parse_options(argc, argv, app_config);
+    if((arg < 0) || (argc - arg != 1))
+    {
+        print_usage(APP_NAME);
+        printf("The control model takes no timestamps file\nExiting\n");
+        return -1;
+    }
+#if MODEL_I2S_IN_USB_OUT
+    if(app_config->low_latency)
+    {
+        printf("ERROR: The low latency mode only applies to the usb_in_i2s_out direction\n");
+        return -1;
+    }
+    if(app_config->avg_window_log2 < 0)
+    {
+        app_config->avg_window_log2 = DEFAULT_AVG_WINDOW_LOG2;
+    }
+#else
+    if(app_config->avg_window_log2 < 0)
+    {
+        app_config->avg_window_log2 = app_config->low_latency ? LOW_LATENCY_AVG_WINDOW_LOG2 : DEFAULT_AVG_WINDOW_LOG2;
+    }
+#endif
+    app_config->nominal_i2s_rate = (double)(atoi(argv[arg]));
+    if(verify_i2s_rate(app_config->nominal_i2s_rate) != 0)
+    {
+        return -1;
+    }
+
+    // The I2S clock is the reference, as in the SystemC applications
+    const double fs_i2s = app_config->nominal_i2s_rate;
+    const double usb_frame_period = 1e-3 / (1 + app_config->usb_drift_ppm / 1e6);
+    const double jitter = app_config->sof_jitter_us * 1e-6;
+#if MODEL_I2S_IN_USB_OUT
+    const double fs_in = fs_i2s, fs_out = app_config->nominal_usb_rate;
+    const double actual_rate_ratio = fs_i2s / (app_config->nominal_usb_rate * (1 + app_config->usb_drift_ppm / 1e6));
+#else
+    const double fs_in = app_config->nominal_usb_rate, fs_out = fs_i2s;
+    const double actual_rate_ratio = (app_config->nominal_usb_rate * (1 + app_config->usb_drift_ppm / 1e6)) / fs_i2s;
+#endif
+    const uint64_t rate_ratio_q60 = (uint64_t)(actual_rate_ratio * Q60);
+
+    buffer_calc_state_t buf_state;
+    pi_control_t buf_control;
+    init_calc_buffer_level_state(&buf_state, app_config->avg_window_log2, app_config->low_latency ? 0 : app_config->avg_stable_threshold);
+    pi_control_init(&buf_control, &app_config->pi_config);
+    pi_control_set_rates(&buf_control, (uint32_t)fs_in, (uint32_t)fs_out, (uint32_t)(UPDATE_BLOCKS * ASRC_BLOCK_SIZE * 1e6 / fs_in));
+
+    const double end_time = app_config->sim_time_mins * 60;
+    int64_t correction = 0;
+    double out_phase = 0;       // Output samples given by the ASRC, with the fraction carried to the next block
+    int64_t written = 0;
+    int64_t read = 0;
+    uint32_t block_count = 0;
+    bool have_set_point = false;
+    int32_t set_point = 0;
+    uint64_t frame_count = 0;
+    double next_frame = usb_frame_period + jitter * jitter_rand();
+#if MODEL_I2S_IN_USB_OUT
+    uint64_t asrc_blocks = 0;
+#else
+    uint32_t frames_in_block = 0;
+#endif
+
+    while(g_now < end_time)
+    {
+        bool asrc_block = false;
+
+#if MODEL_I2S_IN_USB_OUT
+        // I2S fills an ASRC input block on the reference clock. USB takes a frame each SOF.
+        double next_block = (asrc_blocks + 1) * ASRC_BLOCK_SIZE / fs_i2s;
+        if(next_block < next_frame)
+        {
+            g_now = next_block;
+            asrc_blocks += 1;
+            asrc_block = true;
+        }
+        else
+        {
+            g_now = next_frame;
+            frame_count += 1;
+            next_frame = (frame_count + 1) * usb_frame_period + jitter * jitter_rand();
+            read += USB_FRAME_SAMPLES;
+        }
+#else
+        // USB gives a frame each SOF, and the ASRC runs once it has a block. I2S takes samples on the reference clock.
+        g_now = next_frame;
+        frame_count += 1;
+        next_frame = (frame_count + 1) * usb_frame_period + jitter * jitter_rand();
+        read = (int64_t)std::floor(g_now * fs_i2s);
+        frames_in_block += 1;
+        if(frames_in_block * USB_FRAME_SAMPLES == ASRC_BLOCK_SIZE)
+        {
+            frames_in_block = 0;
+            asrc_block = true;
+        }
+#endif
+        if(!asrc_block)
+        {
+            continue;
+        }
+
+        // The rate ratio is given to the ASRC as fs_in/fs_out
+        double rate_ratio = (double)(int64_t)(apply_rate_step(app_config, rate_ratio_q60) + correction) / Q60;
+        out_phase += ASRC_BLOCK_SIZE / rate_ratio;
+        int num_out_samples = (int)out_phase;
+        out_phase -= num_out_samples;
+
+        int level_before_write = (int)(written - read);
+        written += num_out_samples;
+        int level = (int)(written - read);
+        calc_avg_buffer_level(&buf_state, level, false);
+
+        // The range is counted from the set point, once there is one
+        if(have_set_point)
+        {
+            update_buffer_range(app_config, level_before_write - set_point, level - set_point);
+        }
+
+        block_count += 1;
+        if(block_count == UPDATE_BLOCKS)
+        {
+            if(!have_set_point)
+            {
+                have_set_point = app_config->low_latency ? buf_state.flag_first_done : buf_state.flag_stable_avg;
+                set_point = app_config->low_latency ? 0 : buf_state.stable_avg_level;
+            }
+            if(have_set_point)
+            {
+                correction = pi_control_update(&buf_control, buf_state.avg_buffer_level - set_point);
+                update_control_stats(app_config, buf_state.avg_buffer_level - set_point);
+            }
+            block_count = 0;
+        }
+    }
+
+    print_control_stats(app_config);
+
+    delete app_config;
+    return 0;
+}
@@ -1,16 +1,14 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #include "asrc.h"
 #include "ASRC_wrapper.h"
 #include "usb_rate_calc.h"
 #include "pi_control.h"
-#include "usb_rate_calc.h"
 #include "avg_buffer_level.h"
+#include "helpers.h"
 
-extern float_s32_t g_avg_usb_rate;
-float_s32_t g_avg_i2s_rate;
-rate_info_t g_i2s_rate_info;
-extern rate_info_t g_usb_rate_info;
+extern rate_estimate_t g_avg_usb_rate;
+rate_estimate_t g_avg_i2s_rate;
 
 
 ASRC::ASRC(sc_module_name name, uint32_t fs_in, uint32_t fs_out, uint32_t block_size, double actual_rate_ratio, Buffer* buffer, sc_event &trigger, config_t *config)
@@ -30,38 +28,13 @@ ASRC::ASRC(sc_module_name name, uint32_t fs_in, uint32_t fs_out, uint32_t block_
     m_actual_rate_ratio = uint64_t(m_actual_rate_ratio_f * ((uint64_t)1 << (28+32)));
 
 
-    g_avg_i2s_rate = float_div((float_s32_t){(int32_t)m_config->nominal_i2s_rate, 0}, (float_s32_t){100000000, 0});
-    g_i2s_rate_info.samples = m_config->nominal_i2s_rate;
-    g_i2s_rate_info.ticks = 100000000;
+    g_avg_i2s_rate = (rate_estimate_t){(uint32_t)m_config->nominal_i2s_rate, 100000000};
 
-    printf("I2S rate = (0x%x, %d), %.10f\n", g_avg_i2s_rate.mant, g_avg_i2s_rate.exp, ((uint32_t)g_avg_i2s_rate.mant)*pow(2, g_avg_i2s_rate.exp));
+    printf("I2S rate = %u/%u\n", g_avg_i2s_rate.samples, g_avg_i2s_rate.ticks);
 
     SC_THREAD(process); sensitive << trigger;
 }
 
-static inline int32_t get_avg_window_size_log2(uint32_t i2s_rate)
-{
-    if((i2s_rate == 192000) || (i2s_rate == 176400))
-    {
-        return 12;
-    }
-    else if((i2s_rate == 96000) || (i2s_rate == 88200))
-    {
-        return 11;
-    }
-    else if((i2s_rate == 48000) || (i2s_rate == 44100))
-    {
-        // Ideally, the windows size should be 2**10 for 48000,44100 so we can average over the same time window worth of samples, but I can't
-        // stable monotonically increasing or descreasing averages when averaged over 1024 samples, so continuing with a window size of 2**11 itself.
-        return 11;
-    }
-    else
-    {
-        assert(0);
-    }
-    return 0;
-}
-
 void ASRC::process()
 {
     int32_t input[m_block_size];
@@ -77,34 +50,38 @@ void ASRC::process()
         rate_ratio = m_actual_rate_ratio;
     }
 
-    buffer_calc_state_t long_term_buf_state, short_term_buf_state;
+    buffer_calc_state_t buf_state;
+    pi_control_t buf_control;
 
 
     FILE *fp;
     fp = fopen("asrc_output.bin", "wb");
 
-    int32_t window_len_log2 = get_avg_window_size_log2(m_config->nominal_i2s_rate);
+    init_calc_buffer_level_state(&buf_state, m_config->avg_window_log2, m_config->avg_stable_threshold);
 
-    init_calc_buffer_level_state(&long_term_buf_state, window_len_log2, 4);
-    init_calc_buffer_level_state(&short_term_buf_state, 9, 4);
+    // The buffer level control is updated every 16 ASRC blocks
+    pi_control_init(&buf_control, &m_config->pi_config);
+    pi_control_set_rates(&buf_control, (uint32_t)m_config->nominal_i2s_rate, (uint32_t)m_config->nominal_usb_rate,
+                         (uint32_t)(16 * m_block_size * 1e6 / m_config->nominal_i2s_rate));
 
     while(true)
     {
         wait();
-        uint32_t num_out_samples = wrapper_asrc_process(&m_config->asrc_input_samples[0], &output[0], rate_ratio);
+        uint32_t num_out_samples = wrapper_asrc_process(&m_config->asrc_input_samples[0], &output[0], apply_rate_step(m_config, rate_ratio));
 
         fwrite(&output[0], sizeof(int32_t), num_out_samples, fp);
 
         //unsigned int asrc_delay = 60 + (rand() % 20);
         //wait(asrc_delay, SC_US);
+        int level_before_write = m_buffer->fill_level();
         m_buffer->write(num_out_samples);
+        update_buffer_range(m_config, level_before_write, m_buffer->fill_level());
 
-        calc_avg_buffer_level(&long_term_buf_state, m_buffer->fill_level(), false);
-        calc_avg_buffer_level(&short_term_buf_state, m_buffer->fill_level(), false);
+        calc_avg_buffer_level(&buf_state, m_buffer->fill_level(), false);
 
-        if(long_term_buf_state.flag_stable_avg)
+        if(buf_state.flag_stable_avg)
         {
-            printf("%d,%d\n", long_term_buf_state.avg_buffer_level, short_term_buf_state.avg_buffer_level);
+            printf("%d,%d\n", m_buffer->fill_level(), buf_state.avg_buffer_level);
         }
 
         // After 16 writes
@@ -113,25 +90,20 @@ void ASRC::process()
         if(buffer_writes_count == 16)
         {
             //printf("%d\n",m_buffer->fill_level());
-            int64_t error;
-            if(m_config->usb_timestamps[0].size() != 0)
+            int64_t error = 0;
+            if(buf_state.flag_stable_avg)
             {
-                rate_ratio = float_div_u64_fixed_output_q_format(g_avg_i2s_rate, g_avg_usb_rate, 28+32);
-
-                // Try doing (g_i2s_rate_info.samples * g_usb_rate_info.ticks) / (g_usb_rate_info.samples * g_i2s_rate_info.ticks).
-                // Doesn't seem to show any benefit so not enabling it and sticking to g_avg_i2s_rate/g_avg_usb_rate instead
-                //uint64_t test_rate_ratio = test_mult_div(g_i2s_rate_info, g_usb_rate_info);
-
-                //printf("rate_ratio = %llu, test = %llu\n", rate_ratio, test_rate_ratio);
-                //rate_ratio = test_rate_ratio;
-
-                error = calc_usb_buffer_based_correction(m_config->nominal_i2s_rate, &long_term_buf_state, &short_term_buf_state);
+                error = pi_control_update(&buf_control, buf_state.avg_buffer_level - buf_state.stable_avg_level);
+                update_control_stats(m_config, buf_state.avg_buffer_level - buf_state.stable_avg_level);
+            }
 
+            if(m_config->usb_timestamps[0].size() != 0)
+            {
+                rate_ratio = rate_estimator_ratio(g_avg_i2s_rate, g_avg_usb_rate);
                 rate_ratio = rate_ratio + error;
             }
             else
             {
-                error = calc_usb_buffer_based_correction(m_config->nominal_i2s_rate, &long_term_buf_state, &short_term_buf_state);
                 rate_ratio = m_actual_rate_ratio + error;
             }
 
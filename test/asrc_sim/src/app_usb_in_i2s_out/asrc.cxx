@@ -1,13 +1,14 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #include "asrc.h"
 #include "ASRC_wrapper.h"
 #include "usb_rate_calc.h"
 #include "pi_control.h"
 #include "avg_buffer_level.h"
+#include "helpers.h"
 
-extern float_s32_t g_avg_usb_rate;
-float_s32_t g_avg_i2s_rate;
+extern rate_estimate_t g_avg_usb_rate;
+rate_estimate_t g_avg_i2s_rate;
 
 
 ASRC::ASRC(sc_module_name name, uint32_t fs_in, uint32_t fs_out, uint32_t block_size, double actual_rate_ratio, Buffer* buffer, sc_event &trigger, config_t *config)
@@ -27,9 +28,9 @@ ASRC::ASRC(sc_module_name name, uint32_t fs_in, uint32_t fs_out, uint32_t block_
     m_actual_rate_ratio_f = actual_rate_ratio;// + 1e-8;    // Optionally, add an extra drift
     m_actual_rate_ratio = uint64_t(m_actual_rate_ratio_f * ((uint64_t)1 << (28+32)));
 
-    g_avg_i2s_rate = float_div((float_s32_t){(int32_t)m_config->nominal_i2s_rate, 0}, (float_s32_t){100000000, 0});
+    g_avg_i2s_rate = (rate_estimate_t){(uint32_t)m_config->nominal_i2s_rate, 100000000};
 
-    printf("I2S rate = (0x%x, %d), %.10f\n", g_avg_i2s_rate.mant, g_avg_i2s_rate.exp, ((uint32_t)g_avg_i2s_rate.mant)*pow(2, g_avg_i2s_rate.exp));
+    printf("I2S rate = %u/%u\n", g_avg_i2s_rate.samples, g_avg_i2s_rate.ticks);
 
     SC_THREAD(process); sensitive << trigger;
 }
@@ -40,6 +41,7 @@ void ASRC::process()
     int32_t output[int(2*(m_block_size/m_nominal_rate_ratio_f)) * 2];
     uint32_t buffer_writes_count = 0;
     buffer_calc_state_t buf_state;
+    pi_control_t buf_control;
 
     uint64_t rate_ratio;
     if(m_config->usb_timestamps[0].size() != 0)
@@ -51,20 +53,35 @@ void ASRC::process()
         rate_ratio = m_actual_rate_ratio;
     }
 
-    init_calc_buffer_level_state(&buf_state, 10, 8);
+    if(m_config->low_latency)
+    {
+        // The buffer level is counted from the fixed fill that I2S starts at, which is the set point
+        init_calc_buffer_level_state(&buf_state, m_config->avg_window_log2, 0);
+    }
+    else
+    {
+        init_calc_buffer_level_state(&buf_state, m_config->avg_window_log2, m_config->avg_stable_threshold);
+    }
+
+    // The buffer level control is updated every 16 ASRC blocks
+    pi_control_init(&buf_control, &m_config->pi_config);
+    pi_control_set_rates(&buf_control, (uint32_t)m_config->nominal_usb_rate, (uint32_t)m_config->nominal_i2s_rate,
+                         (uint32_t)(16 * m_block_size * 1e6 / m_config->nominal_usb_rate));
 
     FILE *fp;
     fp = fopen("asrc_output.bin", "wb");
     while(true)
     {
         wait();
-        uint32_t num_out_samples = wrapper_asrc_process(&m_config->asrc_input_samples[0], &output[0], rate_ratio);
+        uint32_t num_out_samples = wrapper_asrc_process(&m_config->asrc_input_samples[0], &output[0], apply_rate_step(m_config, rate_ratio));
 
         fwrite(&output[0], sizeof(int32_t), num_out_samples, fp);
 
         //unsigned int asrc_delay = 60 + (rand() % 20);
         //wait(asrc_delay, SC_US);
+        int level_before_write = m_buffer->fill_level();
         m_buffer->write(num_out_samples);
+        update_buffer_range(m_config, level_before_write, m_buffer->fill_level());
 
         calc_avg_buffer_level(&buf_state, m_buffer->fill_level(), false);
 
@@ -73,12 +90,19 @@ void ASRC::process()
 
         if(buffer_writes_count == 16)
         {
-            int64_t error;
+            int64_t error = 0;
+            bool have_set_point = m_config->low_latency ? buf_state.flag_first_done : buf_state.flag_stable_avg;
+            int32_t set_point = m_config->low_latency ? 0 : buf_state.stable_avg_level;
+            if(have_set_point)
+            {
+                error = pi_control_update(&buf_control, buf_state.avg_buffer_level - set_point);
+                update_control_stats(m_config, buf_state.avg_buffer_level - set_point);
+            }
+
             if(m_config->usb_timestamps[0].size() != 0)
             {
-                rate_ratio = float_div_u64_fixed_output_q_format(g_avg_usb_rate, g_avg_i2s_rate, 28+32);
-                error = pi_control(m_config->nominal_i2s_rate, &buf_state);
-                // Uncomment to apply a fixed correction instead of the pi_control() code.
+                rate_ratio = rate_estimator_ratio(g_avg_usb_rate, g_avg_i2s_rate);
+                // Uncomment to apply a fixed correction instead of the pi_control_update() one.
                 //double correction = 0.000000043;
                 //uint64_t correction_i = (uint64_t)(correction * ((uint64_t)1 << (28+32)));
                 //rate_ratio = rate_ratio - correction_i;
@@ -86,13 +110,12 @@ void ASRC::process()
             }
             else
             {
-                error = pi_control(m_config->nominal_i2s_rate, &buf_state);
                 rate_ratio = m_actual_rate_ratio + error;
             }
 
             buffer_writes_count = 0;
 
-            if(buf_state.flag_stable_avg)
+            if(have_set_point)
             {
                 printf("%d,%d\n",m_buffer->fill_level(),buf_state.avg_buffer_level);
             }
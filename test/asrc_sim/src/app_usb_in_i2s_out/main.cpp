@@ -1,4 +1,4 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #include <string>
 #include <sstream>
@@ -14,24 +14,47 @@
 #define DEFAULT_NOMINAL_USB_RATE (48000) // Do not change!! Only 48000KHz USB supported
 #define DEFAULT_USB_DRIFT_PPM    (10)
 #define DEFAULT_SIM_TIME_MINS    (20)    // Simulation time in mins
+// Buffer level control defaults, as in the firmware
+#define DEFAULT_PI_TIME_CONSTANT_MS (5000)
+#define DEFAULT_PI_INTEGRAL_TIME_MS (10000)
+#define DEFAULT_PI_MAX_CORRECTION_PPM (50)
+#define DEFAULT_AVG_WINDOW_LOG2  (9)
+#define DEFAULT_AVG_STABLE_THRESHOLD (2)
+#define LOW_LATENCY_AVG_WINDOW_LOG2 (6)
 #define ASRC_BLOCK_SIZE          (96)    // Number of samples that make the ASRC input block
 
 
-// Usage. From the build directory, run: ./usb_in_i2s_out <i2s_rate> ../log_sofs_1hr 2>&1 | tee log
+// Usage. From the build directory, run: ./usb_in_i2s_out [options] <i2s_rate> ../log_sofs_1hr 2>&1 | tee log
 int sc_main(int argc, char* argv[])
 {
     config_t *app_config = new config_t;
     app_config->nominal_usb_rate = DEFAULT_NOMINAL_USB_RATE;
     app_config->usb_drift_ppm = DEFAULT_USB_DRIFT_PPM;
     app_config->asrc_block_size = ASRC_BLOCK_SIZE;
-
-
-    if(argc < 2)
+    app_config->sim_time_mins = DEFAULT_SIM_TIME_MINS;
+    app_config->pi_config.time_constant_ms = DEFAULT_PI_TIME_CONSTANT_MS;
+    app_config->pi_config.integral_time_ms = DEFAULT_PI_INTEGRAL_TIME_MS;
+    app_config->pi_config.integrator_window = 0;
+    app_config->pi_config.max_correction_ppm = DEFAULT_PI_MAX_CORRECTION_PPM;
+    app_config->rate_step_ppm = 0;
+    app_config->low_latency = false;
+    app_config->avg_window_log2 = -1;
+    app_config->avg_stable_threshold = DEFAULT_AVG_STABLE_THRESHOLD;
+    app_config->sof_jitter_us = 0;
+
+
+    int arg = parse_options(argc, argv, app_config);
+    if((arg < 0) || (argc - arg < 1) || (argc - arg > 2))
     {
-        printf("Usage:\nusb_in_i2s_out <i2s_rate> \nor\nusb_in_i2s_out <i2s_rate> <USB timestamps file>\nExiting\n");
+        print_usage("usb_in_i2s_out");
+        printf("Exiting\n");
         return -1;
     }
-    app_config->nominal_i2s_rate = (double)(atoi(argv[1]));
+    if(app_config->avg_window_log2 < 0)
+    {
+        app_config->avg_window_log2 = app_config->low_latency ? LOW_LATENCY_AVG_WINDOW_LOG2 : DEFAULT_AVG_WINDOW_LOG2;
+    }
+    app_config->nominal_i2s_rate = (double)(atoi(argv[arg]));
     if(verify_i2s_rate(app_config->nominal_i2s_rate) != 0)
     {
         return -1;
@@ -53,10 +76,10 @@ int sc_main(int argc, char* argv[])
         return -1;
     }
 
-    if(argc == 3) // If SOF timestamps file is provided, parse the timestamps into a std::vector
+    if(argc - arg == 2) // If SOF timestamps file is provided, parse the timestamps into a std::vector
     {
-        printf("argv[2] = %s\n", argv[2]);
-        parse_sof_timestamps(argv[2], app_config);
+        printf("argv[%d] = %s\n", arg + 1, argv[arg + 1]);
+        parse_sof_timestamps(argv[arg + 1], app_config);
     }
 
     app_config->actual_usb_rate = (double)app_config->nominal_usb_rate * (1 + app_config->usb_drift_ppm/1000000);
@@ -82,7 +105,9 @@ int sc_main(int argc, char* argv[])
     sc_start(0, SC_SEC);
 
     // Simulate for N seconds
-    sc_start(DEFAULT_SIM_TIME_MINS*60*app_config->nominal_i2s_rate, SC_US);
+    sc_start(app_config->sim_time_mins*60*app_config->nominal_i2s_rate, SC_US);
+
+    print_control_stats(app_config);
 
     return 0;
 }
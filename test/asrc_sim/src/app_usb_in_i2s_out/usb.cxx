@@ -1,4 +1,4 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #include <math.h>
 #include "usb.h"
@@ -6,7 +6,7 @@
 #include "NumCpp.hpp"
 
 
-float_s32_t g_avg_usb_rate = {.mant=0, .exp=0};
+rate_estimate_t g_avg_usb_rate = {0, 0};
 
 USB::USB(sc_module_name name, Buffer* buffer, config_t *config)
     : sc_module(name)
@@ -65,9 +65,8 @@ void USB::process()
 
             if (prev_ts_valid)
             {
-                g_avg_usb_rate = determine_USB_audio_rate(*ts, *(ts+1), 0, true);
-                //printf("usb_timestamp = %u, g_avg_usb_rate = (0x%x, %d), %.10f\n", *ts, g_avg_usb_rate.mant, g_avg_usb_rate.exp,
-                //                                                                ((uint32_t)g_avg_usb_rate.mant)*(pow(2, g_avg_usb_rate.exp))*100000);
+                g_avg_usb_rate = determine_USB_audio_rate(*ts, *(ts+1), 0);
+                //printf("usb_timestamp = %u, g_avg_usb_rate = %u/%u\n", *ts, g_avg_usb_rate.samples, g_avg_usb_rate.ticks);
                 //ts_count += 2;
             }
             count += 1;
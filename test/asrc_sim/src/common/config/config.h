@@ -1,7 +1,24 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #pragma once
 
+#include <cstdint>
+#include <vector>
+#include "pi_control.h"
+
+/// Settling of the buffer level control after a step in the rate ratio, for comparing controller settings
+typedef struct
+{
+    double step_time;           // Time of the rate ratio step, in seconds
+    double ss_start_time;       // Start of the steady state measurement, in seconds
+    double last_unsettled_time; // Last time the buffer level error was outside the settle band
+    double ss_abs_error_sum;
+    uint32_t ss_count;
+    int ss_max_error;
+    int min_level;              // Lowest buffer level just before an ASRC write
+    int max_level;              // Highest buffer level just after an ASRC write
+}control_stats_t;
+
 typedef struct
 {
     /* data */
@@ -14,4 +31,14 @@ typedef struct
     int asrc_block_size;
     std::vector<uint32_t> usb_timestamps[2]; // 2 in case OUT and IN timestamps are present.
     int *asrc_input_samples;
+
+    double sim_time_mins;
+    pi_control_config_t pi_config;
+    int avg_window_log2;        // log2 of the number of buffer writes averaged for the buffer level
+    int avg_stable_threshold;   // Averages to wait for before the buffer level set point is taken
+    double sof_jitter_us;       // Jitter of the USB transfers, control model only
+    int settle_band;            // Largest buffer level error, in samples, that counts as settled
+    double rate_step_ppm;       // Step in the rate ratio given to the ASRC, a quarter of the way into the simulation
+    bool low_latency;           // Control the buffer level to a fixed set point from the first short window, as appconfASRC_LOW_LATENCY does
+    control_stats_t control_stats;
 }config_t;
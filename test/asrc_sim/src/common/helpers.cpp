@@ -1,13 +1,15 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #include <string>
 #include <sstream>
 #include <fstream>
-#include "systemc.h"
 #include "config.h"
+#include "helpers.h"
 
 #include <cstdlib>
+#include <cstring>
+#include <climits>
 #include <iostream>
 #include <numeric>
 
@@ -15,7 +17,6 @@
 
 void parse_sof_timestamps(const char *fname, config_t *app_config)
 {
-    ifstream myfile;
     std::ifstream infile(fname);
     std::string line;
 
@@ -63,3 +64,143 @@ int verify_i2s_rate(int i2s_rate)
     printf("nominal_i2s_rate = %d\n", (int)i2s_rate);
     return 0;
 }
+
+void print_usage(const char *app_name)
+{
+    printf("Usage:\n%s [options] <i2s_rate>\nor\n%s [options] <i2s_rate> <USB timestamps file>\n", app_name, app_name);
+    printf("Options:\n");
+    printf("  -t <ms>    Time constant of the buffer level control\n");
+    printf("  -i <ms>    Integral time of the buffer level control. 0 for P only control\n");
+    printf("  -w <n>     Number of updates summed by the integral term. 0 to sum all of them\n");
+    printf("  -c <ppm>   Limit of the buffer level correction\n");
+    printf("  -e <ppm>   Step in the rate ratio, a quarter of the way into the simulation\n");
+    printf("  -m <mins>  Simulation time\n");
+    printf("  -l <0|1>   Low latency mode, with a fixed buffer level set point and a short averaging window\n");
+    printf("  -a <n>     log2 of the number of buffer writes averaged for the buffer level\n");
+    printf("  -s <n>     Averages to wait for before the buffer level set point is taken\n");
+    printf("  -j <us>    Jitter of the USB transfers. Control model only\n");
+    printf("  -b <n>     Largest average buffer level error that counts as settled, 1 sample by default\n");
+}
+
+int parse_options(int argc, char* argv[], config_t *app_config)
+{
+    int i = 1;
+    app_config->settle_band = 1;
+    while((i < argc) && (argv[i][0] == '-'))
+    {
+        if(i + 1 >= argc)
+        {
+            printf("ERROR: Missing value for option %s\n", argv[i]);
+            return -1;
+        }
+        const char *value = argv[i + 1];
+        switch(argv[i][1])
+        {
+            case 't': app_config->pi_config.time_constant_ms = (uint32_t)atoi(value); break;
+            case 'i': app_config->pi_config.integral_time_ms = (uint32_t)atoi(value); break;
+            case 'w': app_config->pi_config.integrator_window = (uint32_t)atoi(value); break;
+            case 'c': app_config->pi_config.max_correction_ppm = (uint32_t)atoi(value); break;
+            case 'e': app_config->rate_step_ppm = atof(value); break;
+            case 'm': app_config->sim_time_mins = atof(value); break;
+            case 'l': app_config->low_latency = (atoi(value) != 0); break;
+            case 'a': app_config->avg_window_log2 = atoi(value); break;
+            case 's': app_config->avg_stable_threshold = atoi(value); break;
+            case 'j': app_config->sof_jitter_us = atof(value); break;
+            case 'b': app_config->settle_band = atoi(value); break;
+            default:
+                printf("ERROR: Unknown option %s\n", argv[i]);
+                return -1;
+        }
+        i += 2;
+    }
+
+    control_stats_t *stats = &app_config->control_stats;
+    memset(stats, 0, sizeof(control_stats_t));
+    stats->step_time = app_config->sim_time_mins * 60 / 4;
+    stats->ss_start_time = app_config->sim_time_mins * 60 * 3 / 4;
+    stats->last_unsettled_time = -1;
+    stats->min_level = INT_MAX;
+    stats->max_level = INT_MIN;
+
+    return i;
+}
+
+uint64_t apply_rate_step(config_t *app_config, uint64_t rate_ratio)
+{
+    if((app_config->rate_step_ppm != 0) && (sim_seconds(app_config) >= app_config->control_stats.step_time))
+    {
+        rate_ratio += (int64_t)((double)rate_ratio * app_config->rate_step_ppm / 1e6);
+    }
+    return rate_ratio;
+}
+
+void update_control_stats(config_t *app_config, int buffer_level_error)
+{
+    control_stats_t *stats = &app_config->control_stats;
+    double t = sim_seconds(app_config);
+    int abs_error = abs(buffer_level_error);
+
+    if(abs_error > app_config->settle_band)
+    {
+        stats->last_unsettled_time = t;
+    }
+    if(t >= stats->ss_start_time)
+    {
+        stats->ss_abs_error_sum += abs_error;
+        stats->ss_count += 1;
+        if(abs_error > stats->ss_max_error)
+        {
+            stats->ss_max_error = abs_error;
+        }
+    }
+}
+
+void update_buffer_range(config_t *app_config, int level_before_write, int level_after_write)
+{
+    control_stats_t *stats = &app_config->control_stats;
+
+    if(level_before_write < stats->min_level)
+    {
+        stats->min_level = level_before_write;
+    }
+    if(level_after_write > stats->max_level)
+    {
+        stats->max_level = level_after_write;
+    }
+}
+
+// Prints one line of the form
+// control,<time constant ms>,<integral time ms>,<integrator window>,<step ppm>,<settle time s>,<mean abs error>,<max abs error>
+// The settle time is counted from the rate ratio step, and is -1 if the error was still outside the settle band in the
+// steady state part of the simulation. The errors are in samples, over the last quarter of the simulation.
+// Followed by a line of the form
+// buffer,<lowest level just before a write>,<highest level just after a write>
+// when the buffer range was tracked.
+void print_control_stats(config_t *app_config)
+{
+    control_stats_t *stats = &app_config->control_stats;
+    double settle_time = 0;
+
+    if(stats->last_unsettled_time >= stats->ss_start_time)
+    {
+        settle_time = -1;
+    }
+    else if(stats->last_unsettled_time > stats->step_time)
+    {
+        settle_time = stats->last_unsettled_time - stats->step_time;
+    }
+
+    printf("control,%u,%u,%u,%.3f,%.1f,%.2f,%d\n",
+        app_config->pi_config.time_constant_ms,
+        app_config->pi_config.integral_time_ms,
+        app_config->pi_config.integrator_window,
+        app_config->rate_step_ppm,
+        settle_time,
+        stats->ss_count ? stats->ss_abs_error_sum / stats->ss_count : 0.0,
+        stats->ss_max_error);
+
+    if(stats->min_level <= stats->max_level)
+    {
+        printf("buffer,%d,%d\n", stats->min_level, stats->max_level);
+    }
+}
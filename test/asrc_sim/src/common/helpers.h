@@ -1,6 +1,21 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #pragma once
 
 void parse_sof_timestamps(const char *fname, config_t *app_config);
 int verify_i2s_rate(int i2s_rate);
+
+// Parses the options that come before the positional arguments. Returns the index of the first positional argument, or -1 on an error.
+int parse_options(int argc, char* argv[], config_t *app_config);
+
+void print_usage(const char *app_name);
+
+// Time since the start of the simulation in seconds. In sim_time.cpp for the SystemC applications
+double sim_seconds(config_t *app_config);
+
+// Adds the rate ratio step to a rate ratio, once it is time for the step
+uint64_t apply_rate_step(config_t *app_config, uint64_t rate_ratio);
+
+void update_control_stats(config_t *app_config, int buffer_level_error);
+void update_buffer_range(config_t *app_config, int level_before_write, int level_after_write);
+void print_control_stats(config_t *app_config);
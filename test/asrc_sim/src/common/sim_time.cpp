@@ -0,0 +1,12 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "systemc.h"
+#include "config.h"
+#include "helpers.h"
+
+// The SystemC applications run one us of simulation time per I2S sample
+double sim_seconds(config_t *app_config)
+{
+    return sc_time_stamp().to_seconds() * 1e6 / app_config->nominal_i2s_rate;
+}
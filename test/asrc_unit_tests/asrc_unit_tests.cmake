@@ -8,6 +8,8 @@ add_executable(test_asrc_div
     ${CMAKE_CURRENT_LIST_DIR}/src/main.c
     ${CMAKE_CURRENT_LIST_DIR}/src/pseudo_rand.c
     ${ASRC_EXAMPLE_PATH}/src/shared/div.c
+    ${ASRC_EXAMPLE_PATH}/src/shared/rate_estimator.c
+    ${ASRC_EXAMPLE_PATH}/src/shared/pi_control.c
 )
 
 target_include_directories(test_asrc_div
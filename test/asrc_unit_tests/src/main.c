@@ -1,10 +1,11 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
 
 #if !X86_BUILD
     #include <platform.h>
@@ -17,6 +18,8 @@
 #include <xmath/xmath.h>
 #include "pseudo_rand.h"
 #include "div.h"
+#include "rate_estimator.h"
+#include "pi_control.h"
 
 void test_float_div(unsigned seed, bool verbose)
 {
@@ -101,6 +104,298 @@ void test_div_fixed_output_q_format(unsigned seed, bool verbose)
 }
 
 
+void test_rate_estimator_ratio(unsigned seed, bool verbose)
+{
+    for(int itt=0; itt<(1<<8); itt++)
+    {
+        // Rates between 40 kHz and 200 kHz measured over up to 40 seconds of a 100 MHz timer
+        rate_estimate_t num, den;
+        num.ticks = pseudo_rand_uint(&seed, 1000000, 4000000000);
+        den.ticks = pseudo_rand_uint(&seed, 1000000, 4000000000);
+        num.samples = (uint32_t)((double)num.ticks * pseudo_rand_uint(&seed, 40000, 200000) / 100000000);
+        den.samples = (uint32_t)((double)den.ticks * pseudo_rand_uint(&seed, 40000, 200000) / 100000000);
+
+        // reference
+        double ref = ((double)num.samples * den.ticks) / ((double)num.ticks * den.samples);
+
+        uint64_t res = rate_estimator_ratio(num, den);
+        double dut = ldexp(res, -RATE_ESTIMATOR_RATIO_Q);
+
+        double rel_error = fabs((ref - dut) / ref);
+        double thresh = ldexp(1, -46);
+
+        if(verbose)
+        {
+            printf("rate_estimator_ratio: itt %d: dut = %.15f. ref = %.15f, rel_error = %.15g, thresh = %.15g \n", itt, dut, ref, rel_error, thresh);
+        }
+
+        if(rel_error > thresh)
+        {
+            printf("FAIL, test_rate_estimator_ratio(): itt %d: dut = %.15f. ref = %.15f, rel_error = %.15g, thresh = %.15g\n", itt, dut, ref, rel_error, thresh);
+            xassert(0);
+        }
+    }
+
+    // Exact ratios of the nominal rates
+    rate_estimate_t r48 = {48000, 100000000};
+    rate_estimate_t r441 = {44100, 100000000};
+    rate_estimate_t r192 = {192000, 100000000};
+    xassert(rate_estimator_ratio(r48, r48) == (uint64_t)1 << RATE_ESTIMATOR_RATIO_Q);
+    xassert(rate_estimator_ratio(r192, r48) == (uint64_t)4 << RATE_ESTIMATOR_RATIO_Q);
+    xassert(rate_estimator_ratio(r48, r192) == (uint64_t)1 << (RATE_ESTIMATOR_RATIO_Q - 2));
+    xassert(fabs(ldexp(rate_estimator_ratio(r441, r48), -RATE_ESTIMATOR_RATIO_Q) - 44100.0 / 48000) < ldexp(1, -50));
+
+    rate_estimate_t zero = {0, 0};
+    xassert(rate_estimator_ratio(zero, r48) == 0);
+    xassert(rate_estimator_ratio(r48, zero) == 0);
+}
+
+void test_rate_estimator_window(unsigned seed, bool verbose)
+{
+    // USB like updates: 48 +/- 1 samples every 1 ms, 16 buckets of 250 ms
+    const rate_estimator_config_t config = {
+        .nominal_rate = 48000,
+        .ticks_per_second = 100000000,
+        .n_buckets = 16,
+        .bucket_ticks = 25000000,
+        .bucket_updates = 0,
+        .outlier_shift = 0,
+        .max_outliers = 0,
+    };
+    static rate_estimator_t est;
+    static uint32_t samples[40000];
+    static uint32_t ticks[40000];
+    uint32_t n_updates = 0;
+    uint32_t bucket_start[RATE_ESTIMATOR_MAX_BUCKETS + 1];
+    uint32_t n_bucket_edges = 0;
+    uint32_t cur_ticks = 0;
+
+    rate_estimator_init(&est, &config);
+
+    rate_estimate_t rate = rate_estimator_get(&est);
+    xassert(rate.samples == 48000 && rate.ticks == 100000000);
+
+    bucket_start[n_bucket_edges++] = 0;
+    for(int i=0; i<40000; i++)
+    {
+        samples[i] = 48 + pseudo_rand_int(&seed, -1, 1);
+        ticks[i] = 100000 + pseudo_rand_int(&seed, -500, 500);
+        rate_estimator_add(&est, ticks[i], samples[i]);
+        n_updates++;
+
+        // Reference: keep track of where the buckets start and sum the window directly
+        cur_ticks += ticks[i];
+        if(cur_ticks >= config.bucket_ticks)
+        {
+            cur_ticks = 0;
+            if(n_bucket_edges == config.n_buckets + 1)
+            {
+                memmove(&bucket_start[0], &bucket_start[1], config.n_buckets * sizeof(uint32_t));
+                n_bucket_edges--;
+            }
+            bucket_start[n_bucket_edges++] = n_updates;
+        }
+
+        uint32_t ref_samples = 0;
+        uint32_t ref_ticks = 0;
+        for(uint32_t j=bucket_start[0]; j<n_updates; j++)
+        {
+            ref_samples += samples[j];
+            ref_ticks += ticks[j];
+        }
+
+        rate = rate_estimator_get(&est);
+        if(verbose && (i % 1000 == 0))
+        {
+            printf("rate_estimator window: update %d: %lu/%lu, ref %lu/%lu\n", i, (unsigned long)rate.samples, (unsigned long)rate.ticks, (unsigned long)ref_samples, (unsigned long)ref_ticks);
+        }
+        if((rate.samples != ref_samples) || (rate.ticks != ref_ticks))
+        {
+            printf("FAIL, test_rate_estimator_window(): update %d: %lu/%lu, ref %lu/%lu\n", i, (unsigned long)rate.samples, (unsigned long)rate.ticks, (unsigned long)ref_samples, (unsigned long)ref_ticks);
+            xassert(0);
+        }
+    }
+
+    // Bucket closing on the update count
+    rate_estimator_config_t count_config = config;
+    count_config.bucket_ticks = 0;
+    count_config.bucket_updates = 4;
+    count_config.n_buckets = 2;
+    rate_estimator_init(&est, &count_config);
+    for(int i=0; i<13; i++)
+    {
+        rate_estimator_add(&est, 1000, i);
+    }
+    // The buckets of updates 4..7 and 8..11 and the one being filled with update 12 are left,
+    // the one of updates 0..3 has been dropped
+    rate = rate_estimator_get(&est);
+    xassert(rate.samples == (4+5+6+7+8+9+10+11+12) && rate.ticks == 9000);
+}
+
+void test_rate_estimator_outliers(unsigned seed, bool verbose)
+{
+    // SOF timestamped USB packets with a late timestamp now and then
+    const rate_estimator_config_t config = {
+        .nominal_rate = 48000,
+        .ticks_per_second = 100000000,
+        .n_buckets = 64,
+        .bucket_ticks = 25000000,
+        .bucket_updates = 0,
+        .outlier_shift = 3,
+        .max_outliers = 8,
+    };
+    static rate_estimator_t est;
+    static rate_estimator_t est_no_rejection;
+    const double actual_rate = 48000 * (1 + 37e-6); // Host clock off by 37ppm
+    const double ticks_per_sample = 100000000 / actual_rate;
+    double t = 0;
+    uint32_t total_samples = 0;
+
+    rate_estimator_init(&est, &config);
+    rate_estimator_config_t no_rejection_config = config;
+    no_rejection_config.outlier_shift = 0;
+    rate_estimator_init(&est_no_rejection, &no_rejection_config);
+
+    for(int i=0; i<60000; i++)
+    {
+        uint32_t n = 48;
+        t += n * ticks_per_sample;
+        total_samples += n;
+
+        // The timer wraps after about 43 s, which is within this run
+        uint32_t timestamp = (uint32_t)(uint64_t)t;
+        // Always late at the end, which is a window edge
+        if((pseudo_rand_uint(&seed, 0, 100) < 5) || (i == 60000 - 1))
+        {
+            timestamp += pseudo_rand_uint(&seed, 20000, 60000); // Serviced 200 to 600 us late
+        }
+        rate_estimator_add_timestamp(&est, timestamp, n);
+        rate_estimator_add_timestamp(&est_no_rejection, timestamp, n);
+    }
+
+    rate_estimate_t rate = rate_estimator_get(&est);
+    rate_estimate_t rate_no_rejection = rate_estimator_get(&est_no_rejection);
+    double measured = (double)rate.samples * 100000000 / rate.ticks;
+    double measured_no_rejection = (double)rate_no_rejection.samples * 100000000 / rate_no_rejection.ticks;
+    double error_ppm = 1e6 * fabs(measured - actual_rate) / actual_rate;
+    double error_no_rejection_ppm = 1e6 * fabs(measured_no_rejection - actual_rate) / actual_rate;
+
+    if(verbose)
+    {
+        printf("rate_estimator outliers: %.6f Hz (%.3f ppm off), %lu held back. Without rejection %.6f Hz (%.3f ppm off)\n",
+               measured, error_ppm, (unsigned long)est.total_outliers, measured_no_rejection, error_no_rejection_ppm);
+    }
+
+    xassert(est.total_outliers > 0);
+    xassert(error_no_rejection_ppm > 10);
+    if(error_ppm > 0.1)
+    {
+        printf("FAIL, test_rate_estimator_outliers(): %.6f Hz, %.3f ppm off\n", measured, error_ppm);
+        xassert(0);
+    }
+
+    // Updates far from the nominal rate are still counted, max_outliers + 1 at a time
+    rate_estimator_init(&est, &config);
+    for(int i=0; i<100; i++)
+    {
+        rate_estimator_add(&est, 100000, 48);
+    }
+    for(int i=0; i<100; i++)
+    {
+        rate_estimator_add(&est, 100000, 64);
+    }
+    rate = rate_estimator_get(&est);
+    xassert(est.pending_samples <= config.max_outliers * 64);
+    xassert(rate.samples + est.pending_samples == 100*48 + 100*64);
+    xassert(rate.ticks + est.pending_ticks == 200*100000);
+}
+
+
+// Buffer level after running the loop for the given time, with the rate ratio estimate off by error_ppm
+static double run_pi_control_loop(pi_control_t *ctrl, uint32_t fs_in, uint32_t fs_out, uint32_t update_period_us, double error_ppm, double secs)
+{
+    const double one_q60 = (double)((uint64_t)1 << (28+32));
+    const double error_ratio = ((double)fs_in / fs_out) * error_ppm / 1e6;
+    const double plant_gain = ((double)fs_out * fs_out) / fs_in;
+    const double period = (double)update_period_us / 1e6;
+    double level = 0;
+
+    for(int i=0; i<(int)(secs / period); i++)
+    {
+        int32_t error = (int32_t)lround(level);
+        double correction = (double)pi_control_update(ctrl, error) / one_q60;
+        level -= (correction - error_ratio) * plant_gain * period;
+    }
+    return level;
+}
+
+void test_pi_control(unsigned seed, bool verbose)
+{
+    // USB -> I2S at 48000 -> 192000, updated every 16 blocks of 244 samples at the I2S rate
+    const uint32_t fs_in = 48000, fs_out = 192000;
+    const uint32_t update_period_us = (uint32_t)(((uint64_t)16 * 244 * 1000000) / fs_out);
+    pi_control_config_t config = {
+        .time_constant_ms = 10000,
+        .integral_time_ms = 40000,
+        .integrator_window = 0,
+        .max_correction_ppm = 6,
+    };
+    static pi_control_t ctrl;
+    (void)seed;
+
+    // No correction until the rates are known
+    pi_control_init(&ctrl, &config);
+    xassert(pi_control_update(&ctrl, 1000) == 0);
+
+    // The integral term removes the offset that P only control leaves
+    pi_control_set_rates(&ctrl, fs_in, fs_out, update_period_us);
+    double level = run_pi_control_loop(&ctrl, fs_in, fs_out, update_period_us, 4, 300);
+
+    pi_control_config_t p_config = config;
+    p_config.integral_time_ms = 0;
+    static pi_control_t p_ctrl;
+    pi_control_init(&p_ctrl, &p_config);
+    pi_control_set_rates(&p_ctrl, fs_in, fs_out, update_period_us);
+    double p_level = run_pi_control_loop(&p_ctrl, fs_in, fs_out, update_period_us, 4, 300);
+
+    if(verbose)
+    {
+        printf("pi_control: level %.2f with PI, %.2f with P only\n", level, p_level);
+    }
+    if((fabs(level) > 1) || (fabs(p_level) < 5))
+    {
+        printf("FAIL, test_pi_control(): level %.2f with PI, %.2f with P only\n", level, p_level);
+        xassert(0);
+    }
+
+    // The correction is limited, and the integral does not wind up while it is
+    int64_t max_correction = ctrl.max_correction;
+    pi_control_reset(&ctrl);
+    for(int i=0; i<10000; i++)
+    {
+        xassert(pi_control_update(&ctrl, 5000) == max_correction);
+    }
+    xassert(ctrl.ki * ctrl.integral <= max_correction);
+    int64_t correction = pi_control_update(&ctrl, -1);
+    xassert(correction < max_correction);
+
+    // A windowed integral only sums the last updates
+    config.integrator_window = 8;
+    pi_control_init(&ctrl, &config);
+    pi_control_set_rates(&ctrl, fs_in, fs_out, update_period_us);
+    for(int i=0; i<8; i++)
+    {
+        pi_control_update(&ctrl, 3);
+    }
+    xassert(ctrl.integral == 24);
+    for(int i=0; i<8; i++)
+    {
+        pi_control_update(&ctrl, 0);
+    }
+    xassert(ctrl.integral == 0);
+}
+
+
 int main(int argc, char *argv[])
 {
     unsigned seed = 123450;
@@ -111,5 +406,13 @@ int main(int argc, char *argv[])
 
     test_div_fixed_output_q_format(seed, verbose);
 
+    test_rate_estimator_ratio(seed, verbose);
+
+    test_rate_estimator_window(seed, verbose);
+
+    test_rate_estimator_outliers(seed, verbose);
+
+    test_pi_control(seed, verbose);
+
 
 }
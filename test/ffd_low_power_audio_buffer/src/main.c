@@ -1,4 +1,4 @@
-// Copyright 2023 XMOS LIMITED.
+// Copyright 2023-2024 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 /* System headers */
@@ -11,6 +11,7 @@
 #include "app_conf.h"
 #include "asr.h"
 #include "low_power_audio_buffer.h"
+#include "spsc_ring.h"
 
 #define XSTR(s)                     STR(s)
 #define STR(x)                      #x
@@ -50,60 +51,51 @@
     } while(0)
 
 #define TOTAL_SAMPLES       (appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES * appconfAUDIO_PIPELINE_FRAME_ADVANCE)
-#define LAST_SAMPLE_INDEX   (TOTAL_SAMPLES - 1)
-
-#ifndef ring_buffer_t
-typedef struct ring_buffer
-{
-    asr_sample_t * const buf;
-    const uint32_t size;
-    char *set_ptr;
-    char *get_ptr;
-    uint32_t count;
-    uint8_t full;
-    uint8_t empty;
-} ring_buffer_t;
-#endif
+#define RING_CAPACITY       SPSC_RING_POW2_CEIL(TOTAL_SAMPLES)
+#define LAST_SAMPLE_INDEX   (RING_CAPACITY - 1)
 
 /* Internal buffers/structs from unit under test */
 extern asr_sample_t sample_buf[];
-extern ring_buffer_t ring_buf;
+extern spsc_ring_t ring_buf;
 
 static uint32_t error_count = 0;
 static asr_sample_t samples[appconfAUDIO_PIPELINE_FRAME_ADVANCE];
 
-static uint8_t intent_engine_sample_push_skip_verify;
-static asr_sample_t *intent_engine_sample_push_expected_buf;
+static uint32_t intent_engine_sample_push_expected_index;
 static size_t intent_engine_sample_push_total_frames;
 static uint32_t intent_engine_sample_push_error_count;
 
-void setup_intent_engine_sample_push(char *expected_start_address)
+void setup_intent_engine_sample_push(uint32_t expected_start_index)
 {
-    // Catch potential issues in test logic.
-    assert((uint32_t)expected_start_address % sizeof(asr_sample_t) == 0);
-
-    intent_engine_sample_push_expected_buf = (asr_sample_t *)expected_start_address;
+    intent_engine_sample_push_expected_index = expected_start_index;
     intent_engine_sample_push_error_count = error_count;
-    intent_engine_sample_push_skip_verify = 1;
     intent_engine_sample_push_total_frames = 0;
 }
 
 void verify_intent_engine_sample_push_args(asr_sample_t *buf, size_t frames)
 {
-    const uint32_t tail_addr = ((uint32_t)ring_buf.buf + ring_buf.size);
+    uint32_t index = intent_engine_sample_push_expected_index;
 
-    if (intent_engine_sample_push_skip_verify)
+    // Only report the first bad push of a test case.
+    if (intent_engine_sample_push_error_count != error_count)
         return;
 
-    TEST_ASSERT_PTRS_ARE_EQUAL(intent_engine_sample_push_expected_buf, buf);
     TEST_ASSERT_LONGS_ARE_EQUAL((uint32_t)appconfAUDIO_PIPELINE_FRAME_ADVANCE, (uint32_t)frames);
-    intent_engine_sample_push_expected_buf += frames;
 
-    if ((uint32_t)intent_engine_sample_push_expected_buf >= tail_addr)
-        intent_engine_sample_push_expected_buf = ring_buf.buf;
+    // A frame that does not wrap around is pushed straight from the buffer.
+    if (index + frames <= RING_CAPACITY)
+        TEST_ASSERT_PTRS_ARE_EQUAL(&sample_buf[index], buf);
 
-    if (intent_engine_sample_push_error_count != error_count)
-        intent_engine_sample_push_skip_verify = 0;
+    // Each sample holds its own index, see init_sample_buffer().
+    for (size_t i = 0; i < frames; i++) {
+        TEST_ASSERT_INTS_ARE_EQUAL((asr_sample_t)index, buf[i]);
+        if (intent_engine_sample_push_error_count != error_count)
+            break;
+        index = (index + 1) % RING_CAPACITY;
+    }
+
+    intent_engine_sample_push_expected_index = index;
+    intent_engine_sample_push_total_frames++;
 }
 
 void verify_sample_buffer_state(uint32_t *starting_index,
@@ -113,7 +105,7 @@ void verify_sample_buffer_state(uint32_t *starting_index,
     uint32_t error_count_last = error_count;
 
     for (long i = 0; i < num_samples; i++) {
-        TEST_ASSERT_INTS_ARE_EQUAL(starting_value, sample_buf[(*starting_index)]);
+        TEST_ASSERT_INTS_ARE_EQUAL((asr_sample_t)starting_value, sample_buf[(*starting_index)]);
 
         if (error_count != error_count_last) {
             printf("    Index:    %ld\n", *starting_index);
@@ -121,11 +113,44 @@ void verify_sample_buffer_state(uint32_t *starting_index,
         }
 
         starting_value++;
-        if (++(*starting_index) >= TOTAL_SAMPLES)
+        if (++(*starting_index) >= RING_CAPACITY)
             (*starting_index) = 0;
     }
 }
 
+void verify_sample_buffer_unmodified(uint32_t starting_index, long num_samples)
+{
+    uint32_t error_count_last = error_count;
+
+    for (long i = 0; i < num_samples; i++) {
+        // Each sample holds its own index, see init_sample_buffer().
+        TEST_ASSERT_INTS_ARE_EQUAL((asr_sample_t)starting_index, sample_buf[starting_index]);
+
+        if (error_count != error_count_last) {
+            printf("    Index:    %ld\n", starting_index);
+            break;
+        }
+
+        if (++starting_index >= RING_CAPACITY)
+            starting_index = 0;
+    }
+}
+
+void verify_ring_buffer_state(uint32_t expected_count,
+                              uint32_t expected_write_index,
+                              uint32_t expected_read_index)
+{
+    uint8_t expected_full_state = (expected_count == TOTAL_SAMPLES);
+    uint8_t expected_empty_state = (expected_count == 0);
+    uint32_t count = spsc_ring_count(&ring_buf);
+
+    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, (count == TOTAL_SAMPLES));
+    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, (count == 0));
+    TEST_ASSERT_LONGS_ARE_EQUAL(expected_count, count);
+    TEST_ASSERT_LONGS_ARE_EQUAL(expected_write_index, ring_buf.head & ring_buf.mask);
+    TEST_ASSERT_LONGS_ARE_EQUAL(expected_read_index, ring_buf.tail & ring_buf.mask);
+}
+
 void fill_frames(size_t count, uint32_t starting_sample_value)
 {
     memset(samples, 0xFF, sizeof(samples));
@@ -136,331 +161,208 @@ void fill_frames(size_t count, uint32_t starting_sample_value)
     }
 }
 
+void enqueue_samples(uint32_t samples_to_enqueue, uint32_t sample_value)
+{
+    while (samples_to_enqueue > 0) {
+        uint32_t enqueue_samples = (samples_to_enqueue > appconfAUDIO_PIPELINE_FRAME_ADVANCE) ?
+            appconfAUDIO_PIPELINE_FRAME_ADVANCE :
+            samples_to_enqueue;
+
+        fill_frames(enqueue_samples, sample_value);
+        low_power_audio_buffer_enqueue(samples, enqueue_samples);
+        samples_to_enqueue -= enqueue_samples;
+        sample_value += enqueue_samples;
+    }
+}
+
 void init_sample_buffer(void)
 {
     // Set each sample value to its index. This helps with detecting
     // modification and interactions with the sample buffer.
-    for (size_t i = 0; i < ring_buf.size / sizeof(asr_sample_t); i++) {
+    for (size_t i = 0; i < RING_CAPACITY; i++) {
         sample_buf[i] = i;
     }
 }
 
-void set_ring_buffer_state(char *buffer_set_ptr,
-                           char *buffer_get_ptr,
-                           uint32_t buffer_count,
-                           uint8_t buffer_full,
-                           uint8_t buffer_empty)
+void set_ring_buffer_state(uint32_t read_index, uint32_t buffer_count)
 {
-    ring_buf.set_ptr = buffer_set_ptr;
-    ring_buf.get_ptr = buffer_get_ptr;
-    ring_buf.count = buffer_count;
-    ring_buf.full = buffer_full;
-    ring_buf.empty = buffer_empty;
+    ring_buf.tail = read_index;
+    ring_buf.head = read_index + buffer_count;
 }
 
 void reset_ring_buffer_state(void)
 {
-    set_ring_buffer_state((char *)sample_buf, (char *)sample_buf, 0, 0, 1);
+    set_ring_buffer_state(0, 0);
 }
 
 void verify_initial_buffer_state(void)
 {
-    uint32_t expected_buf_size = (uint32_t)(TOTAL_SAMPLES * sizeof(asr_sample_t));
-    uint8_t expected_full_state = 0;
-    uint8_t expected_empty_state = 1;
-    uint32_t expected_frame_count = 0;
-    char *expected_set_ptr = (char *)sample_buf;
-    char *expected_get_ptr = (char *)sample_buf;
-
     TEST_CASE_PRINTF();
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_buf_size, ring_buf.size);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    TEST_ASSERT_PTRS_ARE_EQUAL((uint8_t *)sample_buf, ring_buf.buf);
+    TEST_ASSERT_LONGS_ARE_EQUAL((uint32_t)sizeof(asr_sample_t), (uint32_t)ring_buf.elem_size);
+    TEST_ASSERT_LONGS_ARE_EQUAL((uint32_t)RING_CAPACITY, ring_buf.capacity);
+    verify_ring_buffer_state(0, 0, 0);
 }
 
-void verify_set_pointer_wraps_around(void)
+void verify_write_index_wraps_around(void)
 {
     const uint32_t starting_sample_value = TOTAL_SAMPLES;
-    const uint32_t sample_count = 0;
     uint32_t samples_to_enqueue = 1;
-    uint8_t expected_full_state = 0;
-    uint8_t expected_empty_state = 0;
-    uint32_t expected_frame_count = samples_to_enqueue;
-    char *expected_set_ptr = (char *)(sample_buf);
-    char *expected_get_ptr = (char *)(sample_buf);
     uint32_t starting_sample_index_to_verify = 0;
 
     TEST_CASE_PRINTF();
     init_sample_buffer(); // Reinitialize to decouple test cases.
     // Set the buffer to the tail of the buffer.
-    set_ring_buffer_state((char *)(sample_buf + LAST_SAMPLE_INDEX),
-                          expected_get_ptr,
-                          sample_count,
-                          expected_full_state,
-                          1);
+    set_ring_buffer_state(LAST_SAMPLE_INDEX, 0);
     fill_frames(samples_to_enqueue, starting_sample_value);
 
     low_power_audio_buffer_enqueue(samples, samples_to_enqueue);
 
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    verify_ring_buffer_state(samples_to_enqueue, 0, LAST_SAMPLE_INDEX);
 
     // Verify that only the samples enqueued have been modified.
-    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, TOTAL_SAMPLES - 1);
+    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, RING_CAPACITY - 1);
     verify_sample_buffer_state(&starting_sample_index_to_verify, starting_sample_value, samples_to_enqueue);
 }
 
-void verify_get_pointer_wraps_around(void)
+void verify_read_index_wraps_around(void)
 {
     uint32_t max_dequeue_frames = appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES;
     uint32_t sample_count = appconfAUDIO_PIPELINE_FRAME_ADVANCE;
-    uint8_t expected_full_state = 0;
-    uint8_t expected_empty_state = 1;
-    uint32_t expected_frame_count = 0;
-    uint32_t expected_frames_dequeued = sample_count;
-    char *expected_set_ptr = (char *)(sample_buf);
-    char *expected_get_ptr = (char *)(sample_buf);
-    char *expected_get_ptr_start = (char *)(sample_buf + LAST_SAMPLE_INDEX);
+    uint32_t expected_samples_dequeued = sample_count;
+    uint32_t expected_index = (LAST_SAMPLE_INDEX + sample_count) % RING_CAPACITY;
     uint32_t starting_sample_index_to_verify = 0;
 
     TEST_CASE_PRINTF();
     init_sample_buffer(); // Reinitialize to decouple test cases.
-    setup_intent_engine_sample_push(expected_get_ptr_start);
-    // Set the buffer to the tail of the buffer.
-    set_ring_buffer_state(expected_set_ptr,
-                          expected_get_ptr_start,
-                          sample_count,
-                          expected_full_state,
-                          0);
+    // Start the frame on the last sample of the buffer.
+    setup_intent_engine_sample_push(LAST_SAMPLE_INDEX);
+    set_ring_buffer_state(LAST_SAMPLE_INDEX, sample_count);
 
-    uint32_t frames_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
+    uint32_t samples_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
 
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frames_dequeued, frames_dequeued);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    verify_ring_buffer_state(0, expected_index, expected_index);
+    TEST_ASSERT_LONGS_ARE_EQUAL(expected_samples_dequeued, samples_dequeued);
+    TEST_ASSERT_LONGS_ARE_EQUAL((size_t)1, intent_engine_sample_push_total_frames);
 
     // No samples in buffer should have been modified.
-    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, TOTAL_SAMPLES);
+    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, RING_CAPACITY);
 }
 
 void verify_enqueuing_samples_less_than_buffer_capacity_remains_not_full(uint32_t samples_to_enqueue)
 {
-    uint32_t starting_sample_value = TOTAL_SAMPLES;
-    uint8_t expected_full_state = 0;
-    uint8_t expected_empty_state = 0;
-    uint32_t expected_frame_count = samples_to_enqueue;
-    char *expected_set_ptr = (char *)(sample_buf + samples_to_enqueue);
-    char *expected_get_ptr = (char *)(sample_buf);
+    uint32_t starting_sample_value = RING_CAPACITY;
+    uint32_t expected_count = samples_to_enqueue;
     uint32_t starting_sample_index_to_verify = 0;
-    uint32_t sample_value = starting_sample_value;
 
     TEST_CASE_PRINTF(": Enqueuing %ld sample(s).", samples_to_enqueue);
     init_sample_buffer(); // Reinitialize to decouple test cases.
     reset_ring_buffer_state();
 
-    while (samples_to_enqueue > 0) {
-        uint32_t enqueue_samples = (samples_to_enqueue > appconfAUDIO_PIPELINE_FRAME_ADVANCE) ?
-            appconfAUDIO_PIPELINE_FRAME_ADVANCE :
-            samples_to_enqueue;
-
-        fill_frames(enqueue_samples, sample_value);
-        low_power_audio_buffer_enqueue(samples, enqueue_samples);
-        samples_to_enqueue -= enqueue_samples;
-        sample_value += enqueue_samples;
-    }
+    enqueue_samples(samples_to_enqueue, starting_sample_value);
 
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    verify_ring_buffer_state(expected_count, samples_to_enqueue, 0);
 
     // Verify that only the samples enqueued have been modified.
-    verify_sample_buffer_state(&starting_sample_index_to_verify, starting_sample_value, expected_frame_count);
-    verify_sample_buffer_state(&starting_sample_index_to_verify, starting_sample_index_to_verify, TOTAL_SAMPLES - expected_frame_count);
+    verify_sample_buffer_state(&starting_sample_index_to_verify, starting_sample_value, expected_count);
+    verify_sample_buffer_unmodified(starting_sample_index_to_verify, RING_CAPACITY - expected_count);
 }
 
 void verify_enqueueing_samples_equal_to_buffer_capacity_reports_full(uint32_t frame_index)
 {
-    const uint32_t init_buf_count = 0;
-    const uint32_t init_buf_full_state = 0;
-    const uint32_t init_buf_empty_state = 1;
-    const uint32_t starting_sample_value = TOTAL_SAMPLES;
+    const uint32_t starting_sample_value = RING_CAPACITY;
     uint32_t samples_to_enqueue = TOTAL_SAMPLES;
-    uint8_t expected_full_state = 1;
-    uint8_t expected_empty_state = 0;
-    uint32_t expected_frame_count = samples_to_enqueue;
-    char *expected_set_ptr = (char *)(sample_buf + frame_index);
-    char *expected_get_ptr = (char *)(sample_buf + frame_index); // When full, the get pointer moves with the set pointer.
+    uint32_t expected_count = samples_to_enqueue;
+    uint32_t expected_write_index = (frame_index + samples_to_enqueue) % RING_CAPACITY;
     uint32_t starting_sample_index_to_verify = frame_index;
-    uint32_t sample_value = starting_sample_value;
 
     TEST_CASE_PRINTF(": Enqueuing %ld sample(s) at sample index %ld.",
                      samples_to_enqueue, frame_index);
     init_sample_buffer(); // Reinitialize to decouple test cases.
-    set_ring_buffer_state(expected_set_ptr,
-                          expected_get_ptr,
-                          init_buf_count,
-                          init_buf_full_state,
-                          init_buf_empty_state);
+    set_ring_buffer_state(frame_index, 0);
 
-    while (samples_to_enqueue > 0) {
-        uint32_t enqueue_samples = (samples_to_enqueue > appconfAUDIO_PIPELINE_FRAME_ADVANCE) ?
-            appconfAUDIO_PIPELINE_FRAME_ADVANCE :
-            samples_to_enqueue;
-
-        fill_frames(enqueue_samples, sample_value);
-        low_power_audio_buffer_enqueue(samples, enqueue_samples);
-        samples_to_enqueue -= enqueue_samples;
-        sample_value += enqueue_samples;
-    }
+    enqueue_samples(samples_to_enqueue, starting_sample_value);
 
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    verify_ring_buffer_state(expected_count, expected_write_index, frame_index);
 
-    // Verify that the samples enqueued have been modified.
-    verify_sample_buffer_state(&starting_sample_index_to_verify, starting_sample_value, expected_frame_count);
+    // Verify that the samples enqueued have been modified, and nothing else.
+    verify_sample_buffer_state(&starting_sample_index_to_verify, starting_sample_value, expected_count);
+    verify_sample_buffer_unmodified(starting_sample_index_to_verify, RING_CAPACITY - expected_count);
 }
 
 void verify_enqueue_samples_greater_than_buf_capacity_overwrites_oldest(uint32_t frame_index)
 {
-    const uint32_t init_buf_count = 0;
-    const uint32_t init_buf_full_state = 0;
-    const uint32_t init_buf_empty_state = 1;
-    const uint32_t starting_sample_value = TOTAL_SAMPLES;
-    char *init_set_ptr = (char *)(sample_buf + frame_index);
-    char *init_get_ptr = (char *)(sample_buf + frame_index);
+    const uint32_t starting_sample_value = RING_CAPACITY;
     uint32_t samples_to_enqueue = TOTAL_SAMPLES + 1;
-    uint8_t expected_full_state = 1;
-    uint8_t expected_empty_state = 0;
-    uint32_t expected_frame_count = TOTAL_SAMPLES;
-    char *expected_set_ptr = (char *)(sample_buf + ((frame_index + 1) % TOTAL_SAMPLES));
-    char *expected_get_ptr = (char *)(sample_buf + ((frame_index + 1) % TOTAL_SAMPLES)); // When full, the get pointer moves with the set pointer.
-    uint32_t starting_sample_index_to_verify = (frame_index + 1) % TOTAL_SAMPLES;
-    uint32_t sample_value = starting_sample_value;
+    uint32_t expected_count = TOTAL_SAMPLES;
+    uint32_t expected_write_index = (frame_index + samples_to_enqueue) % RING_CAPACITY;
+    uint32_t expected_read_index = (frame_index + 1) % RING_CAPACITY; // The oldest sample is dropped.
+    uint32_t starting_sample_index_to_verify = expected_read_index;
 
     TEST_CASE_PRINTF(": Enqueuing %ld sample(s) at sample index %ld.",
                      samples_to_enqueue, frame_index);
     init_sample_buffer(); // Reinitialize to decouple test cases.
-    set_ring_buffer_state(init_set_ptr,
-                          init_get_ptr,
-                          init_buf_count,
-                          init_buf_full_state,
-                          init_buf_empty_state);
+    set_ring_buffer_state(frame_index, 0);
 
-    while (samples_to_enqueue > 0) {
-        uint32_t enqueue_samples = (samples_to_enqueue > appconfAUDIO_PIPELINE_FRAME_ADVANCE) ?
-            appconfAUDIO_PIPELINE_FRAME_ADVANCE :
-            samples_to_enqueue;
+    enqueue_samples(samples_to_enqueue, starting_sample_value);
 
-        fill_frames(enqueue_samples, sample_value);
-        low_power_audio_buffer_enqueue(samples, enqueue_samples);
-        samples_to_enqueue -= enqueue_samples;
-        sample_value += enqueue_samples;
-    }
-
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    verify_ring_buffer_state(expected_count, expected_write_index, expected_read_index);
 
-    /* Verify the enqueued samples. The first sample enqueued should have been
-     * overwritten, meaning it has the largest value in the sequence and should
-     * be the last value to verify. */
+    /* Verify the buffered samples. The first sample enqueued should have been
+     * dropped, so the buffer starts with the second one. */
     verify_sample_buffer_state(&starting_sample_index_to_verify, starting_sample_value + 1, TOTAL_SAMPLES);
 }
 
 void verify_dequeuing_empty_buffer_does_not_output_samples(void)
 {
     uint32_t max_dequeue_frames = 1;
-    uint8_t expected_full_state = 0;
-    uint8_t expected_empty_state = 1;
-    uint32_t expected_frames_dequeued = 0;
-    uint32_t expected_frame_count = 0;
-    char *expected_set_ptr = (char *)sample_buf;
-    char *expected_get_ptr = (char *)sample_buf;
-    char *expected_get_ptr_start = (char *)sample_buf;
+    uint32_t expected_samples_dequeued = 0;
     uint32_t starting_sample_index_to_verify = 0;
 
     TEST_CASE_PRINTF();
     init_sample_buffer(); // Reinitialize to decouple test cases.
-    setup_intent_engine_sample_push(expected_get_ptr_start);
+    setup_intent_engine_sample_push(0);
     reset_ring_buffer_state();
 
-    uint32_t frames_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
+    uint32_t samples_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
 
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frames_dequeued, frames_dequeued);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    verify_ring_buffer_state(0, 0, 0);
+    TEST_ASSERT_LONGS_ARE_EQUAL(expected_samples_dequeued, samples_dequeued);
+    TEST_ASSERT_LONGS_ARE_EQUAL((size_t)0, intent_engine_sample_push_total_frames);
 
     // No samples in buffer should have been modified.
-    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, TOTAL_SAMPLES);
+    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, RING_CAPACITY);
 }
 
 void verify_dequeuing_non_full_frame_is_not_possible(uint32_t samples_to_enqueue)
 {
     const uint32_t max_dequeue_frames = appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES;
-    const uint8_t expected_full_state = 0;
-    const uint8_t expected_empty_state = 0;
-    const uint32_t expected_frames_dequeued = 0;
-    uint32_t expected_frame_count = samples_to_enqueue;
-    char *expected_set_ptr = (char *)(sample_buf + samples_to_enqueue);
-    char *expected_get_ptr = (char *)sample_buf;
-    char *expected_get_ptr_start = (char *)sample_buf;
+    const uint32_t expected_samples_dequeued = 0;
+    uint32_t expected_count = samples_to_enqueue;
     uint32_t starting_sample_index_to_verify = 0;
 
     TEST_CASE_PRINTF(": Dequeuing %ld enqueued sample(s).", samples_to_enqueue);
     init_sample_buffer(); // Reinitialize to decouple test cases.
-    setup_intent_engine_sample_push(expected_get_ptr_start);
-    set_ring_buffer_state(expected_set_ptr,
-                          expected_get_ptr,
-                          expected_frame_count,
-                          expected_full_state,
-                          expected_empty_state);
-
-    uint32_t frames_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
-
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frames_dequeued, frames_dequeued);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    setup_intent_engine_sample_push(0);
+    set_ring_buffer_state(0, expected_count);
+
+    uint32_t samples_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
+
+    verify_ring_buffer_state(expected_count, samples_to_enqueue, 0);
+    TEST_ASSERT_LONGS_ARE_EQUAL(expected_samples_dequeued, samples_dequeued);
+    TEST_ASSERT_LONGS_ARE_EQUAL((size_t)0, intent_engine_sample_push_total_frames);
 
     // No samples in buffer should have been modified.
-    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, TOTAL_SAMPLES);
+    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, RING_CAPACITY);
 }
 
 void verify_dequeuing_partially_reports_not_empty(uint32_t frame_index)
 {
-    const uint32_t init_buf_full_state = 1;
-    const uint32_t init_buf_empty_state = 0;
-    const uint32_t init_buf_count = TOTAL_SAMPLES;
     uint32_t max_dequeue_frames = appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES - 1;
-    uint8_t expected_full_state = 0;
-    uint8_t expected_empty_state = 0;
-    uint32_t expected_frame_count = appconfAUDIO_PIPELINE_FRAME_ADVANCE;
-    uint32_t expected_frames_dequeued = max_dequeue_frames * appconfAUDIO_PIPELINE_FRAME_ADVANCE;
-    char *expected_set_ptr = (char *)(sample_buf + frame_index);
-    char *expected_get_ptr = (char *)(sample_buf + (
-        (frame_index + max_dequeue_frames * appconfAUDIO_PIPELINE_FRAME_ADVANCE) % TOTAL_SAMPLES));
-    char *expected_get_ptr_start = (char *)(sample_buf + frame_index);
+    uint32_t expected_count = appconfAUDIO_PIPELINE_FRAME_ADVANCE;
+    uint32_t expected_samples_dequeued = max_dequeue_frames * appconfAUDIO_PIPELINE_FRAME_ADVANCE;
+    uint32_t expected_write_index = (frame_index + TOTAL_SAMPLES) % RING_CAPACITY;
+    uint32_t expected_read_index = (frame_index + expected_samples_dequeued) % RING_CAPACITY;
     uint32_t starting_sample_index_to_verify = 0;
 
     TEST_CASE_PRINTF(": Dequeuing %ld of the %d enqueued frames at sample index %ld.",
@@ -468,65 +370,41 @@ void verify_dequeuing_partially_reports_not_empty(uint32_t frame_index)
                      appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES,
                      frame_index);
     init_sample_buffer(); // Reinitialize to decouple test cases.
-    setup_intent_engine_sample_push(expected_get_ptr_start);
-    set_ring_buffer_state(expected_set_ptr,
-                          expected_get_ptr_start,
-                          init_buf_count,
-                          init_buf_full_state,
-                          init_buf_empty_state);
-
-    uint32_t frames_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
-
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frames_dequeued, frames_dequeued);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    setup_intent_engine_sample_push(frame_index);
+    set_ring_buffer_state(frame_index, TOTAL_SAMPLES);
+
+    uint32_t samples_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
+
+    verify_ring_buffer_state(expected_count, expected_write_index, expected_read_index);
+    TEST_ASSERT_LONGS_ARE_EQUAL(expected_samples_dequeued, samples_dequeued);
+    TEST_ASSERT_LONGS_ARE_EQUAL((size_t)max_dequeue_frames, intent_engine_sample_push_total_frames);
 
     // No samples in buffer should have been modified.
-    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, TOTAL_SAMPLES);
+    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, RING_CAPACITY);
 }
 
 void verify_dequeuing_all_frames_reports_empty(uint32_t frame_index)
 {
-    const uint32_t init_buf_full_state = 1;
-    const uint32_t init_buf_empty_state = 0;
-    const uint32_t init_buf_count = TOTAL_SAMPLES;
     uint32_t max_dequeue_frames = appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES;
-    uint8_t expected_full_state = 0;
-    uint8_t expected_empty_state = 1;
-    uint32_t expected_frame_count = 0;
-    uint32_t expected_frames_dequeued = max_dequeue_frames * appconfAUDIO_PIPELINE_FRAME_ADVANCE;
-    char *expected_set_ptr = (char *)(sample_buf + frame_index);
-    char *expected_get_ptr = (char *)(sample_buf + (
-        (frame_index + max_dequeue_frames * appconfAUDIO_PIPELINE_FRAME_ADVANCE) %
-        (TOTAL_SAMPLES)));
-    char *expected_get_ptr_start = (char *)(sample_buf + frame_index);
+    uint32_t expected_samples_dequeued = max_dequeue_frames * appconfAUDIO_PIPELINE_FRAME_ADVANCE;
+    uint32_t expected_index = (frame_index + expected_samples_dequeued) % RING_CAPACITY;
     uint32_t starting_sample_index_to_verify = 0;
 
     TEST_CASE_PRINTF(": Dequeuing all %ld enqueued frames at sample index %ld.",
                      max_dequeue_frames,
                      frame_index);
     init_sample_buffer(); // Reinitialize to decouple test cases.
-    setup_intent_engine_sample_push(expected_get_ptr_start);
-    set_ring_buffer_state(expected_set_ptr,
-                          expected_get_ptr_start,
-                          init_buf_count,
-                          init_buf_full_state,
-                          init_buf_empty_state);
-
-    uint32_t frames_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
-
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_full_state, ring_buf.full);
-    TEST_ASSERT_INTS_ARE_EQUAL(expected_empty_state, ring_buf.empty);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frame_count, ring_buf.count);
-    TEST_ASSERT_LONGS_ARE_EQUAL(expected_frames_dequeued, frames_dequeued);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_set_ptr, ring_buf.set_ptr);
-    TEST_ASSERT_PTRS_ARE_EQUAL(expected_get_ptr, ring_buf.get_ptr);
+    setup_intent_engine_sample_push(frame_index);
+    set_ring_buffer_state(frame_index, TOTAL_SAMPLES);
+
+    uint32_t samples_dequeued = low_power_audio_buffer_dequeue(max_dequeue_frames);
+
+    verify_ring_buffer_state(0, expected_index, expected_index);
+    TEST_ASSERT_LONGS_ARE_EQUAL(expected_samples_dequeued, samples_dequeued);
+    TEST_ASSERT_LONGS_ARE_EQUAL((size_t)max_dequeue_frames, intent_engine_sample_push_total_frames);
 
     // No samples in buffer should have been modified.
-    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, TOTAL_SAMPLES);
+    verify_sample_buffer_state(&starting_sample_index_to_verify, 0, RING_CAPACITY);
 }
 
 int main(void)
@@ -534,6 +412,7 @@ int main(void)
     TEST_PRINTF("CONFIGURATION:\n");
     TEST_PRINTF("- Frame Size (Samples): %d\n", appconfAUDIO_PIPELINE_FRAME_ADVANCE);
     TEST_PRINTF("- Buffer Size (Frames): %d\n", appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES);
+    TEST_PRINTF("- Ring Capacity (Samples): %d\n", RING_CAPACITY);
     TEST_PRINTF("- Sample Buffer Address: %p\n\n", sample_buf);
 
     /*
@@ -543,11 +422,12 @@ int main(void)
     verify_initial_buffer_state();
 
     /*
-     * The set/get pointers are to wrap around when they reach the tail of the
-     * internal buffer.
+     * The write/read indices are to wrap around when they reach the tail of
+     * the internal buffer. A frame that straddles the tail is still pushed
+     * whole.
      */
-    verify_set_pointer_wraps_around();
-    verify_get_pointer_wraps_around();
+    verify_write_index_wraps_around();
+    verify_read_index_wraps_around();
 
     /*
      * Enqueuing at least one sample results in the buffer no longer being empty.
@@ -568,15 +448,17 @@ int main(void)
     verify_enqueueing_samples_equal_to_buffer_capacity_reports_full(appconfAUDIO_PIPELINE_FRAME_ADVANCE);
     verify_enqueueing_samples_equal_to_buffer_capacity_reports_full(appconfAUDIO_PIPELINE_FRAME_ADVANCE * appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES - 2);
     verify_enqueueing_samples_equal_to_buffer_capacity_reports_full(appconfAUDIO_PIPELINE_FRAME_ADVANCE * appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES - 1);
+    verify_enqueueing_samples_equal_to_buffer_capacity_reports_full(LAST_SAMPLE_INDEX);
 
     /*
      * The oldest samples in the queue are lost when ring buffer is full and new
-     * data is written. Additionally, the get_ptr should follow the set_ptr
-     * while in the full-state.
+     * data is written. Additionally, the read index should follow the write
+     * index while in the full-state.
      */
     verify_enqueue_samples_greater_than_buf_capacity_overwrites_oldest(0);
     verify_enqueue_samples_greater_than_buf_capacity_overwrites_oldest(1);
     verify_enqueue_samples_greater_than_buf_capacity_overwrites_oldest(appconfAUDIO_PIPELINE_FRAME_ADVANCE * appconfAUDIO_PIPELINE_BUFFER_NUM_FRAMES - 1);
+    verify_enqueue_samples_greater_than_buf_capacity_overwrites_oldest(LAST_SAMPLE_INDEX);
 
     /*
      * If the buffer is empty, no sample data should be released/reported by
@@ -0,0 +1,53 @@
+## Host build of the ADEC reference pipeline, for profiling and A/B testing
+## DSP changes without hardware.
+
+set(PIPELINE_BENCHMARK_AP_PATH ${CMAKE_CURRENT_LIST_DIR}/../../modules/audio_pipelines/reference)
+
+set(CMAKE_OSX_ARCHITECTURES "" CACHE INTERNAL "")
+
+add_executable(pipeline_benchmark_adec
+    ${CMAKE_CURRENT_LIST_DIR}/src/main.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/wav_file.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/shim/host_os_shim.c
+    ${PIPELINE_BENCHMARK_AP_PATH}/adec/audio_pipeline_t0.c
+    ${PIPELINE_BENCHMARK_AP_PATH}/adec/audio_pipeline_t1.c
+    ${PIPELINE_BENCHMARK_AP_PATH}/adec/stage1/delay_buffer.c
+    ${PIPELINE_BENCHMARK_AP_PATH}/adec/stage1/stage_1.c
+    ${PIPELINE_BENCHMARK_AP_PATH}/adec/aec/aec_process_frame_1thread.c
+    ${PIPELINE_BENCHMARK_AP_PATH}/frame_pool.c
+    ${PIPELINE_BENCHMARK_AP_PATH}/audio_pipeline_wire.c
+    ${PIPELINE_BENCHMARK_AP_PATH}/../stage_stats/stage_stats.c
+)
+
+## Both tiles are linked into the one executable
+set_source_files_properties(${PIPELINE_BENCHMARK_AP_PATH}/adec/audio_pipeline_t0.c
+    PROPERTIES COMPILE_DEFINITIONS "audio_pipeline_init=audio_pipeline_init_tile0;audio_pipeline_frame_pool_stats=audio_pipeline_frame_pool_stats_tile0")
+set_source_files_properties(${PIPELINE_BENCHMARK_AP_PATH}/adec/audio_pipeline_t1.c
+    PROPERTIES COMPILE_DEFINITIONS "audio_pipeline_init=audio_pipeline_init_tile1;audio_pipeline_frame_pool_stats=audio_pipeline_frame_pool_stats_tile1")
+
+target_include_directories(pipeline_benchmark_adec
+    PRIVATE
+        ${CMAKE_CURRENT_LIST_DIR}/src
+        ${CMAKE_CURRENT_LIST_DIR}/src/shim
+        ${PIPELINE_BENCHMARK_AP_PATH}
+        ${PIPELINE_BENCHMARK_AP_PATH}/adec
+        ${PIPELINE_BENCHMARK_AP_PATH}/adec/aec
+        ${PIPELINE_BENCHMARK_AP_PATH}/adec/stage1
+        ${PIPELINE_BENCHMARK_AP_PATH}/../stage_stats
+        ${PIPELINE_BENCHMARK_AP_PATH}/../subframe
+)
+
+target_compile_options(pipeline_benchmark_adec PRIVATE -O2 -g)
+
+target_link_libraries(pipeline_benchmark_adec
+    PRIVATE
+        fwk_voice::adec
+        fwk_voice::aec
+        fwk_voice::agc
+        fwk_voice::ic
+        fwk_voice::ns
+        fwk_voice::vnr::features
+        fwk_voice::vnr::inference
+        lib_xcore_math
+        m
+)
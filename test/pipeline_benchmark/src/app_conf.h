@@ -0,0 +1,46 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef APP_CONF_H_
+#define APP_CONF_H_
+
+/* Intertile port settings */
+#define appconfAUDIOPIPELINE_PORT               0
+
+/* Application tile specifiers */
+#include "platform/driver_instances.h"
+
+/* Audio Pipeline Configuration */
+#define appconfAUDIO_PIPELINE_SAMPLE_RATE       16000
+#define appconfAUDIO_PIPELINE_CHANNELS          2
+#ifndef appconfAUDIO_PIPELINE_FRAME_ADVANCE
+#define appconfAUDIO_PIPELINE_FRAME_ADVANCE     240
+#endif
+
+#define appconfAUDIO_PIPELINE_INPUT_CHANNELS    4
+#define appconfAUDIO_PIPELINE_OUTPUT_CHANNELS   2
+
+#ifndef appconfAUDIO_PIPELINE_SKIP_STATIC_DELAY
+#define appconfAUDIO_PIPELINE_SKIP_STATIC_DELAY  0
+#endif
+
+#ifndef appconfAUDIO_PIPELINE_SKIP_AEC
+#define appconfAUDIO_PIPELINE_SKIP_AEC           0
+#endif
+
+#ifndef appconfAUDIO_PIPELINE_SKIP_IC_AND_VNR
+#define appconfAUDIO_PIPELINE_SKIP_IC_AND_VNR    0
+#endif
+
+#ifndef appconfAUDIO_PIPELINE_SKIP_NS
+#define appconfAUDIO_PIPELINE_SKIP_NS            0
+#endif
+
+#ifndef appconfAUDIO_PIPELINE_SKIP_AGC
+#define appconfAUDIO_PIPELINE_SKIP_AGC           0
+#endif
+
+/* Task Priorities */
+#define appconfAUDIO_PIPELINE_TASK_PRIORITY     (configMAX_PRIORITIES - 1)
+
+#endif /* APP_CONF_H_ */
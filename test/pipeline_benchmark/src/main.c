@@ -0,0 +1,178 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/*
+ * Host benchmark for the ADEC reference audio pipeline.
+ *
+ * Both tiles of the pipeline are built natively against the OS shim in
+ * src/shim and run synchronously, one frame at a time, on a WAV file with the
+ * same channel layout as the pipeline test input.wav (ref 0, ref 1, mic 0,
+ * mic 1). The time spent in each stage is reported per frame along with the
+ * real time factor and the peak memory use of the process.
+ */
+
+/* STD headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/* FreeRTOS headers */
+#include "FreeRTOS.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "audio_pipeline.h"
+#include "audio_pipeline_subframe.h"
+#include "host_os_shim.h"
+#include "stage_stats.h"
+#include "wav_file.h"
+
+/* The pipeline sources are built with these names for the two tiles */
+void audio_pipeline_init_tile0(void *input_app_data, void *output_app_data);
+void audio_pipeline_init_tile1(void *input_app_data, void *output_app_data);
+void audio_pipeline_frame_pool_stats_tile0(frame_pool_stats_t *stats);
+void audio_pipeline_frame_pool_stats_tile1(frame_pool_stats_t *stats);
+
+typedef struct {
+    const char *tile;
+    const char *stage_names[HOST_PIPELINE_MAX_STAGES];
+} pipeline_desc_t;
+
+/* Listed in the order the tiles are initialised, see main() */
+static const pipeline_desc_t pipeline_desc[] = {
+    {"tile 1", {"stage_aec"}},
+    {"tile 0", {"stage_vnr_and_ic", "stage_ns", "stage_agc"}},
+};
+
+static wav_file_t input_wav;
+static wav_file_t output_wav;
+
+void audio_pipeline_input(void *input_app_data,
+                          int32_t **input_audio_frames,
+                          size_t ch_count,
+                          size_t frame_count)
+{
+    (void) input_app_data;
+    xassert(ch_count == appconfAUDIO_PIPELINE_INPUT_CHANNELS);
+
+    wav_file_read_planes(&input_wav, (int32_t *)input_audio_frames, frame_count);
+}
+
+int audio_pipeline_output(void *output_app_data,
+                          int32_t **output_audio_frames,
+                          size_t ch_count,
+                          size_t frame_count)
+{
+    (void) output_app_data;
+    (void) ch_count;
+
+    if (output_wav.fp != NULL) {
+        wav_file_write_planes(&output_wav, (int32_t *)output_audio_frames, frame_count);
+    }
+
+    return AUDIO_PIPELINE_FREE_FRAME;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s input.wav [output.wav]\n", name);
+    printf("  input.wav   %d channel, %d Hz, 16 or 32 bit PCM (ref 0, ref 1, mic 0, mic 1)\n",
+           appconfAUDIO_PIPELINE_INPUT_CHANNELS, appconfAUDIO_PIPELINE_SAMPLE_RATE);
+    printf("  output.wav  optional, %d channel 32 bit processed output\n",
+           appconfAUDIO_PIPELINE_OUTPUT_CHANNELS);
+}
+
+int main(int argc, char *argv[])
+{
+    const int tile_count = sizeof(pipeline_desc) / sizeof(pipeline_desc[0]);
+    unsigned long long stage_ns[HOST_PIPELINE_MAX_INSTANCES][HOST_PIPELINE_MAX_STAGES] = {{0}};
+    unsigned long long io_ns[HOST_PIPELINE_MAX_INSTANCES] = {0};
+    unsigned long long total_ns = 0;
+
+    if (argc < 2 || argc > 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (wav_file_open_read(&input_wav, argv[1]) != 0) {
+        printf("Error: unable to read %s\n", argv[1]);
+        return 1;
+    }
+    if (input_wav.num_channels != appconfAUDIO_PIPELINE_INPUT_CHANNELS ||
+        input_wav.sample_rate != appconfAUDIO_PIPELINE_SAMPLE_RATE) {
+        printf("Error: %s has %d channels at %d Hz\n", argv[1], input_wav.num_channels, input_wav.sample_rate);
+        usage(argv[0]);
+        return 1;
+    }
+    if (argc == 3 &&
+        wav_file_open_write(&output_wav, argv[2], appconfAUDIO_PIPELINE_OUTPUT_CHANNELS, appconfAUDIO_PIPELINE_SAMPLE_RATE) != 0) {
+        printf("Error: unable to create %s\n", argv[2]);
+        return 1;
+    }
+
+    /* Tile 1 feeds tile 0 over the intertile port */
+    audio_pipeline_init_tile1(NULL, NULL);
+    audio_pipeline_init_tile0(NULL, NULL);
+
+    /* Each run of the pipeline processes one block of AP_FRAME_ADVANCE samples */
+    const long frame_count = (input_wav.num_frames + AP_FRAME_ADVANCE - 1) / AP_FRAME_ADVANCE;
+
+    for (long f = 0; f < frame_count; f++) {
+        unsigned long long start = host_time_ns();
+        for (int t = 0; t < tile_count; t++) {
+            host_pipeline_run_frame(host_pipeline_get(t), stage_ns[t], &io_ns[t]);
+        }
+        total_ns += host_time_ns() - start;
+    }
+
+    wav_file_close(&output_wav);
+    wav_file_close(&input_wav);
+
+    if (frame_count == 0) {
+        printf("Error: %s contains no audio\n", argv[1]);
+        return 1;
+    }
+
+    const double audio_ns = (double)frame_count * AP_FRAME_ADVANCE * 1e9 / appconfAUDIO_PIPELINE_SAMPLE_RATE;
+    struct rusage usage_info;
+    getrusage(RUSAGE_SELF, &usage_info);
+
+    printf("Frames processed:      %ld (%d samples/frame, %d samples/subframe)\n",
+           frame_count, AP_FRAME_ADVANCE, appconfAUDIO_PIPELINE_FRAME_ADVANCE);
+    printf("\n%-8s %-20s %14s\n", "Tile", "Stage", "ns/frame");
+    for (int t = 0; t < tile_count; t++) {
+        host_pipeline_t *p = host_pipeline_get(t);
+        for (int s = 0; s < p->stage_count; s++) {
+            const char *name = pipeline_desc[t].stage_names[s] ? pipeline_desc[t].stage_names[s] : "?";
+            printf("%-8s %-20s %14.0f\n", pipeline_desc[t].tile, name, (double)stage_ns[t][s] / frame_count);
+        }
+        printf("%-8s %-20s %14.0f\n", pipeline_desc[t].tile, "input/output", (double)io_ns[t] / frame_count);
+    }
+    printf("%-8s %-20s %14.0f\n", "", "total", (double)total_ns / frame_count);
+
+    printf("\nReal time factor:      %.4f (%.1fx faster than real time)\n",
+           total_ns / audio_ns, audio_ns / total_ns);
+    printf("Frames per second:     %.1f\n", frame_count * 1e9 / total_ns);
+    printf("Peak pvPortMalloc:     %zu bytes\n", host_heap_peak_bytes());
+    printf("Peak resident memory:  %ld kB\n", usage_info.ru_maxrss);
+
+    frame_pool_stats_t pool_stats[2];
+    audio_pipeline_frame_pool_stats_tile0(&pool_stats[0]);
+    audio_pipeline_frame_pool_stats_tile1(&pool_stats[1]);
+    for (int t = 0; t < 2; t++) {
+        printf("Frame pool tile %d:     %u frames, high water %u, exhausted %u\n",
+               t, pool_stats[t].frame_count, pool_stats[t].high_water, pool_stats[t].exhausted);
+    }
+
+    /* Stage times as seen by the on-device stage statistics, in 100MHz ticks */
+    printf("\n%-20s %10s %10s %10s %10s %8s\n", "Stage", "min", "avg", "p99", "max", "misses");
+    for (int i = 0; i < stage_stats_count(); i++) {
+        stage_stats_summary_t summary;
+        stage_stats_get(i, &summary);
+        printf("%-20s %10u %10u %10u %10u %8u\n", summary.name, summary.min_ticks, summary.avg_ticks,
+               summary.p99_ticks, summary.max_ticks, summary.deadline_misses);
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_FREERTOS_H_
+#define HOST_SHIM_FREERTOS_H_
+
+/*
+ * Minimal stand-in for the FreeRTOS kernel headers so that the audio pipeline
+ * sources can be compiled natively on the host. Only the symbols referenced
+ * by the pipeline stage files are provided.
+ */
+
+/* STD headers */
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define configASSERT(x)             assert(x)
+#define xassert(x)                  assert(x)
+
+#define configSTACK_DEPTH_TYPE      size_t
+#define configMINIMAL_STACK_SIZE    (0)
+#define configMAX_PRIORITIES        (32)
+#define RTOS_THREAD_STACK_SIZE(x)   (0)
+
+#define portMAX_DELAY               (~(uint32_t)0)
+
+#ifndef DWORD_ALIGNED
+#define DWORD_ALIGNED               __attribute__((aligned(8)))
+#endif
+
+#define rtos_printf                 printf
+
+void *pvPortMalloc(size_t xSize);
+void vPortFree(void *pv);
+
+#endif /* HOST_SHIM_FREERTOS_H_ */
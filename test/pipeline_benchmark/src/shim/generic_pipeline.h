@@ -0,0 +1,30 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_GENERIC_PIPELINE_H_
+#define HOST_SHIM_GENERIC_PIPELINE_H_
+
+#include <stddef.h>
+
+typedef void * (*pipeline_input_t)(void *input_data);
+typedef int (*pipeline_output_t)(void *data, void *output_data);
+typedef void (*pipeline_stage_t)(void *data);
+
+/**
+ * Host version of generic_pipeline_init().
+ *
+ * Rather than creating a task per stage, the pipeline description is recorded
+ * so that the host driver can run the stages synchronously, see
+ * host_os_shim.h.
+ */
+void generic_pipeline_init(
+        const pipeline_input_t input,
+        const pipeline_output_t output,
+        void * const input_data,
+        void * const output_data,
+        const pipeline_stage_t * const stage_functions,
+        const size_t * const stage_stack_sizes,
+        const int pipeline_priority,
+        const int stage_count);
+
+#endif /* HOST_SHIM_GENERIC_PIPELINE_H_ */
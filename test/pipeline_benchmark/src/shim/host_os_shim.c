@@ -0,0 +1,206 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* FreeRTOS headers */
+#include "FreeRTOS.h"
+
+/* Library headers */
+#include "generic_pipeline.h"
+#include "xcore/hwtimer.h"
+
+/* App headers */
+#include "platform/driver_instances.h"
+#include "host_os_shim.h"
+
+#define INTERTILE_MAX_PORTS     (4)
+/* Same value as AUDIO_PIPELINE_FREE_FRAME */
+#define PIPELINE_FREE_FRAME     (1)
+
+typedef struct {
+    size_t size;
+    /* Keeps the payload 8 byte aligned, as the pipeline contexts require */
+    uint64_t payload[];
+} heap_block_t;
+
+typedef struct {
+    void *msg;
+    size_t len;
+} intertile_mailbox_t;
+
+static host_pipeline_t pipelines[HOST_PIPELINE_MAX_INSTANCES];
+static int pipeline_count;
+
+static intertile_mailbox_t mailboxes[INTERTILE_MAX_PORTS];
+static intertile_mailbox_t *rx_pending;
+
+static size_t heap_in_use;
+static size_t heap_peak;
+
+rtos_intertile_t *intertile_ctx = NULL;
+
+unsigned long long host_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+uint32_t get_reference_time(void)
+{
+    return (uint32_t)(host_time_ns() / 10);
+}
+
+void *pvPortMalloc(size_t xSize)
+{
+    heap_block_t *block = malloc(sizeof(heap_block_t) + xSize);
+    assert(block != NULL);
+
+    block->size = xSize;
+    heap_in_use += xSize;
+    if (heap_in_use > heap_peak) {
+        heap_peak = heap_in_use;
+    }
+    return block->payload;
+}
+
+void vPortFree(void *pv)
+{
+    if (pv == NULL) {
+        return;
+    }
+    heap_block_t *block = (heap_block_t *)((uint8_t *)pv - offsetof(heap_block_t, payload));
+    heap_in_use -= block->size;
+    free(block);
+}
+
+size_t host_heap_bytes_in_use(void)
+{
+    return heap_in_use;
+}
+
+size_t host_heap_peak_bytes(void)
+{
+    return heap_peak;
+}
+
+void generic_pipeline_init(
+        const pipeline_input_t input,
+        const pipeline_output_t output,
+        void * const input_data,
+        void * const output_data,
+        const pipeline_stage_t * const stage_functions,
+        const size_t * const stage_stack_sizes,
+        const int pipeline_priority,
+        const int stage_count)
+{
+    (void) stage_stack_sizes;
+    (void) pipeline_priority;
+
+    assert(pipeline_count < HOST_PIPELINE_MAX_INSTANCES);
+    assert(stage_count <= HOST_PIPELINE_MAX_STAGES);
+
+    host_pipeline_t *p = &pipelines[pipeline_count++];
+    p->input = input;
+    p->output = output;
+    p->input_data = input_data;
+    p->output_data = output_data;
+    p->stage_count = stage_count;
+    memcpy(p->stages, stage_functions, stage_count * sizeof(pipeline_stage_t));
+}
+
+host_pipeline_t *host_pipeline_get(int index)
+{
+    if (index < 0 || index >= pipeline_count) {
+        return NULL;
+    }
+    return &pipelines[index];
+}
+
+void host_pipeline_run_frame(host_pipeline_t *pipeline,
+                             unsigned long long *stage_ns,
+                             unsigned long long *io_ns)
+{
+    unsigned long long t0 = host_time_ns();
+    void *frame = pipeline->input(pipeline->input_data);
+    unsigned long long t1 = host_time_ns();
+
+    if (io_ns != NULL) {
+        *io_ns += t1 - t0;
+    }
+
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        t0 = host_time_ns();
+        pipeline->stages[i](frame);
+        t1 = host_time_ns();
+        if (stage_ns != NULL) {
+            stage_ns[i] += t1 - t0;
+        }
+    }
+
+    t0 = host_time_ns();
+    if (pipeline->output(frame, pipeline->output_data) == PIPELINE_FREE_FRAME) {
+        vPortFree(frame);
+    }
+    t1 = host_time_ns();
+
+    if (io_ns != NULL) {
+        *io_ns += t1 - t0;
+    }
+}
+
+/*
+ * Intertile transfers are synchronous on the host: the sender's message is
+ * copied into a per port mailbox which must be drained by the receiving
+ * pipeline before the next transfer on the same port.
+ */
+void rtos_intertile_tx(rtos_intertile_t *ctx,
+                       uint8_t port,
+                       void *msg,
+                       size_t len)
+{
+    (void) ctx;
+    assert(port < INTERTILE_MAX_PORTS);
+    assert(mailboxes[port].msg == NULL);
+
+    mailboxes[port].msg = malloc(len);
+    assert(mailboxes[port].msg != NULL);
+    memcpy(mailboxes[port].msg, msg, len);
+    mailboxes[port].len = len;
+}
+
+size_t rtos_intertile_rx_len(rtos_intertile_t *ctx,
+                             uint8_t port,
+                             unsigned timeout)
+{
+    (void) ctx;
+    (void) timeout;
+    assert(port < INTERTILE_MAX_PORTS);
+    assert(mailboxes[port].msg != NULL);
+
+    rx_pending = &mailboxes[port];
+    return rx_pending->len;
+}
+
+size_t rtos_intertile_rx_data(rtos_intertile_t *ctx,
+                              void *data,
+                              size_t len)
+{
+    (void) ctx;
+    assert(rx_pending != NULL);
+    assert(len <= rx_pending->len);
+
+    memcpy(data, rx_pending->msg, len);
+    free(rx_pending->msg);
+    rx_pending->msg = NULL;
+    rx_pending->len = 0;
+    rx_pending = NULL;
+
+    return len;
+}
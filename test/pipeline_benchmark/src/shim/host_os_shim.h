@@ -0,0 +1,51 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_OS_SHIM_H_
+#define HOST_OS_SHIM_H_
+
+/* STD headers */
+#include <stddef.h>
+
+/* Library headers */
+#include "generic_pipeline.h"
+
+#define HOST_PIPELINE_MAX_STAGES    (8)
+#define HOST_PIPELINE_MAX_INSTANCES (2)
+
+/**
+ * A pipeline as registered by generic_pipeline_init(). The host driver is
+ * responsible for calling input, each stage, then output for every frame.
+ */
+typedef struct {
+    pipeline_input_t input;
+    pipeline_output_t output;
+    void *input_data;
+    void *output_data;
+    pipeline_stage_t stages[HOST_PIPELINE_MAX_STAGES];
+    int stage_count;
+} host_pipeline_t;
+
+/**
+ * Returns the pipeline registered by the n-th call to
+ * generic_pipeline_init(), or NULL if there is none.
+ */
+host_pipeline_t *host_pipeline_get(int index);
+
+/**
+ * Runs one frame through a registered pipeline. If stage_ns is not NULL, the
+ * time spent in each stage is added to it, in nanoseconds. The input and
+ * output callbacks are accounted for in io_ns.
+ */
+void host_pipeline_run_frame(host_pipeline_t *pipeline,
+                             unsigned long long *stage_ns,
+                             unsigned long long *io_ns);
+
+/** Current and peak number of bytes allocated with pvPortMalloc() */
+size_t host_heap_bytes_in_use(void);
+size_t host_heap_peak_bytes(void);
+
+/** Monotonic time in nanoseconds */
+unsigned long long host_time_ns(void);
+
+#endif /* HOST_OS_SHIM_H_ */
@@ -0,0 +1,30 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_DRIVER_INSTANCES_H_
+#define HOST_SHIM_DRIVER_INSTANCES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Both tiles of the pipeline are built into the one host process */
+#define ON_TILE(t) (1)
+
+typedef struct rtos_intertile_struct rtos_intertile_t;
+
+extern rtos_intertile_t *intertile_ctx;
+
+void rtos_intertile_tx(rtos_intertile_t *ctx,
+                       uint8_t port,
+                       void *msg,
+                       size_t len);
+
+size_t rtos_intertile_rx_len(rtos_intertile_t *ctx,
+                             uint8_t port,
+                             unsigned timeout);
+
+size_t rtos_intertile_rx_data(rtos_intertile_t *ctx,
+                              void *data,
+                              size_t len);
+
+#endif /* HOST_SHIM_DRIVER_INSTANCES_H_ */
@@ -0,0 +1,10 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_STREAM_BUFFER_H_
+#define HOST_SHIM_STREAM_BUFFER_H_
+
+/* Nothing from this header is needed by the pipeline stages on the host */
+#include "FreeRTOS.h"
+
+#endif /* HOST_SHIM_STREAM_BUFFER_H_ */
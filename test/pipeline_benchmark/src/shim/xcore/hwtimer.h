@@ -0,0 +1,12 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef HOST_SHIM_XCORE_HWTIMER_H_
+#define HOST_SHIM_XCORE_HWTIMER_H_
+
+#include <stdint.h>
+
+/** Returns a free running 100MHz reference time, as on the xcore */
+uint32_t get_reference_time(void);
+
+#endif /* HOST_SHIM_XCORE_HWTIMER_H_ */
@@ -0,0 +1,171 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* STD headers */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* App headers */
+#include "wav_file.h"
+
+#define WAV_FORMAT_PCM          1
+#define WAV_FORMAT_EXTENSIBLE   0xFFFE
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void write_u32(FILE *fp, uint32_t v)
+{
+    uint8_t b[4] = {v & 0xFF, (v >> 8) & 0xFF, (v >> 16) & 0xFF, (v >> 24) & 0xFF};
+    fwrite(b, 1, sizeof(b), fp);
+}
+
+static void write_u16(FILE *fp, uint16_t v)
+{
+    uint8_t b[2] = {v & 0xFF, (v >> 8) & 0xFF};
+    fwrite(b, 1, sizeof(b), fp);
+}
+
+int wav_file_open_read(wav_file_t *wav, const char *path)
+{
+    uint8_t hdr[12];
+    int have_fmt = 0;
+
+    memset(wav, 0, sizeof(wav_file_t));
+    wav->fp = fopen(path, "rb");
+    if (wav->fp == NULL) {
+        return -1;
+    }
+
+    if (fread(hdr, 1, sizeof(hdr), wav->fp) != sizeof(hdr) ||
+        memcmp(hdr, "RIFF", 4) != 0 ||
+        memcmp(hdr + 8, "WAVE", 4) != 0) {
+        goto fail;
+    }
+
+    /* Walk the chunks until the data chunk is found */
+    for (;;) {
+        uint8_t chunk[8];
+        if (fread(chunk, 1, sizeof(chunk), wav->fp) != sizeof(chunk)) {
+            goto fail;
+        }
+        uint32_t chunk_size = read_u32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (chunk_size < sizeof(fmt) || fread(fmt, 1, sizeof(fmt), wav->fp) != sizeof(fmt)) {
+                goto fail;
+            }
+            uint16_t format = read_u16(fmt);
+            if (format != WAV_FORMAT_PCM && format != WAV_FORMAT_EXTENSIBLE) {
+                goto fail;
+            }
+            wav->num_channels = read_u16(fmt + 2);
+            wav->sample_rate = read_u32(fmt + 4);
+            wav->bit_depth = read_u16(fmt + 14);
+            have_fmt = 1;
+            fseek(wav->fp, (chunk_size - sizeof(fmt)) + (chunk_size & 1), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!have_fmt || (wav->bit_depth != 16 && wav->bit_depth != 32)) {
+                goto fail;
+            }
+            wav->data_start = ftell(wav->fp);
+            wav->num_frames = chunk_size / (wav->num_channels * (wav->bit_depth / 8));
+            return 0;
+        } else {
+            fseek(wav->fp, chunk_size + (chunk_size & 1), SEEK_CUR);
+        }
+    }
+
+fail:
+    fclose(wav->fp);
+    wav->fp = NULL;
+    return -1;
+}
+
+size_t wav_file_read_planes(wav_file_t *wav, int32_t *planes, size_t frame_count)
+{
+    const int bytes_per_sample = wav->bit_depth / 8;
+    const size_t frame_bytes = wav->num_channels * bytes_per_sample;
+    uint8_t *buf = malloc(frame_count * frame_bytes);
+    size_t frames_read = fread(buf, frame_bytes, frame_count, wav->fp);
+
+    for (size_t i = 0; i < frame_count; i++) {
+        for (int ch = 0; ch < wav->num_channels; ch++) {
+            int32_t s = 0;
+            if (i < frames_read) {
+                const uint8_t *p = buf + i * frame_bytes + ch * bytes_per_sample;
+                s = (bytes_per_sample == 2) ? (int32_t)((uint32_t)read_u16(p) << 16)
+                                            : (int32_t)read_u32(p);
+            }
+            planes[ch * frame_count + i] = s;
+        }
+    }
+
+    free(buf);
+    return frames_read;
+}
+
+int wav_file_open_write(wav_file_t *wav, const char *path, int num_channels, int sample_rate)
+{
+    memset(wav, 0, sizeof(wav_file_t));
+    wav->fp = fopen(path, "wb");
+    if (wav->fp == NULL) {
+        return -1;
+    }
+    wav->num_channels = num_channels;
+    wav->sample_rate = sample_rate;
+    wav->bit_depth = 32;
+    wav->writing = 1;
+
+    /* Header is rewritten with the final sizes on close */
+    uint8_t header[44] = {0};
+    fwrite(header, 1, sizeof(header), wav->fp);
+    wav->data_start = sizeof(header);
+    return 0;
+}
+
+void wav_file_write_planes(wav_file_t *wav, const int32_t *planes, size_t frame_count)
+{
+    for (size_t i = 0; i < frame_count; i++) {
+        for (int ch = 0; ch < wav->num_channels; ch++) {
+            write_u32(wav->fp, (uint32_t)planes[ch * frame_count + i]);
+        }
+    }
+    wav->num_frames += frame_count;
+}
+
+void wav_file_close(wav_file_t *wav)
+{
+    if (wav->fp == NULL) {
+        return;
+    }
+
+    if (wav->writing) {
+        const uint32_t data_bytes = wav->num_frames * wav->num_channels * 4;
+        fseek(wav->fp, 0, SEEK_SET);
+        fwrite("RIFF", 1, 4, wav->fp);
+        write_u32(wav->fp, 36 + data_bytes);
+        fwrite("WAVEfmt ", 1, 8, wav->fp);
+        write_u32(wav->fp, 16);
+        write_u16(wav->fp, WAV_FORMAT_PCM);
+        write_u16(wav->fp, wav->num_channels);
+        write_u32(wav->fp, wav->sample_rate);
+        write_u32(wav->fp, wav->sample_rate * wav->num_channels * 4);
+        write_u16(wav->fp, wav->num_channels * 4);
+        write_u16(wav->fp, 32);
+        fwrite("data", 1, 4, wav->fp);
+        write_u32(wav->fp, data_bytes);
+    }
+    fclose(wav->fp);
+    wav->fp = NULL;
+}
@@ -0,0 +1,48 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef WAV_FILE_H_
+#define WAV_FILE_H_
+
+/* STD headers */
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    FILE *fp;
+    int num_channels;
+    int sample_rate;
+    int bit_depth;
+    long num_frames;    /* Sample frames in the file, one sample per channel */
+    long data_start;
+    int writing;
+} wav_file_t;
+
+/**
+ * Opens a PCM WAV file for reading. 16 and 32 bit files are supported.
+ *
+ * \returns 0 on success, -1 if the file cannot be opened or is not a
+ *          supported PCM WAV file.
+ */
+int wav_file_open_read(wav_file_t *wav, const char *path);
+
+/**
+ * Reads up to frame_count sample frames and deinterleaves them, left
+ * justified to 32 bits, into channel planes of frame_count samples each.
+ *
+ * \returns the number of sample frames read. Missing samples are zeroed.
+ */
+size_t wav_file_read_planes(wav_file_t *wav, int32_t *planes, size_t frame_count);
+
+/**
+ * Creates a 32 bit PCM WAV file for writing. The header is completed by
+ * wav_file_close().
+ */
+int wav_file_open_write(wav_file_t *wav, const char *path, int num_channels, int sample_rate);
+
+/** Interleaves and writes frame_count sample frames from channel planes */
+void wav_file_write_planes(wav_file_t *wav, const int32_t *planes, size_t frame_count);
+
+void wav_file_close(wav_file_t *wav);
+
+#endif /* WAV_FILE_H_ */
@@ -0,0 +1,23 @@
+
+set(CMAKE_OSX_ARCHITECTURES "" CACHE INTERNAL "")
+
+add_executable(test_spsc_ring
+    ${CMAKE_CURRENT_LIST_DIR}/src/main.c
+)
+
+target_link_libraries(test_spsc_ring PRIVATE spsc_ring)
+
+if(${CMAKE_SYSTEM_NAME} STREQUAL XCORE_XS3A)
+    target_compile_options(test_spsc_ring
+        PRIVATE "-target=XCORE-AI-EXPLORER")
+
+    target_link_options(test_spsc_ring
+        PRIVATE
+            "-target=XCORE-AI-EXPLORER"
+            "-report")
+else()
+    find_package(Threads REQUIRED)
+    target_link_libraries(test_spsc_ring
+        PRIVATE Threads::Threads)
+    target_compile_definitions(test_spsc_ring PRIVATE X86_BUILD=1)
+endif()
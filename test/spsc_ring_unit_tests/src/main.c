@@ -0,0 +1,349 @@
+// Copyright 2024 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if !X86_BUILD
+    #include <platform.h>
+    #include <xs1.h>
+    #include <xcore/assert.h>
+#else
+    #include <assert.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #define xassert assert
+#endif
+#include "spsc_ring.h"
+
+#define TEST_CAPACITY   64
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL, %s() line %d: ", __func__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            fflush(stdout); \
+            xassert(0); \
+        } \
+    } while (0)
+
+static uint32_t rand_next(uint32_t *seed)
+{
+    // xorshift32
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+void test_pow2_ceil(void)
+{
+    CHECK(SPSC_RING_POW2_CEIL(1) == 1, "1");
+    CHECK(SPSC_RING_POW2_CEIL(2) == 2, "2");
+    CHECK(SPSC_RING_POW2_CEIL(3) == 4, "3");
+    CHECK(SPSC_RING_POW2_CEIL(240) == 256, "240");
+    CHECK(SPSC_RING_POW2_CEIL(4800) == 8192, "4800");
+    CHECK(SPSC_RING_POW2_CEIL(8192) == 8192, "8192");
+    CHECK(SPSC_RING_POW2_CEIL(0x80000000u) == 0x80000000u, "2^31");
+}
+
+void test_init_is_empty(void)
+{
+    int16_t storage[TEST_CAPACITY];
+    spsc_ring_t ring;
+    uint32_t n;
+
+    spsc_ring_init(&ring, storage, sizeof(storage[0]), TEST_CAPACITY);
+
+    CHECK(spsc_ring_count(&ring) == 0, "count %lu", (unsigned long)spsc_ring_count(&ring));
+    CHECK(spsc_ring_space(&ring) == TEST_CAPACITY, "space %lu", (unsigned long)spsc_ring_space(&ring));
+    CHECK(spsc_ring_peek(&ring, &n) == storage && n == 0, "peek %lu", (unsigned long)n);
+    CHECK(spsc_ring_write_region(&ring, &n) == storage && n == TEST_CAPACITY, "write region %lu", (unsigned long)n);
+    CHECK(spsc_ring_read(&ring, storage, 1) == 0, "read from empty ring");
+}
+
+void test_full_and_empty(void)
+{
+    int16_t storage[TEST_CAPACITY];
+    int16_t data[TEST_CAPACITY + 1];
+    spsc_ring_t ring;
+
+    for (int i = 0; i < TEST_CAPACITY + 1; i++) {
+        data[i] = i;
+    }
+
+    spsc_ring_init(&ring, storage, sizeof(storage[0]), TEST_CAPACITY);
+
+    // A write that does not fit is truncated to the space available
+    CHECK(spsc_ring_write(&ring, data, TEST_CAPACITY + 1) == TEST_CAPACITY, "write");
+    CHECK(spsc_ring_count(&ring) == TEST_CAPACITY, "count %lu", (unsigned long)spsc_ring_count(&ring));
+    CHECK(spsc_ring_space(&ring) == 0, "space %lu", (unsigned long)spsc_ring_space(&ring));
+    CHECK(spsc_ring_write(&ring, data, 1) == 0, "write to full ring");
+
+    memset(data, 0, sizeof(data));
+    CHECK(spsc_ring_read(&ring, data, TEST_CAPACITY + 1) == TEST_CAPACITY, "read");
+    for (int i = 0; i < TEST_CAPACITY; i++) {
+        CHECK(data[i] == i, "data[%d] = %d", i, data[i]);
+    }
+    CHECK(spsc_ring_count(&ring) == 0, "count %lu", (unsigned long)spsc_ring_count(&ring));
+
+    spsc_ring_write(&ring, data, 5);
+    spsc_ring_reset(&ring);
+    CHECK(spsc_ring_count(&ring) == 0, "count after reset %lu", (unsigned long)spsc_ring_count(&ring));
+}
+
+void test_regions_stop_at_end_of_storage(void)
+{
+    int32_t storage[TEST_CAPACITY];
+    int32_t data[TEST_CAPACITY];
+    spsc_ring_t ring;
+    uint32_t n;
+
+    for (int i = 0; i < TEST_CAPACITY; i++) {
+        data[i] = 1000 + i;
+    }
+
+    spsc_ring_init(&ring, storage, sizeof(storage[0]), TEST_CAPACITY);
+
+    // Leave the indices 10 elements before the end of the storage
+    spsc_ring_write(&ring, data, TEST_CAPACITY - 10);
+    spsc_ring_read(&ring, data, TEST_CAPACITY - 10);
+    for (int i = 0; i < TEST_CAPACITY; i++) {
+        data[i] = 1000 + i;
+    }
+
+    int32_t *w = spsc_ring_write_region(&ring, &n);
+    CHECK(w == &storage[TEST_CAPACITY - 10] && n == 10, "first write region %lu", (unsigned long)n);
+    memcpy(w, data, n * sizeof(int32_t));
+
+    // Nothing is visible to the consumer before the commit
+    spsc_ring_peek(&ring, &n);
+    CHECK(n == 0, "peek before commit %lu", (unsigned long)n);
+    spsc_ring_write_commit(&ring, 10);
+
+    w = spsc_ring_write_region(&ring, &n);
+    CHECK(w == &storage[0] && n == TEST_CAPACITY - 10, "second write region %lu", (unsigned long)n);
+    memcpy(w, &data[10], 20 * sizeof(int32_t));
+    spsc_ring_write_commit(&ring, 20);
+
+    const int32_t *r = spsc_ring_peek(&ring, &n);
+    CHECK(r == &storage[TEST_CAPACITY - 10] && n == 10, "first peek %lu", (unsigned long)n);
+    for (uint32_t i = 0; i < n; i++) {
+        CHECK(r[i] == 1000 + (int32_t)i, "r[%lu] = %ld", (unsigned long)i, (long)r[i]);
+    }
+    spsc_ring_read_commit(&ring, 4);
+
+    r = spsc_ring_peek(&ring, &n);
+    CHECK(r == &storage[TEST_CAPACITY - 6] && n == 6, "partial commit peek %lu", (unsigned long)n);
+    spsc_ring_read_commit(&ring, n);
+
+    r = spsc_ring_peek(&ring, &n);
+    CHECK(r == &storage[0] && n == 20, "second peek %lu", (unsigned long)n);
+    for (uint32_t i = 0; i < n; i++) {
+        CHECK(r[i] == 1010 + (int32_t)i, "r[%lu] = %ld", (unsigned long)i, (long)r[i]);
+    }
+}
+
+void test_elements_wider_than_a_word(void)
+{
+    typedef struct {
+        int16_t ch[3];
+    } frame_t;
+    frame_t storage[8];
+    frame_t in[5];
+    frame_t out[5];
+    spsc_ring_t ring;
+
+    spsc_ring_init(&ring, storage, sizeof(frame_t), 8);
+
+    for (int pass = 0; pass < 4; pass++) {
+        for (int i = 0; i < 5; i++) {
+            in[i].ch[0] = pass;
+            in[i].ch[1] = i;
+            in[i].ch[2] = -i;
+        }
+        CHECK(spsc_ring_write(&ring, in, 5) == 5, "write pass %d", pass);
+        CHECK(spsc_ring_read(&ring, out, 5) == 5, "read pass %d", pass);
+        CHECK(memcmp(in, out, sizeof(in)) == 0, "data pass %d", pass);
+    }
+}
+
+/*
+ * Random interleaving of a producer and a consumer, checked against a
+ * running sequence number. The indices start just short of 2^32 so they
+ * overflow part way through.
+ */
+void test_random_interleave(unsigned seed, bool verbose)
+{
+    uint16_t storage[TEST_CAPACITY];
+    uint16_t block[TEST_CAPACITY + 8];
+    spsc_ring_t ring;
+    uint16_t next_in = 0;
+    uint16_t next_out = 0;
+
+    spsc_ring_init(&ring, storage, sizeof(storage[0]), TEST_CAPACITY);
+    ring.head = ring.tail = 0xFFFFFF00;
+
+    for (int itt = 0; itt < (1 << 14); itt++) {
+        uint32_t r = rand_next(&seed);
+        uint32_t len = (r >> 8) % (TEST_CAPACITY + 8);
+        uint32_t count_before = spsc_ring_count(&ring);
+
+        CHECK(count_before <= TEST_CAPACITY, "itt %d: count %lu", itt, (unsigned long)count_before);
+
+        switch (r & 3) {
+        case 0: {
+            for (uint32_t i = 0; i < len; i++) {
+                block[i] = next_in + i;
+            }
+            uint32_t n = spsc_ring_write(&ring, block, len);
+            uint32_t expected = (len < TEST_CAPACITY - count_before) ? len : TEST_CAPACITY - count_before;
+            CHECK(n == expected, "itt %d: wrote %lu expected %lu", itt, (unsigned long)n, (unsigned long)expected);
+            next_in += n;
+            break;
+        }
+        case 1: {
+            uint32_t n = spsc_ring_read(&ring, block, len);
+            uint32_t expected = (len < count_before) ? len : count_before;
+            CHECK(n == expected, "itt %d: read %lu expected %lu", itt, (unsigned long)n, (unsigned long)expected);
+            for (uint32_t i = 0; i < n; i++) {
+                CHECK(block[i] == next_out, "itt %d: got %u expected %u", itt, block[i], next_out);
+                next_out++;
+            }
+            break;
+        }
+        case 2: {
+            uint32_t n;
+            uint16_t *w = spsc_ring_write_region(&ring, &n);
+            if (n > len) {
+                n = len;
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                w[i] = next_in++;
+            }
+            spsc_ring_write_commit(&ring, n);
+            break;
+        }
+        default: {
+            uint32_t n;
+            const uint16_t *p = spsc_ring_peek(&ring, &n);
+            if (n > len) {
+                n = len;
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                CHECK(p[i] == next_out, "itt %d: peeked %u expected %u", itt, p[i], next_out);
+                next_out++;
+            }
+            spsc_ring_read_commit(&ring, n);
+            break;
+        }
+        }
+
+        CHECK(spsc_ring_count(&ring) == (uint16_t)(next_in - next_out),
+              "itt %d: count %lu expected %u", itt, (unsigned long)spsc_ring_count(&ring), (uint16_t)(next_in - next_out));
+
+        if (verbose) {
+            printf("itt %d: op %lu len %lu count %lu head 0x%08lx\n", itt, (unsigned long)(r & 3),
+                   (unsigned long)len, (unsigned long)spsc_ring_count(&ring), (unsigned long)ring.head);
+        }
+    }
+}
+
+#if X86_BUILD
+#define THREAD_TEST_SAMPLES (1 << 20)
+
+static spsc_ring_t thread_ring;
+static uint32_t thread_storage[256];
+
+static void *producer_thread(void *arg)
+{
+    uint32_t seed = *(uint32_t *)arg;
+    uint32_t next = 0;
+
+    while (next < THREAD_TEST_SAMPLES) {
+        uint32_t n;
+        uint32_t *w = spsc_ring_write_region(&thread_ring, &n);
+        uint32_t len = 1 + rand_next(&seed) % 64;
+
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        if (n > len) {
+            n = len;
+        }
+        if (n > THREAD_TEST_SAMPLES - next) {
+            n = THREAD_TEST_SAMPLES - next;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            w[i] = next++;
+        }
+        spsc_ring_write_commit(&thread_ring, n);
+    }
+    return NULL;
+}
+
+/*
+ * A producer and a consumer on their own threads. Any element seen before
+ * it was published shows up as a break in the sequence.
+ */
+void test_threads(unsigned seed)
+{
+    pthread_t producer;
+    uint32_t expected = 0;
+
+    spsc_ring_init(&thread_ring, thread_storage, sizeof(thread_storage[0]), 256);
+    pthread_create(&producer, NULL, producer_thread, &seed);
+
+    while (expected < THREAD_TEST_SAMPLES) {
+        uint32_t n;
+        const uint32_t *p = spsc_ring_peek(&thread_ring, &n);
+
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            CHECK(p[i] == expected, "got %lu expected %lu", (unsigned long)p[i], (unsigned long)expected);
+            expected++;
+        }
+        spsc_ring_read_commit(&thread_ring, n);
+    }
+
+    pthread_join(producer, NULL);
+    CHECK(spsc_ring_count(&thread_ring) == 0, "count %lu", (unsigned long)spsc_ring_count(&thread_ring));
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    unsigned seed = 123450;
+
+    bool verbose = false;
+
+    test_pow2_ceil();
+
+    test_init_is_empty();
+
+    test_full_and_empty();
+
+    test_regions_stop_at_end_of_storage();
+
+    test_elements_wider_than_a_word();
+
+    test_random_interleave(seed, verbose);
+
+#if X86_BUILD
+    test_threads(seed);
+#endif
+
+    printf("PASS\n");
+
+    return 0;
+}